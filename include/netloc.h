@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
 #ifdef __cplusplus
@@ -194,6 +195,26 @@ static inline char * netloc_decode_node_type_readable(netloc_node_type_t node_ty
     }
 }
 
+/**
+ * Flags to be given as a OR'ed set to \ref netloc_get_paths
+ */
+typedef enum {
+    NETLOC_PATHS_FLAG_EQUAL_COST = (1 << 0)  /**< Only the paths as short as the shortest one */
+} netloc_paths_flag_t;
+
+/**
+ * Flags to be given as a OR'ed set to \ref netloc_get_distance_matrix
+ */
+typedef enum {
+    NETLOC_DISTANCE_FLAG_CACHE = (1 << 0)  /**< Load the matrix from (or store it to) a file next to the network data */
+} netloc_distance_flag_t;
+
+/**
+ * Distance between two hosts that are not connected, in the matrix
+ * returned by \ref netloc_get_distance_matrix
+ */
+#define NETLOC_DISTANCE_UNREACHABLE UINT16_MAX
+
 /**
  * Return codes
  */
@@ -330,6 +351,8 @@ struct netloc_edge_t {
     char *      speed;
     /** Metadata: Width */
     char *      width;
+    /** Metadata: Data rate in Mbit/s parsed from the speed and width (0 if unknown) */
+    unsigned long bandwidth;
 
     /** Description information from discovery (if any) */
     char * description;
@@ -388,12 +411,13 @@ struct netloc_node_t {
     /** Edge IDs (Internal use only) */
     int *edge_ids;
 
-    /** Number of physical paths computed from this node */
+    /** Number of physical paths computed from this node
+     *  (loaded with the paths, on the first \ref netloc_get_path from this node) */
     int num_phy_paths;
     /** Lookup table for physical paths from this node */
     netloc_dt_lookup_table_t physical_paths;
 
-    /** Number of logical paths computed from this node */
+    /** Number of logical paths computed from this node (loaded as num_phy_paths) */
     int num_log_paths;
     /** Lookup table for logical paths from this node */
     netloc_dt_lookup_table_t logical_paths;
@@ -712,11 +736,36 @@ NETLOC_DECLSPEC int netloc_foreach_network(const char * const * search_uris,
  */
 NETLOC_DECLSPEC int netloc_attach(netloc_topology_t * topology, netloc_network_t network);
 
+/**
+ * Attach to the specified network, read-only, through its binary topology cache.
+ *
+ * The binary topology cache (see \ref netloc_topology_export_binary) is mapped
+ * in memory. The strings of the nodes and edges, and the paths, are served from
+ * that mapping instead of being copied, so that all of the processes attached
+ * to the network on a host share one copy of the data in the page cache.
+ * Attaching only maps the file, the data is decoded on first access.
+ *
+ * The strings of the nodes and edges must not be modified or freed.
+ *
+ * User is responsible for calling \ref netloc_detach on the topology handle.
+ *
+ * \param topology A pointer to a netloc_topology_t handle.
+ * \param network The \ref netloc_network_t handle from a prior call to either:
+ *                - \ref netloc_find_network()
+ *                - \ref netloc_foreach_network()
+ *
+ * \returns NETLOC_SUCCESS on success
+ * \returns NETLOC_ERROR_NOENT if the network has no up-to-date binary topology cache
+ *          (use \ref netloc_attach instead)
+ * \returns NETLOC_ERROR upon an error.
+ */
+NETLOC_DECLSPEC int netloc_attach_mapped(netloc_topology_t * topology, netloc_network_t network);
+
 /**
  * Detach from a topology handle
  *
  * \param topology A valid pointer to a \ref netloc_topology_t handle created
- * from a prior call to \ref netloc_attach.
+ * from a prior call to \ref netloc_attach or \ref netloc_attach_mapped.
  *
  * \returns NETLOC_SUCCESS on success
  * \returns NETLOC_ERROR upon an error.
@@ -838,10 +887,37 @@ NETLOC_DECLSPEC int netloc_get_all_edges(netloc_topology_t topology,
  */
 NETLOC_DECLSPEC netloc_node_t * netloc_get_node_by_physical_id(netloc_topology_t topology, const char * phy_id);
 
+/**
+ * Access the \ref netloc_node_t pointer given the integer encoding of a physical
+ * identifier (e.g., a GUID as a 64 bit integer), without any string conversion.
+ *
+ * The user should -not- call the destructor on the returned value.
+ *
+ * \param topology A valid pointer to a topology handle
+ * \param phy_id_int The integer physical identifier to search for
+ *                   (see \ref netloc_node_t::physical_id_int)
+ *
+ * \returns A pointer to the \ref netloc_node_t with the specified physical identifier
+ * \returns NULL if the phy_id_int is not found.
+ */
+NETLOC_DECLSPEC netloc_node_t * netloc_get_node_by_physical_id_int(netloc_topology_t topology, unsigned long phy_id_int);
+
 /**
  * Get the "path" from the source to the destination as an ordered array of \ref netloc_edge_t objects
  *
- * The user is responsible for calling free() on the allocated array, but -not- the elements in the array.
+ * The array belongs to the topology: the user should -not- call free() on the
+ * array, nor on the elements in the array.
+ *
+ * The array stays valid until the topology is detached.
+ *
+ * When the network stores the forwarding tables of its switches instead of
+ * every logical path, logical paths are expanded from the tables on request.
+ * Every path returned this way is kept on the topology until it is detached:
+ * to go through many pairs of nodes in bounded memory, use
+ * \ref netloc_get_path_copy instead.
+ *
+ * The paths from a node are read from the network files on the first call
+ * with that node as the source.
  *
  * \warning A large API change is in the works for v1.0 that will change how we represent path data.
  *
@@ -853,6 +929,7 @@ NETLOC_DECLSPEC netloc_node_t * netloc_get_node_by_physical_id(netloc_topology_t
  * \param is_logical If the path should represent the logical or the physical path information.
  *
  * \returns NETLOC_SUCCESS on success
+ * \returns NETLOC_ERROR_NOT_FOUND if there is no path information between the nodes
  * \returns NETLOC_ERROR upon an error.
  */
 NETLOC_DECLSPEC int netloc_get_path(const netloc_topology_t topology,
@@ -862,6 +939,130 @@ NETLOC_DECLSPEC int netloc_get_path(const netloc_topology_t topology,
                                     netloc_edge_t ***path,
                                     bool is_logical);
 
+/**
+ * Get a copy of the "path" from the source to the destination as an ordered array of \ref netloc_edge_t objects
+ *
+ * Same as \ref netloc_get_path, except that the array belongs to the user,
+ * who is responsible for calling free() on it (but not on the elements in
+ * the array).
+ *
+ * The logical paths expanded from forwarding tables are only kept in a
+ * cache of recently used paths, so that requesting the paths of every pair
+ * of nodes does not keep them all in memory.
+ *
+ * \param topology A valid pointer to a topology handle
+ * \param src_node A valid pointer to the source node
+ * \param dst_node A valid pointer to the destination node
+ * \param num_edges The number of edges in the path array.
+ * \param path An ordered array of \ref netloc_edge_t objects from the source to the destination
+ * \param is_logical If the path should represent the logical or the physical path information.
+ *
+ * \returns NETLOC_SUCCESS on success
+ * \returns NETLOC_ERROR_NOT_FOUND if there is no path information between the nodes
+ * \returns NETLOC_ERROR upon an error.
+ */
+NETLOC_DECLSPEC int netloc_get_path_copy(const netloc_topology_t topology,
+                                         netloc_node_t *src_node,
+                                         netloc_node_t *dst_node,
+                                         int *num_edges,
+                                         netloc_edge_t ***path,
+                                         bool is_logical);
+
+/**
+ * Enumerate several short paths from the source to the destination
+ *
+ * The paths are searched in the physical graph of the topology (the edges
+ * of every node), where the length of a path is the sum of the weights of
+ * its edges (one per hop without a weight function). By default the
+ * max_paths shortest loop-free paths are returned, shortest first (Yen's
+ * algorithm). With \ref NETLOC_PATHS_FLAG_EQUAL_COST only the paths as
+ * short as the shortest one are returned (e.g., the equal-cost routes of a
+ * fat-tree), and a max_paths of 0 returns all of them.
+ *
+ * To avoid one allocation per path, every path is given as a run of edge
+ * UIDs in the edge_uids array: path i is made of the edges
+ * edge_uids[path_offsets[i]] to edge_uids[path_offsets[i+1] - 1], from the
+ * source to the destination (see \ref netloc_get_edge_by_uid). The user
+ * is responsible for calling free() on both arrays.
+ *
+ * \param topology A valid pointer to a topology handle
+ * \param src_node A valid pointer to the source node
+ * \param dest_node A valid pointer to the destination node
+ * \param max_paths The maximum number of paths to return
+ * \param flags A OR'ed set of \ref netloc_paths_flag_t
+ * \param weight The weight of an edge (see netloc_dc_path_weight_fn_t in
+ *               netloc_dc.h, e.g., netloc_dc_path_weight_bandwidth), or NULL
+ *               to count hops
+ * \param num_paths The number of paths returned
+ * \param path_offsets Start of each path in edge_uids (num_paths + 1 entries)
+ * \param edge_uids The edge UIDs of all the paths
+ *
+ * \returns NETLOC_SUCCESS on success
+ * \returns NETLOC_ERROR_NOT_FOUND if there is no path between the nodes
+ * \returns NETLOC_ERROR upon an error.
+ */
+NETLOC_DECLSPEC int netloc_get_paths(netloc_topology_t topology,
+                                     netloc_node_t *src_node,
+                                     netloc_node_t *dest_node,
+                                     int max_paths,
+                                     unsigned long flags,
+                                     int (*weight)(netloc_edge_t *edge),
+                                     int *num_paths,
+                                     int **path_offsets,
+                                     int **edge_uids);
+
+/**
+ * Access the \ref netloc_edge_t pointer given its unique edge identifier
+ *
+ * The user should -not- call the destructor on the returned value.
+ *
+ * \param topology A valid pointer to a topology handle
+ * \param edge_uid The edge UID (see \ref netloc_edge_t::edge_uid)
+ *
+ * \returns A pointer to the \ref netloc_edge_t with the specified UID
+ * \returns NULL if the edge_uid is not found.
+ */
+NETLOC_DECLSPEC netloc_edge_t * netloc_get_edge_by_uid(netloc_topology_t topology, int edge_uid);
+
+/**
+ * Get the number of hops between every pair of hosts
+ *
+ * The distances follow the physical graph of the topology (the edges of
+ * every node), with one breadth first search per host spread over
+ * num_threads threads. This is much cheaper than counting the edges of
+ * \ref netloc_get_path for every pair.
+ *
+ * The matrix is a dense num_hosts x num_hosts array in row major order:
+ * distances[i * num_hosts + j] is the number of hops from hosts[i] to
+ * hosts[j] (\ref NETLOC_DISTANCE_UNREACHABLE if there is no path). The
+ * hosts are sorted by physical ID.
+ *
+ * With \ref NETLOC_DISTANCE_FLAG_CACHE the matrix is read from a file next
+ * to the network data if that file was computed from the data as it is now
+ * (same size and modification time of every file), and written there
+ * otherwise (if possible), so that later calls only read it.
+ *
+ * The user is responsible for calling free() on the hosts and distances
+ * arrays (but not on the hosts themselves).
+ *
+ * \param topology A valid pointer to a topology handle
+ * \param num_threads Number of threads to use (1 computes the matrix in the calling thread)
+ * \param flags A OR'ed set of \ref netloc_distance_flag_t
+ * \param num_hosts The number of hosts
+ * \param hosts The hosts, in the order of the rows and columns of the matrix
+ * \param distances The distance matrix
+ *
+ * \returns NETLOC_SUCCESS on success
+ * \returns NETLOC_ERROR_NOT_FOUND if the topology has no hosts
+ * \returns NETLOC_ERROR upon an error.
+ */
+NETLOC_DECLSPEC int netloc_get_distance_matrix(netloc_topology_t topology,
+                                               int num_threads,
+                                               unsigned long flags,
+                                               int *num_hosts,
+                                               netloc_node_t ***hosts,
+                                               uint16_t **distances);
+
 
 /**********************************************************************
  * Export API Functions
@@ -888,6 +1089,21 @@ NETLOC_DECLSPEC int netloc_topology_export_graphml(netloc_topology_t topology, c
  */
 NETLOC_DECLSPEC int netloc_topology_export_gexf(netloc_topology_t topology, const char * filename);
 
+/**
+ * Exports the network topology to a binary topology cache file.
+ *
+ * When the cache file sits next to the network's JSON (.ndat) files and is
+ * at least as recent as them, it is loaded in place of the JSON files.
+ *
+ * \param topology A valid pointer to a topology handle
+ * \param filename The filename to write the data to. If NULL, the cache file
+ *                 is written next to the JSON files of the network.
+ *
+ * \returns NETLOC_SUCCESS on success
+ * \returns NETLOC_ERROR upon an error.
+ */
+NETLOC_DECLSPEC int netloc_topology_export_binary(netloc_topology_t topology, const char * filename);
+
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -42,6 +42,15 @@
  * Enumerated types
  **********************************************************************/
 
+/**
+ * \brief Path weight function
+ *
+ * Returns the cost (at least 1) of using an edge in a path. The pathfinder
+ * picks the paths of least total cost. It may be called from several
+ * threads at once by \ref netloc_dc_compute_all_paths.
+ */
+typedef int (*netloc_dc_path_weight_fn_t)(netloc_edge_t *edge);
+
 /**********************************************************************
  *        Structures
  **********************************************************************/
@@ -74,6 +83,9 @@ struct netloc_data_collection_handle_t {
     /** Filename: Logical Paths */
     char * filename_logical_paths;
 
+    /** Filename: Binary topology cache */
+    char * filename_binary;
+
     /** Lookup table for all node information */
     netloc_dt_lookup_table_t node_list;
 
@@ -95,6 +107,21 @@ struct netloc_data_collection_handle_t {
     json_t *phy_path_data;
     /** (Internal Use only) Accumulation object */
     json_t *phy_path_data_acc;
+
+    /** (Internal Use only) Forwarding tables stored by
+     *  \ref netloc_dc_append_forwarding_entry, stored with the logical paths */
+    json_t *forwarding_data;
+
+    /** (Internal Use only) Shortest path trees stored by
+     *  \ref netloc_dc_compute_all_paths, keyed by source physical ID */
+    netloc_dt_lookup_table_t path_trees;
+
+    /** (Internal Use only) Pathfinder scratch space, reused across
+     *  path computations (\ref netloc_dc_compute_path_between_nodes) */
+    struct netloc_dc_pathfinder_t *pathfinder;
+
+    /** Edge weight used by the pathfinder (\ref netloc_dc_set_path_weight) */
+    netloc_dc_path_weight_fn_t path_weight;
 };
 typedef struct netloc_data_collection_handle_t netloc_data_collection_handle_t;
 
@@ -143,6 +170,8 @@ NETLOC_DECLSPEC netloc_data_collection_handle_t * netloc_dc_create(netloc_networ
 /**
  * Close a data collection handle
  * This may write out data if the handle was created in \ref netloc_dc_create.
+ * Along with the .ndat JSON files, a binary topology cache is written
+ * (see \ref netloc_topology_export_binary).
  *
  * The user is responsible for calling \ref netloc_dt_data_collection_handle_t_destruct on
  * the handle when finished with it. The close function does not destruct the handle.
@@ -269,6 +298,80 @@ NETLOC_DECLSPEC int netloc_dc_append_path(netloc_data_collection_handle_t *handl
                                           int num_edges, netloc_edge_t **edges,
                                           bool is_logical);
 
+/**
+ * Append an entry to the forwarding table of a node (switch): traffic to the
+ * destination logical ID leaves the node through the given edge.
+ *
+ * The forwarding tables are stored in place of the logical paths, which
+ * \ref netloc_get_path expands from them on request. Logical paths appended
+ * with \ref netloc_dc_append_path take precedence over the tables.
+ *
+ * \param handle A valid pointer to a data collection handle
+ * \param node_id Physical node id of the switch
+ * \param dest_logical_id Logical id of the destination (e.g., a LID)
+ * \param edge The outgoing edge of the switch towards the destination
+ *
+ * \returns NETLOC_SUCCESS upon success
+ * \returns NETLOC_ERROR_NOT_FOUND if the node is not in the data collection
+ * \returns NETLOC_ERROR otherwise
+ */
+NETLOC_DECLSPEC int netloc_dc_append_forwarding_entry(netloc_data_collection_handle_t *handle,
+                                                      const char * node_id,
+                                                      const char * dest_logical_id,
+                                                      netloc_edge_t *edge);
+
+/**
+ * Weight every edge as one hop (the default)
+ *
+ * \param edge The edge to weigh
+ *
+ * \returns 1
+ */
+NETLOC_DECLSPEC int netloc_dc_path_weight_hops(netloc_edge_t *edge);
+
+/**
+ * Weight an edge by the inverse of its data rate
+ *
+ * A 1 Tbit/s edge costs 1, a 4x QDR InfiniBand link (32 Gbit/s) costs 32
+ * and a 4x SDR link (8 Gbit/s) costs 125. Edges of unknown rate cost as
+ * much as a 1 Gbit/s edge, so that they are avoided.
+ *
+ * \param edge The edge to weigh
+ *
+ * \returns The cost of the edge
+ */
+NETLOC_DECLSPEC int netloc_dc_path_weight_bandwidth(netloc_edge_t *edge);
+
+/**
+ * Weight an edge by an estimate of its latency in nanoseconds
+ *
+ * The estimate is the time for a switch to forward a packet plus the time
+ * to serialize a 4 KiB packet at the data rate of the edge (unknown rates
+ * count as 1 Gbit/s).
+ *
+ * \param edge The edge to weigh
+ *
+ * \returns The cost of the edge
+ */
+NETLOC_DECLSPEC int netloc_dc_path_weight_latency(netloc_edge_t *edge);
+
+/**
+ * Set the weight function used by the pathfinder
+ *
+ * Applies to the paths computed from then on, by
+ * \ref netloc_dc_compute_path_between_nodes,
+ * \ref netloc_dc_compute_paths_from_node and
+ * \ref netloc_dc_compute_all_paths.
+ *
+ * \param handle A valid pointer to a data collection handle
+ * \param weight The weight function (NULL for \ref netloc_dc_path_weight_hops)
+ *
+ * \returns NETLOC_SUCCESS upon success
+ * \returns NETLOC_ERROR otherwise
+ */
+NETLOC_DECLSPEC int netloc_dc_set_path_weight(netloc_data_collection_handle_t *handle,
+                                              netloc_dc_path_weight_fn_t weight);
+
 /**
  * Compute the path between two nodes
  *
@@ -283,6 +386,7 @@ NETLOC_DECLSPEC int netloc_dc_append_path(netloc_data_collection_handle_t *handl
  *
  * \returns NETLOC_SUCCESS upon success
  * \returns NETLOC_ERROR_NOT_IMPL if is_logical is true
+ * \returns NETLOC_ERROR_NOT_FOUND if there is no path between the nodes
  * \returns NETLOC_ERROR otherwise
  */
 NETLOC_DECLSPEC int netloc_dc_compute_path_between_nodes(netloc_data_collection_handle_t *handle,
@@ -292,6 +396,101 @@ NETLOC_DECLSPEC int netloc_dc_compute_path_between_nodes(netloc_data_collection_
                                                          netloc_edge_t ***edges,
                                                          bool is_logical);
 
+/**
+ * Compute the paths from one node to a set of destination nodes
+ *
+ * A single shortest path tree is built from the source, and every path is
+ * read off of it. This is much cheaper than calling
+ * \ref netloc_dc_compute_path_between_nodes once per destination.
+ *
+ * The caller provides the num_edges and edges arrays (num_dest_nodes
+ * elements each). On return edges[i] is an ordered list of edges from the
+ * source node to dest_nodes[i], that the caller is responsible for freeing
+ * (the edges themselves must not be freed). A destination that cannot be
+ * reached from the source, or that is the source itself, gets zero edges
+ * and a NULL array.
+ *
+ * \warning Logical paths is known not to be fully implemented/tested.
+ *
+ * \param handle A valid point to a data collection handle
+ * \param src_node A reference to the source node to compute the paths from
+ * \param num_dest_nodes The number of elements in the dest_nodes array
+ * \param dest_nodes The destination nodes to compute the paths to
+ * \param num_edges The number of edges of each path
+ * \param edges The path (ordered list of edges) to each destination node
+ * \param is_logical If the paths are logical or physical paths
+ *
+ * \returns NETLOC_SUCCESS upon success
+ * \returns NETLOC_ERROR_NOT_IMPL if is_logical is true
+ * \returns NETLOC_ERROR otherwise
+ */
+NETLOC_DECLSPEC int netloc_dc_compute_paths_from_node(netloc_data_collection_handle_t *handle,
+                                                      netloc_node_t *src_node,
+                                                      int num_dest_nodes,
+                                                      netloc_node_t **dest_nodes,
+                                                      int *num_edges,
+                                                      netloc_edge_t ***edges,
+                                                      bool is_logical);
+
+
+/**
+ * Compute the paths from every source node to every destination node, and
+ * add them to the data collection.
+ *
+ * Instead of one edge list per path (as \ref netloc_dc_append_path
+ * stores), the shortest path tree of each source is kept on the handle, and
+ * the paths are only rebuilt from it when \ref netloc_dc_close writes them
+ * out. This takes memory in the order of sources times nodes rather than
+ * sources times destinations times hops.
+ *
+ * The sources are spread over num_threads threads, each running its own
+ * shortest path searches. The trees are stored by the calling thread, so
+ * the result does not depend on the number of threads. Paths from a node
+ * to itself are skipped, and destinations that cannot be reached only get
+ * a warning. Computing the paths of a source again replaces its tree.
+ *
+ * The node list of the handle must not be modified while this runs, and
+ * nodes must not be removed from it afterwards.
+ *
+ * \warning Logical paths is known not to be fully implemented/tested.
+ *
+ * \param handle A valid point to a data collection handle
+ * \param num_src_nodes The number of elements in the src_nodes array
+ * \param src_nodes The source nodes to compute the paths from
+ * \param num_dest_nodes The number of elements in the dest_nodes array
+ * \param dest_nodes The destination nodes to compute the paths to
+ * \param num_threads Number of threads to use (1 computes the paths in the calling thread)
+ * \param is_logical If the paths are logical or physical paths
+ *
+ * \returns NETLOC_SUCCESS upon success
+ * \returns NETLOC_ERROR_NOT_IMPL if is_logical is true
+ * \returns NETLOC_ERROR otherwise
+ */
+NETLOC_DECLSPEC int netloc_dc_compute_all_paths(netloc_data_collection_handle_t *handle,
+                                                int num_src_nodes,
+                                                netloc_node_t **src_nodes,
+                                                int num_dest_nodes,
+                                                netloc_node_t **dest_nodes,
+                                                int num_threads,
+                                                bool is_logical);
+
+/**
+ * Compute the physical paths between every pair of host nodes of the data
+ * collection, and add them to it (see \ref netloc_dc_compute_all_paths).
+ *
+ * This is what the readers do once all of the nodes and edges are in. The
+ * weight set by \ref netloc_dc_set_path_weight is used.
+ *
+ * \param handle A valid point to a data collection handle
+ * \param num_threads Number of threads to use (1 computes the paths in the calling thread)
+ * \param progress If the progress should be shown on stdout
+ *
+ * \returns NETLOC_SUCCESS upon success
+ * \returns NETLOC_ERROR otherwise
+ */
+NETLOC_DECLSPEC int netloc_dc_compute_all_host_paths(netloc_data_collection_handle_t *handle,
+                                                     int num_threads,
+                                                     bool progress);
 
 /**
  * Pretty print the data collection to stdout (Debugging Support)
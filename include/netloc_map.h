@@ -88,7 +88,10 @@ NETLOC_DECLSPEC int netloc_map_load_netloc_data(netloc_map_t map, const char *da
  * Flags to be passed as a OR'ed set to the netloc_map_build() function
  */
 enum netloc_map_build_flags_e {
-  NETLOC_MAP_BUILD_FLAG_COMPRESS_HWLOC = (1<<0) /**< Enable hwloc topology compression if supported. \hideinitializer */
+  NETLOC_MAP_BUILD_FLAG_COMPRESS_HWLOC = (1<<0) /**< Enable hwloc topology compression if supported.
+                                                 * Besides the .diff.xml files, the entire topologies of servers
+                                                 * with the same hardware are stored as diffs of one of them.
+                                                 * \hideinitializer */
 };
 
 /**
@@ -97,6 +100,10 @@ enum netloc_map_build_flags_e {
  * Requires the netloc_map_load_hwloc_data() and netloc_map_load_netloc_data()
  * functions have been called on the map object.
  *
+ * The hwloc XML files are parsed by a pool of threads, one per online
+ * processor unless the NETLOC_MAP_THREADS environment variable (read by
+ * netloc_map_create()) says otherwise.
+ *
  * \param map A netloc map.
  * \param flags Any OR'ed set of ::netloc_map_build_flags_e.
  *
@@ -150,6 +157,37 @@ NETLOC_DECLSPEC int netloc_map_hwloc2port(netloc_map_t map,
 					  hwloc_topology_t htopo, hwloc_obj_t hobj,
 					  netloc_map_port_t *ports, unsigned *nrp);
 
+/**
+ * Returns map ports that are close to each of several objects of a hwloc topology.
+ *
+ * Same as netloc_map_hwloc2port() for each object, with a single server lookup.
+ *
+ * \param map A netloc map.
+ *
+ * \param htopo A hwloc topology that was previously returned by netloc.
+ *
+ * \param nr_objs The number of objects.
+ *
+ * \param hobjs The array of \p nr_objs hwloc objects inside the hwloc topology.
+ * A \c NULL entry matches all ports of that map server.
+ *
+ * \param ports The array where the corresponding map ports will be stored.
+ * The caller must preallocate \p nr_objs * \p max_ports slots.
+ * The ports close to \p hobjs[i] are stored from \p ports[i * \p max_ports] on.
+ *
+ * \param max_ports The number of ports that can be stored for each object.
+ *
+ * \param nrs The array of \p nr_objs numbers of ports found for each object.
+ * Like the return value of netloc_map_hwloc2port(), \p nrs[i] may be larger than \p max_ports,
+ * in which case only the first \p max_ports ports close to \p hobjs[i] were stored.
+ *
+ * \returns 0 on success
+ * \return -1 on error
+ */
+NETLOC_DECLSPEC int netloc_map_hwloc2port_many(netloc_map_t map,
+					       hwloc_topology_t htopo, unsigned nr_objs, hwloc_obj_t *hobjs,
+					       netloc_map_port_t *ports, unsigned max_ports, unsigned *nrs);
+
 /**
  * Return the map port corresponding to a network edge and/or node.
  *
@@ -240,6 +278,12 @@ NETLOC_DECLSPEC int netloc_map_hwloc2server(netloc_map_t map, hwloc_topology_t t
  * \param topology A hwloc topology previously obtained with netloc_map_port2hwloc()
  * or netloc_map_server2hwloc().
  *
+ * If the map was built with ::NETLOC_MAP_BUILD_FLAG_COMPRESS_HWLOC, the last
+ * released topologies stay uncompressed until more recently released ones push
+ * them out. The NETLOC_MAP_HWLOC_CACHE environment variable (read by
+ * netloc_map_create()) sets how many are kept, 64 by default, 0 to compress
+ * them as soon as they are released.
+ *
  * \returns 0 on success
  * \return -1 on error
  */
@@ -402,7 +446,8 @@ struct netloc_map_edge_s {
  */
 enum netloc_map_paths_flag_e {
   NETLOC_MAP_PATHS_FLAG_IO = (1UL << 0), /**< Want edges between I/O objects such as PCI NICs and normal hwloc objects */
-  NETLOC_MAP_PATHS_FLAG_VERTICAL = (1UL << 1) /**< Want edges between normal hwloc object child and parent, for instance from a core to a NUMA node */
+  NETLOC_MAP_PATHS_FLAG_VERTICAL = (1UL << 1), /**< Want edges between normal hwloc object child and parent, for instance from a core to a NUMA node */
+  NETLOC_MAP_PATHS_FLAG_MULTIPATH = (1UL << 2) /**< Want one path per equal-cost network path between each pair of ports (see netloc_get_paths()) instead of only the stored path */
 };
 
 /** A netloc map path handle. */
@@ -420,6 +465,13 @@ typedef void * netloc_map_paths_t;
  * \param paths The paths handle returned on success. It must be freed with netloc_map_paths_destroy() after use.
  * \param nr The number of paths contained in the \p paths handle that is returned on success.
  *
+ * \note The network paths between each pair of ports, and the hwloc edges
+ * between an object and each port of its server, are cached in the map
+ * so that later queries reuse them.
+ * The hwloc edges of a server are dropped when its topology is compressed
+ * (see ::NETLOC_MAP_BUILD_FLAG_COMPRESS_HWLOC),
+ * the network paths are kept until the map is destroyed.
+ *
  * \returns 0 on success
  * \returns -1 on error
  */
@@ -431,6 +483,32 @@ NETLOC_DECLSPEC int netloc_map_paths_build(netloc_map_t map,
 					   unsigned long flags,
 					   netloc_map_paths_t *paths, unsigned *nr);
 
+/**
+ * Build the lists of netloc map paths between several pairs of hwloc objects.
+ *
+ * Same as calling netloc_map_paths_build() on each pair,
+ * but the temporary buffers are only allocated once for the whole batch.
+ *
+ * \param map A netloc map.
+ * \param nr_pairs The number of pairs of objects.
+ * \param srctopos The hwloc topologies of the source servers, one per pair.
+ * \param srcobjs The source hwloc objects, one per pair.
+ * \param dsttopos The hwloc topologies of the destination servers, one per pair.
+ * \param dstobjs The destination hwloc objects, one per pair.
+ * \param flags A OR'ed set of ::netloc_map_paths_flag_e.
+ * \param paths The array of \p nr_pairs paths handles filled on success.
+ * Each of them must be freed with netloc_map_paths_destroy() after use.
+ * \param nrs The array of \p nr_pairs numbers of paths filled on success.
+ *
+ * \returns 0 on success
+ * \returns -1 on error, no paths handle is returned then
+ */
+NETLOC_DECLSPEC int netloc_map_paths_build_many(netloc_map_t map, unsigned nr_pairs,
+						hwloc_topology_t *srctopos, hwloc_obj_t *srcobjs,
+						hwloc_topology_t *dsttopos, hwloc_obj_t *dstobjs,
+						unsigned long flags,
+						netloc_map_paths_t *paths, unsigned *nrs);
+
 /**
  * Get a single path from a previously built netloc map paths handle.
  *
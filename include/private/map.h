@@ -14,6 +14,7 @@
 
 #include <hwloc.h>
 #include <netloc.h>
+#include <netloc_map.h>
 
 
 struct netloc_map__subnet;
@@ -24,6 +25,8 @@ struct netloc_map__port {
   struct netloc_map__server * server;
 
   netloc_edge_t * edge;
+  netloc_node_t * node; /* NULL if not found in the subnet */
+  unsigned subnet_index; /* rank among the ports of the subnet */
 
   unsigned hwloc_obj_depth;
   unsigned hwloc_obj_index;
@@ -48,14 +51,45 @@ struct netloc_map__subnet {
   struct netloc_map__port *port_first, *port_last;
   unsigned ports_nr;
 
+  /* network part of the paths between two ports, filled on demand */
+  int segment_by_ports_ready;
+  struct netloc_dt_lookup_table segment_by_ports;
+
   char id[0];
 };
 
+/* network paths between two ports of a subnet */
+struct netloc_map__netloc_segment {
+  unsigned nr_paths; /* 0 if the ports are not connected */
+  unsigned *offsets; /* path #i is edges[offsets[i]..offsets[i+1]-1] */
+  netloc_edge_t **edges;
+};
+
+#define NETLOC_MAP__HWLOC_SEGMENT_EDGES_MAX 4
+
+/* hwloc edges between an object and a port of a server,
+ * with all the edges that any paths flags may want.
+ */
+struct netloc_map__hwloc_segment {
+  int ready;
+  unsigned nr_edges;
+  struct netloc_map_edge_s edges[NETLOC_MAP__HWLOC_SEGMENT_EDGES_MAX];
+};
+
+/* ports of a server sharing the same locality */
+struct netloc_map__locality {
+  hwloc_bitmap_t cpuset; /* cpuset of the ports' non-I/O ancestor, NULL if none */
+  hwloc_bitmap_t ports; /* indexes in the server ports array */
+};
+
 struct netloc_map__server {
   hwloc_topology_t topology; /* NULL if compressed */
 #if HWLOC_API_VERSION >= 0x00010800
   hwloc_topology_diff_t topology_diff;
   struct netloc_map__server *topology_diff_refserver;
+  /* in the cache of unused uncompressed topologies, most recently used first */
+  int cached;
+  struct netloc_map__server *cache_prev, *cache_next;
 #endif
 
   int usecount; /* references from the application,
@@ -67,6 +101,20 @@ struct netloc_map__server {
   unsigned nr_ports_allocated;
   struct netloc_map__port ** ports;
 
+  /* locality table of the ports, computed once the ports are known,
+   * remains valid when the topology is compressed.
+   * NULL if it could not be built.
+   */
+  unsigned nr_localities;
+  struct netloc_map__locality *localities;
+
+  /* hwloc part of the paths, filled on demand and dropped when the topology is compressed.
+   * indexed by port, direction (to or from the port) and object depth,
+   * each of them is then indexed by object logical index.
+   */
+  unsigned hwloc_segments_depth;
+  struct netloc_map__hwloc_segment **hwloc_segments;
+
   struct netloc_map__server *prev, *next;
   struct netloc_map *map;
 
@@ -80,6 +128,12 @@ enum netloc_map_verbose_flags_e {
 struct netloc_map {
   unsigned long flags;
   unsigned long verbose_flags;
+  unsigned nr_threads; /* threads loading the hwloc XML files */
+
+  /* unused uncompressed topologies kept before compressing them again */
+  unsigned hwloc_cache_max;
+  unsigned hwloc_cache_nr;
+  struct netloc_map__server *hwloc_cache_first, *hwloc_cache_last;
 
   unsigned server_ports_nr; /* needed during build, to create large-enough hash tables */
 
@@ -103,8 +157,9 @@ struct netloc_map__paths {
   struct netloc_map__path {
     /* FIXME: cache the subnet */
     unsigned nr_edges;
-    struct netloc_map_edge_s *edges;
+    struct netloc_map_edge_s *edges; /* within the edges array below */
   } * paths;
+  struct netloc_map_edge_s *edges; /* edges of all paths */
 };
 
 #endif /* _PRIVATE_NETLOC_MAP_H_ */
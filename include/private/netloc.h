@@ -37,19 +37,54 @@ struct netloc_lookup_table_entry_t {
     void *value;
     /** Lookup key */
     unsigned long __key__;
+    /** Hash of the key (cached to avoid rehashing strings on growth) */
+    unsigned long __hash__;
 };
 typedef struct netloc_lookup_table_entry_t netloc_lookup_table_entry_t;
 
+/**
+ * Chunk of the key arena of a lookup table
+ */
+struct netloc_lookup_table_key_chunk {
+    /** Previously filled chunk */
+    struct netloc_lookup_table_key_chunk *next;
+    /** Number of bytes available in data */
+    size_t size;
+    /** Number of bytes used in data */
+    size_t used;
+    /** Number of keys of live entries stored in data */
+    size_t live;
+    /** Key storage */
+    char data[];
+};
+
 /**
  * Lookup table
+ *
+ * Entries are kept in insertion order in the ht_entries array, which is
+ * what the iterators walk. Lookups go through ht_index, an open addressing
+ * (linear probing) hash index whose slots hold a position in ht_entries.
+ * Removing an entry leaves a hole (NULL key) in ht_entries (so iterators
+ * stay valid across removals); holes are squeezed out when the table fills up.
+ * Unless NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY is set, keys are copied into
+ * a per-table arena (ht_keys). A chunk of the arena is released as soon as
+ * all the entries whose key it holds are removed, the rest with the table.
  */
 struct netloc_dt_lookup_table {
-    /** Table entries array */
-    netloc_lookup_table_entry_t **ht_entries;
+    /** Table entries array (entries are stored inline) */
+    netloc_lookup_table_entry_t *ht_entries;
     /** Number of entries in the lookup table */
     size_t   ht_size;
     /** Number of filled entried in the lookup table */
     size_t   ht_used_size;
+    /** Number of slots of ht_entries used so far (filled entries and holes) */
+    size_t   ht_tail;
+    /** Hash index: position+1 in ht_entries, 0 if the slot is empty */
+    size_t  *ht_index;
+    /** Number of slots in the hash index (always a power of 2) */
+    size_t   ht_index_size;
+    /** Key arena (most recent chunk first) */
+    struct netloc_lookup_table_key_chunk *ht_keys;
     /** Flags */
     unsigned long flags;
 };
@@ -71,6 +106,10 @@ struct netloc_dt_lookup_table_iterator {
 /**********************************************************************
  *        Topology object
  **********************************************************************/
+struct support_path_cache_t;
+struct support_path_source_t;
+struct support_graph_t;
+
 /**
  * Topology state used by the API functions.
  */
@@ -85,8 +124,40 @@ struct netloc_topology {
     int num_nodes;
     netloc_node_t **nodes;
 
+    /** Index of the nodes by physical_id */
+    struct netloc_dt_lookup_table *nodes_by_phy_id;
+    /** Index of the nodes by physical_id_int */
+    struct netloc_dt_lookup_table *nodes_by_phy_id_int;
+
     /** Lookup table for all edge information */
     struct netloc_dt_lookup_table *edges;
+
+    /** Dense index of the edges by edge_uid (NULL for unused UIDs) */
+    int num_edge_uids;
+    netloc_edge_t **edges_by_uid;
+
+    /** Compact adjacency of the nodes, used by the traversals (built on first use) */
+    struct support_graph_t *graph;
+
+    /** Where the paths of each source node are loaded from, on first use */
+    struct support_path_source_t *path_source;
+
+    /** Binary topology cache mapped by netloc_attach_mapped (NULL otherwise) */
+    void *binary_map;
+    size_t binary_map_size;
+    /** Storage of all the paths served from binary_map */
+    netloc_edge_t **binary_paths;
+
+    /** Forwarding tables of the switches, indexed by node __uid__ (NULL if
+     *  the logical paths are stored one by one). Each maps a destination
+     *  logical_id to the outgoing edge. */
+    int num_forwarding_tables;
+    struct netloc_dt_lookup_table **forwarding_tables;
+    /** Logical paths expanded from the forwarding tables (see forwarding.c) */
+    struct support_path_cache_t *path_cache;
+    /** Number of expanded paths kept for reuse, besides the ones handed out
+     *  by netloc_get_path (SUPPORT_PATH_CACHE_SIZE by default) */
+    int path_cache_size;
 };
 
 
@@ -192,6 +263,31 @@ NETLOC_DECLSPEC netloc_node_t * netloc_dt_node_t_dup(netloc_node_t *node);
 NETLOC_DECLSPEC int netloc_dt_node_t_copy(netloc_node_t *from, netloc_node_t *to);
 
 
+/**
+ * Build a dense edge_uid -> edge index over the edges of a lookup table
+ *
+ * Edge UIDs are allocated from NETLOC_EDGE_UID_START, so the index is an
+ * array with one slot per UID up to the largest one in the table.
+ * User is responsible for calling free() on the returned array (not on the elements).
+ *
+ * \param edge_table A lookup table of netloc_edge_t
+ * \param num_edge_uids Set to the number of slots in the returned array
+ *
+ * Returns
+ *   NULL on error
+ *   otherwise the array of edge pointers indexed by edge_uid
+ */
+NETLOC_DECLSPEC netloc_edge_t ** netloc_dt_edge_index_t_construct(netloc_dt_lookup_table_t edge_table, int *num_edge_uids);
+
+/**
+ * Access an edge from an index built by netloc_dt_edge_index_t_construct
+ *
+ * Evaluates to NULL if the UID is out of range or unused.
+ */
+#define NETLOC_DT_EDGE_BY_UID(edges_by_uid, num_edge_uids, uid)            \
+    (((uid) >= NETLOC_EDGE_UID_START && (uid) < (num_edge_uids)) ?         \
+     (edges_by_uid)[(uid)] : NULL)
+
 /*************************************************/
 
 /**
@@ -284,6 +380,21 @@ enum netloc_lookup_table_init_flag_e {
  */
 NETLOC_DECLSPEC int netloc_lookup_table_init(netloc_dt_lookup_table_t table, size_t size, unsigned long flags);
 
+/**
+ * Reserve room in the lookup table for at least 'size' entries
+ *
+ * Useful before a bulk load when the number of entries is known, since it
+ * avoids growing (and re-indexing) the table repeatedly. Never shrinks the table.
+ *
+ * \param table A valid pointer to a lookup table
+ * \param size Number of entries the table should be able to hold
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR on error
+ */
+NETLOC_DECLSPEC int netloc_lookup_table_reserve(netloc_dt_lookup_table_t table, size_t size);
+
 /**
  * Access the -allocated- size of the lookup table
  *
@@ -495,12 +606,14 @@ NETLOC_DECLSPEC json_t* netloc_dt_node_t_json_encode(netloc_node_t *node);
  * This will -not- decode the path information
  * User is responsible for calling _destruct on the returned pointer.
  *
+ * \param edges_by_uid Edge index from netloc_dt_edge_index_t_construct
+ * \param num_edge_uids Number of slots in the edges_by_uid index
  * \param json_node A point to a valid json object representing the node information
  *
  * Returns
  *   A newly allocated node type filled in with the stored information
  */
-NETLOC_DECLSPEC netloc_node_t* netloc_dt_node_t_json_decode(netloc_dt_lookup_table_t edge_table, json_t *json_node);
+NETLOC_DECLSPEC netloc_node_t* netloc_dt_node_t_json_decode(netloc_edge_t **edges_by_uid, int num_edge_uids, json_t *json_node);
 
 /**
  * JSON Encode the paths in the data structure
@@ -521,12 +634,14 @@ NETLOC_DECLSPEC json_t* netloc_dt_node_t_json_encode_paths(netloc_node_t *node,
  * This will -only- decode the path information
  * User is responsible for calling _destruct on the returned pointer.
  *
+ * \param edges_by_uid Edge index from netloc_dt_edge_index_t_construct
+ * \param num_edge_uids Number of slots in the edges_by_uid index
  * \param json_all_paths A point to a valid json object representing the path information for a node
  *
  * Returns
  *   A newly allocated lookup table for the path information stored in the json object
  */
-NETLOC_DECLSPEC netloc_dt_lookup_table_t netloc_dt_node_t_json_decode_paths(netloc_dt_lookup_table_t edge_table, json_t *json_all_paths);
+NETLOC_DECLSPEC netloc_dt_lookup_table_t netloc_dt_node_t_json_decode_paths(netloc_edge_t **edges_by_uid, int num_edge_uids, json_t *json_all_paths);
 
 /*************************************************/
 
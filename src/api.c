@@ -26,6 +26,27 @@
  */
 static int find_matching_nodes(struct netloc_topology * topology, struct netloc_dt_lookup_table ** nodes, netloc_node_type_t *nt);
 
+/**
+ * Get the path from the source to the destination (see netloc_get_path)
+ *
+ * \param topology A valid pointer to a topology handle
+ * \param src_node A valid pointer to the source node
+ * \param dest_node A valid pointer to the destination node
+ * \param num_edges The number of edges in the path array
+ * \param path NULL terminated array of edges from the source to the destination
+ * \param is_logical If the path should represent the logical or the physical path information
+ * \param copy If the path should be a copy owned by the caller
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR_NOT_FOUND if there is no path information between the nodes
+ *   NETLOC_ERROR otherwise
+ */
+static int get_path(struct netloc_topology * topology,
+                    netloc_node_t *src_node, netloc_node_t *dest_node,
+                    int *num_edges, netloc_edge_t ***path,
+                    bool is_logical, bool copy);
+
 
 /*********************************************************************/
 
@@ -56,7 +77,7 @@ int netloc_get_all_host_nodes(struct netloc_topology * topology, struct netloc_d
 
 netloc_node_t * netloc_get_node_by_physical_id(struct netloc_topology * topology, const char * phy_id)
 {
-    int i, ret;
+    int ret;
 
     if( NULL == phy_id ) {
         return NULL;
@@ -73,13 +94,29 @@ netloc_node_t * netloc_get_node_by_physical_id(struct netloc_topology * topology
         }
     }
 
-    for(i = 0; i < topology->num_nodes; ++i) {
-        if( 0 == strncmp(topology->nodes[i]->physical_id, phy_id, strlen(topology->nodes[i]->physical_id)) ) {
-            return topology->nodes[i];
+    return (netloc_node_t*)netloc_lookup_table_access(topology->nodes_by_phy_id, phy_id);
+}
+
+netloc_node_t * netloc_get_node_by_physical_id_int(struct netloc_topology * topology, unsigned long phy_id_int)
+{
+    int ret;
+
+    if( 0 == phy_id_int ) {
+        return NULL;
+    }
+
+    /*
+     * Lazy load the node information
+     */
+    if( !topology->nodes_loaded ) {
+        ret = support_load_json(topology);
+        if( NETLOC_SUCCESS != ret ) {
+            fprintf(stderr, "Error: Failed to load the topology\n");
+            return NULL;
         }
     }
 
-    return NULL;
+    return (netloc_node_t*)netloc_lookup_table_access_with_int(topology->nodes_by_phy_id_int, NULL, phy_id_int);
 }
 
 int netloc_get_all_edges(struct netloc_topology * topology, netloc_node_t *node, int *num_edges, netloc_edge_t ***edges)
@@ -110,6 +147,21 @@ int netloc_get_path(const netloc_topology_t topology,
                     int *num_edges,
                     netloc_edge_t ***path,
                     bool is_logical)
+{
+    return get_path(topology, src_node, dest_node, num_edges, path, is_logical, false);
+}
+
+int netloc_get_path_copy(const netloc_topology_t topology,
+                         netloc_node_t *src_node,
+                         netloc_node_t *dest_node,
+                         int *num_edges,
+                         netloc_edge_t ***path,
+                         bool is_logical)
+{
+    return get_path(topology, src_node, dest_node, num_edges, path, is_logical, true);
+}
+
+netloc_edge_t * netloc_get_edge_by_uid(struct netloc_topology * topology, int edge_uid)
 {
     int ret;
 
@@ -120,26 +172,11 @@ int netloc_get_path(const netloc_topology_t topology,
         ret = support_load_json(topology);
         if( NETLOC_SUCCESS != ret ) {
             fprintf(stderr, "Error: Failed to load the topology\n");
-            return ret;
+            return NULL;
         }
     }
 
-    (*num_edges) = 0;
-    if( is_logical ) {
-        (*path) = (netloc_edge_t**)netloc_lookup_table_access(src_node->logical_paths, dest_node->physical_id);
-    } else {
-        (*path) = (netloc_edge_t**)netloc_lookup_table_access(src_node->physical_paths, dest_node->physical_id);
-    }
-    if( NULL == (*path) ) {
-        return NETLOC_ERROR_NOT_FOUND;
-    }
-
-    /* Count the edges */
-    for((*num_edges) = 0; NULL != (*path)[(*num_edges)]; (*num_edges) += 1) {
-        ;
-    }
-
-    return NETLOC_SUCCESS;
+    return NETLOC_DT_EDGE_BY_UID(topology->edges_by_uid, topology->num_edge_uids, edge_uid);
 }
 
 
@@ -171,7 +208,7 @@ static int find_matching_nodes(struct netloc_topology * topology, struct netloc_
         if( NULL == nt || (*nt) == topology->nodes[i]->node_type ) {
             if( NULL == (*nodes) ) {
 	        (*nodes) = calloc(1, sizeof(**nodes));
-                netloc_lookup_table_init((*nodes), 0, 0);
+                netloc_lookup_table_init((*nodes), topology->num_nodes - i, 0);
             }
 
             netloc_lookup_table_append( (*nodes), topology->nodes[i]->physical_id, topology->nodes[i]);
@@ -180,3 +217,69 @@ static int find_matching_nodes(struct netloc_topology * topology, struct netloc_
 
     return NETLOC_SUCCESS;
 }
+
+static int get_path(struct netloc_topology * topology,
+                    netloc_node_t *src_node, netloc_node_t *dest_node,
+                    int *num_edges, netloc_edge_t ***path,
+                    bool is_logical, bool copy)
+{
+    int ret;
+    netloc_edge_t **stored = NULL;
+
+    /*
+     * Lazy load the node information
+     */
+    if( !topology->nodes_loaded ) {
+        ret = support_load_json(topology);
+        if( NETLOC_SUCCESS != ret ) {
+            fprintf(stderr, "Error: Failed to load the topology\n");
+            return ret;
+        }
+    }
+
+    (*num_edges) = 0;
+    (*path) = NULL;
+
+    /*
+     * Lazy load the paths from the source node
+     */
+    ret = support_load_node_paths(topology, src_node, is_logical);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: Failed to load the paths of node %s\n", src_node->physical_id);
+        return ret;
+    }
+
+    if( is_logical ) {
+        (*path) = (netloc_edge_t**)netloc_lookup_table_access(src_node->logical_paths, dest_node->physical_id);
+
+        /*
+         * Paths not stored one by one are expanded from the forwarding tables
+         */
+        if( NULL == (*path) && NULL != topology->forwarding_tables ) {
+            return support_forwarding_get_path(topology, src_node, dest_node, num_edges, path, copy);
+        }
+    } else {
+        (*path) = (netloc_edge_t**)netloc_lookup_table_access(src_node->physical_paths, dest_node->physical_id);
+    }
+    if( NULL == (*path) ) {
+        return NETLOC_ERROR_NOT_FOUND;
+    }
+
+    /* Count the edges */
+    for((*num_edges) = 0; NULL != (*path)[(*num_edges)]; (*num_edges) += 1) {
+        ;
+    }
+
+    if( copy ) {
+        stored = (*path);
+        (*path) = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * ((*num_edges) + 1));
+        if( NULL == (*path) ) {
+            (*num_edges) = 0;
+            return NETLOC_ERROR;
+        }
+        memcpy((*path), stored, sizeof(netloc_edge_t*) * ((*num_edges) + 1));
+    }
+
+    return NETLOC_SUCCESS;
+}
+
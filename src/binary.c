@@ -0,0 +1,1233 @@
+/*
+ * Copyright (c) 2013-2014 University of Wisconsin-La Crosse.
+ *                         All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ * See COPYING in top-level directory.
+ *
+ * $HEADER$
+ */
+
+#include <netloc.h>
+#include <private/netloc.h>
+#include "support.h"
+
+#include <stdint.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * Binary topology cache
+ *
+ * A single file holding everything support_load_json() reads from the three
+ * .ndat JSON files, laid out as flat arrays so that it can be read back
+ * without any parsing:
+ *
+ *   header
+ *   string pool       (NUL terminated strings, referenced by byte offset)
+ *   node records      (struct binary_node_t[num_nodes])
+ *   edge records      (struct binary_edge_t[num_edges])
+ *   adjacency index   (uint32_t[num_nodes+1], CSR offsets into adjacency)
+ *   adjacency         (uint32_t[num_adj], edge record indexes)
+ *   for the physical, then the logical paths:
+ *     path index      (uint32_t[num_nodes+1], CSR offsets into path records)
+ *     path records    (struct binary_path_t[num_paths])
+ *     path edges      (uint32_t[num_path_edges], edge record indexes)
+ *   forwarding index  (uint32_t[num_nodes+1], CSR offsets into route records)
+ *   route records     (struct binary_route_t[num_routes])
+ *
+ * Every section starts on an 8 byte boundary. Values are stored in host byte
+ * order, the header records the byte order so a foreign file is rejected.
+ */
+#define BINARY_MAGIC       "NLTOPO\0"
+#define BINARY_VERSION     2
+#define BINARY_BYTE_ORDER  0x01020304
+#define BINARY_NONE        UINT32_MAX
+
+#define BINARY_PHY_PATHS   0
+#define BINARY_LOG_PATHS   1
+
+#define BINARY_NODE_HAS_PHY_PATHS (1U<<0)
+#define BINARY_NODE_HAS_LOG_PATHS (1U<<1)
+
+#define BINARY_ALIGN(x) (((x) + 7) & ~((uint64_t)7))
+
+struct binary_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+
+    uint32_t num_nodes;
+    uint32_t num_edges;
+    uint32_t num_adj;
+    uint32_t num_paths[2];
+    uint32_t num_path_edges[2];
+    uint32_t num_routes;
+
+    uint64_t strings_off;
+    uint64_t strings_size;
+    uint64_t nodes_off;
+    uint64_t edges_off;
+    uint64_t adj_index_off;
+    uint64_t adj_off;
+    uint64_t path_index_off[2];
+    uint64_t paths_off[2];
+    uint64_t path_edges_off[2];
+    uint64_t route_index_off;
+    uint64_t routes_off;
+
+    uint64_t file_size;
+};
+
+struct binary_node_t {
+    uint64_t physical_id_int;
+    uint32_t network_type;
+    uint32_t node_type;
+    uint32_t physical_id;
+    uint32_t logical_id;
+    uint32_t subnet_id;
+    uint32_t description;
+    uint32_t flags;
+    uint32_t pad;
+};
+
+struct binary_edge_t {
+    int32_t  edge_uid;
+    uint32_t src_node;
+    uint32_t dest_node;
+    uint32_t src_node_type;
+    uint32_t dest_node_type;
+    uint32_t src_node_id;
+    uint32_t src_port_id;
+    uint32_t dest_node_id;
+    uint32_t dest_port_id;
+    uint32_t speed;
+    uint32_t width;
+    uint32_t description;
+};
+
+struct binary_path_t {
+    /** Destination key (string) */
+    uint32_t dest_id;
+    /** Destination node index (BINARY_NONE if not in the topology) */
+    uint32_t dest_node;
+    /** Offset of the first edge in path edges */
+    uint32_t edges_start;
+    uint32_t num_edges;
+};
+
+struct binary_route_t {
+    /** Destination logical ID (string) */
+    uint32_t dest_id;
+    /** Outgoing edge record index */
+    uint32_t edge;
+};
+
+/**
+ * Growable array used while serializing a section
+ */
+struct binary_buffer_t {
+    char  *data;
+    size_t size;
+    size_t alloc;
+};
+
+static int binary_buffer_append(struct binary_buffer_t *buf, const void *data, size_t len);
+static uint32_t binary_string_ref(struct binary_buffer_t *pool, netloc_dt_lookup_table_t refs, const char *str);
+static int binary_write_section(FILE *fh, uint64_t *offset, const void *data, size_t len);
+static int binary_serialize_paths(struct netloc_topology *topology, int kind, uint32_t *edge_map,
+                                  struct binary_buffer_t *pool, netloc_dt_lookup_table_t refs,
+                                  struct binary_node_t *nodes,
+                                  struct binary_buffer_t *index, struct binary_buffer_t *paths,
+                                  struct binary_buffer_t *path_edges);
+static int binary_serialize_forwarding(struct netloc_topology *topology, uint32_t *edge_map,
+                                       struct binary_buffer_t *pool, netloc_dt_lookup_table_t refs,
+                                       struct binary_buffer_t *index, struct binary_buffer_t *routes);
+
+/**
+ * Modification time of a file, in nanoseconds since the Epoch
+ */
+static inline uint64_t binary_mtime_ns(const struct stat *sb) {
+    return (uint64_t)sb->st_mtim.tv_sec * 1000000000ULL + (uint64_t)sb->st_mtim.tv_nsec;
+}
+
+static int binary_map_file(const char * fname, char **base, size_t *size);
+static int binary_check_header(const struct binary_header_t *hdr, size_t size);
+static int binary_check_contents(const struct binary_header_t *hdr);
+static int binary_decode(struct netloc_topology * topology, char *base, bool borrow);
+static char * binary_string(char *strings, uint64_t strings_size, uint32_t ref, bool borrow);
+static netloc_dt_lookup_table_t binary_decode_paths(struct netloc_topology * topology, char *base,
+                                                   int kind, uint32_t node_idx,
+                                                   netloc_edge_t ***path_store);
+
+/*****************************************************/
+
+char * support_binary_filename(netloc_network_t *network)
+{
+    char * fname = NULL;
+    size_t len;
+    static const char *json_suffix = "nodes.ndat";
+
+    if( NULL == network || NULL == network->node_uri ) {
+        return NULL;
+    }
+
+    len = strlen(network->node_uri);
+    if( len < strlen(json_suffix) ||
+        0 != strcmp(&network->node_uri[len - strlen(json_suffix)], json_suffix) ) {
+        return NULL;
+    }
+
+    asprintf(&fname, "%.*s%s", (int)(len - strlen(json_suffix)), network->node_uri, SUPPORT_BINARY_SUFFIX);
+
+    return fname;
+}
+
+bool support_binary_is_current(netloc_network_t *network, const char * fname)
+{
+    struct stat sb_bin, sb_json;
+    const char *json_files[SUPPORT_NUM_JSON_FILES];
+    int i;
+
+    if( 0 != stat(fname, &sb_bin) ) {
+        return false;
+    }
+
+    json_files[0] = network->node_uri;
+    json_files[1] = network->phy_path_uri;
+    json_files[2] = network->path_uri;
+
+    for(i = 0; i < SUPPORT_NUM_JSON_FILES; ++i) {
+        if( NULL == json_files[i] || 0 != stat(json_files[i], &sb_json) ) {
+            continue;
+        }
+        if( binary_mtime_ns(&sb_json) > binary_mtime_ns(&sb_bin) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void support_binary_json_stamps(netloc_network_t *network, struct support_file_stamp_t *stamps)
+{
+    struct stat sb;
+    const char *json_files[SUPPORT_NUM_JSON_FILES];
+    int i;
+
+    json_files[0] = network->node_uri;
+    json_files[1] = network->phy_path_uri;
+    json_files[2] = network->path_uri;
+
+    memset(stamps, 0, sizeof(struct support_file_stamp_t) * SUPPORT_NUM_JSON_FILES);
+    for(i = 0; i < SUPPORT_NUM_JSON_FILES; ++i) {
+        if( NULL == json_files[i] || 0 != stat(json_files[i], &sb) ) {
+            continue;
+        }
+        stamps[i].size     = (uint64_t)sb.st_size;
+        stamps[i].mtime_ns = binary_mtime_ns(&sb);
+    }
+}
+
+int support_write_binary(struct netloc_topology * topology, const char * fname)
+{
+    int exit_status = NETLOC_SUCCESS;
+    int i, j, kind;
+    uint32_t num_edges = 0, num_adj = 0, idx;
+    uint32_t *edge_map = NULL;
+    netloc_edge_t *edge = NULL;
+    netloc_node_t *node = NULL;
+
+    struct binary_header_t hdr;
+    struct binary_node_t *bnodes = NULL;
+    struct binary_edge_t *bedges = NULL;
+    uint32_t *adj_index = NULL;
+    uint32_t *adj = NULL;
+    struct binary_buffer_t pool = {NULL, 0, 0};
+    struct binary_buffer_t path_index[2] = {{NULL, 0, 0}, {NULL, 0, 0}};
+    struct binary_buffer_t paths[2]      = {{NULL, 0, 0}, {NULL, 0, 0}};
+    struct binary_buffer_t path_edges[2] = {{NULL, 0, 0}, {NULL, 0, 0}};
+    struct binary_buffer_t route_index = {NULL, 0, 0};
+    struct binary_buffer_t routes      = {NULL, 0, 0};
+    struct netloc_dt_lookup_table refs;
+
+    char *tmp_fname = NULL;
+    FILE *fh = NULL;
+    uint64_t offset;
+
+    /*
+     * The paths not asked for yet go into the file as well
+     */
+    exit_status = support_load_all_paths(topology);
+    if( NETLOC_SUCCESS != exit_status ) {
+        return exit_status;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memset(&refs, 0, sizeof(refs));
+
+    // Strings are shared through the pool: node ids repeat in every edge and path
+    if( NETLOC_SUCCESS != netloc_lookup_table_init(&refs, topology->num_nodes * 4,
+                                                   NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY) ) {
+        return NETLOC_ERROR;
+    }
+
+    /*
+     * Edges: written in edge_uid order, edge_map translates an edge_uid
+     * into its record index.
+     */
+    edge_map = (uint32_t*)malloc(sizeof(uint32_t) * (topology->num_edge_uids + 1));
+    bedges = (struct binary_edge_t*)calloc(topology->num_edge_uids + 1, sizeof(struct binary_edge_t));
+    bnodes = (struct binary_node_t*)calloc(topology->num_nodes + 1, sizeof(struct binary_node_t));
+    adj_index = (uint32_t*)malloc(sizeof(uint32_t) * (topology->num_nodes + 1));
+    if( NULL == edge_map || NULL == bedges || NULL == bnodes || NULL == adj_index ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    for(i = 0; i < topology->num_nodes; ++i) {
+        topology->nodes[i]->__uid__ = i;
+    }
+
+    for(i = 0; i < topology->num_edge_uids; ++i) {
+        edge = topology->edges_by_uid[i];
+        if( NULL == edge ) {
+            edge_map[i] = BINARY_NONE;
+            continue;
+        }
+        edge_map[i] = num_edges;
+
+        bedges[num_edges].edge_uid       = edge->edge_uid;
+        bedges[num_edges].src_node       = (NULL == edge->src_node  ? BINARY_NONE : (uint32_t)edge->src_node->__uid__);
+        bedges[num_edges].dest_node      = (NULL == edge->dest_node ? BINARY_NONE : (uint32_t)edge->dest_node->__uid__);
+        bedges[num_edges].src_node_type  = edge->src_node_type;
+        bedges[num_edges].dest_node_type = edge->dest_node_type;
+        bedges[num_edges].src_node_id    = binary_string_ref(&pool, &refs, edge->src_node_id);
+        bedges[num_edges].src_port_id    = binary_string_ref(&pool, &refs, edge->src_port_id);
+        bedges[num_edges].dest_node_id   = binary_string_ref(&pool, &refs, edge->dest_node_id);
+        bedges[num_edges].dest_port_id   = binary_string_ref(&pool, &refs, edge->dest_port_id);
+        bedges[num_edges].speed          = binary_string_ref(&pool, &refs, edge->speed);
+        bedges[num_edges].width          = binary_string_ref(&pool, &refs, edge->width);
+        bedges[num_edges].description    = binary_string_ref(&pool, &refs, edge->description);
+        ++num_edges;
+    }
+
+    /*
+     * Nodes and the CSR adjacency of their outgoing edges
+     */
+    for(i = 0; i < topology->num_nodes; ++i) {
+        node = topology->nodes[i];
+
+        bnodes[i].physical_id_int = node->physical_id_int;
+        bnodes[i].network_type    = node->network_type;
+        bnodes[i].node_type       = node->node_type;
+        bnodes[i].physical_id     = binary_string_ref(&pool, &refs, node->physical_id);
+        bnodes[i].logical_id      = binary_string_ref(&pool, &refs, node->logical_id);
+        bnodes[i].subnet_id       = binary_string_ref(&pool, &refs, node->subnet_id);
+        bnodes[i].description     = binary_string_ref(&pool, &refs, node->description);
+        bnodes[i].flags           = 0;
+
+        num_adj += node->num_edges;
+    }
+
+    adj = (uint32_t*)malloc(sizeof(uint32_t) * (num_adj + 1));
+    if( NULL == adj ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    idx = 0;
+    for(i = 0; i < topology->num_nodes; ++i) {
+        node = topology->nodes[i];
+        adj_index[i] = idx;
+        for(j = 0; j < node->num_edges; ++j) {
+            adj[idx++] = edge_map[node->edges[j]->edge_uid];
+        }
+    }
+    adj_index[topology->num_nodes] = idx;
+
+    /*
+     * Physical and logical paths
+     */
+    for(kind = BINARY_PHY_PATHS; kind <= BINARY_LOG_PATHS; ++kind) {
+        exit_status = binary_serialize_paths(topology, kind, edge_map, &pool, &refs, bnodes,
+                                             &path_index[kind], &paths[kind], &path_edges[kind]);
+        if( NETLOC_SUCCESS != exit_status ) {
+            goto cleanup;
+        }
+    }
+
+    /*
+     * Forwarding tables
+     */
+    exit_status = binary_serialize_forwarding(topology, edge_map, &pool, &refs, &route_index, &routes);
+    if( NETLOC_SUCCESS != exit_status ) {
+        goto cleanup;
+    }
+
+    /*
+     * Write everything to a temporary file, and move it into place once
+     * complete so that a concurrent reader never sees a partial file.
+     */
+    asprintf(&tmp_fname, "%s.%d", fname, (int)getpid());
+    fh = fopen(tmp_fname, "w");
+    if( NULL == fh ) {
+        fprintf(stderr, "Error: Failed to open the file <%s> for writing\n", tmp_fname);
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    memcpy(hdr.magic, BINARY_MAGIC, sizeof(hdr.magic));
+    hdr.version    = BINARY_VERSION;
+    hdr.byte_order = BINARY_BYTE_ORDER;
+    hdr.num_nodes  = topology->num_nodes;
+    hdr.num_edges  = num_edges;
+    hdr.num_adj    = num_adj;
+    for(kind = BINARY_PHY_PATHS; kind <= BINARY_LOG_PATHS; ++kind) {
+        hdr.num_paths[kind]      = paths[kind].size / sizeof(struct binary_path_t);
+        hdr.num_path_edges[kind] = path_edges[kind].size / sizeof(uint32_t);
+    }
+    hdr.num_routes   = routes.size / sizeof(struct binary_route_t);
+    hdr.strings_size = pool.size;
+
+    // Header is rewritten at the end, once the offsets are known
+    offset = 0;
+    if( NETLOC_SUCCESS != binary_write_section(fh, &offset, &hdr, sizeof(hdr)) ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    hdr.strings_off   = offset;
+    exit_status |= binary_write_section(fh, &offset, pool.data, pool.size);
+    hdr.nodes_off     = offset;
+    exit_status |= binary_write_section(fh, &offset, bnodes, sizeof(struct binary_node_t) * topology->num_nodes);
+    hdr.edges_off     = offset;
+    exit_status |= binary_write_section(fh, &offset, bedges, sizeof(struct binary_edge_t) * num_edges);
+    hdr.adj_index_off = offset;
+    exit_status |= binary_write_section(fh, &offset, adj_index, sizeof(uint32_t) * (topology->num_nodes + 1));
+    hdr.adj_off       = offset;
+    exit_status |= binary_write_section(fh, &offset, adj, sizeof(uint32_t) * num_adj);
+    for(kind = BINARY_PHY_PATHS; kind <= BINARY_LOG_PATHS; ++kind) {
+        hdr.path_index_off[kind] = offset;
+        exit_status |= binary_write_section(fh, &offset, path_index[kind].data, path_index[kind].size);
+        hdr.paths_off[kind]      = offset;
+        exit_status |= binary_write_section(fh, &offset, paths[kind].data, paths[kind].size);
+        hdr.path_edges_off[kind] = offset;
+        exit_status |= binary_write_section(fh, &offset, path_edges[kind].data, path_edges[kind].size);
+    }
+    hdr.route_index_off = offset;
+    exit_status |= binary_write_section(fh, &offset, route_index.data, route_index.size);
+    hdr.routes_off      = offset;
+    exit_status |= binary_write_section(fh, &offset, routes.data, routes.size);
+    hdr.file_size = offset;
+
+    if( NETLOC_SUCCESS != exit_status ||
+        0 != fseek(fh, 0, SEEK_SET) ||
+        1 != fwrite(&hdr, sizeof(hdr), 1, fh) ) {
+        fprintf(stderr, "Error: Failed to write the binary topology file <%s>\n", tmp_fname);
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    if( 0 != fclose(fh) ) {
+        fh = NULL;
+        fprintf(stderr, "Error: Failed to write the binary topology file <%s>\n", tmp_fname);
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    fh = NULL;
+
+    if( 0 != rename(tmp_fname, fname) ) {
+        fprintf(stderr, "Error: Failed to rename <%s> to <%s>\n", tmp_fname, fname);
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+ cleanup:
+    if( NULL != fh ) {
+        fclose(fh);
+    }
+    if( NULL != tmp_fname ) {
+        if( NETLOC_SUCCESS != exit_status ) {
+            unlink(tmp_fname);
+        }
+        free(tmp_fname);
+    }
+
+    for(kind = BINARY_PHY_PATHS; kind <= BINARY_LOG_PATHS; ++kind) {
+        free(path_index[kind].data);
+        free(paths[kind].data);
+        free(path_edges[kind].data);
+    }
+    free(route_index.data);
+    free(routes.data);
+    free(pool.data);
+    free(adj);
+    free(adj_index);
+    free(bnodes);
+    free(bedges);
+    free(edge_map);
+    netloc_lookup_table_destroy(&refs);
+
+    return exit_status;
+}
+
+int support_load_binary(struct netloc_topology * topology, const char * fname)
+{
+    int ret;
+    char *base = NULL;
+    size_t size = 0;
+
+    ret = binary_map_file(fname, &base, &size);
+    if( NETLOC_SUCCESS != ret ) {
+        return ret;
+    }
+
+    if( NETLOC_SUCCESS != binary_check_contents((const struct binary_header_t *)base) ) {
+        fprintf(stderr, "Warning: Ignoring invalid binary topology file %s\n", fname);
+        munmap(base, size);
+        return NETLOC_ERROR_NOENT;
+    }
+
+    // On success the mapping is kept, to load the paths from
+    ret = binary_decode(topology, base, false);
+    if( NETLOC_SUCCESS != ret ) {
+        munmap(base, size);
+    }
+
+    return ret;
+}
+
+int support_map_binary(struct netloc_topology * topology, const char * fname)
+{
+    int ret;
+    char *base = NULL;
+    size_t size = 0;
+
+    ret = binary_map_file(fname, &base, &size);
+    if( NETLOC_SUCCESS != ret ) {
+        return ret;
+    }
+
+    topology->binary_map      = base;
+    topology->binary_map_size = size;
+
+    return NETLOC_SUCCESS;
+}
+
+int support_load_binary_mapped(struct netloc_topology * topology)
+{
+    if( NETLOC_SUCCESS != binary_check_contents((const struct binary_header_t *)topology->binary_map) ) {
+        fprintf(stderr, "Error: Invalid binary topology file for network %s\n",
+                netloc_pretty_print_network_t(topology->network));
+        return NETLOC_ERROR;
+    }
+
+    return binary_decode(topology, topology->binary_map, true);
+}
+
+int support_binary_load_node_paths(struct netloc_topology * topology, netloc_node_t *node, bool is_logical)
+{
+    struct support_path_source_t *source = topology->path_source;
+    char *base = source->binary_map;
+    const struct binary_header_t *hdr = (const struct binary_header_t *)base;
+    const struct binary_node_t *bnodes = (const struct binary_node_t *)(base + hdr->nodes_off);
+    int kind = (is_logical ? BINARY_LOG_PATHS : BINARY_PHY_PATHS);
+    uint32_t flag = (is_logical ? BINARY_NODE_HAS_LOG_PATHS : BINARY_NODE_HAS_PHY_PATHS);
+    netloc_dt_lookup_table_t *paths = NULL;
+    netloc_dt_lookup_table_t table = NULL;
+
+    // A node without paths keeps the empty tables from netloc_dt_node_t_construct
+    if( !(bnodes[node->__uid__].flags & flag) ) {
+        return NETLOC_SUCCESS;
+    }
+
+    table = binary_decode_paths(topology, base, kind, node->__uid__,
+                                (source->binary_owned ? NULL : &source->binary_path_store));
+    if( NULL == table ) {
+        return NETLOC_ERROR;
+    }
+
+    paths = (is_logical ? &node->logical_paths : &node->physical_paths);
+    if( NULL != (*paths) ) {
+        netloc_lookup_table_destroy(*paths);
+        free(*paths);
+    }
+    (*paths) = table;
+
+    if( is_logical ) {
+        node->num_log_paths = netloc_lookup_table_size(table);
+    } else {
+        node->num_phy_paths = netloc_lookup_table_size(table);
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+int support_unmap_binary(struct netloc_topology * topology)
+{
+    int i;
+    netloc_node_t *node = NULL;
+    netloc_edge_t *edge = NULL;
+
+    if( NULL == topology->binary_map ) {
+        return NETLOC_SUCCESS;
+    }
+
+    // Forwarding table keys point into the mapping
+    support_forwarding_tables_destruct(topology);
+
+    /*
+     * Strings and path keys point into the mapping, and the paths into a
+     * single block: take them away from the nodes and edges so that their
+     * destructors do not free them.
+     */
+    for(i = 0; i < topology->num_nodes; ++i) {
+        node = topology->nodes[i];
+        if( NULL == node ) {
+            continue;
+        }
+        node->physical_id = NULL;
+        node->logical_id  = NULL;
+        node->subnet_id   = NULL;
+        node->description = NULL;
+
+        if( NULL != node->physical_paths ) {
+            netloc_lookup_table_destroy(node->physical_paths);
+            free(node->physical_paths);
+            node->physical_paths = NULL;
+        }
+        if( NULL != node->logical_paths ) {
+            netloc_lookup_table_destroy(node->logical_paths);
+            free(node->logical_paths);
+            node->logical_paths = NULL;
+        }
+    }
+
+    for(i = 0; i < topology->num_edge_uids; ++i) {
+        edge = topology->edges_by_uid[i];
+        if( NULL == edge ) {
+            continue;
+        }
+        edge->src_node_id  = NULL;
+        edge->src_port_id  = NULL;
+        edge->dest_node_id = NULL;
+        edge->dest_port_id = NULL;
+        edge->speed        = NULL;
+        edge->width        = NULL;
+        edge->description  = NULL;
+    }
+
+    if( NULL != topology->binary_paths ) {
+        free(topology->binary_paths);
+        topology->binary_paths = NULL;
+    }
+
+    munmap(topology->binary_map, topology->binary_map_size);
+    topology->binary_map      = NULL;
+    topology->binary_map_size = 0;
+
+    return NETLOC_SUCCESS;
+}
+
+/*****************************************************/
+
+static int binary_map_file(const char * fname, char **base, size_t *size)
+{
+    int fd = -1;
+    struct stat sb;
+
+    fd = open(fname, O_RDONLY);
+    if( 0 > fd ) {
+        return NETLOC_ERROR_NOENT;
+    }
+
+    if( 0 != fstat(fd, &sb) || (size_t)sb.st_size < sizeof(struct binary_header_t) ) {
+        close(fd);
+        return NETLOC_ERROR_NOENT;
+    }
+    (*size) = sb.st_size;
+
+    // Shared, read-only: every process mapping the file uses the same pages
+    (*base) = (char *) mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if( MAP_FAILED == (*base) ) {
+        (*base) = NULL;
+        return NETLOC_ERROR_NOENT;
+    }
+
+    if( NETLOC_SUCCESS != binary_check_header((const struct binary_header_t *)(*base), *size) ) {
+        fprintf(stderr, "Warning: Ignoring invalid binary topology file %s\n", fname);
+        munmap(*base, *size);
+        (*base) = NULL;
+        return NETLOC_ERROR_NOENT;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+static int binary_decode(struct netloc_topology * topology, char *base, bool borrow)
+{
+    int exit_status = NETLOC_SUCCESS;
+    const struct binary_header_t *hdr = (const struct binary_header_t *)base;
+    const struct binary_node_t *bnodes = NULL;
+    const struct binary_edge_t *bedges = NULL;
+    const uint32_t *adj_index = NULL;
+    const uint32_t *adj = NULL;
+    const uint32_t *route_index = NULL;
+    const struct binary_route_t *routes = NULL;
+    char *strings = NULL;
+
+    netloc_dt_lookup_table_t table = NULL;
+    netloc_edge_t **edges = NULL;
+    netloc_edge_t *edge = NULL;
+    struct support_path_source_t *source = NULL;
+    netloc_node_t *node = NULL;
+    uint32_t i, j;
+    char key[32];
+
+    strings   = base + hdr->strings_off;
+    bnodes    = (const struct binary_node_t *)(base + hdr->nodes_off);
+    bedges    = (const struct binary_edge_t *)(base + hdr->edges_off);
+    adj_index = (const uint32_t *)(base + hdr->adj_index_off);
+    adj       = (const uint32_t *)(base + hdr->adj_off);
+
+    /*
+     * Edges
+     */
+    edges = (netloc_edge_t**)calloc(hdr->num_edges + 1, sizeof(netloc_edge_t*));
+    topology->edges = calloc(1, sizeof(*topology->edges));
+    if( NULL == edges || NULL == topology->edges ||
+        NETLOC_SUCCESS != netloc_lookup_table_init(topology->edges, hdr->num_edges, 0) ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    for(i = 0; i < hdr->num_edges; ++i) {
+        edge = netloc_dt_edge_t_construct();
+        if( NULL == edge ) {
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+
+        edge->edge_uid       = bedges[i].edge_uid;
+        edge->src_node_type  = (netloc_node_type_t)bedges[i].src_node_type;
+        edge->dest_node_type = (netloc_node_type_t)bedges[i].dest_node_type;
+        edge->src_node_id    = binary_string(strings, hdr->strings_size, bedges[i].src_node_id, borrow);
+        edge->src_port_id    = binary_string(strings, hdr->strings_size, bedges[i].src_port_id, borrow);
+        edge->dest_node_id   = binary_string(strings, hdr->strings_size, bedges[i].dest_node_id, borrow);
+        edge->dest_port_id   = binary_string(strings, hdr->strings_size, bedges[i].dest_port_id, borrow);
+        edge->speed          = binary_string(strings, hdr->strings_size, bedges[i].speed, borrow);
+        edge->width          = binary_string(strings, hdr->strings_size, bedges[i].width, borrow);
+        edge->bandwidth      = support_parse_edge_bandwidth(edge->speed, edge->width);
+        edge->description    = binary_string(strings, hdr->strings_size, bedges[i].description, borrow);
+
+        // Same key as the JSON edge_info object
+        snprintf(key, sizeof(key), "%d", edge->edge_uid);
+        netloc_lookup_table_append(topology->edges, key, edge);
+        edges[i] = edge;
+    }
+
+    topology->edges_by_uid = netloc_dt_edge_index_t_construct(topology->edges, &topology->num_edge_uids);
+    if( NULL == topology->edges_by_uid ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    /*
+     * Nodes
+     */
+    topology->num_nodes = hdr->num_nodes;
+    topology->nodes = (netloc_node_t**)calloc(hdr->num_nodes + 1, sizeof(netloc_node_t*));
+    if( NULL == topology->nodes ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    for(i = 0; i < hdr->num_nodes; ++i) {
+        node = netloc_dt_node_t_construct();
+        if( NULL == node ) {
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+        topology->nodes[i] = node;
+
+        node->__uid__         = i;
+        node->network_type    = (netloc_network_type_t)bnodes[i].network_type;
+        node->node_type       = (netloc_node_type_t)bnodes[i].node_type;
+        node->physical_id     = binary_string(strings, hdr->strings_size, bnodes[i].physical_id, borrow);
+        node->physical_id_int = bnodes[i].physical_id_int;
+        node->logical_id      = binary_string(strings, hdr->strings_size, bnodes[i].logical_id, borrow);
+        node->subnet_id       = binary_string(strings, hdr->strings_size, bnodes[i].subnet_id, borrow);
+        node->description     = binary_string(strings, hdr->strings_size, bnodes[i].description, borrow);
+
+        node->num_edges    = adj_index[i+1] - adj_index[i];
+        node->num_edge_ids = node->num_edges;
+        node->edges    = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * (node->num_edges + 1));
+        node->edge_ids = (int*)malloc(sizeof(int) * (node->num_edges + 1));
+        if( NULL == node->edges || NULL == node->edge_ids ) {
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+
+        for(j = 0; j < (uint32_t)node->num_edges; ++j) {
+            edge = edges[ adj[adj_index[i] + j] ];
+            node->edges[j]    = edge;
+            node->edge_ids[j] = edge->edge_uid;
+            edge->src_node    = node;
+        }
+    }
+
+    for(i = 0; i < hdr->num_edges; ++i) {
+        if( BINARY_NONE != bedges[i].dest_node ) {
+            edges[i]->dest_node = topology->nodes[ bedges[i].dest_node ];
+        }
+    }
+
+    exit_status = support_build_node_index(topology);
+    if( NETLOC_SUCCESS != exit_status ) {
+        goto cleanup;
+    }
+
+    /*
+     * Paths are decoded one source node at a time, on first use
+     * (support_binary_load_node_paths). When borrowing from the mapping, all
+     * of the (NULL terminated) paths are carved out of a single block owned
+     * by the topology.
+     */
+    if( borrow ) {
+        topology->binary_paths = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) *
+                                                         ((size_t)hdr->num_path_edges[BINARY_PHY_PATHS] +
+                                                          hdr->num_paths[BINARY_PHY_PATHS] +
+                                                          hdr->num_path_edges[BINARY_LOG_PATHS] +
+                                                          hdr->num_paths[BINARY_LOG_PATHS] + 1));
+        if( NULL == topology->binary_paths ) {
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+    }
+
+    /*
+     * Forwarding tables
+     * When borrowing from the mapping, the keys point into it.
+     */
+    route_index = (const uint32_t *)(base + hdr->route_index_off);
+    routes      = (const struct binary_route_t *)(base + hdr->routes_off);
+    for(i = 0; i < hdr->num_nodes && hdr->num_routes > 0; ++i) {
+        if( route_index[i] == route_index[i+1] ) {
+            continue;
+        }
+
+        table = support_forwarding_table_get(topology, topology->nodes[i], route_index[i+1] - route_index[i],
+                                             (borrow ? NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY : 0));
+        if( NULL == table ) {
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+
+        for(j = route_index[i]; j < route_index[i+1]; ++j) {
+            netloc_lookup_table_append(table, &strings[routes[j].dest_id], edges[ routes[j].edge ]);
+        }
+    }
+
+    source = support_path_source_get(topology);
+    if( NULL == source ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    source->binary_map        = base;
+    source->binary_map_size   = hdr->file_size;
+    source->binary_owned      = !borrow;
+    source->binary_path_store = topology->binary_paths;
+
+    topology->nodes_loaded = true;
+
+ cleanup:
+    free(edges);
+
+    return exit_status;
+}
+
+static int binary_buffer_append(struct binary_buffer_t *buf, const void *data, size_t len)
+{
+    size_t new_alloc;
+    char *new_data = NULL;
+
+    if( buf->size + len > buf->alloc ) {
+        new_alloc = (0 == buf->alloc ? 4096 : buf->alloc);
+        while( buf->size + len > new_alloc ) {
+            new_alloc *= 2;
+        }
+        new_data = (char*)realloc(buf->data, new_alloc);
+        if( NULL == new_data ) {
+            return NETLOC_ERROR;
+        }
+        buf->data  = new_data;
+        buf->alloc = new_alloc;
+    }
+
+    memcpy(buf->data + buf->size, data, len);
+    buf->size += len;
+
+    return NETLOC_SUCCESS;
+}
+
+static uint32_t binary_string_ref(struct binary_buffer_t *pool, netloc_dt_lookup_table_t refs, const char *str)
+{
+    uintptr_t ref;
+
+    if( NULL == str ) {
+        return BINARY_NONE;
+    }
+
+    // The table holds offset+1, so that 0 (NULL) means "not seen yet"
+    ref = (uintptr_t)netloc_lookup_table_access(refs, str);
+    if( 0 != ref ) {
+        return (uint32_t)(ref - 1);
+    }
+
+    ref = pool->size;
+    if( NETLOC_SUCCESS != binary_buffer_append(pool, str, strlen(str) + 1) ) {
+        return BINARY_NONE;
+    }
+    netloc_lookup_table_append(refs, str, (void*)(ref + 1));
+
+    return (uint32_t)ref;
+}
+
+static int binary_write_section(FILE *fh, uint64_t *offset, const void *data, size_t len)
+{
+    static const char zeros[8] = {0};
+    uint64_t padding;
+
+    if( len > 0 && 1 != fwrite(data, len, 1, fh) ) {
+        return NETLOC_ERROR;
+    }
+
+    padding = BINARY_ALIGN(*offset + len) - (*offset + len);
+    if( padding > 0 && 1 != fwrite(zeros, padding, 1, fh) ) {
+        return NETLOC_ERROR;
+    }
+
+    (*offset) += len + padding;
+
+    return NETLOC_SUCCESS;
+}
+
+static int binary_serialize_paths(struct netloc_topology *topology, int kind, uint32_t *edge_map,
+                                  struct binary_buffer_t *pool, netloc_dt_lookup_table_t refs,
+                                  struct binary_node_t *bnodes,
+                                  struct binary_buffer_t *index, struct binary_buffer_t *paths,
+                                  struct binary_buffer_t *path_edges)
+{
+    int i;
+    uint32_t idx = 0;
+    netloc_node_t *node = NULL;
+    netloc_node_t *dest_node = NULL;
+    netloc_dt_lookup_table_t table = NULL;
+    struct netloc_dt_lookup_table_iterator *hti = NULL;
+    const char *key = NULL;
+    netloc_edge_t **path = NULL;
+    struct binary_path_t bpath;
+    uint32_t edge_idx;
+
+    for(i = 0; i < topology->num_nodes; ++i) {
+        node = topology->nodes[i];
+        table = (BINARY_PHY_PATHS == kind ? node->physical_paths : node->logical_paths);
+
+        if( NETLOC_SUCCESS != binary_buffer_append(index, &idx, sizeof(idx)) ) {
+            return NETLOC_ERROR;
+        }
+
+        if( NULL == table ) {
+            continue;
+        }
+        bnodes[i].flags |= (BINARY_PHY_PATHS == kind ? BINARY_NODE_HAS_PHY_PATHS : BINARY_NODE_HAS_LOG_PATHS);
+
+        hti = netloc_dt_lookup_table_iterator_t_construct(table);
+        while( !netloc_lookup_table_iterator_at_end(hti) ) {
+            key = netloc_lookup_table_iterator_next_key(hti);
+            if( NULL == key ) {
+                break;
+            }
+
+            // Path is a NULL terminated array of edge pointers to that destination.
+            path = (netloc_edge_t**)netloc_lookup_table_access(table, key);
+
+            dest_node = (netloc_node_t*)netloc_lookup_table_access(topology->nodes_by_phy_id, key);
+
+            bpath.dest_id     = binary_string_ref(pool, refs, key);
+            bpath.dest_node   = (NULL == dest_node ? BINARY_NONE : (uint32_t)dest_node->__uid__);
+            bpath.edges_start = path_edges->size / sizeof(uint32_t);
+            bpath.num_edges   = 0;
+            for( ; NULL != path && NULL != path[bpath.num_edges]; ++bpath.num_edges) {
+                edge_idx = edge_map[path[bpath.num_edges]->edge_uid];
+                if( NETLOC_SUCCESS != binary_buffer_append(path_edges, &edge_idx, sizeof(edge_idx)) ) {
+                    netloc_dt_lookup_table_iterator_t_destruct(hti);
+                    return NETLOC_ERROR;
+                }
+            }
+
+            if( NETLOC_SUCCESS != binary_buffer_append(paths, &bpath, sizeof(bpath)) ) {
+                netloc_dt_lookup_table_iterator_t_destruct(hti);
+                return NETLOC_ERROR;
+            }
+            ++idx;
+        }
+        netloc_dt_lookup_table_iterator_t_destruct(hti);
+    }
+
+    if( NETLOC_SUCCESS != binary_buffer_append(index, &idx, sizeof(idx)) ) {
+        return NETLOC_ERROR;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+static int binary_serialize_forwarding(struct netloc_topology *topology, uint32_t *edge_map,
+                                       struct binary_buffer_t *pool, netloc_dt_lookup_table_t refs,
+                                       struct binary_buffer_t *index, struct binary_buffer_t *routes)
+{
+    int i;
+    uint32_t idx = 0;
+    netloc_dt_lookup_table_t table = NULL;
+    struct netloc_dt_lookup_table_iterator *hti = NULL;
+    const char *key = NULL;
+    netloc_edge_t *edge = NULL;
+    struct binary_route_t broute;
+
+    for(i = 0; i < topology->num_nodes; ++i) {
+        if( NETLOC_SUCCESS != binary_buffer_append(index, &idx, sizeof(idx)) ) {
+            return NETLOC_ERROR;
+        }
+
+        table = (i < topology->num_forwarding_tables ? topology->forwarding_tables[i] : NULL);
+        if( NULL == table ) {
+            continue;
+        }
+
+        hti = netloc_dt_lookup_table_iterator_t_construct(table);
+        while( !netloc_lookup_table_iterator_at_end(hti) ) {
+            key = netloc_lookup_table_iterator_next_key(hti);
+            if( NULL == key ) {
+                break;
+            }
+            edge = (netloc_edge_t*)netloc_lookup_table_access(table, key);
+
+            broute.dest_id = binary_string_ref(pool, refs, key);
+            broute.edge    = edge_map[edge->edge_uid];
+            if( NETLOC_SUCCESS != binary_buffer_append(routes, &broute, sizeof(broute)) ) {
+                netloc_dt_lookup_table_iterator_t_destruct(hti);
+                return NETLOC_ERROR;
+            }
+            ++idx;
+        }
+        netloc_dt_lookup_table_iterator_t_destruct(hti);
+    }
+
+    if( NETLOC_SUCCESS != binary_buffer_append(index, &idx, sizeof(idx)) ) {
+        return NETLOC_ERROR;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+#define BINARY_SECTION_OK(off, len) \
+    ((off) <= hdr->file_size && (uint64_t)(len) <= hdr->file_size - (off))
+
+static int binary_check_header(const struct binary_header_t *hdr, size_t size)
+{
+    const char *base = (const char *)hdr;
+    int kind;
+
+    if( 0 != memcmp(hdr->magic, BINARY_MAGIC, sizeof(hdr->magic)) ||
+        BINARY_VERSION != hdr->version ||
+        BINARY_BYTE_ORDER != hdr->byte_order ||
+        hdr->file_size != size ) {
+        return NETLOC_ERROR;
+    }
+
+    if( !BINARY_SECTION_OK(hdr->strings_off,   hdr->strings_size) ||
+        !BINARY_SECTION_OK(hdr->nodes_off,     (uint64_t)hdr->num_nodes * sizeof(struct binary_node_t)) ||
+        !BINARY_SECTION_OK(hdr->edges_off,     (uint64_t)hdr->num_edges * sizeof(struct binary_edge_t)) ||
+        !BINARY_SECTION_OK(hdr->adj_index_off, ((uint64_t)hdr->num_nodes + 1) * sizeof(uint32_t)) ||
+        !BINARY_SECTION_OK(hdr->adj_off,       (uint64_t)hdr->num_adj * sizeof(uint32_t)) ) {
+        return NETLOC_ERROR;
+    }
+
+    for(kind = BINARY_PHY_PATHS; kind <= BINARY_LOG_PATHS; ++kind) {
+        if( !BINARY_SECTION_OK(hdr->path_index_off[kind], ((uint64_t)hdr->num_nodes + 1) * sizeof(uint32_t)) ||
+            !BINARY_SECTION_OK(hdr->paths_off[kind], (uint64_t)hdr->num_paths[kind] * sizeof(struct binary_path_t)) ||
+            !BINARY_SECTION_OK(hdr->path_edges_off[kind], (uint64_t)hdr->num_path_edges[kind] * sizeof(uint32_t)) ) {
+            return NETLOC_ERROR;
+        }
+    }
+
+    if( !BINARY_SECTION_OK(hdr->route_index_off, ((uint64_t)hdr->num_nodes + 1) * sizeof(uint32_t)) ||
+        !BINARY_SECTION_OK(hdr->routes_off, (uint64_t)hdr->num_routes * sizeof(struct binary_route_t)) ) {
+        return NETLOC_ERROR;
+    }
+
+    if( hdr->strings_size > 0 && '\0' != base[hdr->strings_off + hdr->strings_size - 1] ) {
+        return NETLOC_ERROR;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+static int binary_check_contents(const struct binary_header_t *hdr)
+{
+    const uint32_t *index = NULL;
+    const struct binary_edge_t *bedges = NULL;
+    const uint32_t *adj = NULL;
+    const struct binary_path_t *paths = NULL;
+    const uint32_t *path_edges = NULL;
+    const struct binary_route_t *routes = NULL;
+    const char *base = (const char *)hdr;
+    uint32_t i, j;
+    int kind;
+
+    /*
+     * Check every index that is later dereferenced, so the decoder itself
+     * can trust the file.
+     */
+    bedges = (const struct binary_edge_t *)(base + hdr->edges_off);
+    for(i = 0; i < hdr->num_edges; ++i) {
+        if( (BINARY_NONE != bedges[i].dest_node && bedges[i].dest_node >= hdr->num_nodes) ||
+            bedges[i].edge_uid < NETLOC_EDGE_UID_START ) {
+            return NETLOC_ERROR;
+        }
+    }
+
+    index = (const uint32_t *)(base + hdr->adj_index_off);
+    adj = (const uint32_t *)(base + hdr->adj_off);
+    for(i = 0; i < hdr->num_nodes; ++i) {
+        if( index[i] > index[i+1] ) {
+            return NETLOC_ERROR;
+        }
+    }
+    if( hdr->num_nodes > 0 && (0 != index[0] || index[hdr->num_nodes] != hdr->num_adj) ) {
+        return NETLOC_ERROR;
+    }
+    for(i = 0; i < hdr->num_adj; ++i) {
+        if( adj[i] >= hdr->num_edges ) {
+            return NETLOC_ERROR;
+        }
+    }
+
+    for(kind = BINARY_PHY_PATHS; kind <= BINARY_LOG_PATHS; ++kind) {
+        index = (const uint32_t *)(base + hdr->path_index_off[kind]);
+        for(i = 0; i < hdr->num_nodes; ++i) {
+            if( index[i] > index[i+1] ) {
+                return NETLOC_ERROR;
+            }
+        }
+        if( index[hdr->num_nodes] != hdr->num_paths[kind] ) {
+            return NETLOC_ERROR;
+        }
+
+        paths = (const struct binary_path_t *)(base + hdr->paths_off[kind]);
+        for(i = 0; i < hdr->num_paths[kind]; ++i) {
+            if( paths[i].dest_id >= hdr->strings_size ||
+                paths[i].edges_start > hdr->num_path_edges[kind] ||
+                paths[i].num_edges > hdr->num_path_edges[kind] - paths[i].edges_start ) {
+                return NETLOC_ERROR;
+            }
+        }
+
+        path_edges = (const uint32_t *)(base + hdr->path_edges_off[kind]);
+        for(i = 0; i < hdr->num_path_edges[kind]; ++i) {
+            if( path_edges[i] >= hdr->num_edges ) {
+                return NETLOC_ERROR;
+            }
+        }
+    }
+
+    /*
+     * A forwarding table only holds edges leaving its own node
+     */
+    index = (const uint32_t *)(base + hdr->route_index_off);
+    routes = (const struct binary_route_t *)(base + hdr->routes_off);
+    if( index[hdr->num_nodes] != hdr->num_routes ) {
+        return NETLOC_ERROR;
+    }
+    for(i = 0; i < hdr->num_nodes; ++i) {
+        if( index[i] > index[i+1] ) {
+            return NETLOC_ERROR;
+        }
+        for(j = index[i]; j < index[i+1]; ++j) {
+            if( routes[j].dest_id >= hdr->strings_size ||
+                routes[j].edge >= hdr->num_edges ||
+                bedges[ routes[j].edge ].src_node != i ) {
+                return NETLOC_ERROR;
+            }
+        }
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+static char * binary_string(char *strings, uint64_t strings_size, uint32_t ref, bool borrow)
+{
+    if( BINARY_NONE == ref || ref >= strings_size ) {
+        return NULL;
+    }
+
+    if( borrow ) {
+        return &strings[ref];
+    }
+
+    return strdup(&strings[ref]);
+}
+
+static netloc_dt_lookup_table_t binary_decode_paths(struct netloc_topology * topology, char *base,
+                                                   int kind, uint32_t node_idx,
+                                                   netloc_edge_t ***path_store)
+{
+    const struct binary_header_t *hdr = (const struct binary_header_t *)base;
+    const struct binary_edge_t *bedges = (const struct binary_edge_t *)(base + hdr->edges_off);
+    netloc_dt_lookup_table_t ht = NULL;
+    const uint32_t *index = (const uint32_t *)(base + hdr->path_index_off[kind]);
+    const struct binary_path_t *paths = (const struct binary_path_t *)(base + hdr->paths_off[kind]);
+    const uint32_t *path_edges = (const uint32_t *)(base + hdr->path_edges_off[kind]);
+    char *strings = base + hdr->strings_off;
+    netloc_edge_t **path = NULL;
+    uint32_t i, j;
+
+    ht = calloc(1, sizeof(*ht));
+    if( NULL == ht ) {
+        return NULL;
+    }
+    // Keys stay valid as long as the mapping when borrowing from it
+    netloc_lookup_table_init(ht, index[node_idx+1] - index[node_idx],
+                             (NULL != path_store ? NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY : 0));
+
+    for(i = index[node_idx]; i < index[node_idx+1]; ++i) {
+        if( NULL != path_store ) {
+            path = (*path_store);
+            (*path_store) += paths[i].num_edges + 1;
+        } else {
+            path = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * (paths[i].num_edges + 1));
+            if( NULL == path ) {
+                return NULL;
+            }
+        }
+
+        for(j = 0; j < paths[i].num_edges; ++j) {
+            path[j] = NETLOC_DT_EDGE_BY_UID(topology->edges_by_uid, topology->num_edge_uids,
+                                            bedges[ path_edges[paths[i].edges_start + j] ].edge_uid);
+        }
+        // Null terminated array
+        path[paths[i].num_edges] = NULL;
+
+        netloc_lookup_table_append(ht, &strings[paths[i].dest_id], path);
+    }
+
+    return ht;
+}
@@ -16,6 +16,8 @@
 
 #include "support.h"
 
+#include <unistd.h>
+
 /**
  * Encode an edge
  */
@@ -36,6 +38,26 @@ static void display_edge(netloc_edge_t *edge, char * prefix);
  */
 static void display_path(const char * src, const char * dest, int num_edges, netloc_edge_t **edges, char * prefix);
 
+/**
+ * Write the binary topology cache from the JSON files of the handle
+ */
+static int dc_write_binary(netloc_data_collection_handle_t *handle);
+
+/**
+ * Write out a path file one source node at a time, rebuilding the paths
+ * from the shortest path trees as needed, so that the JSON of all of the
+ * paths is never held in memory at once.
+ */
+static int dc_write_paths_file(netloc_data_collection_handle_t *handle,
+                               const char *fname,
+                               json_t *json_network,
+                               bool is_logical);
+
+/**
+ * Entry of the path index of a path file: [offset, length] in the file
+ */
+static json_t * dc_encode_path_index_entry(long offset, long length);
+
 netloc_data_collection_handle_t * netloc_dt_data_collection_handle_t_construct()
 {
     netloc_data_collection_handle_t *handle = NULL;
@@ -53,6 +75,7 @@ netloc_data_collection_handle_t * netloc_dt_data_collection_handle_t_construct()
     handle->filename_nodes = NULL;
     handle->filename_physical_paths = NULL;
     handle->filename_logical_paths = NULL;
+    handle->filename_binary = NULL;
 
     handle->node_list = NULL;
 
@@ -62,6 +85,13 @@ netloc_data_collection_handle_t * netloc_dt_data_collection_handle_t_construct()
     handle->node_data_acc = NULL;
     handle->path_data = NULL;
     handle->path_data_acc = NULL;
+    handle->phy_path_data = NULL;
+    handle->phy_path_data_acc = NULL;
+    handle->forwarding_data = NULL;
+
+    handle->path_trees = NULL;
+    handle->pathfinder = NULL;
+    handle->path_weight = NULL;
 
     return handle;
 }
@@ -105,6 +135,26 @@ int netloc_dt_data_collection_handle_t_destruct(netloc_data_collection_handle_t
         handle->filename_logical_paths = NULL;
     }
 
+    if( NULL != handle->filename_binary ) {
+        free(handle->filename_binary);
+        handle->filename_binary = NULL;
+    }
+
+    support_pathfinder_destruct(handle->pathfinder);
+    handle->pathfinder = NULL;
+
+    if( NULL != handle->path_trees ) {
+        hti = netloc_dt_lookup_table_iterator_t_construct(handle->path_trees);
+        while( !netloc_lookup_table_iterator_at_end(hti) ) {
+            support_path_tree_destruct((struct netloc_dc_path_tree_t*)netloc_lookup_table_iterator_next_entry(hti));
+        }
+        netloc_dt_lookup_table_iterator_t_destruct(hti);
+
+        netloc_lookup_table_destroy(handle->path_trees);
+        free(handle->path_trees);
+        handle->path_trees = NULL;
+    }
+
     if( NULL != handle->node_list ) {
         // Make sure to free all of the nodes pointed to in the lookup table
         hti = netloc_dt_lookup_table_iterator_t_construct(handle->node_list);
@@ -151,6 +201,11 @@ int netloc_dt_data_collection_handle_t_destruct(netloc_data_collection_handle_t
         // Implied decref of handle->path_data_acc
     }
 
+    if( NULL != handle->forwarding_data ) {
+        json_decref(handle->forwarding_data);
+        handle->forwarding_data = NULL;
+    }
+
     free( handle );
 
     return NETLOC_SUCCESS;
@@ -199,6 +254,7 @@ netloc_data_collection_handle_t * netloc_dc_create(netloc_network_t *network, ch
     asprintf(&handle->filename_nodes, "%s/%s-nodes.ndat", dir, handle->unique_id_str);
     asprintf(&handle->filename_physical_paths, "%s/%s-phy-paths.ndat", dir, handle->unique_id_str);
     asprintf(&handle->filename_logical_paths, "%s/%s-log-paths.ndat", dir, handle->unique_id_str);
+    asprintf(&handle->filename_binary, "%s/%s-%s", dir, handle->unique_id_str, SUPPORT_BINARY_SUFFIX);
     asprintf(&handle->data_uri, "file://%s", dir);
 
     handle->is_open       = true;
@@ -219,6 +275,8 @@ netloc_data_collection_handle_t * netloc_dc_create(netloc_network_t *network, ch
     json_object_set_new(handle->phy_path_data, JSON_NODE_FILE_NETWORK_INFO, netloc_dt_network_t_json_encode(handle->network));
     handle->phy_path_data_acc = json_object();
 
+    handle->forwarding_data = json_object();
+
     return handle;
 }
 
@@ -243,6 +301,12 @@ int netloc_dc_close(netloc_data_collection_handle_t *handle)
     }
 
 
+    /*
+     * Remove any previous binary topology cache, so it is never picked up
+     * alongside the new JSON files if we fail to write the new one.
+     */
+    unlink(handle->filename_binary);
+
     /******************** Node and Edge Data **************************/
 
     json_object_set_new(handle->node_data, JSON_NODE_FILE_NODE_INFO, handle->node_data_acc);
@@ -267,69 +331,47 @@ int netloc_dc_close(netloc_data_collection_handle_t *handle)
 
 
     /******************** Physical Path Data **************************/
-    struct netloc_dt_lookup_table_iterator *hti = NULL;
-    netloc_node_t *cur_node = NULL;
-
-    /*
-     * Add path entries to the JSON file (physical path)
-     */
-    hti = netloc_dt_lookup_table_iterator_t_construct(handle->node_list);
-    while( !netloc_lookup_table_iterator_at_end(hti) ) {
-        cur_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti);
-        if( NULL == cur_node ) {
-            break;
-        }
-
-        json_object_set_new(handle->phy_path_data_acc,
-                            cur_node->physical_id,
-                            netloc_dt_node_t_json_encode_paths(cur_node, cur_node->physical_paths));
-    }
-    netloc_dt_lookup_table_iterator_t_destruct(hti);
-    json_object_set_new(handle->phy_path_data, JSON_NODE_FILE_PATH_INFO, handle->phy_path_data_acc);
-
-    /*
-     * Write out path data
-     */
-    ret = json_dump_file(handle->phy_path_data, handle->filename_physical_paths, JSON_COMPACT);
-    if( 0 != ret ) {
+    ret = dc_write_paths_file(handle, handle->filename_physical_paths,
+                              json_object_get(handle->phy_path_data, JSON_NODE_FILE_NETWORK_INFO),
+                              false);
+    if( NETLOC_SUCCESS != ret ) {
         fprintf(stderr, "Error: Failed to write out physical path JSON file!\n");
         return NETLOC_ERROR;
     }
 
     json_decref(handle->phy_path_data);
     handle->phy_path_data = NULL;
+    json_decref(handle->phy_path_data_acc);
+    handle->phy_path_data_acc = NULL;
 
 
     /******************** Logical Path Data **************************/
-
-    /*
-     * Add path entries to the JSON file (logical path)
-     */
-    hti = netloc_dt_lookup_table_iterator_t_construct(handle->node_list);
-    while( !netloc_lookup_table_iterator_at_end(hti) ) {
-        cur_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti);
-        if( NULL == cur_node ) {
-            break;
-        }
-
-        json_object_set_new(handle->path_data_acc,
-                            cur_node->physical_id,
-                            netloc_dt_node_t_json_encode_paths(cur_node, cur_node->logical_paths));
-    }
-    netloc_dt_lookup_table_iterator_t_destruct(hti);
-    json_object_set_new(handle->path_data, JSON_NODE_FILE_PATH_INFO, handle->path_data_acc);
-
-    /*
-     * Write out path data
-     */
-    ret = json_dump_file(handle->path_data, handle->filename_logical_paths, JSON_COMPACT);
-    if( 0 != ret ) {
+    ret = dc_write_paths_file(handle, handle->filename_logical_paths,
+                              json_object_get(handle->path_data, JSON_NODE_FILE_NETWORK_INFO),
+                              true);
+    if( NETLOC_SUCCESS != ret ) {
         fprintf(stderr, "Error: Failed to write out logical path JSON file!\n");
         return NETLOC_ERROR;
     }
 
     json_decref(handle->path_data);
     handle->path_data = NULL;
+    json_decref(handle->path_data_acc);
+    handle->path_data_acc = NULL;
+    json_decref(handle->forwarding_data);
+    handle->forwarding_data = NULL;
+
+
+    /******************** Binary Topology Cache **************************/
+
+    /*
+     * Read back the JSON files just written, and store them in the binary
+     * format. This is only a cache, so failing here is not fatal.
+     */
+    ret = dc_write_binary(handle);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Warning: Failed to write out the binary topology file %s\n", handle->filename_binary);
+    }
 
     /*
      * Mark file as closed
@@ -633,6 +675,48 @@ int netloc_dc_append_path(netloc_data_collection_handle_t *handle,
     return NETLOC_SUCCESS;
 }
 
+int netloc_dc_append_forwarding_entry(netloc_data_collection_handle_t *handle,
+                                      const char * node_id,
+                                      const char * dest_logical_id,
+                                      netloc_edge_t *edge)
+{
+    netloc_node_t *node = NULL;
+    json_t *json_table = NULL;
+    unsigned long key_int;
+
+    if( NULL == node_id || NULL == dest_logical_id || NULL == edge ) {
+        fprintf(stderr, "Error: Null forwarding entry provided\n");
+        return NETLOC_ERROR;
+    }
+
+    /*
+     * Find the Node
+     */
+    SUPPORT_CONVERT_ADDR_TO_INT(node_id, handle->network->network_type, key_int);
+    node = netloc_lookup_table_access_with_int( handle->node_list, node_id, key_int );
+    if( NULL == node ) {
+        fprintf(stderr, "Error: node not found in the list (id = %s)\n", node_id);
+        return NETLOC_ERROR_NOT_FOUND;
+    }
+
+    if( NULL == edge->src_node_id || 0 != strcmp(edge->src_node_id, node->physical_id) ) {
+        fprintf(stderr, "Error: edge %d does not leave the node %s\n", edge->edge_uid, node_id);
+        return NETLOC_ERROR;
+    }
+
+    /*
+     * Only the edge id is stored: Key = Destination, Value = Edge ID
+     */
+    json_table = json_object_get(handle->forwarding_data, node->physical_id);
+    if( NULL == json_table ) {
+        json_table = json_object();
+        json_object_set_new(handle->forwarding_data, node->physical_id, json_table);
+    }
+    json_object_set_new(json_table, dest_logical_id, json_integer(edge->edge_uid));
+
+    return NETLOC_SUCCESS;
+}
+
 int netloc_dc_append_edge_to_node_by_id(netloc_data_collection_handle_t *handle, char * phy_id, netloc_edge_t *edge)
 {
     netloc_node_t *node = NULL;
@@ -759,6 +843,179 @@ static void display_path(const char * src, const char * dest, int num_edges, net
     printf("\n");
 }
 
+static int dc_write_paths_file(netloc_data_collection_handle_t *handle,
+                               const char *fname,
+                               json_t *json_network,
+                               bool is_logical)
+{
+    int ret, exit_status = NETLOC_SUCCESS;
+    FILE *fp = NULL;
+    bool first = true;
+    unsigned long key_int;
+    struct netloc_dt_lookup_table_iterator *hti = NULL;
+    netloc_node_t *cur_node = NULL;
+    struct netloc_dc_path_tree_t *tree = NULL;
+    netloc_edge_t **edges_by_uid = NULL;
+    int num_edge_uids = 0;
+    json_t *json_key = NULL;
+    json_t *json_paths = NULL;
+    json_t *json_index = NULL;
+    json_t *json_index_paths = NULL;
+    long offset;
+
+    // Only physical paths come from shortest path trees
+    if( !is_logical && NULL != handle->path_trees && NULL != handle->edges ) {
+        edges_by_uid = netloc_dt_edge_index_t_construct(handle->edges, &num_edge_uids);
+        if( NULL == edges_by_uid ) {
+            fprintf(stderr, "Error: Failed to index the edges\n");
+            return NETLOC_ERROR;
+        }
+    }
+
+    fp = fopen(fname, "w");
+    if( NULL == fp ) {
+        fprintf(stderr, "Error: Failed to open the file %s for writing\n", fname);
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    /*
+     * Where the paths of every source node are written, so that readers
+     * can load them one source node at a time (see support_path_source_t)
+     */
+    json_index = json_object();
+    json_index_paths = json_object();
+    json_object_set_new(json_index, JSON_NODE_FILE_PATH_INFO, json_index_paths);
+
+    fprintf(fp, "{\"%s\":", JSON_NODE_FILE_NETWORK_INFO);
+    json_dumpf(json_network, fp, JSON_COMPACT);
+    fprintf(fp, ",\"%s\":{", JSON_NODE_FILE_PATH_INFO);
+
+    hti = netloc_dt_lookup_table_iterator_t_construct(handle->node_list);
+    while( !netloc_lookup_table_iterator_at_end(hti) ) {
+        cur_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti);
+        if( NULL == cur_node ) {
+            break;
+        }
+
+        json_paths = netloc_dt_node_t_json_encode_paths(cur_node,
+                                                        (is_logical ? cur_node->logical_paths : cur_node->physical_paths));
+
+        if( NULL != edges_by_uid ) {
+            SUPPORT_CONVERT_ADDR_TO_INT(cur_node->physical_id, handle->network->network_type, key_int);
+            tree = (struct netloc_dc_path_tree_t*)netloc_lookup_table_access_with_int(handle->path_trees,
+                                                                                      cur_node->physical_id,
+                                                                                      key_int);
+            if( NULL != tree ) {
+                ret = support_path_tree_json_encode(tree, edges_by_uid, num_edge_uids, json_paths);
+                if( NETLOC_SUCCESS != ret ) {
+                    json_decref(json_paths);
+                    exit_status = ret;
+                    goto cleanup;
+                }
+            }
+        }
+
+        // Key = Source
+        json_key = json_string(cur_node->physical_id);
+        if( !first ) {
+            fputc(',', fp);
+        }
+        first = false;
+        json_dumpf(json_key, fp, JSON_ENCODE_ANY);
+        fputc(':', fp);
+        offset = ftell(fp);
+        json_dumpf(json_paths, fp, JSON_COMPACT);
+        json_object_set_new(json_index_paths, cur_node->physical_id,
+                            dc_encode_path_index_entry(offset, ftell(fp) - offset));
+
+        json_decref(json_key);
+        json_decref(json_paths);
+    }
+
+    fputc('}', fp);
+
+    // Forwarding tables of the switches, from which the other logical paths are expanded
+    if( is_logical && NULL != handle->forwarding_data && 0 < json_object_size(handle->forwarding_data) ) {
+        fprintf(fp, ",\"%s\":", JSON_NODE_FILE_FORWARDING_INFO);
+        offset = ftell(fp);
+        json_dumpf(handle->forwarding_data, fp, JSON_COMPACT);
+        json_object_set_new(json_index, JSON_NODE_FILE_FORWARDING_INFO,
+                            dc_encode_path_index_entry(offset, ftell(fp) - offset));
+    }
+
+    // Last, where readers look for it
+    fprintf(fp, ",\"%s\":", JSON_NODE_FILE_PATH_INDEX);
+    json_dumpf(json_index, fp, JSON_COMPACT);
+
+    fputc('}', fp);
+
+ cleanup:
+    netloc_dt_lookup_table_iterator_t_destruct(hti);
+
+    if( NULL != fp ) {
+        if( 0 != ferror(fp) ) {
+            fprintf(stderr, "Error: Failed to write to the file %s\n", fname);
+            exit_status = NETLOC_ERROR;
+        }
+        if( 0 != fclose(fp) ) {
+            exit_status = NETLOC_ERROR;
+        }
+    }
+
+    if( NULL != edges_by_uid ) {
+        free(edges_by_uid);
+    }
+
+    json_decref(json_index);
+
+    return exit_status;
+}
+
+static int dc_write_binary(netloc_data_collection_handle_t *handle)
+{
+    int ret;
+    netloc_network_t *network = NULL;
+    netloc_topology_t topology = NULL;
+
+    network = netloc_dt_network_t_dup(handle->network);
+    if( NULL == network ) {
+        return NETLOC_ERROR;
+    }
+
+    free(network->node_uri);
+    free(network->phy_path_uri);
+    free(network->path_uri);
+    network->node_uri     = strdup(handle->filename_nodes);
+    network->phy_path_uri = strdup(handle->filename_physical_paths);
+    network->path_uri     = strdup(handle->filename_logical_paths);
+
+    ret = netloc_attach(&topology, *network);
+    netloc_dt_network_t_destruct(network);
+    if( NETLOC_SUCCESS != ret ) {
+        return ret;
+    }
+
+    ret = support_load_json_files(topology);
+    if( NETLOC_SUCCESS == ret ) {
+        ret = support_write_binary(topology, handle->filename_binary);
+    }
+
+    netloc_detach(topology);
+
+    return ret;
+}
+
+static json_t * dc_encode_path_index_entry(long offset, long length)
+{
+    json_t *json_entry = json_array();
+
+    json_array_append_new(json_entry, json_integer(offset));
+    json_array_append_new(json_entry, json_integer(length));
+
+    return json_entry;
+}
+
 json_t* dc_encode_edge(const char * key, void *value)
 {
     return netloc_dt_edge_t_json_encode((netloc_edge_t*)value);
@@ -279,6 +279,7 @@ netloc_edge_t * netloc_dt_edge_t_construct()
 
     edge->speed = NULL;
     edge->width = NULL;
+    edge->bandwidth = 0;
 
     edge->description = NULL;
 
@@ -376,6 +377,9 @@ int netloc_dt_edge_t_copy(netloc_edge_t *from, netloc_edge_t *to)
     }
     to->width = STRDUP_IF_NOT_NULL(from->width);
 
+    // Readers set the strings directly, so parse them here
+    to->bandwidth = support_parse_edge_bandwidth(to->speed, to->width);
+
 
     if( NULL != to->description ) {
         free(to->description);
@@ -432,6 +436,7 @@ netloc_edge_t* netloc_dt_edge_t_json_decode(json_t *json_edge)
 
     ASSIGN_NULL_IF_EMPTY( edge->speed, json_edge, JSON_NODE_FILE_EDGE_SPEED);
     ASSIGN_NULL_IF_EMPTY( edge->width, json_edge, JSON_NODE_FILE_EDGE_WIDTH);
+    edge->bandwidth = support_parse_edge_bandwidth(edge->speed, edge->width);
 
     ASSIGN_NULL_IF_EMPTY( edge->description, json_edge, JSON_NODE_FILE_DESCRIPTION );
 
@@ -702,12 +707,11 @@ json_t* netloc_dt_node_t_json_encode(netloc_node_t *node)
     return json_node;
 }
 
-netloc_node_t* netloc_dt_node_t_json_decode(struct netloc_dt_lookup_table *edge_table, json_t *json_node)
+netloc_node_t* netloc_dt_node_t_json_decode(netloc_edge_t **edges_by_uid, int num_edge_uids, json_t *json_node)
 {
     netloc_node_t *node = NULL;
     size_t i;
     json_t *edge_list = NULL;
-    char * key = NULL;
 
     node = netloc_dt_node_t_construct();
     if( NULL == node ) {
@@ -746,8 +750,7 @@ netloc_node_t* netloc_dt_node_t_json_decode(struct netloc_dt_lookup_table *edge_
 
     for(i = 0; i < node->num_edge_ids; ++i) {
         node->edge_ids[i] = json_integer_value( json_array_get(edge_list, i));
-        asprintf(&key, "%d", node->edge_ids[i]);
-        node->edges[i] = (netloc_edge_t*)netloc_lookup_table_access(edge_table, key);
+        node->edges[i] = NETLOC_DT_EDGE_BY_UID(edges_by_uid, num_edge_uids, node->edge_ids[i]);
         if( NULL == node->edges[i] ) {
             printf("Error: Failed to find edge UID %d for the following node\n",node->edge_ids[i]);
             printf("Error: \t%s\n", netloc_pretty_print_node_t(node));
@@ -758,8 +761,6 @@ netloc_node_t* netloc_dt_node_t_json_decode(struct netloc_dt_lookup_table *edge_
         // Note: We cannot fill in the dest_node since that node may not exist yet.
         //       We can only do that after all nodes have been read.
         node->edges[i]->src_node = node;
-
-        free(key);
     }
 
     /** Do not decode the Logical Paths here. **/
@@ -808,7 +809,7 @@ json_t* netloc_dt_node_t_json_encode_paths(netloc_node_t *node, struct netloc_dt
     return json_all_paths;
 }
 
-struct netloc_dt_lookup_table * netloc_dt_node_t_json_decode_paths(struct netloc_dt_lookup_table *edge_table, json_t *json_all_paths)
+struct netloc_dt_lookup_table * netloc_dt_node_t_json_decode_paths(netloc_edge_t **edges_by_uid, int num_edge_uids, json_t *json_all_paths)
 {
     struct netloc_dt_lookup_table * ht = NULL;
     size_t size = 0;
@@ -818,9 +819,7 @@ struct netloc_dt_lookup_table * netloc_dt_node_t_json_decode_paths(struct netloc
 
     size_t i, j, num_edges = 0;
     netloc_edge_t **edges = NULL;
-    int *edge_ids = NULL;
-
-    char *edge_key = NULL;
+    int edge_id;
 
     ht = calloc(1, sizeof(*ht));
 
@@ -836,47 +835,28 @@ struct netloc_dt_lookup_table * netloc_dt_node_t_json_decode_paths(struct netloc
         num_edges = json_array_size(value1);
 
         /*
-         * Only edge_id's are stored in the JSON file, so we need a temporary
-         * structure to hold those ids before we translate them to real edge
-         * pointers.
-         */
-        edge_ids = (int*)malloc(sizeof(int) * (num_edges));
-        if( NULL == edge_ids ) {
-            return NULL;
-        }
-
-        for(i = 0; i < num_edges; ++i ) {
-            edge_ids[i] = json_integer_value( json_array_get(value1, i) );
-        }
-
-        /*
-         * Now that we have the edge ids, find the cooresponding pointer in the
-         * edge_table
+         * Only edge_id's are stored in the JSON file, translate them directly
+         * to the edge pointers through the edge_uid index.
          */
         edges = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * (num_edges+1));
         if( NULL == edges ) {
-            free(edge_ids);
-            edge_ids = NULL;
             return NULL;
         }
 
         for(i = 0; i < num_edges; ++i ) {
-            asprintf(&edge_key, "%d", edge_ids[i]);
-            edges[i] = (netloc_edge_t*)netloc_lookup_table_access(edge_table, edge_key);
+            edge_id = json_integer_value( json_array_get(value1, i) );
+            edges[i] = NETLOC_DT_EDGE_BY_UID(edges_by_uid, num_edge_uids, edge_id);
             if( NULL == edges[i] ) {
-                printf("Error: Failed to find edge UID %d while decoding the path:\n", edge_ids[i]);
+                printf("Error: Failed to find edge UID %d while decoding the path:\n", edge_id);
                 printf("Error: \t");
                 for(j = 0; j < num_edges; ++j) {
-                    printf("%3d,", edge_ids[j]);
+                    printf("%3d,", (int)json_integer_value( json_array_get(value1, j) ));
                 }
                 printf("\n");
 
-                free(edge_ids);
-                edge_ids = NULL;
+                free(edges);
                 return NULL;
             }
-            free(edge_key);
-            edge_key = NULL;
         }
         // Null terminated array
         edges[num_edges] = NULL;
@@ -887,24 +867,55 @@ struct netloc_dt_lookup_table * netloc_dt_node_t_json_decode_paths(struct netloc
          */
         netloc_lookup_table_append(ht, key1, edges);
         edges = NULL; // Do --not-- free the memory.
+    }
 
-        if( NULL != edge_ids ) {
-            free(edge_ids);
-            edge_ids = NULL;
+    return ht;
+}
+
+netloc_edge_t ** netloc_dt_edge_index_t_construct(struct netloc_dt_lookup_table *edge_table, int *num_edge_uids)
+{
+    struct netloc_dt_lookup_table_iterator *hti = NULL;
+    netloc_edge_t *cur_edge = NULL;
+    netloc_edge_t **edges_by_uid = NULL;
+    int max_uid = -1;
+
+    (*num_edge_uids) = 0;
+
+    // Edge UIDs are handed out from NETLOC_EDGE_UID_START, so size the
+    // index by the largest one seen.
+    hti = netloc_dt_lookup_table_iterator_t_construct(edge_table);
+    while( !netloc_lookup_table_iterator_at_end(hti) ) {
+        cur_edge = (netloc_edge_t*)netloc_lookup_table_iterator_next_entry(hti);
+        if( NULL == cur_edge ) {
+            break;
+        }
+        if( cur_edge->edge_uid > max_uid ) {
+            max_uid = cur_edge->edge_uid;
         }
     }
 
-    if( NULL != edge_ids ) {
-        free(edge_ids);
-        edge_ids = NULL;
+    // At least one slot, as calloc(0) may return NULL for a network without edges
+    edges_by_uid = (netloc_edge_t**)calloc((max_uid < 0 ? 1 : max_uid + 1), sizeof(netloc_edge_t*));
+    if( NULL == edges_by_uid ) {
+        netloc_dt_lookup_table_iterator_t_destruct(hti);
+        return NULL;
     }
 
-    if( NULL != edge_key ) {
-        free(edge_key);
-        edge_key = NULL;
+    netloc_lookup_table_iterator_reset(hti);
+    while( !netloc_lookup_table_iterator_at_end(hti) ) {
+        cur_edge = (netloc_edge_t*)netloc_lookup_table_iterator_next_entry(hti);
+        if( NULL == cur_edge ) {
+            break;
+        }
+        if( cur_edge->edge_uid >= NETLOC_EDGE_UID_START ) {
+            edges_by_uid[cur_edge->edge_uid] = cur_edge;
+        }
     }
+    netloc_dt_lookup_table_iterator_t_destruct(hti);
 
-    return ht;
+    (*num_edge_uids) = max_uid + 1;
+
+    return edges_by_uid;
 }
 
 
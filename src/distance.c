@@ -0,0 +1,534 @@
+/*
+ * Copyright (c) 2013-2014 University of Wisconsin-La Crosse.
+ *                         All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ * See COPYING in top-level directory.
+ *
+ * $HEADER$
+ */
+
+#include <netloc.h>
+#include <private/netloc.h>
+#include "support.h"
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * Host to host hop distances
+ *
+ * One breadth first search per host over the physical graph (the edges of
+ * every node), spread over a few threads. Each search only writes the row
+ * of its source, so the threads share nothing but the next source to take.
+ *
+ * The matrix may be cached next to the .ndat files of the network:
+ *
+ *   header     (struct distance_header_t)
+ *   host IDs   (uint64_t[num_hosts], physical_id_int of the hosts in order)
+ *   distances  (uint16_t[num_hosts * num_hosts], row major)
+ *
+ * Values are stored in host byte order, the header records the byte order
+ * so a foreign file is rejected. The header also records the size and
+ * modification time of the .ndat files the matrix was computed from, and
+ * the matrix is only used while they are all exactly the same.
+ */
+#define DISTANCE_MAGIC      "NLDIST\0"
+#define DISTANCE_VERSION    2
+#define DISTANCE_BYTE_ORDER 0x01020304
+
+/**
+ * Number of sources a thread takes at a time
+ */
+#define DISTANCE_SOURCES_PER_CLAIM 16
+
+struct distance_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t num_hosts;
+    uint32_t pad;
+    uint64_t file_size;
+    /** Stamps of the nodes, physical paths and logical paths files */
+    struct support_file_stamp_t sources[SUPPORT_NUM_JSON_FILES];
+};
+
+/**
+ * Shared state of the threads of netloc_get_distance_matrix
+ */
+struct distance_state_t {
+    pthread_mutex_t lock;
+    /** Next source to take (protected by lock) */
+    int next_src;
+    /** First error seen by a thread (protected by lock) */
+    int status;
+
+    int num_nodes;
+    /** Graph of the topology (read only) */
+    struct support_graph_t *graph;
+    int num_hosts;
+    netloc_node_t **hosts;
+    /** Position of each node (by __uid__) in hosts, -1 if not a host */
+    int *host_index;
+    uint16_t *distances;
+};
+
+struct distance_worker_t {
+    struct distance_state_t *state;
+    pthread_t thread;
+};
+
+static int distance_host_compare(const void *a, const void *b);
+static void * distance_worker(void *arg);
+static void distance_bfs(struct distance_state_t *state, int src,
+                         int *hops, int *queue);
+
+static char * distance_filename(netloc_network_t *network);
+static int distance_read_cache(const char * fname, netloc_network_t *network,
+                               int num_hosts, netloc_node_t **hosts,
+                               uint16_t *distances);
+static int distance_write_cache(const char * fname, netloc_network_t *network,
+                                int num_hosts, netloc_node_t **hosts,
+                                uint16_t *distances);
+
+/*****************************************************/
+
+int netloc_get_distance_matrix(struct netloc_topology * topology,
+                               int num_threads,
+                               unsigned long flags,
+                               int *num_hosts,
+                               netloc_node_t ***hosts,
+                               uint16_t **distances)
+{
+    int ret, exit_status = NETLOC_SUCCESS;
+    int i, num_workers = 0;
+    char *cache_fname = NULL;
+    struct distance_state_t state;
+    struct distance_worker_t *workers = NULL;
+    bool lock_init = false;
+
+    // Just in case things go poorly below
+    (*num_hosts) = 0;
+    (*hosts)     = NULL;
+    (*distances) = NULL;
+
+    state.host_index = NULL;
+    state.hosts      = NULL;
+    state.distances  = NULL;
+
+    /*
+     * Lazy load the node information
+     */
+    if( !topology->nodes_loaded ) {
+        ret = support_load_json(topology);
+        if( NETLOC_SUCCESS != ret ) {
+            fprintf(stderr, "Error: Failed to load the topology\n");
+            return ret;
+        }
+    }
+
+    if( num_threads < 1 ) {
+        num_threads = 1;
+    }
+
+    // Built before the threads start, they only read it
+    state.graph = support_topology_graph(topology);
+    if( NULL == state.graph ) {
+        return NETLOC_ERROR;
+    }
+
+    /*
+     * The hosts, sorted by physical ID. The node list follows the order of
+     * the JSON objects, which may change from one process to the next.
+     */
+    state.num_nodes  = topology->num_nodes;
+    state.num_hosts  = 0;
+    state.hosts      = (netloc_node_t**)malloc(sizeof(netloc_node_t*) * (topology->num_nodes > 0 ? topology->num_nodes : 1));
+    state.host_index = (int*)malloc(sizeof(int) * (topology->num_nodes > 0 ? topology->num_nodes : 1));
+    if( NULL == state.hosts || NULL == state.host_index ) {
+        fprintf(stderr, "Error: Failed to allocate the host array\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    for(i = 0; i < topology->num_nodes; ++i) {
+        state.host_index[i] = -1;
+        if( NETLOC_NODE_TYPE_HOST == state.graph->node_types[i] ) {
+            state.hosts[state.num_hosts++] = topology->nodes[i];
+        }
+    }
+    qsort(state.hosts, state.num_hosts, sizeof(netloc_node_t*), distance_host_compare);
+    for(i = 0; i < state.num_hosts; ++i) {
+        state.host_index[state.hosts[i]->__uid__] = i;
+    }
+
+    if( 0 == state.num_hosts ) {
+        exit_status = NETLOC_ERROR_NOT_FOUND;
+        goto cleanup;
+    }
+
+    state.distances = (uint16_t*)malloc(sizeof(uint16_t) * state.num_hosts * state.num_hosts);
+    if( NULL == state.distances ) {
+        fprintf(stderr, "Error: Failed to allocate the distance matrix\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    /*
+     * Use the cached matrix if it is current and matches the hosts
+     */
+    if( flags & NETLOC_DISTANCE_FLAG_CACHE ) {
+        cache_fname = distance_filename(topology->network);
+        if( NULL != cache_fname &&
+            NETLOC_SUCCESS == distance_read_cache(cache_fname, topology->network,
+                                                  state.num_hosts, state.hosts, state.distances) ) {
+            goto done;
+        }
+    }
+
+    /*
+     * Compute the rows
+     */
+    state.next_src = 0;
+    state.status   = NETLOC_SUCCESS;
+    if( 0 != pthread_mutex_init(&state.lock, NULL) ) {
+        fprintf(stderr, "Error: Failed to initialize the distance lock\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    lock_init = true;
+
+    if( num_threads > state.num_hosts ) {
+        num_threads = state.num_hosts;
+    }
+
+    workers = (struct distance_worker_t*)calloc(num_threads, sizeof(struct distance_worker_t));
+    if( NULL == workers ) {
+        fprintf(stderr, "Error: Failed to allocate the distance threads\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    for(i = 0; i < num_threads; ++i) {
+        workers[i].state = &state;
+    }
+
+    if( 1 == num_threads ) {
+        distance_worker(&workers[0]);
+    } else {
+        for(num_workers = 0; num_workers < num_threads; ++num_workers) {
+            ret = pthread_create(&workers[num_workers].thread, NULL, distance_worker, &workers[num_workers]);
+            if( 0 != ret ) {
+                // The threads that did start take the remaining sources
+                fprintf(stderr, "Error: Failed to start distance thread %d\n", num_workers);
+                break;
+            }
+        }
+        if( 0 == num_workers ) {
+            distance_worker(&workers[0]);
+        }
+        for(i = 0; i < num_workers; ++i) {
+            pthread_join(workers[i].thread, NULL);
+        }
+    }
+
+    if( NETLOC_SUCCESS != state.status ) {
+        exit_status = state.status;
+        goto cleanup;
+    }
+
+    // A cache that cannot be written is not an error for the caller
+    if( NULL != cache_fname ) {
+        if( NETLOC_SUCCESS != distance_write_cache(cache_fname, topology->network,
+                                                   state.num_hosts, state.hosts, state.distances) ) {
+            fprintf(stderr, "Warning: Failed to cache the distance matrix in <%s>\n", cache_fname);
+        }
+    }
+
+ done:
+    // Hand the arrays over to the caller
+    (*num_hosts)    = state.num_hosts;
+    (*hosts)        = state.hosts;
+    (*distances)    = state.distances;
+    state.hosts     = NULL;
+    state.distances = NULL;
+
+ cleanup:
+    if( lock_init ) {
+        pthread_mutex_destroy(&state.lock);
+    }
+
+    free(workers);
+    free(cache_fname);
+    free(state.host_index);
+    free(state.hosts);
+    free(state.distances);
+
+    return exit_status;
+}
+
+/*****************************************************/
+
+static int distance_host_compare(const void *a, const void *b)
+{
+    const netloc_node_t *node_a = *(netloc_node_t * const *)a;
+    const netloc_node_t *node_b = *(netloc_node_t * const *)b;
+
+    return strcmp(node_a->physical_id, node_b->physical_id);
+}
+
+static void * distance_worker(void *arg)
+{
+    struct distance_worker_t *worker = (struct distance_worker_t*)arg;
+    struct distance_state_t *state = worker->state;
+    int *hops = NULL;
+    int *queue = NULL;
+    int s, first;
+
+    hops  = (int*)malloc(sizeof(int) * state->num_nodes);
+    queue = (int*)malloc(sizeof(int) * state->num_nodes);
+    if( NULL == hops || NULL == queue ) {
+        fprintf(stderr, "Error: Failed to allocate the distance search space\n");
+        pthread_mutex_lock(&state->lock);
+        state->status = NETLOC_ERROR;
+        pthread_mutex_unlock(&state->lock);
+        goto cleanup;
+    }
+
+    while( true ) {
+        // Take the next few sources
+        pthread_mutex_lock(&state->lock);
+        first = state->next_src;
+        state->next_src += DISTANCE_SOURCES_PER_CLAIM;
+        if( NETLOC_SUCCESS != state->status ) {
+            first = state->num_hosts;
+        }
+        pthread_mutex_unlock(&state->lock);
+        if( first >= state->num_hosts ) {
+            break;
+        }
+
+        for(s = first; s < first + DISTANCE_SOURCES_PER_CLAIM && s < state->num_hosts; ++s) {
+            distance_bfs(state, s, hops, queue);
+        }
+    }
+
+ cleanup:
+    free(hops);
+    free(queue);
+
+    return NULL;
+}
+
+static void distance_bfs(struct distance_state_t *state, int src,
+                         int *hops, int *queue)
+{
+    int i, e, d, head = 0, tail = 0;
+    int found = 0;
+    int idx_u, idx_v;
+    const int *edge_offsets = state->graph->edge_offsets;
+    const int *edge_dests = state->graph->edge_dests;
+    uint16_t *row = &state->distances[(size_t)src * state->num_hosts];
+
+    for(i = 0; i < state->num_nodes; ++i) {
+        hops[i] = -1;
+    }
+    for(i = 0; i < state->num_hosts; ++i) {
+        row[i] = NETLOC_DISTANCE_UNREACHABLE;
+    }
+
+    hops[state->hosts[src]->__uid__] = 0;
+    queue[tail++] = state->hosts[src]->__uid__;
+
+    // Stop as soon as every host has been reached
+    while( head < tail && found < state->num_hosts ) {
+        idx_u = queue[head++];
+
+        d = state->host_index[idx_u];
+        if( d >= 0 ) {
+            row[d] = (hops[idx_u] < NETLOC_DISTANCE_UNREACHABLE ?
+                      (uint16_t)hops[idx_u] : NETLOC_DISTANCE_UNREACHABLE - 1);
+            ++found;
+        }
+
+        for(e = edge_offsets[idx_u]; e < edge_offsets[idx_u+1]; ++e) {
+            idx_v = edge_dests[e];
+            if( idx_v < 0 || hops[idx_v] >= 0 ) {
+                continue;
+            }
+            hops[idx_v] = hops[idx_u] + 1;
+            queue[tail++] = idx_v;
+        }
+    }
+}
+
+static char * distance_filename(netloc_network_t *network)
+{
+    char * fname = NULL;
+    char * binary_fname = NULL;
+    size_t len;
+
+    // Same prefix as the binary topology cache
+    binary_fname = support_binary_filename(network);
+    if( NULL == binary_fname ) {
+        return NULL;
+    }
+
+    len = strlen(binary_fname) - strlen(SUPPORT_BINARY_SUFFIX);
+    asprintf(&fname, "%.*s%s", (int)len, binary_fname, SUPPORT_DISTANCE_SUFFIX);
+    free(binary_fname);
+
+    return fname;
+}
+
+static int distance_read_cache(const char * fname, netloc_network_t *network,
+                               int num_hosts, netloc_node_t **hosts,
+                               uint16_t *distances)
+{
+    int exit_status = NETLOC_SUCCESS;
+    int fd = -1, i;
+    struct stat sb;
+    char *data = NULL;
+    struct distance_header_t *hdr = NULL;
+    uint64_t *host_ids = NULL;
+    struct support_file_stamp_t sources[SUPPORT_NUM_JSON_FILES];
+    size_t size;
+
+    size = sizeof(struct distance_header_t) + sizeof(uint64_t) * num_hosts +
+        sizeof(uint16_t) * num_hosts * num_hosts;
+
+    fd = open(fname, O_RDONLY);
+    if( fd < 0 ) {
+        return NETLOC_ERROR_NOENT;
+    }
+
+    if( 0 != fstat(fd, &sb) || (size_t)sb.st_size != size ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    /*
+     * The whole file at once
+     */
+    data = (char*)malloc(size);
+    if( NULL == data ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    if( (ssize_t)size != read(fd, data, size) ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    hdr = (struct distance_header_t*)data;
+    if( 0 != memcmp(hdr->magic, DISTANCE_MAGIC, sizeof(hdr->magic)) ||
+        DISTANCE_VERSION != hdr->version ||
+        DISTANCE_BYTE_ORDER != hdr->byte_order ||
+        (uint32_t)num_hosts != hdr->num_hosts ||
+        size != hdr->file_size ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    // Computed from the very same files
+    support_binary_json_stamps(network, sources);
+    if( 0 != memcmp(hdr->sources, sources, sizeof(sources)) ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    // The hosts must be the same, in the same order
+    host_ids = (uint64_t*)(data + sizeof(struct distance_header_t));
+    for(i = 0; i < num_hosts; ++i) {
+        if( host_ids[i] != (uint64_t)hosts[i]->physical_id_int ) {
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+    }
+
+    memcpy(distances, host_ids + num_hosts, sizeof(uint16_t) * num_hosts * num_hosts);
+
+ cleanup:
+    free(data);
+    close(fd);
+
+    return exit_status;
+}
+
+static int distance_write_cache(const char * fname, netloc_network_t *network,
+                                int num_hosts, netloc_node_t **hosts,
+                                uint16_t *distances)
+{
+    int exit_status = NETLOC_SUCCESS;
+    int i;
+    struct distance_header_t hdr;
+    uint64_t host_id;
+    char *tmp_fname = NULL;
+    FILE *fh = NULL;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, DISTANCE_MAGIC, sizeof(hdr.magic));
+    hdr.version    = DISTANCE_VERSION;
+    hdr.byte_order = DISTANCE_BYTE_ORDER;
+    hdr.num_hosts  = num_hosts;
+    hdr.file_size  = sizeof(struct distance_header_t) + sizeof(uint64_t) * num_hosts +
+        sizeof(uint16_t) * num_hosts * num_hosts;
+    support_binary_json_stamps(network, hdr.sources);
+
+    /*
+     * Write to a temporary file, and move it in place once complete
+     */
+    asprintf(&tmp_fname, "%s.%d", fname, (int)getpid());
+    fh = fopen(tmp_fname, "w");
+    if( NULL == fh ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    if( 1 != fwrite(&hdr, sizeof(hdr), 1, fh) ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    for(i = 0; i < num_hosts; ++i) {
+        host_id = hosts[i]->physical_id_int;
+        if( 1 != fwrite(&host_id, sizeof(host_id), 1, fh) ) {
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+    }
+    if( 1 != fwrite(distances, sizeof(uint16_t) * num_hosts * num_hosts, 1, fh) ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    if( 0 != fclose(fh) ) {
+        fh = NULL;
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    fh = NULL;
+
+    if( 0 != rename(tmp_fname, fname) ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+ cleanup:
+    if( NULL != fh ) {
+        fclose(fh);
+    }
+    if( NULL != tmp_fname ) {
+        if( NETLOC_SUCCESS != exit_status ) {
+            unlink(tmp_fname);
+        }
+        free(tmp_fname);
+    }
+
+    return exit_status;
+}
@@ -294,6 +294,41 @@ int netloc_topology_export_gexf(struct netloc_topology * topology, const char *
 /*******************************************************************
  * Support Functionality
  *******************************************************************/
+int netloc_topology_export_binary(struct netloc_topology * topology, const char * filename) {
+    int ret;
+    char * default_filename = NULL;
+
+    /*
+     * Lazy load the node information
+     */
+    ret = support_load_json(topology);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: Failed to load the topology\n");
+        return ret;
+    }
+
+    /*
+     * Default: the cache file that netloc_attach picks up
+     */
+    if( NULL == filename ) {
+        default_filename = support_binary_filename(topology->network);
+        if( NULL == default_filename ) {
+            fprintf(stderr, "Error: Cannot determine the binary topology filename of network %s\n",
+                    netloc_pretty_print_network_t(topology->network) );
+            return NETLOC_ERROR;
+        }
+        filename = default_filename;
+    }
+
+    ret = support_write_binary(topology, filename);
+
+    if( NULL != default_filename ) {
+        free(default_filename);
+    }
+
+    return ret;
+}
+
 static int netloc_topology_export_graphml_edge(const netloc_edge_t *edge, FILE *fh) {
     const char * src_type = NULL;
     const char * target_type = NULL;
@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2013-2014 University of Wisconsin-La Crosse.
+ *                         All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ * See COPYING in top-level directory.
+ *
+ * $HEADER$
+ */
+
+#include <netloc.h>
+#include <private/netloc.h>
+#include "support.h"
+
+/*
+ * Logical paths from the forwarding tables
+ *
+ * Instead of one edge list per pair of nodes, the logical path file may hold
+ * the forwarding table of every switch (destination logical ID -> outgoing
+ * edge). A path is expanded on request by following the tables hop by hop,
+ * starting from the first edge of the source node (a host does not forward).
+ *
+ * The expanded paths are kept in an LRU cache on the topology: a lookup
+ * table (keyed by the source and destination __uid__) over a doubly linked
+ * list ordered from the most to the least recently used path. Only
+ * path_cache_size paths are kept in the list, so walking every pair of nodes
+ * with netloc_get_path_copy (which hands out copies) takes bounded memory.
+ *
+ * A path returned by netloc_get_path itself must stay valid until detach: its
+ * entry is pinned, i.e., taken off the list so that it is never evicted.
+ */
+struct path_cache_entry_t {
+    /** Lookup key */
+    unsigned long key;
+    /** Destination node (its physical_id is the string key of the entry) */
+    netloc_node_t *dest_node;
+    /** Number of edges in the path */
+    int num_edges;
+    /** NULL terminated array of edges */
+    netloc_edge_t **path;
+    /** If the path was handed out by netloc_get_path (not in the list) */
+    bool pinned;
+    /** Next more recently used entry */
+    struct path_cache_entry_t *prev;
+    /** Next less recently used entry */
+    struct path_cache_entry_t *next;
+};
+
+struct support_path_cache_t {
+    /** Maximum number of entries in the list */
+    int max_entries;
+    /** Number of entries in the list (the pinned ones are not counted) */
+    int num_entries;
+    /** Entries by key, pinned or not */
+    struct netloc_dt_lookup_table index;
+    /** Most recently used entry */
+    struct path_cache_entry_t *head;
+    /** Least recently used entry (next to be evicted) */
+    struct path_cache_entry_t *tail;
+    /** Room for the longest possible path (num_nodes edges and the NULL),
+     *  where a path is expanded before being copied out at its own size */
+    netloc_edge_t **scratch;
+};
+
+static int expand_path(struct netloc_topology * topology,
+                       netloc_node_t *src_node, netloc_node_t *dest_node,
+                       int *num_edges, netloc_edge_t ***path);
+
+static struct support_path_cache_t * path_cache_construct(int max_entries, int num_nodes);
+static void path_cache_destruct(struct support_path_cache_t *cache);
+static void path_cache_unlink(struct support_path_cache_t *cache, struct path_cache_entry_t *entry);
+static void path_cache_push_front(struct support_path_cache_t *cache, struct path_cache_entry_t *entry);
+static struct path_cache_entry_t * path_cache_insert(struct support_path_cache_t *cache, unsigned long key,
+                                                     netloc_node_t *dest_node,
+                                                     int num_edges, netloc_edge_t **path, bool pinned);
+
+/*****************************************************/
+
+netloc_dt_lookup_table_t support_forwarding_table_get(struct netloc_topology * topology,
+                                                      netloc_node_t *node,
+                                                      size_t size, unsigned long flags)
+{
+    netloc_dt_lookup_table_t table = NULL;
+
+    if( NULL == node || node->__uid__ < 0 || node->__uid__ >= topology->num_nodes ) {
+        return NULL;
+    }
+
+    if( NULL == topology->forwarding_tables ) {
+        topology->forwarding_tables = (netloc_dt_lookup_table_t*)calloc(topology->num_nodes,
+                                                                        sizeof(netloc_dt_lookup_table_t));
+        if( NULL == topology->forwarding_tables ) {
+            return NULL;
+        }
+        topology->num_forwarding_tables = topology->num_nodes;
+    }
+
+    table = topology->forwarding_tables[node->__uid__];
+    if( NULL != table ) {
+        return table;
+    }
+
+    table = calloc(1, sizeof(*table));
+    if( NULL == table ) {
+        return NULL;
+    }
+    if( NETLOC_SUCCESS != netloc_lookup_table_init(table, size, flags) ) {
+        free(table);
+        return NULL;
+    }
+    topology->forwarding_tables[node->__uid__] = table;
+
+    return table;
+}
+
+int support_forwarding_table_json_decode(struct netloc_topology * topology,
+                                         netloc_node_t *node, json_t *json_table)
+{
+    netloc_dt_lookup_table_t table = NULL;
+    netloc_edge_t *edge = NULL;
+    const char *key = NULL;
+    json_t *json_euid = NULL;
+    int edge_uid;
+
+    if( !json_is_object(json_table) ) {
+        fprintf(stderr, "Error: Forwarding table of node %s is not a valid object\n", node->physical_id);
+        return NETLOC_ERROR;
+    }
+
+    table = support_forwarding_table_get(topology, node, json_object_size(json_table), 0);
+    if( NULL == table ) {
+        return NETLOC_ERROR;
+    }
+
+    json_object_foreach(json_table, key, json_euid) {
+        edge_uid = (int)json_integer_value(json_euid);
+        edge = NETLOC_DT_EDGE_BY_UID(topology->edges_by_uid, topology->num_edge_uids, edge_uid);
+        if( NULL == edge || edge->src_node != node ) {
+            fprintf(stderr, "Error: Edge UID %d is not an edge of node %s (forwarding to %s)\n",
+                    edge_uid, node->physical_id, key);
+            return NETLOC_ERROR;
+        }
+
+        if( NETLOC_SUCCESS != netloc_lookup_table_append(table, key, edge) ) {
+            return NETLOC_ERROR;
+        }
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+int support_forwarding_tables_destruct(struct netloc_topology * topology)
+{
+    int i;
+
+    if( NULL != topology->path_cache ) {
+        path_cache_destruct(topology->path_cache);
+        topology->path_cache = NULL;
+    }
+
+    if( NULL != topology->forwarding_tables ) {
+        for(i = 0; i < topology->num_forwarding_tables; ++i) {
+            if( NULL != topology->forwarding_tables[i] ) {
+                netloc_lookup_table_destroy(topology->forwarding_tables[i]);
+                free(topology->forwarding_tables[i]);
+            }
+        }
+        free(topology->forwarding_tables);
+        topology->forwarding_tables = NULL;
+        topology->num_forwarding_tables = 0;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+int support_forwarding_get_path(struct netloc_topology * topology,
+                                netloc_node_t *src_node, netloc_node_t *dest_node,
+                                int *num_edges, netloc_edge_t ***path, bool copy)
+{
+    int ret;
+    unsigned long key;
+    struct path_cache_entry_t *entry = NULL;
+    netloc_edge_t **edges = NULL;
+
+    (*num_edges) = 0;
+    (*path) = NULL;
+
+    if( NULL == topology->forwarding_tables ) {
+        return NETLOC_ERROR_NOT_FOUND;
+    }
+
+    if( NULL == topology->path_cache ) {
+        topology->path_cache = path_cache_construct(topology->path_cache_size, topology->num_nodes);
+        if( NULL == topology->path_cache ) {
+            return NETLOC_ERROR;
+        }
+    }
+
+    // Never 0, which the lookup table takes as "hash the string key"
+    key = (unsigned long)src_node->__uid__ * topology->num_nodes + dest_node->__uid__ + 1;
+
+    entry = (struct path_cache_entry_t*)netloc_lookup_table_access_with_int(&topology->path_cache->index,
+                                                                            dest_node->physical_id, key);
+    if( NULL != entry ) {
+        if( !entry->pinned ) {
+            path_cache_unlink(topology->path_cache, entry);
+            path_cache_push_front(topology->path_cache, entry);
+        }
+    }
+    else {
+        ret = expand_path(topology, src_node, dest_node, num_edges, &edges);
+        if( NETLOC_SUCCESS != ret ) {
+            return ret;
+        }
+
+        entry = path_cache_insert(topology->path_cache, key, dest_node, (*num_edges), edges, !copy);
+        if( NULL == entry ) {
+            free(edges);
+            (*num_edges) = 0;
+            return NETLOC_ERROR;
+        }
+    }
+
+    /*
+     * A copy leaves the entry evictable, while a path handed out as is must
+     * stay valid until detach
+     */
+    if( copy ) {
+        edges = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * (entry->num_edges + 1));
+        if( NULL == edges ) {
+            return NETLOC_ERROR;
+        }
+        memcpy(edges, entry->path, sizeof(netloc_edge_t*) * (entry->num_edges + 1));
+    }
+    else {
+        if( !entry->pinned ) {
+            path_cache_unlink(topology->path_cache, entry);
+            topology->path_cache->num_entries -= 1;
+            entry->pinned = true;
+        }
+        edges = entry->path;
+    }
+
+    (*num_edges) = entry->num_edges;
+    (*path) = edges;
+
+    return NETLOC_SUCCESS;
+}
+
+/*****************************************************/
+
+static int expand_path(struct netloc_topology * topology,
+                       netloc_node_t *src_node, netloc_node_t *dest_node,
+                       int *num_edges, netloc_edge_t ***path)
+{
+    netloc_node_t *cur_node = NULL;
+    netloc_edge_t *cur_edge = NULL;
+    netloc_dt_lookup_table_t table = NULL;
+    netloc_edge_t **scratch = topology->path_cache->scratch;
+    netloc_edge_t **edges = NULL;
+    int n = 0;
+
+    if( src_node == dest_node || NULL == dest_node->logical_id ) {
+        return NETLOC_ERROR_NOT_FOUND;
+    }
+
+    /*
+     * A loop-free path visits every node at most once, which bounds the
+     * number of hops in case of a routing loop.
+     */
+
+    cur_node = src_node;
+    while( cur_node != dest_node ) {
+        table = NULL;
+        if( cur_node->__uid__ >= 0 && cur_node->__uid__ < topology->num_forwarding_tables ) {
+            table = topology->forwarding_tables[cur_node->__uid__];
+        }
+
+        if( NULL != table ) {
+            cur_edge = (netloc_edge_t*)netloc_lookup_table_access(table, dest_node->logical_id);
+        }
+        else if( cur_node == src_node && cur_node->num_edges > 0 ) {
+            cur_edge = cur_node->edges[0];
+        }
+        else {
+            cur_edge = NULL;
+        }
+
+        if( NULL == cur_edge || NULL == cur_edge->dest_node || n >= topology->num_nodes ) {
+            return NETLOC_ERROR_NOT_FOUND;
+        }
+
+        scratch[n++] = cur_edge;
+        cur_node = cur_edge->dest_node;
+    }
+
+    // Null terminated array, only as long as the path
+    edges = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * (n + 1));
+    if( NULL == edges ) {
+        return NETLOC_ERROR;
+    }
+    memcpy(edges, scratch, sizeof(netloc_edge_t*) * n);
+    edges[n] = NULL;
+
+    (*num_edges) = n;
+    (*path) = edges;
+
+    return NETLOC_SUCCESS;
+}
+
+static struct support_path_cache_t * path_cache_construct(int max_entries, int num_nodes)
+{
+    struct support_path_cache_t *cache = NULL;
+
+    cache = (struct support_path_cache_t*)calloc(1, sizeof(struct support_path_cache_t));
+    if( NULL == cache ) {
+        return NULL;
+    }
+
+    cache->scratch = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * (num_nodes + 1));
+    if( NULL == cache->scratch ) {
+        free(cache);
+        return NULL;
+    }
+
+    // Keys point into the destination nodes
+    if( NETLOC_SUCCESS != netloc_lookup_table_init(&cache->index, max_entries,
+                                                   NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY) ) {
+        free(cache->scratch);
+        free(cache);
+        return NULL;
+    }
+    cache->max_entries = max_entries;
+
+    return cache;
+}
+
+static void path_cache_destruct(struct support_path_cache_t *cache)
+{
+    struct path_cache_entry_t *entry = NULL;
+    netloc_dt_lookup_table_iterator_t hti = NULL;
+
+    hti = netloc_dt_lookup_table_iterator_t_construct(&cache->index);
+    if( NULL != hti ) {
+        while( !netloc_lookup_table_iterator_at_end(hti) ) {
+            entry = (struct path_cache_entry_t*)netloc_lookup_table_iterator_next_entry(hti);
+            if( NULL == entry ) {
+                break;
+            }
+            free(entry->path);
+            free(entry);
+        }
+        netloc_dt_lookup_table_iterator_t_destruct(hti);
+    }
+
+    netloc_lookup_table_destroy(&cache->index);
+    free(cache->scratch);
+    free(cache);
+}
+
+static void path_cache_unlink(struct support_path_cache_t *cache, struct path_cache_entry_t *entry)
+{
+    if( NULL != entry->prev ) {
+        entry->prev->next = entry->next;
+    } else {
+        cache->head = entry->next;
+    }
+
+    if( NULL != entry->next ) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache->tail = entry->prev;
+    }
+
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void path_cache_push_front(struct support_path_cache_t *cache, struct path_cache_entry_t *entry)
+{
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if( NULL != cache->head ) {
+        cache->head->prev = entry;
+    }
+    cache->head = entry;
+    if( NULL == cache->tail ) {
+        cache->tail = entry;
+    }
+}
+
+static struct path_cache_entry_t * path_cache_insert(struct support_path_cache_t *cache, unsigned long key,
+                                                     netloc_node_t *dest_node,
+                                                     int num_edges, netloc_edge_t **path, bool pinned)
+{
+    struct path_cache_entry_t *entry = NULL;
+
+    /*
+     * Evict the least recently used path to make room, reusing its entry
+     * (no pinned path is ever in the list)
+     */
+    if( !pinned && cache->num_entries >= cache->max_entries && NULL != cache->tail ) {
+        entry = cache->tail;
+        path_cache_unlink(cache, entry);
+        netloc_lookup_table_remove_with_int(&cache->index, entry->dest_node->physical_id, entry->key);
+        free(entry->path);
+        cache->num_entries -= 1;
+    } else {
+        entry = (struct path_cache_entry_t*)malloc(sizeof(struct path_cache_entry_t));
+        if( NULL == entry ) {
+            return NULL;
+        }
+    }
+
+    entry->key       = key;
+    entry->dest_node = dest_node;
+    entry->num_edges = num_edges;
+    entry->path      = path;
+    entry->pinned    = pinned;
+    entry->prev      = NULL;
+    entry->next      = NULL;
+
+    if( NETLOC_SUCCESS != netloc_lookup_table_append_with_int(&cache->index, dest_node->physical_id, key, entry) ) {
+        free(entry);
+        return NULL;
+    }
+    if( !pinned ) {
+        path_cache_push_front(cache, entry);
+        cache->num_entries += 1;
+    }
+
+    return entry;
+}
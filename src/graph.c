@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2013-2014 University of Wisconsin-La Crosse.
+ *                         All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ * See COPYING in top-level directory.
+ *
+ * $HEADER$
+ */
+
+#include <netloc.h>
+#include <private/netloc.h>
+#include "support.h"
+
+/*
+ * Compact view of the graph for the traversals
+ *
+ * The edges of every node are laid out back to back (compressed sparse row),
+ * so that a search reads a few flat int arrays in order instead of chasing
+ * the node -> edge array -> edge -> node pointers.
+ */
+
+/*****************************************************/
+
+struct support_graph_t * support_graph_construct(netloc_node_t **nodes, int num_nodes)
+{
+    struct support_graph_t *graph = NULL;
+    netloc_node_t *dest_node = NULL;
+    int i, e, pos, num_edges = 0;
+
+    for(i = 0; i < num_nodes; ++i) {
+        num_edges += nodes[i]->num_edges;
+    }
+
+    graph = (struct support_graph_t*)calloc(1, sizeof(struct support_graph_t));
+    if( NULL == graph ) {
+        return NULL;
+    }
+    graph->num_nodes = num_nodes;
+    graph->num_edges = num_edges;
+
+    // Never allocate 0 bytes, so that NULL always means failure
+    graph->node_types   = (unsigned char*)malloc(sizeof(unsigned char) * (num_nodes > 0 ? num_nodes : 1));
+    graph->nodes        = (netloc_node_t**)malloc(sizeof(netloc_node_t*) * (num_nodes > 0 ? num_nodes : 1));
+    graph->edge_offsets = (int*)malloc(sizeof(int) * (num_nodes + 1));
+    graph->edge_dests   = (int*)malloc(sizeof(int) * (num_edges > 0 ? num_edges : 1));
+    graph->edge_uids    = (int*)malloc(sizeof(int) * (num_edges > 0 ? num_edges : 1));
+    graph->edges        = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * (num_edges > 0 ? num_edges : 1));
+    if( NULL == graph->node_types || NULL == graph->nodes || NULL == graph->edge_offsets ||
+        NULL == graph->edge_dests || NULL == graph->edge_uids || NULL == graph->edges ) {
+        fprintf(stderr, "Error: Failed to allocate the graph arrays\n");
+        support_graph_destruct(graph);
+        return NULL;
+    }
+
+    pos = 0;
+    for(i = 0; i < num_nodes; ++i) {
+        graph->nodes[i]        = nodes[i];
+        graph->node_types[i]   = (unsigned char)nodes[i]->node_type;
+        graph->edge_offsets[i] = pos;
+
+        for(e = 0; e < nodes[i]->num_edges; ++e) {
+            dest_node = nodes[i]->edges[e]->dest_node;
+
+            // The destination must be one of the numbered nodes
+            graph->edge_dests[pos] = -1;
+            if( NULL != dest_node && dest_node->__uid__ >= 0 && dest_node->__uid__ < num_nodes &&
+                nodes[dest_node->__uid__] == dest_node ) {
+                graph->edge_dests[pos] = dest_node->__uid__;
+            }
+            graph->edge_uids[pos] = nodes[i]->edges[e]->edge_uid;
+            graph->edges[pos]     = nodes[i]->edges[e];
+            ++pos;
+        }
+    }
+    graph->edge_offsets[num_nodes] = pos;
+
+    return graph;
+}
+
+int support_graph_destruct(struct support_graph_t *graph)
+{
+    if( NULL == graph ) {
+        return NETLOC_SUCCESS;
+    }
+
+    free(graph->node_types);
+    free(graph->nodes);
+    free(graph->edge_offsets);
+    free(graph->edge_dests);
+    free(graph->edge_uids);
+    free(graph->edges);
+    free(graph);
+
+    return NETLOC_SUCCESS;
+}
+
+struct support_graph_t * support_topology_graph(struct netloc_topology * topology)
+{
+    if( NULL == topology->graph ) {
+        // The nodes of a topology are numbered by their index
+        topology->graph = support_graph_construct(topology->nodes, topology->num_nodes);
+    }
+
+    return topology->graph;
+}
@@ -14,43 +14,91 @@
 #include <netloc.h>
 #include <private/netloc.h>
 
+#include <stdint.h>
+
+/* Minimum number of entries added when the table grows (it then doubles) */
 #define HASH_GROWS_BY 8
 
+/* Smallest hash index we allocate (must be a power of 2) */
+#define HASH_INDEX_MIN_SIZE 8
+
+/* Bounds on the size of a key arena chunk (bytes) */
+#define HASH_KEY_CHUNK_MIN_SIZE 256
+#define HASH_KEY_CHUNK_MAX_SIZE (1024*1024)
+
+/**
+ * Hash a string key (64-bit FNV-1a)
+ */
+static inline unsigned long lookup_table_hash_str(const char *key);
+
 /**
- * Constructor for netloc_lookup_table_entry_t
+ * Hash an integer key (64-bit MurmurHash3 finalizer)
+ */
+static inline unsigned long lookup_table_hash_int(unsigned long key_int);
+
+/**
+ * Find the position of an entry in ht_entries
  *
- * User is responsible for calling the destructor on the handle returned.
+ * \param ht A valid pointer to a lookup table
+ * \param key The key used to find the data (only used if key_int is 0)
+ * \param key_int The integer key used to find the data
+ * \param hash The hash of the key
+ * \param slot Set to the hash index slot of the entry if found, or to the
+ *             first empty slot of the probe sequence if not found.
  *
  * Returns
- *   A newly allocated pointer to the lookup table entry
+ *   -1 if not found
+ *   otherwise the position in ht_entries
  */
-netloc_lookup_table_entry_t *netloc_lookup_table_entry_t_construct();
+static ssize_t lookup_table_find(struct netloc_dt_lookup_table *ht,
+                                 const char *key, unsigned long key_int,
+                                 unsigned long hash, size_t *slot);
 
 /**
- * Do a -shallow copy- of the data in the table entry.
- *
- * User is responsible for calling the destructor on the handle returned.
- *
- * \param hte A valid pointer to a lookup table entry
- * \param dup Set to 1 if keys are internally duplicated
+ * Number of slots of ht_entries handed out so far (live entries and holes)
+ */
+static inline size_t lookup_table_tail(struct netloc_dt_lookup_table *ht);
+
+/**
+ * Squeeze the holes left by removed entries out of ht_entries
  *
  * Returns
- *   NULL if an error occurs
- *   otherwise returns a newly allocated pointer to a lookup table entry.
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR on error
  */
-netloc_lookup_table_entry_t *netloc_copy_lookup_table_entry_t(netloc_lookup_table_entry_t* hte, int dup);
+static int lookup_table_compact(struct netloc_dt_lookup_table *ht);
 
 /**
- * Destructor for a netloc_lookup_table_entry_t
- *
- * \param hte A void pointer to a lookup table entry
- * \param dup Set to 1 if keys are internally duplicated
+ * (Re)build the hash index with room for at least 'count' entries
  *
  * Returns
  *   NETLOC_SUCCESS on success
  *   NETLOC_ERROR on error
  */
-int netloc_lookup_table_entry_t_destruct(netloc_lookup_table_entry_t* hte, int dup);
+static int lookup_table_rehash(struct netloc_dt_lookup_table *ht, size_t count);
+
+/**
+ * Copy a key into the key arena of the table
+ *
+ * \param ht A valid pointer to a lookup table
+ * \param key The key to copy
+ *
+ * Returns
+ *   NULL on error
+ *   otherwise a pointer to the copy, valid until the table is destroyed
+ */
+static const char * lookup_table_intern_key(struct netloc_dt_lookup_table *ht, const char *key);
+
+/**
+ * Release a key copied into the key arena of the table
+ *
+ * The chunk holding the key is freed (or reused, if it is the one being
+ * filled) once it holds no key of a live entry anymore.
+ *
+ * \param ht A valid pointer to a lookup table
+ * \param key A key returned by lookup_table_intern_key
+ */
+static void lookup_table_release_key(struct netloc_dt_lookup_table *ht, const char *key);
 
 
 /**********************************************************************
@@ -106,14 +154,14 @@ const char * netloc_lookup_table_iterator_next_key(struct netloc_dt_lookup_table
 {
     size_t i;
 
-    for(i = hti->loc; i < netloc_lookup_table_size(hti->htp); ++i) {
-        if( NULL != hti->htp->ht_entries[i] ) {
+    for(i = hti->loc; i < lookup_table_tail(hti->htp); ++i) {
+        if( NULL != hti->htp->ht_entries[i].key ) {
             hti->loc = i+1;
-            return hti->htp->ht_entries[i]->key;
+            return hti->htp->ht_entries[i].key;
         }
     }
 
-    hti->loc = netloc_lookup_table_size(hti->htp);
+    hti->loc = lookup_table_tail(hti->htp);
     hti->at_end = true;
 
     return NULL;
@@ -123,14 +171,14 @@ unsigned long netloc_lookup_table_iterator_next_key_int(struct netloc_dt_lookup_
 {
     size_t i;
 
-    for(i = hti->loc; i < netloc_lookup_table_size(hti->htp); ++i) {
-        if( NULL != hti->htp->ht_entries[i] ) {
+    for(i = hti->loc; i < lookup_table_tail(hti->htp); ++i) {
+        if( NULL != hti->htp->ht_entries[i].key ) {
             hti->loc = i+1;
-            return hti->htp->ht_entries[i]->__key__;
+            return hti->htp->ht_entries[i].__key__;
         }
     }
 
-    hti->loc = netloc_lookup_table_size(hti->htp);
+    hti->loc = lookup_table_tail(hti->htp);
     hti->at_end = true;
 
     return 0;
@@ -140,14 +188,14 @@ void * netloc_lookup_table_iterator_next_entry(struct netloc_dt_lookup_table_ite
 {
     size_t i;
 
-    for(i = hti->loc; i < netloc_lookup_table_size(hti->htp); ++i) {
-        if( NULL != hti->htp->ht_entries[i] ) {
+    for(i = hti->loc; i < lookup_table_tail(hti->htp); ++i) {
+        if( NULL != hti->htp->ht_entries[i].key ) {
             hti->loc = i+1;
-            return hti->htp->ht_entries[i]->value;
+            return hti->htp->ht_entries[i].value;
         }
     }
 
-    hti->loc = netloc_lookup_table_size(hti->htp);
+    hti->loc = lookup_table_tail(hti->htp);
     hti->at_end = true;
 
     return NULL;
@@ -162,94 +210,85 @@ void netloc_lookup_table_iterator_reset(struct netloc_dt_lookup_table_iterator *
     hti->at_end = false;
 }
 
-netloc_lookup_table_entry_t *netloc_lookup_table_entry_t_construct()
+int netloc_dt_lookup_table_t_copy(struct netloc_dt_lookup_table *from, struct netloc_dt_lookup_table *to)
 {
-    netloc_lookup_table_entry_t* hte = NULL;
+    size_t i;
+    int dup;
+    netloc_lookup_table_entry_t *hte = NULL;
 
-    hte = (netloc_lookup_table_entry_t*)malloc(sizeof(netloc_lookup_table_entry_t));
-    if( NULL == hte ){
-        return NULL;
+    if( NULL == from || NULL == to ) {
+        return NETLOC_ERROR;
     }
 
-    hte->__key__ = 0;
-    hte->key = NULL;
-    hte->value = NULL;
-
-    return hte;
-}
+    dup = !(from->flags & NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY);
 
-netloc_lookup_table_entry_t *netloc_copy_lookup_table_entry_t(netloc_lookup_table_entry_t* orig, int dup)
-{
-    netloc_lookup_table_entry_t* hte = NULL;
-    hte = netloc_lookup_table_entry_t_construct();
-
-    hte->__key__ = orig->__key__;
-    hte->key = dup ? strdup(orig->key) : orig->key;
-    hte->value = orig->value;
-
-    return hte;
-}
-
-int netloc_lookup_table_entry_t_destruct(netloc_lookup_table_entry_t* hte, int dup)
-{
-    if( NULL == hte ) {
-        return NETLOC_SUCCESS;
-    }
-
-    hte->__key__ = 0;
+    netloc_lookup_table_init(to, netloc_lookup_table_size(from), from->flags);
 
-    if( NULL != hte->key ) {
-        if (dup) {
-            free((char*) hte->key);
+    for(i = 0; i < from->ht_tail; ++i ) {
+        if( NULL != from->ht_entries[i].key ) {
+            hte = &to->ht_entries[to->ht_tail];
+            *hte = from->ht_entries[i];
+            if( dup ) {
+                hte->key = lookup_table_intern_key(to, hte->key);
+                if( NULL == hte->key ) {
+                    return NETLOC_ERROR;
+                }
+            }
+            to->ht_tail += 1;
         }
-        hte->key = NULL;
     }
-    hte->value = NULL;
+    to->ht_used_size = to->ht_tail;
 
-    free(hte);
-
-    return NETLOC_SUCCESS;
+    return lookup_table_rehash(to, to->ht_used_size);
 }
 
-int netloc_dt_lookup_table_t_copy(struct netloc_dt_lookup_table *from, struct netloc_dt_lookup_table *to)
+int netloc_lookup_table_init(struct netloc_dt_lookup_table *ht, size_t size, unsigned long flags)
 {
-    size_t i;
-    int dup = !(from->flags & NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY);
-
-    if( NULL == from || NULL == to ) {
+    if( NULL == ht ) {
+        fprintf(stderr, "Error: Hash Table handle is NULL!\n");
         return NETLOC_ERROR;
     }
 
-    netloc_lookup_table_init(to, netloc_lookup_table_size(from), from->flags);
-
-    for(i = 0; i < from->ht_size; ++i ) {
-        if( NULL != from->ht_entries[i] ) {
-            to->ht_entries[i] = netloc_copy_lookup_table_entry_t(from->ht_entries[i], dup);
-        }
-    }
+    ht->ht_entries = NULL;
+    ht->ht_size = 0;
+    ht->ht_used_size = 0;
+    ht->ht_tail = 0;
+    ht->ht_index = NULL;
+    ht->ht_index_size = 0;
+    ht->ht_keys = NULL;
+    ht->flags = flags;
 
-    return NETLOC_SUCCESS;
+    return netloc_lookup_table_reserve(ht, size);
 }
 
-int netloc_lookup_table_init(struct netloc_dt_lookup_table *ht, size_t size, unsigned long flags)
+int netloc_lookup_table_reserve(struct netloc_dt_lookup_table *ht, size_t size)
 {
-    size_t i;
+    netloc_lookup_table_entry_t *entries = NULL;
 
     if( NULL == ht ) {
         fprintf(stderr, "Error: Hash Table handle is NULL!\n");
         return NETLOC_ERROR;
     }
 
-    ht->ht_entries = (netloc_lookup_table_entry_t**)malloc(sizeof(netloc_lookup_table_entry_t*) * size);
-    if( NULL == ht->ht_entries ) {
+    if( size <= ht->ht_size ) {
+        return NETLOC_SUCCESS;
+    }
+
+    entries = (netloc_lookup_table_entry_t*)realloc(ht->ht_entries, sizeof(netloc_lookup_table_entry_t) * size);
+    if( NULL == entries ) {
         return NETLOC_ERROR;
     }
+    ht->ht_entries = entries;
+
+    memset(&ht->ht_entries[ht->ht_size], 0, sizeof(netloc_lookup_table_entry_t) * (size - ht->ht_size));
     ht->ht_size = size;
-    ht->ht_used_size = 0;
-    ht->flags = flags;
 
-    for(i = 0; i < ht->ht_size; ++i ) {
-        ht->ht_entries[i] = NULL;
+    /*
+     * Size the hash index for the new capacity now, so that appends up to
+     * 'size' never need to rebuild it.
+     */
+    if( 2 * size > ht->ht_index_size ) {
+        return lookup_table_rehash(ht, size);
     }
 
     return NETLOC_SUCCESS;
@@ -257,84 +296,81 @@ int netloc_lookup_table_init(struct netloc_dt_lookup_table *ht, size_t size, uns
 
 int netloc_lookup_table_destroy(struct netloc_dt_lookup_table *ht)
 {
-    size_t i;
-    int dup;
+    struct netloc_lookup_table_key_chunk *chunk = NULL;
 
     if( NULL == ht ) {
         fprintf(stderr, "Error: Hash Table handle is NULL!\n");
         return NETLOC_ERROR;
     }
 
-    dup = !(ht->flags & NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY);
-
-    for(i = 0; i < ht->ht_size; ++i) {
-        if( NULL != ht->ht_entries[i] ) {
-            netloc_lookup_table_entry_t_destruct(ht->ht_entries[i], dup);
-        }
+    // Duplicated keys all live in the key arena
+    while( NULL != ht->ht_keys ) {
+        chunk = ht->ht_keys;
+        ht->ht_keys = chunk->next;
+        free(chunk);
     }
+
     free(ht->ht_entries);
     ht->ht_entries = NULL;
     ht->ht_size = 0;
     ht->ht_used_size = 0;
+    ht->ht_tail = 0;
+
+    free(ht->ht_index);
+    ht->ht_index = NULL;
+    ht->ht_index_size = 0;
 
     return NETLOC_SUCCESS;
 }
 
 int netloc_lookup_table_append(struct netloc_dt_lookup_table *ht, const char *key, void *value)
 {
-    unsigned long hashed_key;
-    // JJH : Add hash function
-    hashed_key = 0;
-
-    return netloc_lookup_table_append_with_int(ht, key, hashed_key, value);
+    return netloc_lookup_table_append_with_int(ht, key, 0, value);
 }
 
 int netloc_lookup_table_append_with_int(struct netloc_dt_lookup_table *ht, const char *key, unsigned long key_int, void *value)
 {
     int dup = !(ht->flags & NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY);
-    size_t i, a;
-    int len;
+    unsigned long hash;
+    size_t i, slot;
+    netloc_lookup_table_entry_t *hte = NULL;
 
-    // Check if key already exists!
-    // If not then we are looking at the next free entry
-    for(i = 0; i < ht->ht_size; ++i ) {
-        if( NULL == ht->ht_entries[i] ) {
-            break;
-        }
-        else {
-            if( 0 != key_int ) {
-                if( key_int == ht->ht_entries[i]->__key__ ) {
-                    return NETLOC_ERROR_EXISTS;
-                }
-            }
-            else {
-                if( strlen(key) > strlen(ht->ht_entries[i]->key) ) {
-                    len = strlen(key);
-                } else {
-                    len = strlen(ht->ht_entries[i]->key);
-                }
-                if( 0 == strncmp(ht->ht_entries[i]->key, key, len) ) {
-                    return NETLOC_ERROR_EXISTS;
-                }
-            }
-        }
-    }
+    hash = (0 != key_int) ? lookup_table_hash_int(key_int) : lookup_table_hash_str(key);
 
     /*
-     * Grow the lookup table as needed
+     * Grow the lookup table as needed. Doubling keeps appends amortized O(1),
+     * and the hash index is grown along with it (load factor under 1/2).
+     * If removals left at least half of the table as holes, reclaim them
+     * instead of growing.
      */
-    if( i == ht->ht_size ) {
-        ht->ht_size += HASH_GROWS_BY;
-        ht->ht_entries = (netloc_lookup_table_entry_t**)realloc(ht->ht_entries, sizeof(netloc_lookup_table_entry_t*) * ht->ht_size);
-        for(a = i; a < ht->ht_size; ++a) {
-            ht->ht_entries[a] = NULL;
+    if( ht->ht_tail == ht->ht_size ) {
+        if( ht->ht_size > 0 && 2 * ht->ht_used_size <= ht->ht_size ) {
+            if( NETLOC_SUCCESS != lookup_table_compact(ht) ) {
+                return NETLOC_ERROR;
+            }
+        }
+        else if( NETLOC_SUCCESS != netloc_lookup_table_reserve(ht, (ht->ht_size < HASH_GROWS_BY) ? HASH_GROWS_BY : 2 * ht->ht_size) ) {
+            return NETLOC_ERROR;
         }
     }
 
-    ht->ht_entries[i] = netloc_lookup_table_entry_t_construct();
-    ht->ht_entries[i]->key   = dup ? strdup(key) : key;
-    ht->ht_entries[i]->value = value;
-    ht->ht_entries[i]->__key__ = key_int;
+    // Check if key already exists!
+    if( 0 <= lookup_table_find(ht, key, key_int, hash, &slot) ) {
+        return NETLOC_ERROR_EXISTS;
+    }
+
+    i = ht->ht_tail;
+    hte = &ht->ht_entries[i];
+    hte->key      = dup ? lookup_table_intern_key(ht, key) : key;
+    if( NULL == hte->key ) {
+        return NETLOC_ERROR;
+    }
+    hte->value    = value;
+    hte->__key__  = key_int;
+    hte->__hash__ = hash;
+
+    ht->ht_index[slot] = i + 1;
+    ht->ht_tail += 1;
     ht->ht_used_size += 1;
 
     return NETLOC_SUCCESS;
@@ -342,80 +378,42 @@ int netloc_lookup_table_append_with_int(struct netloc_dt_lookup_table *ht, const
 
 void * netloc_lookup_table_access(struct netloc_dt_lookup_table *ht, const char *key)
 {
-    unsigned long hashed_key;
-    // JJH : Add hash function
-    hashed_key = 0;
-
-    return netloc_lookup_table_access_with_int(ht, key, hashed_key);
+    return netloc_lookup_table_access_with_int(ht, key, 0);
 }
 
 void * netloc_lookup_table_access_with_int(struct netloc_dt_lookup_table *ht, const char *key, unsigned long key_int)
 {
-    size_t i;
-    int len;
+    ssize_t pos;
+    size_t slot;
+    unsigned long hash;
 
-    for(i = 0; i < ht->ht_size; ++i ) {
-        if( NULL == ht->ht_entries[i] ) {
-            continue;
-        }
-        else {
-            if( 0 != key_int ) {
-                if( key_int == ht->ht_entries[i]->__key__ ) {
-                    return ht->ht_entries[i]->value;
-                }
-            }
-            else {
-                if( strlen(key) > strlen(ht->ht_entries[i]->key) ) {
-                    len = strlen(key);
-                } else {
-                    len = strlen(ht->ht_entries[i]->key);
-                }
-                if( 0 == strncmp(ht->ht_entries[i]->key, key, len) ) {
-                    return ht->ht_entries[i]->value;
-                }
-            }
-        }
+    hash = (0 != key_int) ? lookup_table_hash_int(key_int) : lookup_table_hash_str(key);
+
+    pos = lookup_table_find(ht, key, key_int, hash, &slot);
+    if( pos < 0 ) {
+        return NULL;
     }
 
-    return NULL;
+    return ht->ht_entries[pos].value;
 }
 
 int netloc_lookup_table_replace(struct netloc_dt_lookup_table *ht, const char *key, void *value)
 {
-    unsigned long hashed_key;
-    // JJH : Add hash function
-    hashed_key = 0;
-
-    return netloc_lookup_table_replace_with_int(ht, key, hashed_key, value);
+    return netloc_lookup_table_replace_with_int(ht, key, 0, value);
 }
 
 int netloc_lookup_table_replace_with_int(struct netloc_dt_lookup_table *ht, const char *key, unsigned long key_int, void *value)
 {
-    size_t i;
-    int len;
+    ssize_t pos;
+    size_t slot;
+    unsigned long hash;
+
+    hash = (0 != key_int) ? lookup_table_hash_int(key_int) : lookup_table_hash_str(key);
 
     // Find this value
-    for(i = 0; i < ht->ht_size; ++i ) {
-        if( NULL == ht->ht_entries[i] ) {
-            break;
-        }
-        else {
-            if( 0 != key_int ) {
-                if( key_int == ht->ht_entries[i]->__key__ ) {
-                    ht->ht_entries[i]->value = value;
-                }
-            }
-            else {
-                if( strlen(key) > strlen(ht->ht_entries[i]->key) ) {
-                    len = strlen(key);
-                } else {
-                    len = strlen(ht->ht_entries[i]->key);
-                }
-                if( 0 == strncmp(ht->ht_entries[i]->key, key, len) ) {
-                    ht->ht_entries[i]->value = value;
-                }
-            }
-        }
+    pos = lookup_table_find(ht, key, key_int, hash, &slot);
+    if( pos >= 0 ) {
+        ht->ht_entries[pos].value = value;
     }
 
     return NETLOC_SUCCESS;
@@ -423,57 +421,51 @@ int netloc_lookup_table_replace_with_int(struct netloc_dt_lookup_table *ht, cons
 
 int netloc_lookup_table_remove(struct netloc_dt_lookup_table *ht, const char *key)
 {
-    unsigned long hashed_key;
-    // JJH : Add hash function
-    hashed_key = 0;
-
-    return netloc_lookup_table_remove_with_int(ht, key, hashed_key);
+    return netloc_lookup_table_remove_with_int(ht, key, 0);
 }
+
 int netloc_lookup_table_remove_with_int(struct netloc_dt_lookup_table *ht, const char *key, unsigned long key_int)
 {
-    size_t i;
-    int len;
-    int idx_to_remove = -1;
-    int dup = !(ht->flags & NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY);
+    size_t i, j, home, slot, mask;
+    ssize_t idx_to_remove;
+    unsigned long hash;
 
-    // Find this value
-    for(i = 0; i < ht->ht_size; ++i ) {
-        if( NULL == ht->ht_entries[i] ) {
-            break;
-        }
-        else {
-            if( 0 != key_int ) {
-                if( key_int == ht->ht_entries[i]->__key__ ) {
-                    idx_to_remove = i;
-                    break;
-                }
-            }
-            else {
-                if( strlen(key) > strlen(ht->ht_entries[i]->key) ) {
-                    len = strlen(key);
-                } else {
-                    len = strlen(ht->ht_entries[i]->key);
-                }
-                if( 0 == strncmp(ht->ht_entries[i]->key, key, len) ) {
-                    idx_to_remove = i;
-                    break;
-                }
-            }
-        }
-    }
+    hash = (0 != key_int) ? lookup_table_hash_int(key_int) : lookup_table_hash_str(key);
 
+    // Find this value
+    idx_to_remove = lookup_table_find(ht, key, key_int, hash, &slot);
     if( idx_to_remove < 0 ) {
         return NETLOC_ERROR;
     }
 
-    netloc_lookup_table_entry_t_destruct(ht->ht_entries[idx_to_remove], dup);
-    for( i = idx_to_remove; i < ht->ht_size-1; ++i ) {
-        ht->ht_entries[i] = ht->ht_entries[i+1];
+    /*
+     * Leave a hole in ht_entries instead of shifting the following entries
+     * down, so the positions held by the index and by any live iterator stay
+     * valid. Holes are reclaimed by the next append that fills the table.
+     */
+    if( !(ht->flags & NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY) ) {
+        lookup_table_release_key(ht, ht->ht_entries[idx_to_remove].key);
     }
-    ht->ht_entries[ht->ht_size-1] = NULL;
-
+    memset(&ht->ht_entries[idx_to_remove], 0, sizeof(netloc_lookup_table_entry_t));
     ht->ht_used_size -= 1;
 
+    /*
+     * Backward shift deletion: pull later members of the probe run into the
+     * freed slot so that lookups never need index tombstones.
+     */
+    mask = ht->ht_index_size - 1;
+    i = slot;
+    for(j = (i + 1) & mask; 0 != ht->ht_index[j]; j = (j + 1) & mask) {
+        home = ht->ht_entries[ht->ht_index[j] - 1].__hash__ & mask;
+        // Skip entries whose home slot lies cyclically in (i, j]
+        if( (i <= j) ? (i < home && home <= j) : (i < home || home <= j) ) {
+            continue;
+        }
+        ht->ht_index[i] = ht->ht_index[j];
+        i = j;
+    }
+    ht->ht_index[i] = 0;
+
     return NETLOC_SUCCESS;
 }
 
@@ -483,8 +475,8 @@ void netloc_lookup_table_pretty_print(struct netloc_dt_lookup_table *ht)
 
     for(i = 0; i < ht->ht_size; ++i ) {
         printf("%3d) ", (int)i);
-        if( NULL != ht->ht_entries[i] ) {
-            printf("%4s [%p]", ht->ht_entries[i]->key, ht->ht_entries[i]->value);
+        if( NULL != ht->ht_entries[i].key ) {
+            printf("%4s [%p]", ht->ht_entries[i].key, ht->ht_entries[i].value);
         } else {
             printf("NULL");
         }
@@ -536,3 +528,192 @@ struct netloc_dt_lookup_table* netloc_dt_lookup_table_t_json_decode(json_t *json
 
     return table;
 }
+
+
+/**********************************************************************
+ * Support Functions
+ **********************************************************************/
+static inline unsigned long lookup_table_hash_str(const char *key)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char *c;
+
+    for(c = (const unsigned char *)key; '\0' != *c; ++c) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+
+    return (unsigned long)hash;
+}
+
+static inline unsigned long lookup_table_hash_int(unsigned long key_int)
+{
+    uint64_t hash = key_int;
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    return (unsigned long)hash;
+}
+
+static ssize_t lookup_table_find(struct netloc_dt_lookup_table *ht,
+                                 const char *key, unsigned long key_int,
+                                 unsigned long hash, size_t *slot)
+{
+    size_t mask = ht->ht_index_size - 1;
+    size_t s;
+    netloc_lookup_table_entry_t *hte = NULL;
+
+    // Tables that were only zeroed (never initialized) have no index yet
+    *slot = 0;
+    if( 0 == ht->ht_index_size ) {
+        return -1;
+    }
+
+    for(s = hash & mask; 0 != ht->ht_index[s]; s = (s + 1) & mask) {
+        hte = &ht->ht_entries[ht->ht_index[s] - 1];
+        if( hte->__hash__ != hash ) {
+            continue;
+        }
+        if( 0 != key_int ) {
+            if( key_int == hte->__key__ ) {
+                break;
+            }
+        }
+        else if( 0 == strcmp(hte->key, key) ) {
+            break;
+        }
+    }
+
+    *slot = s;
+    if( 0 == ht->ht_index[s] ) {
+        return -1;
+    }
+    return (ssize_t)(ht->ht_index[s] - 1);
+}
+
+static inline size_t lookup_table_tail(struct netloc_dt_lookup_table *ht)
+{
+    return (NULL == ht) ? 0 : ht->ht_tail;
+}
+
+static int lookup_table_compact(struct netloc_dt_lookup_table *ht)
+{
+    size_t i, j;
+
+    for(i = 0, j = 0; i < ht->ht_tail; ++i) {
+        if( NULL != ht->ht_entries[i].key ) {
+            ht->ht_entries[j] = ht->ht_entries[i];
+            ++j;
+        }
+    }
+    memset(&ht->ht_entries[j], 0, sizeof(netloc_lookup_table_entry_t) * (ht->ht_tail - j));
+    ht->ht_tail = j;
+
+    return lookup_table_rehash(ht, ht->ht_used_size);
+}
+
+static const char * lookup_table_intern_key(struct netloc_dt_lookup_table *ht, const char *key)
+{
+    struct netloc_lookup_table_key_chunk *chunk = ht->ht_keys;
+    size_t len = strlen(key) + 1;
+    size_t size;
+    char *str = NULL;
+
+    if( NULL == chunk || chunk->size - chunk->used < len ) {
+        // Each new chunk doubles the previous one (bounded), or fits the key
+        size = (NULL == chunk) ? HASH_KEY_CHUNK_MIN_SIZE : 2 * chunk->size;
+        if( size > HASH_KEY_CHUNK_MAX_SIZE ) {
+            size = HASH_KEY_CHUNK_MAX_SIZE;
+        }
+        if( size < len ) {
+            size = len;
+        }
+
+        chunk = (struct netloc_lookup_table_key_chunk*)malloc(sizeof(*chunk) + size);
+        if( NULL == chunk ) {
+            return NULL;
+        }
+        chunk->next = ht->ht_keys;
+        chunk->size = size;
+        chunk->used = 0;
+        chunk->live = 0;
+        ht->ht_keys = chunk;
+    }
+
+    str = &chunk->data[chunk->used];
+    memcpy(str, key, len);
+    chunk->used += len;
+    chunk->live += 1;
+
+    return str;
+}
+
+static void lookup_table_release_key(struct netloc_dt_lookup_table *ht, const char *key)
+{
+    struct netloc_lookup_table_key_chunk **prev = &ht->ht_keys;
+    struct netloc_lookup_table_key_chunk *chunk = NULL;
+    uintptr_t addr = (uintptr_t)key;
+
+    for(chunk = ht->ht_keys; NULL != chunk; prev = &chunk->next, chunk = chunk->next) {
+        if( (uintptr_t)chunk->data <= addr && addr < (uintptr_t)&chunk->data[chunk->used] ) {
+            break;
+        }
+    }
+    if( NULL == chunk ) {
+        return;
+    }
+
+    chunk->live -= 1;
+    if( 0 != chunk->live ) {
+        return;
+    }
+
+    // Keep filling the current chunk from the start, drop older ones
+    if( chunk == ht->ht_keys ) {
+        chunk->used = 0;
+    } else {
+        *prev = chunk->next;
+        free(chunk);
+    }
+}
+
+static int lookup_table_rehash(struct netloc_dt_lookup_table *ht, size_t count)
+{
+    size_t i, s, mask;
+    size_t new_size = ht->ht_index_size;
+
+    if( new_size < HASH_INDEX_MIN_SIZE ) {
+        new_size = HASH_INDEX_MIN_SIZE;
+    }
+    while( new_size < 2 * count ) {
+        new_size *= 2;
+    }
+
+    if( new_size != ht->ht_index_size ) {
+        free(ht->ht_index);
+        ht->ht_index = (size_t*)malloc(sizeof(size_t) * new_size);
+        if( NULL == ht->ht_index ) {
+            ht->ht_index_size = 0;
+            return NETLOC_ERROR;
+        }
+        ht->ht_index_size = new_size;
+    }
+    memset(ht->ht_index, 0, sizeof(size_t) * ht->ht_index_size);
+
+    mask = ht->ht_index_size - 1;
+    for(i = 0; i < ht->ht_tail; ++i) {
+        if( NULL == ht->ht_entries[i].key ) {
+            continue;
+        }
+        for(s = ht->ht_entries[i].__hash__ & mask; 0 != ht->ht_index[s]; s = (s + 1) & mask) {
+            ;
+        }
+        ht->ht_index[s] = i + 1;
+    }
+
+    return NETLOC_SUCCESS;
+}
@@ -12,13 +12,17 @@
 #include <netloc_map.h>
 #include <private/netloc.h>
 #include <private/map.h>
+#include "support.h"
 
 #include <stdlib.h>
 #include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
 
 
 static void netloc_map__destroy_servers(struct netloc_map *map);
 static void netloc_map__destroy_subnets(struct netloc_map *map);
+static void netloc_map__destroy_server_hwloc_segments(struct netloc_map__server *server);
 
 static struct netloc_map__server * netloc_map__get_server_by_name(struct netloc_map *map, const char *name);
 static struct netloc_map__subnet * netloc_map__get_subnet_by_id(struct netloc_map *map, netloc_network_type_t type, const char *id);
@@ -29,6 +33,9 @@ static struct netloc_map__port * netloc_map__get_port_by_id(struct netloc_map__s
  * Initializing a netloc_map
  */
 
+/* Number of unused uncompressed hwloc topologies kept by default */
+#define NETLOC_MAP_HWLOC_CACHE_DEFAULT 64
+
 int
 netloc_map_create(netloc_map_t *mapp)
 {
@@ -43,6 +50,25 @@ netloc_map_create(netloc_map_t *mapp)
     if (verbose_env)
         map->verbose_flags = strtoul(verbose_env, NULL, 0);
 
+    char *threads_env;
+    long nr_cpus;
+    threads_env = getenv("NETLOC_MAP_THREADS");
+    if (threads_env) {
+        map->nr_threads = strtoul(threads_env, NULL, 0);
+    } else {
+        nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        map->nr_threads = nr_cpus > 0 ? nr_cpus : 1;
+    }
+    if (!map->nr_threads)
+        map->nr_threads = 1;
+
+    char *cache_env;
+    cache_env = getenv("NETLOC_MAP_HWLOC_CACHE");
+    if (cache_env)
+        map->hwloc_cache_max = strtoul(cache_env, NULL, 0);
+    else
+        map->hwloc_cache_max = NETLOC_MAP_HWLOC_CACHE_DEFAULT;
+
     *mapp = map;
     return 0;
 
@@ -71,11 +97,55 @@ netloc_map_load_netloc_data(netloc_map_t _map, const char *data_dir)
  * Managing hwloc topology diffs
  */
 
+#if HWLOC_API_VERSION >= 0x00010800
+/* The cache is a list of the unused uncompressed topologies,
+ * the least recently used one is compressed first
+ */
+static void
+netloc_map__hwloc_cache_remove(struct netloc_map *map,
+                               struct netloc_map__server *server)
+{
+    if (!server->cached)
+        return;
+
+    if (server->cache_prev)
+        server->cache_prev->cache_next = server->cache_next;
+    else
+        map->hwloc_cache_first = server->cache_next;
+    if (server->cache_next)
+        server->cache_next->cache_prev = server->cache_prev;
+    else
+        map->hwloc_cache_last = server->cache_prev;
+
+    server->cache_prev = server->cache_next = NULL;
+    server->cached = 0;
+    map->hwloc_cache_nr--;
+}
+
+static void
+netloc_map__hwloc_cache_push(struct netloc_map *map,
+                             struct netloc_map__server *server)
+{
+    server->cache_prev = NULL;
+    server->cache_next = map->hwloc_cache_first;
+    if (map->hwloc_cache_first)
+        map->hwloc_cache_first->cache_prev = server;
+    else
+        map->hwloc_cache_last = server;
+    map->hwloc_cache_first = server;
+    server->cached = 1;
+    map->hwloc_cache_nr++;
+}
+#endif
+
 static int
 netloc_map__prepare_hwloc_topology(struct netloc_map *map,
                                    struct netloc_map__server *server)
 {
 #if HWLOC_API_VERSION >= 0x00010800
+    /* still uncompressed, it is in use again */
+    netloc_map__hwloc_cache_remove(map, server);
+
     if (map->flags & NETLOC_MAP_BUILD_FLAG_COMPRESS_HWLOC
         && !server->topology) {
         unsigned i;
@@ -105,7 +175,7 @@ netloc_map__unprepare_hwloc_topology(struct netloc_map *map,
 {
 #if HWLOC_API_VERSION >= 0x00010800
     if (map->flags & NETLOC_MAP_BUILD_FLAG_COMPRESS_HWLOC
-        && server->topology_diff) {
+        && server->topology_diff_refserver) {
         unsigned i;
         if (map->verbose_flags & NETLOC_MAP_VERBOSE_FLAG_COMPRESS)
             printf("compressing hwloc topology %s on top of %s\n",
@@ -114,6 +184,8 @@ netloc_map__unprepare_hwloc_topology(struct netloc_map *map,
         server->topology = NULL;
         for(i=0; i<server->nr_ports; i++)
             server->ports[i]->hwloc_obj = NULL;
+        /* the cached paths point to the destroyed objects */
+        netloc_map__destroy_server_hwloc_segments(server);
     }
 #endif
 }
@@ -313,6 +385,61 @@ netloc_map__add_eth_port(struct netloc_map *map,
     }
 }
 
+/* group the ports by locality, usually one group per NUMA node or package with NICs */
+static int
+netloc_map__init_server_localities(struct netloc_map__server *server)
+{
+    unsigned i, j;
+
+    server->localities = calloc(server->nr_ports ? server->nr_ports : 1, sizeof(*server->localities));
+    if (!server->localities)
+        return -1;
+    server->nr_localities = 0;
+
+    for(i=0; i<server->nr_ports; i++) {
+        hwloc_obj_t obj = hwloc_get_non_io_ancestor_obj(server->topology, server->ports[i]->hwloc_obj);
+        hwloc_const_bitmap_t cpuset = obj ? obj->cpuset : NULL;
+        struct netloc_map__locality *locality;
+
+        for(j=0; j<server->nr_localities; j++) {
+            locality = &server->localities[j];
+            if (cpuset ? locality->cpuset && hwloc_bitmap_isequal(cpuset, locality->cpuset) : !locality->cpuset)
+                break;
+        }
+
+        locality = &server->localities[j];
+        if (j == server->nr_localities) {
+            locality->ports = hwloc_bitmap_alloc();
+            if (!locality->ports)
+                return -1;
+            server->nr_localities++;
+            if (cpuset) {
+                locality->cpuset = hwloc_bitmap_dup(cpuset);
+                if (!locality->cpuset)
+                    return -1;
+            }
+        }
+        hwloc_bitmap_set(locality->ports, i);
+    }
+
+    return 0;
+}
+
+static void
+netloc_map__destroy_server_localities(struct netloc_map__server *server)
+{
+    unsigned i;
+
+    for(i=0; i<server->nr_localities; i++) {
+        if (server->localities[i].cpuset)
+            hwloc_bitmap_free(server->localities[i].cpuset);
+        hwloc_bitmap_free(server->localities[i].ports);
+    }
+    free(server->localities);
+    server->localities = NULL;
+    server->nr_localities = 0;
+}
+
 static struct netloc_map__server *
 netloc_map__init_server(struct netloc_map *map, hwloc_topology_t topo, const char *name)
 {
@@ -373,21 +500,428 @@ netloc_map__init_server(struct netloc_map *map, hwloc_topology_t topo, const cha
         }
     }
 
+    /* without the table, locality queries check each port */
+    if (netloc_map__init_server_localities(server) < 0)
+        netloc_map__destroy_server_localities(server);
+
     return server;
 }
 
+/* Loading of one hwloc XML file, done by the thread pool */
+struct netloc_map__xml_job {
+    char *name; /* server name (file name without .xml or .diff.xml) */
+    hwloc_topology_t topology; /* loaded topology (diff applied), NULL if failed or left to the merge step */
+#if HWLOC_API_VERSION >= 0x00010800
+    hwloc_topology_diff_t diff;
+    char *refname;
+#endif
+};
+
+struct netloc_map__xml_pool {
+    struct netloc_map *map;
+    struct netloc_map__xml_job *jobs;
+    void (*load)(struct netloc_map__xml_pool *pool, struct netloc_map__xml_job *job);
+#if HWLOC_API_VERSION >= 0x00010800
+    hwloc_topology_t validtopo; /* any loaded topology, to parse the diffs with */
+#endif
+    pthread_mutex_t lock;
+    unsigned next; /* next job to take (protected by lock) */
+    unsigned end;
+};
+
+/* Files are loaded by batches of this many jobs per thread,
+ * so that not all of them are uncompressed at once
+ */
+#define NETLOC_MAP_XML_BATCH_PER_THREAD 16
+
+static void
+netloc_map__load_xml_job(struct netloc_map__xml_pool *pool,
+                         struct netloc_map__xml_job *job)
+{
+    hwloc_topology_t topo;
+    char *filepath;
+    int err;
+
+    err = asprintf(&filepath, "%s/%s.xml", pool->map->hwloc_xml_path, job->name);
+    if (err < 0)
+        return;
+
+    hwloc_topology_init(&topo);
+    hwloc_topology_set_flags(topo, HWLOC_TOPOLOGY_FLAG_IO_DEVICES);
+    err = hwloc_topology_set_xml(topo, filepath);
+    free(filepath);
+    if (err < 0) {
+        hwloc_topology_destroy(topo);
+        return;
+    }
+    hwloc_topology_load(topo);
+
+    job->topology = topo;
+}
+
+#if HWLOC_API_VERSION >= 0x00010800
+/* Read a diff and the name of its reference server */
+static void
+netloc_map__parse_diff_job(struct netloc_map__xml_pool *pool,
+                           struct netloc_map__xml_job *job)
+{
+    char *filepath;
+    size_t refnamelen;
+    int err;
+
+    err = asprintf(&filepath, "%s/%s.diff.xml", pool->map->hwloc_xml_path, job->name);
+    if (err < 0)
+        return;
+
+    err = hwloc_topology_diff_load_xml(pool->validtopo, filepath, &job->diff, &job->refname);
+    free(filepath);
+    if (err < 0) {
+        job->diff = NULL;
+        job->refname = NULL;
+        return;
+    }
+    if (!job->refname) {
+        hwloc_topology_diff_destroy(pool->validtopo, job->diff);
+        job->diff = NULL;
+        return;
+    }
+    refnamelen = strlen(job->refname);
+    if (refnamelen < 4 || strcmp(job->refname+refnamelen-4, ".xml")) {
+        free(job->refname);
+        job->refname = NULL;
+        hwloc_topology_diff_destroy(pool->validtopo, job->diff);
+        job->diff = NULL;
+        return;
+    }
+    job->refname[refnamelen-4] = '\0';
+}
+
+/* Apply a diff on top of its reference server */
+static void
+netloc_map__load_diff_job(struct netloc_map__xml_pool *pool,
+                          struct netloc_map__xml_job *job)
+{
+    struct netloc_map__server *refserver;
+    hwloc_topology_t topo;
+    int err;
+
+    if (!job->diff)
+        return;
+
+    /* Only entire topologies are ready (and read-only) while the pool runs,
+     * diffs on top of other diffs are left to the merge step.
+     */
+    refserver = netloc_lookup_table_access(&pool->map->server_by_name, job->refname);
+    if (!refserver || !refserver->topology || refserver->topology_diff_refserver)
+        return;
+
+    err = hwloc_topology_dup(&topo, refserver->topology);
+    if (err < 0)
+        return;
+
+    err = hwloc_topology_diff_apply(topo, job->diff, 0);
+    if (err < 0) {
+        hwloc_topology_destroy(topo);
+        return;
+    }
+
+    job->topology = topo;
+}
+#endif
+
+#if HWLOC_API_VERSION >= 0x00010800
+/* Reference topology of a hardware class */
+struct netloc_map__hwloc_class {
+    unsigned long signature;
+    struct netloc_map__server *refserver;
+};
+
+/* Compression of the entire topologies as diffs of the first one of their class */
+struct netloc_map__compress_state {
+    struct netloc_map__hwloc_class *classes;
+    unsigned nr_classes;
+    unsigned nr_classes_allocated;
+    unsigned nr_topologies;
+    unsigned nr_compressed;
+    unsigned long nr_objs; /* objects of the compressed topologies */
+    unsigned long nr_diff_entries; /* what they were replaced with */
+};
+
+static const int netloc_map__hwloc_io_depths[] = {
+    HWLOC_TYPE_DEPTH_BRIDGE,
+    HWLOC_TYPE_DEPTH_PCI_DEVICE,
+    HWLOC_TYPE_DEPTH_OS_DEVICE
+};
+
+/* Shape of the object tree: type and number of objects at each depth */
+static unsigned long
+netloc_map__hwloc_signature(hwloc_topology_t topo, unsigned long *nr_objs)
+{
+    unsigned long signature = 5381;
+    unsigned depth, nbdepths = hwloc_topology_get_depth(topo);
+    unsigned i, nbobjs;
+
+    *nr_objs = 0;
+    for(depth=0; depth<nbdepths; depth++) {
+        nbobjs = hwloc_get_nbobjs_by_depth(topo, depth);
+        signature = signature * 33 + hwloc_get_depth_type(topo, depth);
+        signature = signature * 33 + nbobjs;
+        *nr_objs += nbobjs;
+    }
+    for(i=0; i<sizeof(netloc_map__hwloc_io_depths)/sizeof(netloc_map__hwloc_io_depths[0]); i++) {
+        nbobjs = hwloc_get_nbobjs_by_depth(topo, (unsigned) netloc_map__hwloc_io_depths[i]);
+        signature = signature * 33 + nbobjs;
+        *nr_objs += nbobjs;
+    }
+
+    return signature;
+}
+
+/* Store a new server as a diff of the reference of its hardware class,
+ * or make it the reference of a new class.
+ * Servers that a .diff.xml file refers to are never compressed,
+ * their diffs are applied on top of them.
+ */
+static void
+netloc_map__compress_server(struct netloc_map *map,
+                            struct netloc_map__compress_state *state,
+                            struct netloc_map__server *server,
+                            int diffref)
+{
+    struct netloc_map__hwloc_class *classes;
+    struct netloc_map__server *refserver;
+    hwloc_topology_diff_t diff, entry;
+    unsigned long signature, nr_objs;
+    unsigned i;
+    int err;
+
+    signature = netloc_map__hwloc_signature(server->topology, &nr_objs);
+    state->nr_topologies++;
+
+    if (diffref && (map->verbose_flags & NETLOC_MAP_VERBOSE_FLAG_COMPRESS))
+        printf("keeping hwloc topology %s entire, topology diffs refer to it\n", server->name);
+
+    for(i=0; !diffref && i<state->nr_classes; i++) {
+        if (state->classes[i].signature != signature)
+            continue;
+        refserver = state->classes[i].refserver;
+
+        err = hwloc_topology_diff_build(refserver->topology, server->topology, 0, &diff);
+        if (err < 0)
+            continue;
+        if (err > 0) {
+            /* too complex to be applied, the trees differ */
+            hwloc_topology_diff_destroy(refserver->topology, diff);
+            continue;
+        }
+
+        state->nr_compressed++;
+        state->nr_objs += nr_objs;
+        for(entry = diff; entry; entry = entry->generic.next)
+            state->nr_diff_entries++;
+
+        server->topology_diff_refserver = refserver;
+        refserver->usecount++;
+        server->topology_diff = diff;
+        netloc_map__unprepare_hwloc_topology(map, server);
+        return;
+    }
+
+    if (state->nr_classes == state->nr_classes_allocated) {
+        unsigned nr_allocated = state->nr_classes_allocated ? state->nr_classes_allocated * 2 : 8;
+        classes = realloc(state->classes, nr_allocated * sizeof(*classes));
+        if (!classes)
+            return;
+        state->classes = classes;
+        state->nr_classes_allocated = nr_allocated;
+    }
+    state->classes[state->nr_classes].signature = signature;
+    state->classes[state->nr_classes].refserver = server;
+    state->nr_classes++;
+}
+#endif
+
+static void *
+netloc_map__xml_worker(void *arg)
+{
+    struct netloc_map__xml_pool *pool = arg;
+    unsigned i;
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->end)
+            break;
+
+        pool->load(pool, &pool->jobs[i]);
+    }
+
+    return NULL;
+}
+
+/* Run the jobs from first to end-1 on the thread pool */
+static void
+netloc_map__run_xml_jobs(struct netloc_map__xml_pool *pool,
+                         unsigned first, unsigned end)
+{
+    unsigned nr_threads = pool->map->nr_threads;
+    pthread_t *threads;
+    unsigned i;
+
+    pool->next = first;
+    pool->end = end;
+
+    if (nr_threads > end - first)
+        nr_threads = end - first;
+    if (nr_threads <= 1) {
+        netloc_map__xml_worker(pool);
+        return;
+    }
+
+    threads = malloc(nr_threads * sizeof(*threads));
+    if (!threads) {
+        netloc_map__xml_worker(pool);
+        return;
+    }
+
+    for(i=0; i<nr_threads; i++) {
+        /* the threads that did start take the remaining jobs */
+        if (pthread_create(&threads[i], NULL, netloc_map__xml_worker, pool)) {
+            fprintf(stderr, "Failed to start hwloc XML loading thread %u\n", i);
+            break;
+        }
+    }
+    if (!i)
+        netloc_map__xml_worker(pool);
+    nr_threads = i;
+    for(i=0; i<nr_threads; i++)
+        pthread_join(threads[i], NULL);
+
+    free(threads);
+}
+
+#if HWLOC_API_VERSION >= 0x00010800
+/* Read all diffs with the first entire topology, before any gets compressed,
+ * and list the servers they refer to
+ */
+static void
+netloc_map__parse_diff_jobs(struct netloc_map__xml_pool *pool,
+                            struct netloc_map__xml_job *diffjobs, unsigned nr,
+                            hwloc_topology_t validtopo,
+                            struct netloc_dt_lookup_table *diffrefs)
+{
+    struct netloc_map__xml_job *jobs = pool->jobs;
+    void (*load)(struct netloc_map__xml_pool *pool, struct netloc_map__xml_job *job) = pool->load;
+    unsigned i;
+
+    pool->jobs = diffjobs;
+    pool->validtopo = validtopo;
+    pool->load = netloc_map__parse_diff_job;
+    netloc_map__run_xml_jobs(pool, 0, nr);
+    pool->jobs = jobs;
+    pool->load = load;
+
+    /* several diffs may refer to the same server, only the first one is stored */
+    for(i=0; i<nr; i++)
+        if (diffjobs[i].refname)
+            netloc_lookup_table_append(diffrefs, diffjobs[i].refname, &diffjobs[i]);
+}
+
+/* Register the server of a diff job, in directory order */
+static void
+netloc_map__merge_diff_job(struct netloc_map *map,
+                           hwloc_topology_t validtopo,
+                           struct netloc_map__xml_job *job)
+{
+    struct netloc_map__server *server, *refserver;
+    hwloc_topology_t topo = job->topology;
+    int err;
+
+    if (map->verbose_flags & NETLOC_MAP_VERBOSE_FLAG_COMPRESS)
+        printf("loading topology diff %s/%s.diff.xml\n", map->hwloc_xml_path, job->name);
+    if (!job->diff)
+        return;
+
+    if (map->verbose_flags & NETLOC_MAP_VERBOSE_FLAG_COMPRESS)
+        printf("  applying diff on top of reference topology %s\n", job->refname);
+
+    refserver = netloc_lookup_table_access(&map->server_by_name, job->refname);
+    if (!refserver) {
+        fprintf(stderr, "Could not find hwloc topology diff reference server %s\n", job->refname);
+        goto out_with_diff;
+    }
+
+    if (!topo) {
+        /* the reference is itself a diff, uncompress it.
+         * it stays uncompressed since it becomes a reference (usecount > 0 below).
+         */
+        if (netloc_map__prepare_hwloc_topology(map, refserver) < 0) {
+            fprintf(stderr, "Failed to uncompress reference server %s topology\n", job->refname);
+            goto out_with_diff;
+        }
+
+        err = hwloc_topology_dup(&topo, refserver->topology);
+        if (err < 0)
+            goto out_with_diff;
+
+        err = hwloc_topology_diff_apply(topo, job->diff, 0);
+        if (err < 0)
+            goto out_with_topo;
+    }
+
+    server = netloc_map__init_server(map, topo, job->name);
+    if (!server)
+        goto out_with_topo;
+
+    /* ideally, we would walk up the chain of reference servers, but:
+     * - there shouldn't be any stack of multiple diffs if the compression is properly done.
+     * - things could fail above if the diffs are not loaded in the right order.
+     * so we don't bother.
+     */
+    server->topology_diff_refserver = refserver;
+    refserver->usecount++;
+    server->topology_diff = job->diff;
+    job->diff = NULL;
+    job->topology = NULL;
+    /* compress the new server, there will likely be nobody depending on it */
+    netloc_map__unprepare_hwloc_topology(map, server);
+    return;
+
+ out_with_topo:
+    hwloc_topology_destroy(topo);
+ out_with_diff:
+    job->topology = NULL;
+    hwloc_topology_diff_destroy(validtopo, job->diff);
+    job->diff = NULL;
+}
+#endif
+
 static int
 netloc_map__init_servers(struct netloc_map *map)
 {
     DIR *hwloc_xml_dir;
     struct dirent *dirent;
-    unsigned nbxmls;
+    struct netloc_map__xml_job *jobs = NULL, *diffjobs = NULL;
+    struct netloc_map__xml_pool pool;
+    unsigned nbxmls, nbjobs = 0, i;
     unsigned founddiffs = 0;
+    unsigned first, end, batch;
+#if HWLOC_API_VERSION >= 0x00010800
+    struct netloc_map__compress_state compress;
+    struct netloc_dt_lookup_table diffrefs; /* servers that diffs refer to */
+    int diffs_parsed = 0;
+#endif
+    int ret = -1;
     int err;
 
     if (!map->hwloc_xml_path)
         return 0;
 
+#if HWLOC_API_VERSION >= 0x00010800
+    memset(&diffrefs, 0, sizeof(diffrefs));
+#endif
+
     hwloc_xml_dir = opendir(map->hwloc_xml_path);
     if (!hwloc_xml_dir)
         goto out;
@@ -402,14 +936,17 @@ netloc_map__init_servers(struct netloc_map *map)
     if (NETLOC_SUCCESS != err)
         goto out_with_dir;
 
-    /* load uncompressed topologies */
+    /* list the entire topologies and the diffs, in directory order */
+    jobs = calloc(nbxmls ? nbxmls : 1, sizeof(*jobs));
+    diffjobs = calloc(nbxmls ? nbxmls : 1, sizeof(*diffjobs));
+    if (!jobs || !diffjobs)
+        goto out_with_jobs;
+
     while ((dirent = readdir(hwloc_xml_dir)) != NULL) {
-        struct netloc_map__server *server;
-        hwloc_topology_t topo;
+        struct netloc_map__xml_job *job;
         char *name;
-        char *filepath;
         size_t namelen;
-        int err;
+        int is_diff = 0;
 
         name = dirent->d_name;
         namelen = strlen(name);
@@ -418,147 +955,140 @@ netloc_map__init_servers(struct netloc_map *map)
         if (strcmp(".xml", name+namelen-4))
             continue;
         namelen -= 4;
-        name[namelen] = '\0';
 
-        if (namelen >= 5 && !strcmp(".diff", name+namelen-5)) {
-            founddiffs++;
-            continue;
+        if (namelen >= 5 && !strncmp(".diff", name+namelen-5, 5)) {
+            namelen -= 5;
+            is_diff = 1;
         }
 
-        err = asprintf(&filepath, "%s/%s.xml", map->hwloc_xml_path, name);
-        if (err < 0)
+        /* the directory may have grown since it was counted */
+        if (nbjobs + founddiffs >= nbxmls)
+            break;
+        job = is_diff ? &diffjobs[founddiffs] : &jobs[nbjobs];
+        job->name = strndup(name, namelen);
+        if (!job->name)
             continue;
+        if (is_diff)
+            founddiffs++;
+        else
+            nbjobs++;
+    }
 
-        hwloc_topology_init(&topo);
-        hwloc_topology_set_flags(topo, HWLOC_TOPOLOGY_FLAG_IO_DEVICES);
-        err = hwloc_topology_set_xml(topo, filepath);
-        free(filepath);
-        if (err < 0) {
-            hwloc_topology_destroy(topo);
-            continue;
-        }
-        hwloc_topology_load(topo);
+#if HWLOC_API_VERSION >= 0x00010800
+    /* keys point into the diff jobs */
+    err = netloc_lookup_table_init(&diffrefs, founddiffs,
+                                   NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY);
+    if (NETLOC_SUCCESS != err)
+        goto out_with_jobs;
+#endif
+
+    if (pthread_mutex_init(&pool.lock, NULL))
+        goto out_with_jobs;
+    pool.map = map;
+
+#if HWLOC_API_VERSION >= 0x00010800
+    memset(&compress, 0, sizeof(compress));
+#endif
+
+    /* load uncompressed topologies on the thread pool by batches, each job
+     * into its own topology. The first one is loaded alone so that the XML
+     * library sets its global state up before the threads start.
+     */
+    pool.jobs = jobs;
+    pool.load = netloc_map__load_xml_job;
+    batch = map->nr_threads * NETLOC_MAP_XML_BATCH_PER_THREAD;
+    for(first = 0; first < nbjobs; first = end) {
+        end = !first ? 1 : first + batch < nbjobs ? first + batch : nbjobs;
+        netloc_map__run_xml_jobs(&pool, first, end);
+
+        /* register their servers in directory order */
+        for(i=first; i<end; i++) {
+            struct netloc_map__server *server;
+
+            if (!jobs[i].topology)
+                continue;
+
+            server = netloc_map__init_server(map, jobs[i].topology, jobs[i].name);
+            if (!server)
+                hwloc_topology_destroy(jobs[i].topology);
+            jobs[i].topology = NULL;
 
-        server = netloc_map__init_server(map, topo, name);
-        if (!server)
-            hwloc_topology_destroy(topo);
+#if HWLOC_API_VERSION >= 0x00010800
+            /* the first entire topology is needed to read the diffs,
+             * and their references must be known before compressing anything
+             */
+            if (server && founddiffs && !diffs_parsed) {
+                netloc_map__parse_diff_jobs(&pool, diffjobs, founddiffs, server->topology, &diffrefs);
+                diffs_parsed = 1;
+            }
 
-        /* FIXME: try to compress if the input directory isn't ? */
+            /* keep one entire topology per hardware class */
+            if (server && (map->flags & NETLOC_MAP_BUILD_FLAG_COMPRESS_HWLOC))
+                netloc_map__compress_server(map, &compress, server,
+                                            netloc_lookup_table_access(&diffrefs, server->name) != NULL);
+#endif
+        }
     }
 
+#if HWLOC_API_VERSION >= 0x00010800
+    if ((map->flags & NETLOC_MAP_BUILD_FLAG_COMPRESS_HWLOC)
+        && (map->verbose_flags & NETLOC_MAP_VERBOSE_FLAG_COMPRESS))
+        printf("compressed %u of %u entire hwloc topologies on top of %u references:"
+               " %lu objects replaced with %lu diff entries\n",
+               compress.nr_compressed, compress.nr_topologies, compress.nr_classes,
+               compress.nr_objs, compress.nr_diff_entries);
+    free(compress.classes);
+#endif
+
     /* load compressed topologies now that the refs are ready */  
     if (founddiffs) {
 #if HWLOC_API_VERSION < 0x00010800
         fprintf(stderr, "Found %u hwloc topology diffs, cannot load without hwloc >= 1.8\n",
                 founddiffs);
 #else
-        /* find one valid topology so that we can load diffs */
-        if (!map->server_first) {
+        /* the diffs were read with the first entire topology */
+        if (!diffs_parsed) {
             fprintf(stderr, "Found %u hwloc topology diffs, cannot load without any entire topology\n",
                     founddiffs);
         } else {
-            hwloc_topology_t validtopo = map->server_first->topology;
-
-            /* now reread the directory entries */
-            rewinddir(hwloc_xml_dir);
-            while ((dirent = readdir(hwloc_xml_dir)) != NULL) {
-                struct netloc_map__server *server, *refserver;
-                hwloc_topology_t topo;
-                hwloc_topology_diff_t diff;
-                char *filepath;
-                char *refname;
-                size_t refnamelen;
-                char *name;
-                size_t namelen;
-                int err;
+            pool.jobs = diffjobs;
+            pool.load = netloc_map__load_diff_job;
 
-                name = dirent->d_name;
-                namelen = strlen(name);
-                if (namelen < 9)
-                    continue;
-                if (strcmp(".diff.xml", name+namelen-9))
-                    continue;
-                namelen -= 9;
-                name[namelen] = '\0';
-
-                err = asprintf(&filepath, "%s/%s.diff.xml", map->hwloc_xml_path, name);
-                if (err < 0)
-                    continue;
-
-                if (map->verbose_flags & NETLOC_MAP_VERBOSE_FLAG_COMPRESS)
-                    printf("loading topology diff %s\n", filepath);
-
-                err = hwloc_topology_diff_load_xml(validtopo, filepath, &diff, &refname);
-                free(filepath);
-                if (err < 0)
-                    continue;
-                if (!refname) {
-                    hwloc_topology_diff_destroy(validtopo, diff);
-                    continue;
-                }
-                refnamelen = strlen(refname);
-                if (strcmp(refname+refnamelen-4, ".xml")) {
-                    free(refname);
-                    hwloc_topology_diff_destroy(validtopo, diff);
-                    continue;
-                }
-                refname[refnamelen-4] = '\0';
-
-                if (map->verbose_flags & NETLOC_MAP_VERBOSE_FLAG_COMPRESS)
-                    printf("  applying diff on top of reference topology %s\n", refname);
-
-                refserver = netloc_lookup_table_access(&map->server_by_name, refname);
-                if (!refserver) {
-                    fprintf(stderr, "Could not find hwloc topology diff reference server %s\n", refname);
-                    free(refname);
-                    hwloc_topology_diff_destroy(validtopo, diff);
-                    continue;
-                }
-                free(refname);
-
-                /* make sure the ref isn't compressed */
-                if (netloc_map__prepare_hwloc_topology(map, refserver) < 0) {
-                    fprintf(stderr, "Failed to uncompress reference server %s topology\n", refname);
-                    hwloc_topology_diff_destroy(validtopo, diff);
-                    continue;
-                }
-
-                err = hwloc_topology_dup(&topo, refserver->topology);
-                if (err < 0) {
-                    hwloc_topology_diff_destroy(validtopo, diff);
-                    continue;
-                }
-
-                err = hwloc_topology_diff_apply(topo, diff, 0);
-                if (err < 0) {
-                    hwloc_topology_diff_destroy(validtopo, diff);
-                    hwloc_topology_destroy(topo);
-                    continue;
-                }	  
-
-                server = netloc_map__init_server(map, topo, name);
-                if (!server) {
-                    hwloc_topology_diff_destroy(validtopo, diff);
-                    hwloc_topology_destroy(topo);
-                } else {
-                    /* ideally, we would walk up the chain of reference servers, but:
-                     * - there shouldn't be any stack of multiple diffs if the compression is properly done.
-                     * - things could fail above if the diffs are not loaded in the right order.
-                     * so we don't bother.
-                     */
-                    server->topology_diff_refserver = refserver;
-                    refserver->usecount++;
-                    server->topology_diff = diff;
-                    /* compress the new server, there will likely be nobody depending on it */
-                    netloc_map__unprepare_hwloc_topology(map, server);
-                }
+            /* apply the diffs in parallel by batches,
+             * then register (and compress) the servers in directory order
+             */
+            for(first = 0; first < founddiffs; first = end) {
+                end = first + batch < founddiffs ? first + batch : founddiffs;
+                netloc_map__run_xml_jobs(&pool, first, end);
+                for(i=first; i<end; i++)
+                    netloc_map__merge_diff_job(map, pool.validtopo, &diffjobs[i]);
             }
         }
 #endif
     }
 
+    pthread_mutex_destroy(&pool.lock);
+    ret = 0;
+
+ out_with_jobs:
+    for(i=0; i<nbjobs; i++) {
+        if (jobs[i].topology)
+            hwloc_topology_destroy(jobs[i].topology);
+        free(jobs[i].name);
+    }
+    for(i=0; i<founddiffs; i++) {
+#if HWLOC_API_VERSION >= 0x00010800
+        free(diffjobs[i].refname);
+#endif
+        free(diffjobs[i].name);
+    }
+#if HWLOC_API_VERSION >= 0x00010800
+    netloc_lookup_table_destroy(&diffrefs);
+#endif
+    free(jobs);
+    free(diffjobs);
     closedir(hwloc_xml_dir);
-    return 0;
+    return ret;
 
  out_with_dir:
     closedir(hwloc_xml_dir);
@@ -601,6 +1131,7 @@ netloc_map__hash_ports(struct netloc_map *map)
             if (NETLOC_SUCCESS != err)
                 return -1;
 
+            port->subnet_index = subnet->ports_nr;
             port->next = NULL;
             port->prev = subnet->port_last;
             if (subnet->port_last)
@@ -628,6 +1159,7 @@ netloc_map__map(struct netloc_map *map)
             netloc_node_t *node;
 
             node = netloc_get_node_by_physical_id(subnet->topology, port->id);
+            port->node = node;
 
             if (node) {
                 netloc_edge_t **edges = NULL;
@@ -707,6 +1239,8 @@ netloc_map__destroy_servers(struct netloc_map *map)
 #endif
         if (curserver->topology)
             hwloc_topology_destroy(curserver->topology);
+        netloc_map__destroy_server_localities(curserver);
+        netloc_map__destroy_server_hwloc_segments(curserver);
         for(i=0; i<curserver->nr_ports; i++)
             free(curserver->ports[i]);
         free(curserver->ports);
@@ -731,6 +1265,14 @@ netloc_map__destroy_subnets(struct netloc_map *map)
         netloc_detach(cursubnet->topology);
         if (cursubnet->port_by_id_ready)
             netloc_lookup_table_destroy(&cursubnet->port_by_id);
+        if (cursubnet->segment_by_ports_ready) {
+            netloc_dt_lookup_table_iterator_t hti;
+            hti = netloc_dt_lookup_table_iterator_t_construct(&cursubnet->segment_by_ports);
+            while (hti && !netloc_lookup_table_iterator_at_end(hti))
+                free(netloc_lookup_table_iterator_next_entry(hti));
+            netloc_dt_lookup_table_iterator_t_destruct(hti);
+            netloc_lookup_table_destroy(&cursubnet->segment_by_ports);
+        }
         free(cursubnet);
         cursubnet = nextsubnet;
     }
@@ -812,8 +1354,25 @@ static void
 netloc_map__put_hwloc_topology(struct netloc_map *map,
                                struct netloc_map__server *server)
 {
-    if (!--server->usecount)
-        netloc_map__unprepare_hwloc_topology(map, server);
+    if (--server->usecount)
+        return;
+
+#if HWLOC_API_VERSION >= 0x00010800
+    /* keep it uncompressed in case it is used again soon */
+    if (map->hwloc_cache_max
+        && (map->flags & NETLOC_MAP_BUILD_FLAG_COMPRESS_HWLOC)
+        && server->topology_diff_refserver) {
+        netloc_map__hwloc_cache_push(map, server);
+        while (map->hwloc_cache_nr > map->hwloc_cache_max) {
+            struct netloc_map__server *lru = map->hwloc_cache_last;
+            netloc_map__hwloc_cache_remove(map, lru);
+            netloc_map__unprepare_hwloc_topology(map, lru);
+        }
+        return;
+    }
+#endif
+
+    netloc_map__unprepare_hwloc_topology(map, server);
 }
 
 static int
@@ -852,6 +1411,37 @@ netloc_map__check_port_locality(struct netloc_map__port *port,
     return hwloc_bitmap_intersects(closeto_obj->cpuset, port_obj->cpuset);
 }
 
+/* set the indexes of the server ports close to closeto_obj in ports */
+static void
+netloc_map__get_close_ports(struct netloc_map__server *server,
+                            hwloc_obj_t closeto_obj,
+                            hwloc_bitmap_t ports)
+{
+    unsigned i;
+
+    hwloc_bitmap_zero(ports);
+
+    /* I/O objects are matched against each port */
+    if (!server->localities
+        || (closeto_obj
+            && (closeto_obj->type == HWLOC_OBJ_OS_DEVICE
+                || closeto_obj->type == HWLOC_OBJ_PCI_DEVICE
+                || closeto_obj->type == HWLOC_OBJ_BRIDGE))) {
+        for(i=0; i<server->nr_ports; i++)
+            if (netloc_map__check_port_locality(server->ports[i], closeto_obj))
+                hwloc_bitmap_set(ports, i);
+        return;
+    }
+
+    /* the others against the locality table */
+    for(i=0; i<server->nr_localities; i++) {
+        struct netloc_map__locality *locality = &server->localities[i];
+        if (!closeto_obj || !closeto_obj->cpuset || !locality->cpuset
+            || hwloc_bitmap_intersects(closeto_obj->cpuset, locality->cpuset))
+            hwloc_bitmap_or(ports, ports, locality->ports);
+    }
+}
+
 
 /*****************
  * Public queries
@@ -863,7 +1453,9 @@ int netloc_map_hwloc2port(netloc_map_t _map,
 {
     struct netloc_map *map = _map;
     struct netloc_map__server *server;
-    unsigned i, found, room = *nrp;
+    hwloc_bitmap_t ports;
+    unsigned found, room = *nrp;
+    int i;
 
     if (!map->merged) {
         errno = EINVAL;
@@ -876,23 +1468,67 @@ int netloc_map_hwloc2port(netloc_map_t _map,
         return -1;
     }
 
-    found = 0;
-    for(i=0; i<server->nr_ports; i++) {
-        struct netloc_map__port *port = server->ports[i];
-        if (!netloc_map__check_port_locality(port, hobj))
-            continue;
+    ports = hwloc_bitmap_alloc();
+    if (!ports)
+        return -1;
+    netloc_map__get_close_ports(server, hobj, ports);
 
+    found = 0;
+    hwloc_bitmap_foreach_begin(i, ports) {
         found++;
         if (room) {
-            *(portsp++) = port;
+            *(portsp++) = server->ports[i];
             room--;
         }
-    }
+    } hwloc_bitmap_foreach_end();
+    hwloc_bitmap_free(ports);
 
     *nrp -= room;
     return found;
 }
 
+int netloc_map_hwloc2port_many(netloc_map_t _map,
+                               hwloc_topology_t htopo, unsigned nr_objs, hwloc_obj_t *hobjs,
+                               netloc_map_port_t *portsp, unsigned max_ports, unsigned *nrs)
+{
+    struct netloc_map *map = _map;
+    struct netloc_map__server *server;
+    hwloc_bitmap_t ports;
+    unsigned j, nr;
+    int i;
+
+    if (!map->merged) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    server = netloc_map__get_server_by_topology(map, htopo);
+    if (!server) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ports = hwloc_bitmap_alloc();
+    if (!ports)
+        return -1;
+
+    for(j=0; j<nr_objs; j++) {
+        netloc_map__get_close_ports(server, hobjs[j], ports);
+
+        /* count them all like hwloc2port, store what fits */
+        nr = 0;
+        hwloc_bitmap_foreach_begin(i, ports) {
+            if (nr < max_ports)
+                portsp[(size_t)j * max_ports + nr] = server->ports[i];
+            nr++;
+        } hwloc_bitmap_foreach_end();
+        nrs[j] = nr;
+    }
+
+    hwloc_bitmap_free(ports);
+    return 0;
+}
+
 int
 netloc_map_port2hwloc(netloc_map_port_t _port,
                       hwloc_topology_t *htopop, hwloc_obj_t *hobjp)
@@ -1188,26 +1824,24 @@ int netloc_map_name2server(netloc_map_t _map,
  * Paths
  */
 
-static int
+/* edges from an object to a port (or from a port to an object),
+ * as if NETLOC_MAP_PATHS_FLAG_IO and NETLOC_MAP_PATHS_FLAG_VERTICAL were given.
+ * netloc_map__filter_hwloc_segment() removes the unwanted ones.
+ */
+enum netloc_map__hwloc_segment_dir_e {
+    NETLOC_MAP__HWLOC_SEGMENT_TO_PORT = 0,
+    NETLOC_MAP__HWLOC_SEGMENT_FROM_PORT = 1
+};
+
+static unsigned
 netloc_map__paths_build_hwloc_edge_to_port(hwloc_topology_t topology,
                                            hwloc_obj_t src, hwloc_obj_t port,
-                                           unsigned long flags,
-                                           struct netloc_map_edge_s **edgesp, unsigned *nr_edgesp)
+                                           struct netloc_map_edge_s *edges)
 {
-    struct netloc_map_edge_s *edges = *edgesp;
-    unsigned nr_edges = *nr_edgesp;
-    unsigned i = nr_edges;
+    unsigned i = 0;
     unsigned pcilength;
     hwloc_obj_t portparent, srcparent, srccousin, ancestor;
 
-    nr_edges += 4;
-    edges = realloc(edges, nr_edges * sizeof(*edges));
-    if (!edges) {
-        *edgesp = NULL;
-        *nr_edgesp = 0;
-        return -1;
-    }
-
     /*  hwloc_get_non_io_ancestor_obj(topology, port) with length */
     pcilength = 0;
     portparent = port;
@@ -1247,7 +1881,7 @@ netloc_map__paths_build_hwloc_edge_to_port(hwloc_topology_t topology,
             i++;
         }
         /* go down to portparent */
-        if (portparent != srccousin && (flags & NETLOC_MAP_PATHS_FLAG_VERTICAL)) {
+        if (portparent != srccousin) {
             edges[i].type = NETLOC_MAP_EDGE_TYPE_HWLOC_CHILD;
             edges[i].hwloc.src_obj = srccousin;
             edges[i].hwloc.dest_obj = portparent;
@@ -1265,7 +1899,7 @@ netloc_map__paths_build_hwloc_edge_to_port(hwloc_topology_t topology,
         srcparent = src;
         while (srcparent->depth != portparent->depth)
             srcparent = srcparent->parent;
-        if (srcparent != src && (flags & NETLOC_MAP_PATHS_FLAG_VERTICAL)) {
+        if (srcparent != src) {
             /* go up from src to srcparent */
             edges[i].type = NETLOC_MAP_EDGE_TYPE_HWLOC_PARENT;
             edges[i].hwloc.src_obj = src;
@@ -1288,39 +1922,24 @@ netloc_map__paths_build_hwloc_edge_to_port(hwloc_topology_t topology,
         }
     }
 
-    if (flags & NETLOC_MAP_PATHS_FLAG_IO) {
-        /* now go down from portparent to port */
-        edges[i].type = NETLOC_MAP_EDGE_TYPE_HWLOC_PCI;
-        edges[i].hwloc.src_obj = portparent;
-        edges[i].hwloc.dest_obj = port;
-        edges[i].hwloc.weight = pcilength;
-        i++;
-    }
+    /* now go down from portparent to port */
+    edges[i].type = NETLOC_MAP_EDGE_TYPE_HWLOC_PCI;
+    edges[i].hwloc.src_obj = portparent;
+    edges[i].hwloc.dest_obj = port;
+    edges[i].hwloc.weight = pcilength;
+    i++;
 
-    *edgesp = edges;
-    *nr_edgesp = i;
-    return 0;
+    return i;
 }
 
-static int
+static unsigned
 netloc_map__paths_build_hwloc_edge_from_port(hwloc_topology_t topology,
                                              hwloc_obj_t port, hwloc_obj_t dst,
-                                             unsigned long flags,
-                                             struct netloc_map_edge_s **edgesp, unsigned *nr_edgesp)
+                                             struct netloc_map_edge_s *edges)
 {
-    struct netloc_map_edge_s *edges = *edgesp;
-    unsigned nr_edges = *nr_edgesp;
-    unsigned i = nr_edges;
+    unsigned i = 0;
     hwloc_obj_t portparent, dstparent, dstcousin, ancestor;
     unsigned pcilength;
-  
-    nr_edges += 3;
-    edges = realloc(edges, nr_edges * sizeof(*edges));
-    if (!edges) {
-        *edgesp = NULL;
-        *nr_edgesp = 0;
-        return -1;
-    }
 
     /*  hwloc_get_non_io_ancestor_obj(topology, port) with length */
     pcilength = 0;
@@ -1335,14 +1954,12 @@ netloc_map__paths_build_hwloc_edge_from_port(hwloc_topology_t topology,
     while (portparent->depth == (unsigned) HWLOC_TYPE_DEPTH_UNKNOWN)
         portparent = portparent->parent;
 
-    if (flags & NETLOC_MAP_PATHS_FLAG_IO) {
-        /* go up from portparent to port */
-        edges[i].type = NETLOC_MAP_EDGE_TYPE_HWLOC_PCI;
-        edges[i].hwloc.src_obj = port;
-        edges[i].hwloc.dest_obj = portparent;
-        edges[i].hwloc.weight = pcilength;
-        i++;
-    }
+    /* go up from portparent to port */
+    edges[i].type = NETLOC_MAP_EDGE_TYPE_HWLOC_PCI;
+    edges[i].hwloc.src_obj = port;
+    edges[i].hwloc.dest_obj = portparent;
+    edges[i].hwloc.weight = pcilength;
+    i++;
 
     if (portparent->depth > dst->depth) {
         /*  dstcousin ------ dst
@@ -1357,7 +1974,7 @@ netloc_map__paths_build_hwloc_edge_from_port(hwloc_topology_t topology,
         while (dstcousin->depth != dst->depth)
             dstcousin = dstcousin->parent;
         /* go up to dstcousin */
-        if (portparent != dst && (flags & NETLOC_MAP_PATHS_FLAG_VERTICAL)) {
+        if (portparent != dst) {
             edges[i].type = NETLOC_MAP_EDGE_TYPE_HWLOC_PARENT;
             edges[i].hwloc.src_obj = portparent;
             edges[i].hwloc.dest_obj = dstcousin;
@@ -1401,7 +2018,7 @@ netloc_map__paths_build_hwloc_edge_from_port(hwloc_topology_t topology,
             edges[i].hwloc.weight = (portparent->depth - ancestor->depth) * 2 - 1;
             i++;
         }
-        if (dstparent != dst && (flags & NETLOC_MAP_PATHS_FLAG_VERTICAL)) {
+        if (dstparent != dst) {
             /* go down from dstparent to dst */
             edges[i].type = NETLOC_MAP_EDGE_TYPE_HWLOC_CHILD;
             edges[i].hwloc.src_obj = dstparent;
@@ -1411,48 +2028,266 @@ netloc_map__paths_build_hwloc_edge_from_port(hwloc_topology_t topology,
         }
     }
 
-    *edgesp = edges;
-    *nr_edgesp = i;
-    return 0;
+    return i;
 }
 
-int netloc_map_paths_build(netloc_map_t _map,
-                           hwloc_topology_t srctopo, hwloc_obj_t srcobj,
-                           hwloc_topology_t dsttopo, hwloc_obj_t dstobj,
-                           unsigned long flags,
-                           netloc_map_paths_t *_paths, unsigned *nr)
+/* copy the edges of a segment that the flags want, or just count them if edges is NULL */
+static unsigned
+netloc_map__filter_hwloc_segment(struct netloc_map__hwloc_segment *segment,
+                                 unsigned long flags,
+                                 struct netloc_map_edge_s *edges)
 {
-    struct netloc_map *map = _map;
-    struct netloc_map__paths *paths;
-    struct netloc_map__server *srcserver, *dstserver;
-    unsigned max,i,j;
-    int err;
+    unsigned i, nr = 0;
 
-    /* check flags */
-    if (flags & ~(NETLOC_MAP_PATHS_FLAG_IO
-                  |NETLOC_MAP_PATHS_FLAG_VERTICAL))
-        return -1;
+    for(i=0; i<segment->nr_edges; i++) {
+        switch (segment->edges[i].type) {
+        case NETLOC_MAP_EDGE_TYPE_HWLOC_PCI:
+            if (!(flags & NETLOC_MAP_PATHS_FLAG_IO))
+                continue;
+            break;
+        case NETLOC_MAP_EDGE_TYPE_HWLOC_PARENT:
+        case NETLOC_MAP_EDGE_TYPE_HWLOC_CHILD:
+            if (!(flags & NETLOC_MAP_PATHS_FLAG_VERTICAL))
+                continue;
+            break;
+        default:
+            break;
+        }
+        if (edges)
+            edges[nr] = segment->edges[i];
+        nr++;
+    }
+    return nr;
+}
 
-    /* don't let special objects be used, they would mess up the weights */
-    if (srcobj->depth == (unsigned) HWLOC_TYPE_DEPTH_UNKNOWN
-        || dstobj->depth == (unsigned) HWLOC_TYPE_DEPTH_UNKNOWN)
-        return -1;
+static void
+netloc_map__destroy_server_hwloc_segments(struct netloc_map__server *server)
+{
+    unsigned i;
 
-    srcserver = netloc_map__get_server_by_topology(map, srctopo);
-    if (!srcserver)
-        return -1;
-    dstserver = netloc_map__get_server_by_topology(map, dsttopo);
-    if (!dstserver)
+    if (!server->hwloc_segments)
+        return;
+
+    for(i=0; i<server->nr_ports * 2 * server->hwloc_segments_depth; i++)
+        free(server->hwloc_segments[i]);
+    free(server->hwloc_segments);
+    server->hwloc_segments = NULL;
+    server->hwloc_segments_depth = 0;
+}
+
+/* the hwloc edges between obj and a port of the server.
+ * segments of I/O objects aren't cached, they are built in tmp instead.
+ */
+static struct netloc_map__hwloc_segment *
+netloc_map__get_hwloc_segment(struct netloc_map__server *server,
+                              hwloc_topology_t topology, hwloc_obj_t obj,
+                              unsigned portidx, enum netloc_map__hwloc_segment_dir_e dir,
+                              struct netloc_map__hwloc_segment *tmp)
+{
+    struct netloc_map__hwloc_segment *segment = tmp;
+    hwloc_obj_t port = server->ports[portidx]->hwloc_obj;
+    unsigned depth = hwloc_topology_get_depth(topology);
+
+    if (obj->depth < depth) {
+        struct netloc_map__hwloc_segment **segmentsp;
+
+        if (!server->hwloc_segments) {
+            server->hwloc_segments = calloc(server->nr_ports * 2 * depth, sizeof(*server->hwloc_segments));
+            if (server->hwloc_segments)
+                server->hwloc_segments_depth = depth;
+        }
+        if (server->hwloc_segments) {
+            segmentsp = &server->hwloc_segments[(portidx * 2 + dir) * depth + obj->depth];
+            if (!*segmentsp)
+                *segmentsp = calloc(hwloc_get_nbobjs_by_depth(topology, obj->depth), sizeof(**segmentsp));
+            if (*segmentsp) {
+                segment = &(*segmentsp)[obj->logical_index];
+                if (segment->ready)
+                    return segment;
+            }
+        }
+    }
+
+    if (dir == NETLOC_MAP__HWLOC_SEGMENT_TO_PORT)
+        segment->nr_edges = netloc_map__paths_build_hwloc_edge_to_port(topology, obj, port, segment->edges);
+    else
+        segment->nr_edges = netloc_map__paths_build_hwloc_edge_from_port(topology, port, obj, segment->edges);
+    segment->ready = 1;
+    return segment;
+}
+
+/* the network paths between two ports of the same subnet.
+ * NULL if they could not be found this time (and may be retried later).
+ */
+static struct netloc_map__netloc_segment *
+netloc_map__get_netloc_segment(struct netloc_map__port *srcport,
+                               struct netloc_map__port *dstport,
+                               unsigned long flags)
+{
+    struct netloc_map__subnet *subnet = srcport->subnet;
+    netloc_topology_t netloc = subnet->topology;
+    struct netloc_map__netloc_segment *segment = NULL;
+    unsigned long multipath = !!(flags & NETLOC_MAP_PATHS_FLAG_MULTIPATH);
+    unsigned long key;
+    netloc_edge_t **nedges = NULL;
+    int nr_nedges = 0;
+    int nr_npaths = 1;
+    int *noffsets = NULL;
+    int *nedge_uids = NULL;
+    int res, k;
+
+    if (!srcport->node || !dstport->node)
+        return NULL;
+
+    if (!subnet->segment_by_ports_ready) {
+        res = netloc_lookup_table_init(&subnet->segment_by_ports, subnet->ports_nr,
+                                       NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY);
+        if (NETLOC_SUCCESS != res)
+            return NULL;
+        subnet->segment_by_ports_ready = 1;
+    }
+
+    /* unique per pair of ports and multipath flag, never 0 so that the string key is ignored */
+    key = ((((unsigned long) srcport->subnet_index * subnet->ports_nr + dstport->subnet_index) << 1) | multipath) + 1;
+    segment = netloc_lookup_table_access_with_int(&subnet->segment_by_ports, dstport->id, key);
+    if (segment)
+        return segment;
+
+    if (multipath) {
+        res = netloc_get_paths(netloc, srcport->node, dstport->node, 0, NETLOC_PATHS_FLAG_EQUAL_COST, NULL,
+                               &nr_npaths, &noffsets, &nedge_uids);
+        if (NETLOC_SUCCESS == res)
+            nr_nedges = noffsets[nr_npaths];
+    } else {
+        res = netloc_get_path(netloc, srcport->node, dstport->node, &nr_nedges, &nedges, 0);
+    }
+    if (NETLOC_ERROR_NOT_FOUND == res) {
+        /* remember that the ports aren't connected */
+        nr_npaths = 0;
+        nr_nedges = 0;
+    } else if (NETLOC_SUCCESS != res) {
+        return NULL;
+    }
+
+    segment = malloc(sizeof(*segment)
+                     + nr_nedges * sizeof(*segment->edges)
+                     + (nr_npaths + 1) * sizeof(*segment->offsets));
+    if (!segment)
+        goto out;
+    segment->edges = (netloc_edge_t **) (segment + 1);
+    segment->offsets = (unsigned *) (segment->edges + nr_nedges);
+    segment->nr_paths = nr_npaths;
+    segment->offsets[0] = 0;
+    if (multipath) {
+        for(k=0; k<nr_npaths; k++)
+            segment->offsets[k+1] = noffsets[k+1];
+        for(k=0; k<nr_nedges; k++)
+            segment->edges[k] = netloc_get_edge_by_uid(netloc, nedge_uids[k]);
+    } else if (nr_npaths) {
+        segment->offsets[1] = nr_nedges;
+        memcpy(segment->edges, nedges, nr_nedges * sizeof(*nedges));
+    }
+
+    res = netloc_lookup_table_append_with_int(&subnet->segment_by_ports, dstport->id, key, segment);
+    if (NETLOC_SUCCESS != res) {
+        free(segment);
+        segment = NULL;
+    }
+
+ out:
+    free(noffsets);
+    free(nedge_uids);
+    return segment;
+}
+
+/* temporary arrays for building paths, sized for the largest servers of a batch */
+struct netloc_map__paths_scratch {
+    struct netloc_map__netloc_segment **netloc; /* per pair of ports */
+    struct netloc_map__hwloc_segment **src, **dst; /* per port, NULL until needed */
+    struct netloc_map__hwloc_segment *srctmp, *dsttmp; /* per port, for uncached segments */
+};
+
+static void
+netloc_map__paths_scratch_destroy(struct netloc_map__paths_scratch *scratch)
+{
+    free(scratch->netloc);
+    free(scratch->src);
+    free(scratch->dst);
+    free(scratch->srctmp);
+    free(scratch->dsttmp);
+}
+
+static int
+netloc_map__paths_scratch_init(struct netloc_map__paths_scratch *scratch,
+                               unsigned max_srcports, unsigned max_dstports)
+{
+    /* never allocate 0 bytes, so that NULL always means failure */
+    max_srcports = max_srcports ? max_srcports : 1;
+    max_dstports = max_dstports ? max_dstports : 1;
+
+    scratch->netloc = malloc(max_srcports * max_dstports * sizeof(*scratch->netloc));
+    scratch->src = malloc(max_srcports * sizeof(*scratch->src));
+    scratch->dst = malloc(max_dstports * sizeof(*scratch->dst));
+    scratch->srctmp = malloc(max_srcports * sizeof(*scratch->srctmp));
+    scratch->dsttmp = malloc(max_dstports * sizeof(*scratch->dsttmp));
+    if (!scratch->netloc || !scratch->src || !scratch->dst || !scratch->srctmp || !scratch->dsttmp) {
+        netloc_map__paths_scratch_destroy(scratch);
         return -1;
+    }
+    return 0;
+}
+
+static int
+netloc_map__paths_build_one(struct netloc_map *map,
+                            struct netloc_map__server *srcserver,
+                            hwloc_topology_t srctopo, hwloc_obj_t srcobj,
+                            struct netloc_map__server *dstserver,
+                            hwloc_topology_t dsttopo, hwloc_obj_t dstobj,
+                            unsigned long flags,
+                            struct netloc_map__paths_scratch *scratch,
+                            struct netloc_map__paths **pathsp)
+{
+    struct netloc_map__paths *paths;
+    struct netloc_map_edge_s *edges;
+    unsigned nr_paths, nr_edges;
+    unsigned i, j, n, k;
+
+    /* find the segments and count the paths and edges */
+    nr_paths = 0;
+    nr_edges = 0;
+    for(i=0; i<srcserver->nr_ports; i++)
+        scratch->src[i] = NULL;
+    for(j=0; j<dstserver->nr_ports; j++)
+        scratch->dst[j] = NULL;
 
-    /* preallocate the maximal number of paths */
-    max = 0;
     for(i=0; i<srcserver->nr_ports; i++) {
         struct netloc_map__port *srcport = srcserver->ports[i];
+
         for(j=0; j<dstserver->nr_ports; j++) {
             struct netloc_map__port *dstport = dstserver->ports[j];
+            struct netloc_map__netloc_segment *nsegment = NULL;
+
             if (srcport->subnet == dstport->subnet)
-                max++;
+                nsegment = netloc_map__get_netloc_segment(srcport, dstport, flags);
+            if (nsegment && !nsegment->nr_paths)
+                nsegment = NULL;
+            scratch->netloc[i * dstserver->nr_ports + j] = nsegment;
+            if (!nsegment)
+                continue;
+
+            if (!scratch->src[i])
+                scratch->src[i] = netloc_map__get_hwloc_segment(srcserver, srctopo, srcobj,
+                                                                i, NETLOC_MAP__HWLOC_SEGMENT_TO_PORT,
+                                                                &scratch->srctmp[i]);
+            if (!scratch->dst[j])
+                scratch->dst[j] = netloc_map__get_hwloc_segment(dstserver, dsttopo, dstobj,
+                                                                j, NETLOC_MAP__HWLOC_SEGMENT_FROM_PORT,
+                                                                &scratch->dsttmp[j]);
+
+            nr_paths += nsegment->nr_paths;
+            nr_edges += nsegment->offsets[nsegment->nr_paths]
+                + nsegment->nr_paths * (netloc_map__filter_hwloc_segment(scratch->src[i], flags, NULL)
+                                        + netloc_map__filter_hwloc_segment(scratch->dst[j], flags, NULL));
         }
     }
 
@@ -1462,77 +2297,135 @@ int netloc_map_paths_build(netloc_map_t _map,
     paths->map = map;
     paths->flags = flags;
 
+    /* all edges of all paths in a single array */
     paths->nr_paths = 0;
-    paths->paths = calloc(max, sizeof(*paths->paths));
-    if (!paths->paths) {
+    paths->paths = malloc((nr_paths ? nr_paths : 1) * sizeof(*paths->paths));
+    paths->edges = malloc((nr_edges ? nr_edges : 1) * sizeof(*paths->edges));
+    if (!paths->paths || !paths->edges) {
+        free(paths->paths);
+        free(paths->edges);
         free(paths);
         return -1;
     }
 
+    edges = paths->edges;
     for(i=0; i<srcserver->nr_ports; i++) {
-        struct netloc_map__port *srcport = srcserver->ports[i];
-        netloc_topology_t netloc = srcport->subnet->topology;
-        netloc_node_t *srcnode;
-        srcnode = netloc_get_node_by_physical_id(netloc, srcport->id);
-        assert(srcnode);
+        netloc_topology_t netloc = srcserver->ports[i]->subnet->topology;
 
         for(j=0; j<dstserver->nr_ports; j++) {
-            struct netloc_map__port *dstport = dstserver->ports[j];
-
-            if (srcport->subnet != dstport->subnet)
+            struct netloc_map__netloc_segment *nsegment = scratch->netloc[i * dstserver->nr_ports + j];
+            if (!nsegment)
                 continue;
 
-            netloc_node_t *dstnode;
-            dstnode = netloc_get_node_by_physical_id(netloc, dstport->id);
-            assert(dstnode);
+            for(n=0; n<nsegment->nr_paths; n++) {
+                struct netloc_map__path *path = &paths->paths[paths->nr_paths++];
+                path->edges = edges;
 
-            struct netloc_map__path *path = &paths->paths[paths->nr_paths];
-            path->edges = NULL;
-            path->nr_edges = 0;
+                /* hwloc edges in the source node */
+                edges += netloc_map__filter_hwloc_segment(scratch->src[i], flags, edges);
 
-            /* hwloc edges in the source node */
-            err = netloc_map__paths_build_hwloc_edge_to_port(srctopo,
-                                                             srcobj, srcport->hwloc_obj,
-                                                             flags,
-                                                             &path->edges, &path->nr_edges);
-            if (err < 0)
-                continue;
+                /* netloc edges */
+                for(k=nsegment->offsets[n]; k<nsegment->offsets[n+1]; k++) {
+                    edges->type = NETLOC_MAP_EDGE_TYPE_NETLOC;
+                    edges->netloc.topology = netloc;
+                    edges->netloc.edge = nsegment->edges[k];
+                    edges++;
+                }
 
-            /* netloc edges */
-            netloc_edge_t **nedges = NULL;
-            int nr_nedges = 0;
-            int res = netloc_get_path(netloc, srcnode, dstnode, &nr_nedges, &nedges, 0);
-            if (NETLOC_SUCCESS != res)
-                continue;
-            path->edges = realloc(path->edges, (path->nr_edges + nr_nedges) * sizeof(*path->edges));
-            if (!path->edges)
-                goto out;
-            unsigned k;
-            for(k=0; k<(unsigned) nr_nedges; k++) {
-                struct netloc_map_edge_s *edge = &path->edges[path->nr_edges++];
-                edge->type = NETLOC_MAP_EDGE_TYPE_NETLOC;
-                edge->netloc.topology = netloc;
-                edge->netloc.edge = nedges[k];
+                /* hwloc edges in the destination node */
+                edges += netloc_map__filter_hwloc_segment(scratch->dst[j], flags, edges);
+
+                path->nr_edges = edges - path->edges;
             }
-      
-            /* hwloc edges in the destination node */
-            err = netloc_map__paths_build_hwloc_edge_from_port(dsttopo,
-                                                               dstport->hwloc_obj, dstobj,
-                                                               flags,
-                                                               &path->edges, &path->nr_edges);
-            if (err < 0)
-                continue;
+        }
+    }
+
+    *pathsp = paths;
+    return 0;
+}
+
+int netloc_map_paths_build_many(netloc_map_t _map, unsigned nr_pairs,
+                                hwloc_topology_t *srctopos, hwloc_obj_t *srcobjs,
+                                hwloc_topology_t *dsttopos, hwloc_obj_t *dstobjs,
+                                unsigned long flags,
+                                netloc_map_paths_t *_paths, unsigned *nrs)
+{
+    struct netloc_map *map = _map;
+    struct netloc_map__paths_scratch scratch;
+    struct netloc_map__server *srcserver, *dstserver;
+    unsigned max_srcports, max_dstports;
+    unsigned i;
+    int err;
+
+    /* check flags */
+    if (flags & ~(NETLOC_MAP_PATHS_FLAG_IO
+                  |NETLOC_MAP_PATHS_FLAG_VERTICAL
+                  |NETLOC_MAP_PATHS_FLAG_MULTIPATH))
+        return -1;
+
+    /* check all pairs before building anything */
+    max_srcports = 0;
+    max_dstports = 0;
+    for(i=0; i<nr_pairs; i++) {
+        /* don't let special objects be used, they would mess up the weights */
+        if (srcobjs[i]->depth == (unsigned) HWLOC_TYPE_DEPTH_UNKNOWN
+            || dstobjs[i]->depth == (unsigned) HWLOC_TYPE_DEPTH_UNKNOWN)
+            return -1;
+
+        srcserver = netloc_map__get_server_by_topology(map, srctopos[i]);
+        if (!srcserver)
+            return -1;
+        dstserver = netloc_map__get_server_by_topology(map, dsttopos[i]);
+        if (!dstserver)
+            return -1;
+
+        if (srcserver->nr_ports > max_srcports)
+            max_srcports = srcserver->nr_ports;
+        if (dstserver->nr_ports > max_dstports)
+            max_dstports = dstserver->nr_ports;
+    }
+
+    err = netloc_map__paths_scratch_init(&scratch, max_srcports, max_dstports);
+    if (err < 0)
+        return -1;
 
-            paths->nr_paths++;
+    for(i=0; i<nr_pairs; i++) {
+        struct netloc_map__paths *paths;
+
+        srcserver = netloc_map__get_server_by_topology(map, srctopos[i]);
+        dstserver = netloc_map__get_server_by_topology(map, dsttopos[i]);
+        err = netloc_map__paths_build_one(map,
+                                          srcserver, srctopos[i], srcobjs[i],
+                                          dstserver, dsttopos[i], dstobjs[i],
+                                          flags, &scratch, &paths);
+        if (err < 0) {
+            while (i--)
+                netloc_map_paths_destroy(_paths[i]);
+            netloc_map__paths_scratch_destroy(&scratch);
+            return -1;
         }
+
+        _paths[i] = paths;
+        nrs[i] = paths->nr_paths;
     }
 
- out:
-    *_paths = paths;
-    *nr = paths->nr_paths;
+    netloc_map__paths_scratch_destroy(&scratch);
     return 0;
 }
 
+int netloc_map_paths_build(netloc_map_t map,
+                           hwloc_topology_t srctopo, hwloc_obj_t srcobj,
+                           hwloc_topology_t dsttopo, hwloc_obj_t dstobj,
+                           unsigned long flags,
+                           netloc_map_paths_t *paths, unsigned *nr)
+{
+    return netloc_map_paths_build_many(map, 1,
+                                       &srctopo, &srcobj,
+                                       &dsttopo, &dstobj,
+                                       flags,
+                                       paths, nr);
+}
+
 int netloc_map_paths_get(netloc_map_paths_t _paths, unsigned idx,
                          struct netloc_map_edge_s **edges, unsigned *nr_edges)
 {
@@ -1551,9 +2444,7 @@ int netloc_map_paths_get(netloc_map_paths_t _paths, unsigned idx,
 int netloc_map_paths_destroy(netloc_map_paths_t _paths)
 {
     struct netloc_map__paths *paths = _paths;
-    unsigned i;
-    for(i=0; i<paths->nr_paths; i++)
-        free(paths->paths[i].edges);
+    free(paths->edges);
     free(paths->paths);
     free(paths);
     return 0;
@@ -1569,7 +2460,7 @@ netloc_map_find_neighbors(netloc_map_t _map,
 {
     struct netloc_map *map = _map;
     struct netloc_map__server *server;
-    unsigned i,j,k,l;
+    unsigned i,j;
 
     if (!map->merged) {
         errno = EINVAL;
@@ -1580,67 +2471,66 @@ netloc_map_find_neighbors(netloc_map_t _map,
     if (!server)
         return -1;
 
-    unsigned done_nr_allocated = 32;
-    const char **done_ids = malloc(done_nr_allocated * sizeof(*done_ids));
-    unsigned prev_nr_allocated = 32;
-    const char **prev_ids = malloc(prev_nr_allocated * sizeof(*prev_ids));
-    unsigned next_nr_allocated = 32;
-    const char **next_ids = malloc(next_nr_allocated * sizeof(*next_ids));
+    /* Nodes are followed by their index in the compact graph of the subnet */
+    unsigned char *done = NULL;
+    int *prev_idx = NULL;
+    int *next_idx = NULL;
 
     for(i=0; i<server->nr_ports; i++) {
         struct netloc_map__port *port = server->ports[i];
         struct netloc_map__subnet *subnet = port->subnet;
         netloc_topology_t netloc = subnet->topology;
+        struct support_graph_t *graph;
+        netloc_node_t *node;
         unsigned depth;
+        int e;
 
         assert(netloc);
 
-        unsigned done_nr = 1;
-        done_ids[0] = port->id;
-        unsigned prev_nr = 1;
-        prev_ids[0] = port->id;
-        unsigned next_nr = 0;
-
         printf("Starting from port %s in subnet type %d id %s\n", 
                port->id, subnet->type, subnet->id);
 
+        node = netloc_get_node_by_physical_id(netloc, port->id);
+        if (!node) {
+            fprintf(stderr, "lookup_table_access(nodes) failed, port down or unknown?\n");
+            continue;
+        }
+
+        graph = support_topology_graph(netloc);
+        if (!graph)
+            goto out;
+
+        /* Every node is queued at most once */
+        done = calloc(graph->num_nodes, sizeof(*done));
+        prev_idx = malloc(graph->num_nodes * sizeof(*prev_idx));
+        next_idx = malloc(graph->num_nodes * sizeof(*next_idx));
+        if (!done || !prev_idx || !next_idx)
+            goto out;
+
+        done[node->__uid__] = 1;
+        unsigned prev_nr = 1;
+        prev_idx[0] = node->__uid__;
+        unsigned next_nr = 0;
+
         for(depth = 1; depth <= maxdepth; depth++) {
             printf("Looking at distance %u in subnet type %d id %s\n", 
                    depth, subnet->type, subnet->id);
       
             for(j=0; j<prev_nr; j++) {
-                netloc_edge_t **edges = NULL;
-                int nredges = 0;
-                netloc_node_t *node = netloc_get_node_by_physical_id(netloc, prev_ids[j]);
-                if (!node) {
-                    fprintf(stderr, "lookup_table_access(nodes) failed, port down or unknown?\n");
-                    continue;
-                }
+                int u = prev_idx[j];
 
-                netloc_get_all_edges(netloc, node, &nredges, &edges);
-
-                for(k=0; k<(unsigned)nredges; k++) {
-                    netloc_edge_t *edge = edges[k];
-                    const char* id = edge->dest_node_id;
-                    int done = 0;
-                    for(l=0; l<done_nr; l++) {
-                        if (!strcmp(id, done_ids[l])) {
-                            done = 1;
-                            break;
-                        }
-                    }
-                    if (done)
+                for(e=graph->edge_offsets[u]; e<graph->edge_offsets[u+1]; e++) {
+                    int v = graph->edge_dests[e];
+                    const char *id;
+
+                    /* Destinations outside the subnet cannot be followed */
+                    if (v < 0 || done[v])
                         continue;
+                    id = graph->nodes[v]->physical_id;
 
-                    if (edge->dest_node_type == NETLOC_NODE_TYPE_SWITCH) {
+                    if (graph->node_types[v] == NETLOC_NODE_TYPE_SWITCH) {
                         printf("Queueing switch %s\n", id);
-                        if (next_nr == next_nr_allocated) {
-                            //next_nr_allocated = next_nr_allocated;
-                            next_ids = realloc(next_ids, next_nr_allocated * sizeof(*next_ids));
-                            if (!next_ids)
-                                goto out;
-                        }
-                        next_ids[next_nr++] = id;
+                        next_idx[next_nr++] = v;
 
                     } else {
                         const char *name = "unknown";
@@ -1650,35 +2540,32 @@ netloc_map_find_neighbors(netloc_map_t _map,
                         printf("Found server %s port %s\n", name, id);
                     }
 
-                    if (done_nr == done_nr_allocated) {
-                        done_nr_allocated <<= 1;
-                        done_ids = realloc(done_ids, done_nr_allocated * sizeof(*done_ids));
-                        if (!done_ids)
-                            goto out;
-                    }
-                    done_ids[done_nr++] = id;
+                    done[v] = 1;
                 }
             }
 
             if (!next_nr)
                 break;
 
-            if (next_nr > prev_nr_allocated) {
-                prev_nr_allocated = next_nr_allocated;
-                prev_ids = realloc(prev_ids, prev_nr_allocated * sizeof(*prev_ids));
-                if (!prev_ids)
-                    goto out;
-            }
-            memcpy(prev_ids, next_ids, next_nr * sizeof(*prev_ids));
+            int *tmp = prev_idx;
+            prev_idx = next_idx;
+            next_idx = tmp;
             prev_nr = next_nr;
             next_nr = 0;
         }
+
+        free(done);
+        free(prev_idx);
+        free(next_idx);
+        done = NULL;
+        prev_idx = NULL;
+        next_idx = NULL;
     }
 
  out:
-    free(done_ids);
-    free(prev_ids);
-    free(next_ids);
+    free(done);
+    free(prev_idx);
+    free(next_idx);
     return 0;
 }
 
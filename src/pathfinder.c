@@ -15,15 +15,21 @@
 #include <private/netloc.h>
 
 #include <limits.h>
+#include <string.h>
+#include <pthread.h>
 
 #include "support.h"
 
 /**
  * Priority Queue support
+ *
+ * An indexed binary min-heap. Every item is a dense id (the node's
+ * __uid__), and pos[id] tracks where that item sits in the heap so that
+ * pq_reorder (decrease-key) does not have to search for it.
  */
 struct pq_element_t {
     int priority;
-    void * data;
+    int id;
 };
 typedef struct pq_element_t pq_element_t;
 
@@ -31,32 +37,267 @@ struct pq_queue_t {
     int size;
     int alloc;
     pq_element_t *data;
+    /** Heap position of each id (-1 if not in the queue) */
+    int *pos;
 };
 typedef struct pq_queue_t pq_queue_t;
 
-static pq_queue_t * pq_queue_t_construct();
+static pq_queue_t * pq_queue_t_construct(int max_items);
 static int pq_queue_t_destruct(pq_queue_t *pq);
-static int pq_push(pq_queue_t *pq, int priority, void *data);
-static void * pq_pop(pq_queue_t *pq);
-static void pq_reorder(pq_queue_t *pq, int priority, void *data);
+static int pq_push(pq_queue_t *pq, int priority, int id);
+static int pq_pop(pq_queue_t *pq);
+static void pq_reorder(pq_queue_t *pq, int priority, int id);
+static void pq_clear(pq_queue_t *pq);
 //static void pq_dump(pq_queue_t *pq);
 
 static inline bool pq_is_empty(pq_queue_t *pq) {
     return pq->size == 0;
 }
 
+static inline bool pq_contains(pq_queue_t *pq, int id) {
+    return pq->pos[id] >= 0;
+}
+
+/**
+ * Scratch space for the pathfinder, kept on the data collection handle
+ * so that it is only reallocated when the number of nodes grows.
+ */
+struct netloc_dc_pathfinder_t {
+    /** Number of nodes the arrays below can hold */
+    int alloc;
+    /** Number of nodes in the last search (valid __uid__ values) */
+    int num_nodes;
+    /** Graph of the search */
+    struct support_graph_t *graph;
+    /** If the graph is released with the scratch space */
+    bool own_graph;
+    pq_queue_t *queue;
+    int *distance;
+    bool *not_seen;
+    /** Node before each node on its shortest path (-1 if none) */
+    int *prev_node;
+    /** Edge (position in the graph) reaching each node (-1 if none) */
+    int *prev_edge;
+    /** Edge weight of the search (NULL counts hops) */
+    netloc_dc_path_weight_fn_t weight;
+    /** Nodes (by __uid__) and edges (by UID) to avoid (NULL if none) */
+    bool *excluded_nodes;
+    bool *excluded_edges;
+    int num_excluded_edges;
+};
+
+static struct netloc_dc_pathfinder_t * pathfinder_construct(int num_nodes);
+
+static inline int pathfinder_weight(struct netloc_dc_pathfinder_t *pf, int edge) {
+    int weight = (NULL == pf->weight ? 1 : pf->weight(pf->graph->edges[edge]));
+    return (weight < 1 ? 1 : weight);
+}
+
+static inline bool pathfinder_is_excluded(struct netloc_dc_pathfinder_t *pf, int edge) {
+    int uid = pf->graph->edge_uids[edge];
+
+    if( NULL != pf->excluded_nodes && pf->excluded_nodes[pf->graph->edge_dests[edge]] ) {
+        return true;
+    }
+    return (NULL != pf->excluded_edges &&
+            uid >= 0 && uid < pf->num_excluded_edges &&
+            pf->excluded_edges[uid]);
+}
+static struct netloc_dc_pathfinder_t * pathfinder_get(netloc_data_collection_handle_t *handle,
+                                                      int num_nodes);
+
+/**
+ * Set the __uid__ of every node of the handle to its position in the node
+ * list, and build the compact graph of the nodes. Returns NULL on error.
+ */
+static struct support_graph_t * pathfinder_graph(netloc_data_collection_handle_t *handle);
+
+/**
+ * Search the graph of the scratch space from node src to node dest (-1 to
+ * build the whole tree). Only touches the scratch space, so several
+ * searches may run at once on separate ones.
+ */
+static void pathfinder_search(struct netloc_dc_pathfinder_t *pf, int src, int dest);
+
 /**
- * Use Dijkstra's shortest path algorithm to calculate the
- * path between the two nodes specified.
+ * Use Dijkstra's shortest path algorithm to build the shortest path
+ * tree rooted at src_node (left in prev_edge of the scratch space).
+ * If dest_node is not NULL, the search stops once it is settled.
  */
 static int compute_shortest_path_dijkstra(netloc_data_collection_handle_t *handle,
                                           netloc_node_t *src_node,
                                           netloc_node_t *dest_node,
-                                          int *num_edges,
-                                          netloc_edge_t ***edges);
+                                          struct netloc_dc_pathfinder_t **pf_out);
+
+/**
+ * Walk the shortest path tree back from dest_node to src_node, and return
+ * the edges in order from the source to the destination.
+ */
+static int extract_path(struct netloc_dc_pathfinder_t *pf,
+                        netloc_node_t *src_node,
+                        netloc_node_t *dest_node,
+                        int *num_edges,
+                        netloc_edge_t ***edges);
+
+/**
+ * Shared state of the threads of netloc_dc_compute_all_paths.
+ * Sources are handed out in batches; the shortest path tree of each source
+ * of the batch is kept in its own slot until it is stored on the handle.
+ */
+struct all_paths_state_t {
+    pthread_mutex_t lock;
+    /** First error seen by a thread (protected by lock) */
+    int status;
+
+    int num_nodes;
+    netloc_node_t **src_nodes;
+
+    int batch_start;
+    int batch_end;
+    /** Next source to claim (protected by lock) */
+    int next_src;
+
+    struct netloc_dc_path_tree_t **trees;
+};
+
+struct all_paths_worker_t {
+    struct all_paths_state_t *state;
+    struct netloc_dc_pathfinder_t *pf;
+    pthread_t thread;
+};
+
+/**
+ * Number of sources per thread in each batch of netloc_dc_compute_all_paths
+ */
+#define ALL_PATHS_BATCH_PER_THREAD 16
+
+/**
+ * Path weights: data rate (Mbit/s) of an edge of cost 1 for
+ * netloc_dc_path_weight_bandwidth, rate assumed for edges of unknown
+ * rate, and the switch latency (ns) and packet size (bits) of the
+ * netloc_dc_path_weight_latency estimate.
+ */
+#define PATH_WEIGHT_REF_BANDWIDTH     1000000UL
+#define PATH_WEIGHT_UNKNOWN_BANDWIDTH    1000UL
+#define PATH_WEIGHT_SWITCH_LATENCY        100UL
+#define PATH_WEIGHT_PACKET_BITS      (4096UL * 8)
+
+static void * compute_all_paths_worker(void *arg);
+
+/**
+ * Paths found by netloc_get_paths, as runs of edge UIDs
+ */
+struct path_list_t {
+    int num_paths;
+    int alloc_paths;
+    /** Start of each path in edge_uids (num_paths + 1 entries) */
+    int *offsets;
+    /** If the path was already taken (candidate paths of Yen's algorithm) */
+    bool *taken;
+    int alloc_uids;
+    int *edge_uids;
+};
+
+static int path_list_append(struct path_list_t *list, const int *edge_uids, int num_edges);
+static bool path_list_contains(struct path_list_t *list, const int *edge_uids, int num_edges);
+static void path_list_destruct(struct path_list_t *list);
+
+/**
+ * Read the edge UIDs of the path from src_node to dest_node off of the
+ * shortest path tree of the last search. Returns the number of edges, or
+ * -1 if dest_node was not reached.
+ */
+static int tree_path_uids(struct netloc_dc_pathfinder_t *pf,
+                          int dest,
+                          int *edge_uids);
+
+/**
+ * Walk of the edges that lie on a shortest path to the destination (the
+ * "tight" edges of the last search), used to enumerate equal-cost paths.
+ */
+struct equal_cost_state_t {
+    struct netloc_dc_pathfinder_t *pf;
+    int dest;
+    int max_paths;
+    /** Per node: 0 if unknown, 1 if it leads to the destination, 2 if not */
+    char *reaches;
+    /** Edge UIDs of the path being walked */
+    int *stack;
+    struct path_list_t *paths;
+    int status;
+};
+
+static int equal_cost_paths(struct netloc_dc_pathfinder_t *pf,
+                            netloc_node_t *src_node,
+                            netloc_node_t *dest_node,
+                            int max_paths,
+                            struct path_list_t *paths);
+static bool equal_cost_reaches(struct equal_cost_state_t *st, int node);
+static void equal_cost_walk(struct equal_cost_state_t *st, int node, int depth);
+
+/**
+ * Total weight of a path given as edge UIDs (its hop count without a
+ * weight function), as the pathfinder counts it
+ */
+static long path_uids_weight(struct netloc_topology * topology,
+                             struct netloc_dc_pathfinder_t *pf,
+                             const int *edge_uids, int num_edges);
+
+/**
+ * Yen's algorithm: the max_paths shortest loop-free paths, by the weight of
+ * the pathfinder
+ */
+static int k_shortest_paths(struct netloc_topology * topology,
+                            struct netloc_dc_pathfinder_t *pf,
+                            netloc_node_t *src_node,
+                            netloc_node_t *dest_node,
+                            int max_paths,
+                            struct path_list_t *paths);
 
 /*************************************************************/
 
+int netloc_dc_path_weight_hops(netloc_edge_t *edge)
+{
+    return 1;
+}
+
+int netloc_dc_path_weight_bandwidth(netloc_edge_t *edge)
+{
+    unsigned long bandwidth = edge->bandwidth;
+
+    if( 0 == bandwidth ) {
+        bandwidth = PATH_WEIGHT_UNKNOWN_BANDWIDTH;
+    }
+
+    // Round up, so that only the fastest edges cost 1
+    return (int)((PATH_WEIGHT_REF_BANDWIDTH + bandwidth - 1) / bandwidth);
+}
+
+int netloc_dc_path_weight_latency(netloc_edge_t *edge)
+{
+    unsigned long bandwidth = edge->bandwidth;
+
+    if( 0 == bandwidth ) {
+        bandwidth = PATH_WEIGHT_UNKNOWN_BANDWIDTH;
+    }
+
+    // bits / (Mbit/s) = us
+    return (int)(PATH_WEIGHT_SWITCH_LATENCY +
+                 (PATH_WEIGHT_PACKET_BITS * 1000 + bandwidth - 1) / bandwidth);
+}
+
+int netloc_dc_set_path_weight(netloc_data_collection_handle_t *handle,
+                              netloc_dc_path_weight_fn_t weight)
+{
+    if( NULL == handle ) {
+        return NETLOC_ERROR;
+    }
+
+    handle->path_weight = weight;
+
+    return NETLOC_SUCCESS;
+}
+
 int netloc_dc_compute_path_between_nodes(netloc_data_collection_handle_t *handle,
                                          netloc_node_t *src_node,
                                          netloc_node_t *dest_node,
@@ -65,6 +306,11 @@ int netloc_dc_compute_path_between_nodes(netloc_data_collection_handle_t *handle
                                          bool is_logical)
 {
     int ret, exit_status = NETLOC_SUCCESS;
+    struct netloc_dc_pathfinder_t *pf = NULL;
+
+    // Just in case things go poorly below
+    (*num_edges) = 0;
+    (*edges) = NULL;
 
     /*
      * Sanity check
@@ -87,305 +333,1245 @@ int netloc_dc_compute_path_between_nodes(netloc_data_collection_handle_t *handle
     ret = compute_shortest_path_dijkstra(handle,
                                          src_node,
                                          dest_node,
-                                         num_edges,
-                                         edges);
+                                         &pf);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    ret = extract_path(pf, src_node, dest_node, num_edges, edges);
+    if( NETLOC_SUCCESS != ret ) {
+        if( NETLOC_ERROR_NOT_FOUND == ret ) {
+            fprintf(stderr, "Error: No path found from %s to %s\n",
+                    src_node->physical_id, dest_node->physical_id);
+        }
+        exit_status = ret;
+        goto cleanup;
+    }
+
+ cleanup:
+    return exit_status;
+}
+
+int netloc_dc_compute_paths_from_node(netloc_data_collection_handle_t *handle,
+                                      netloc_node_t *src_node,
+                                      int num_dest_nodes,
+                                      netloc_node_t **dest_nodes,
+                                      int *num_edges,
+                                      netloc_edge_t ***edges,
+                                      bool is_logical)
+{
+    int ret, exit_status = NETLOC_SUCCESS;
+    int i;
+    struct netloc_dc_pathfinder_t *pf = NULL;
+
+    // Just in case things go poorly below
+    for(i = 0; i < num_dest_nodes; ++i) {
+        num_edges[i] = 0;
+        edges[i]     = NULL;
+    }
+
+    /*
+     * Sanity check
+     */
+    if( NULL == src_node ) {
+        fprintf(stderr, "Error: Source node is NULL\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    if( is_logical ) {
+        fprintf(stderr, "Error: Logical Pathfinding not supported\n");
+        exit_status = NETLOC_ERROR_NOT_IMPL;
+        goto cleanup;
+    }
+
+    /*
+     * Build the whole shortest path tree from this source once
+     */
+    ret = compute_shortest_path_dijkstra(handle,
+                                         src_node,
+                                         NULL,
+                                         &pf);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    /*
+     * Read every requested path off of the tree
+     */
+    for(i = 0; i < num_dest_nodes; ++i) {
+        if( NULL == dest_nodes[i] ) {
+            continue;
+        }
+
+        ret = extract_path(pf, src_node, dest_nodes[i], &num_edges[i], &edges[i]);
+        // Unreachable destinations are left empty
+        if( NETLOC_SUCCESS != ret && NETLOC_ERROR_NOT_FOUND != ret ) {
+            exit_status = ret;
+            goto cleanup;
+        }
+    }
+
+ cleanup:
+    if( NETLOC_SUCCESS != exit_status ) {
+        for(i = 0; i < num_dest_nodes; ++i) {
+            free(edges[i]);
+            num_edges[i] = 0;
+            edges[i]     = NULL;
+        }
+    }
+
+    return exit_status;
+}
+
+int netloc_dc_compute_all_paths(netloc_data_collection_handle_t *handle,
+                                int num_src_nodes,
+                                netloc_node_t **src_nodes,
+                                int num_dest_nodes,
+                                netloc_node_t **dest_nodes,
+                                int num_threads,
+                                bool is_logical)
+{
+    int ret, exit_status = NETLOC_SUCCESS;
+    int i, s, d, idx;
+    int batch_size, num_workers;
+    unsigned long key_int;
+    struct all_paths_state_t state;
+    struct all_paths_worker_t *workers = NULL;
+    struct netloc_dc_path_dests_t *dests = NULL;
+    struct netloc_dc_path_tree_t *tree = NULL;
+    struct netloc_dc_path_tree_t *prev_tree = NULL;
+    struct support_graph_t *graph = NULL;
+    bool lock_init = false;
+
+    state.trees = NULL;
+
+    if( is_logical ) {
+        fprintf(stderr, "Error: Logical Pathfinding not supported\n");
+        exit_status = NETLOC_ERROR_NOT_IMPL;
+        goto cleanup;
+    }
+
+    if( num_src_nodes <= 0 || num_dest_nodes <= 0 ) {
+        goto cleanup;
+    }
+
+    if( num_threads < 1 ) {
+        num_threads = 1;
+    }
+
+    /*
+     * Setup the table of trees for the first call
+     */
+    if( NULL == handle->path_trees ) {
+        handle->path_trees = calloc(1, sizeof(*handle->path_trees));
+        if( NULL == handle->path_trees ) {
+            fprintf(stderr, "Error: Failed to allocate the path tree table\n");
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+        // Keys are the physical IDs of the (source) nodes
+        netloc_lookup_table_init(handle->path_trees, 1, NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY);
+    }
+
+    /*
+     * All of the trees of this call share the destinations
+     */
+    dests = (struct netloc_dc_path_dests_t*)calloc(1, sizeof(struct netloc_dc_path_dests_t));
+    if( NULL != dests ) {
+        dests->nodes = (netloc_node_t**)malloc(sizeof(netloc_node_t*) * num_dest_nodes);
+    }
+    if( NULL == dests || NULL == dests->nodes ) {
+        fprintf(stderr, "Error: Failed to allocate the destination array\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    dests->refcount  = 1;
+    dests->num_nodes = num_dest_nodes;
+    memcpy(dests->nodes, dest_nodes, sizeof(netloc_node_t*) * num_dest_nodes);
+
+    /*
+     * Number the nodes and build the graph once, the threads only read
+     * them from here on
+     */
+    graph = pathfinder_graph(handle);
+    if( NULL == graph ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    state.num_nodes = graph->num_nodes;
+
+    batch_size = num_threads * ALL_PATHS_BATCH_PER_THREAD;
+    if( batch_size > num_src_nodes ) {
+        batch_size = num_src_nodes;
+    }
+
+    state.status    = NETLOC_SUCCESS;
+    state.src_nodes = src_nodes;
+    state.trees     = (struct netloc_dc_path_tree_t**)calloc(batch_size, sizeof(struct netloc_dc_path_tree_t*));
+    if( NULL == state.trees ) {
+        fprintf(stderr, "Error: Failed to allocate the path tree array\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    if( 0 != pthread_mutex_init(&state.lock, NULL) ) {
+        fprintf(stderr, "Error: Failed to initialize the pathfinder lock\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    lock_init = true;
+
+    /*
+     * Each thread gets its own scratch space
+     */
+    workers = (struct all_paths_worker_t*)calloc(num_threads, sizeof(struct all_paths_worker_t));
+    if( NULL == workers ) {
+        fprintf(stderr, "Error: Failed to allocate the pathfinder threads\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    for(i = 0; i < num_threads; ++i) {
+        workers[i].state = &state;
+        workers[i].pf    = pathfinder_construct(state.num_nodes);
+        if( NULL == workers[i].pf ) {
+            fprintf(stderr, "Error: Failed to allocate the pathfinder data structures\n");
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+        workers[i].pf->num_nodes = state.num_nodes;
+        workers[i].pf->graph     = graph;
+        workers[i].pf->weight    = handle->path_weight;
+    }
+
+    for(state.batch_start = 0; state.batch_start < num_src_nodes; state.batch_start += batch_size) {
+        state.batch_end = state.batch_start + batch_size;
+        if( state.batch_end > num_src_nodes ) {
+            state.batch_end = num_src_nodes;
+        }
+        state.next_src = state.batch_start;
+
+        /*
+         * Compute the trees of this batch
+         */
+        num_workers = (state.batch_end - state.batch_start < num_threads ?
+                       state.batch_end - state.batch_start : num_threads);
+        if( 1 == num_workers ) {
+            compute_all_paths_worker(&workers[0]);
+        } else {
+            for(i = 0; i < num_workers; ++i) {
+                ret = pthread_create(&workers[i].thread, NULL, compute_all_paths_worker, &workers[i]);
+                if( 0 != ret ) {
+                    // Let the threads that did start finish the batch
+                    fprintf(stderr, "Error: Failed to start pathfinder thread %d\n", i);
+                    exit_status = NETLOC_ERROR;
+                    break;
+                }
+            }
+            if( 0 == i ) {
+                compute_all_paths_worker(&workers[0]);
+            }
+            num_workers = i;
+            for(i = 0; i < num_workers; ++i) {
+                pthread_join(workers[i].thread, NULL);
+            }
+        }
+
+        if( NETLOC_SUCCESS != state.status ) {
+            exit_status = state.status;
+        }
+
+        /*
+         * Store the trees on the handle (replacing any previous tree of
+         * the same source)
+         */
+        for(s = state.batch_start; s < state.batch_end; ++s) {
+            idx  = s - state.batch_start;
+            tree = state.trees[idx];
+            state.trees[idx] = NULL;
+            if( NULL == tree ) {
+                continue;
+            }
+            if( NETLOC_SUCCESS != exit_status ) {
+                support_path_tree_destruct(tree);
+                continue;
+            }
+
+            for(d = 0; d < num_dest_nodes; ++d) {
+                if( src_nodes[s] != dest_nodes[d] &&
+                    NETLOC_EDGE_UID_INVALID == tree->pred_edge_uids[dest_nodes[d]->__uid__] ) {
+                    fprintf(stderr, "Warning: No path found from %s to %s\n",
+                            src_nodes[s]->physical_id, dest_nodes[d]->physical_id);
+                }
+            }
+
+            tree->dests = dests;
+            dests->refcount++;
+
+            SUPPORT_CONVERT_ADDR_TO_INT(src_nodes[s]->physical_id, handle->network->network_type, key_int);
+            prev_tree = netloc_lookup_table_access_with_int(handle->path_trees,
+                                                            src_nodes[s]->physical_id,
+                                                            key_int);
+            if( NULL != prev_tree ) {
+                support_path_tree_destruct(prev_tree);
+                ret = netloc_lookup_table_replace_with_int(handle->path_trees,
+                                                           src_nodes[s]->physical_id,
+                                                           key_int, tree);
+            } else {
+                ret = netloc_lookup_table_append_with_int(handle->path_trees,
+                                                          src_nodes[s]->physical_id,
+                                                          key_int, tree);
+            }
+            if( NETLOC_SUCCESS != ret ) {
+                fprintf(stderr, "Error: Could not store the paths from %s\n", src_nodes[s]->physical_id);
+                support_path_tree_destruct(tree);
+                exit_status = ret;
+            }
+        }
+
+        if( NETLOC_SUCCESS != exit_status ) {
+            goto cleanup;
+        }
+    }
+
+ cleanup:
+    if( NULL != workers ) {
+        for(i = 0; i < num_threads; ++i) {
+            support_pathfinder_destruct(workers[i].pf);
+        }
+        free(workers);
+    }
+    support_graph_destruct(graph);
+
+    if( lock_init ) {
+        pthread_mutex_destroy(&state.lock);
+    }
+
+    if( NULL != state.trees ) {
+        free(state.trees);
+    }
+
+    // Drop the reference of this call
+    if( NULL != dests && --dests->refcount <= 0 ) {
+        free(dests->nodes);
+        free(dests);
+    }
+
+    return exit_status;
+}
+
+int netloc_dc_compute_all_host_paths(netloc_data_collection_handle_t *handle,
+                                     int num_threads,
+                                     bool progress)
+{
+    int ret, exit_status = NETLOC_SUCCESS;
+    int src_idx, chunk;
+    int num_hosts = 0;
+    netloc_node_t **hosts = NULL;
+    netloc_dt_lookup_table_iterator_t hti = NULL;
+    netloc_node_t *cur_node = NULL;
+
+    /*
+     * Collect the "host" nodes (JJH: For now limit the paths to just those)
+     */
+    hosts = (netloc_node_t**)malloc(sizeof(netloc_node_t*) * (netloc_lookup_table_size(handle->node_list) + 1));
+    if( NULL == hosts ) {
+        fprintf(stderr, "Error: Failed to allocate the host array\n");
+        return NETLOC_ERROR;
+    }
+
+    hti = netloc_dt_lookup_table_iterator_t_construct(handle->node_list);
+    while( !netloc_lookup_table_iterator_at_end(hti) ) {
+        cur_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti);
+        if( NULL == cur_node ) {
+            break;
+        }
+
+        if( NETLOC_NODE_TYPE_HOST == cur_node->node_type ) {
+            hosts[num_hosts++] = cur_node;
+        }
+    }
+    netloc_dt_lookup_table_iterator_t_destruct(hti);
+
+    /*
+     * Calculate the path from all sources to all destinations
+     * (the sources are handed over in chunks to be able to show progress)
+     */
+    chunk = (progress ? (num_hosts + 19) / 20 : num_hosts);
+    for( src_idx = 0; src_idx < num_hosts; src_idx += chunk ) {
+        if( progress ) {
+            printf("\tProgress: %6.2f%% -- %4d of %4d\n", (src_idx * 100.0) / num_hosts, src_idx, num_hosts);
+        }
+
+        ret = netloc_dc_compute_all_paths(handle,
+                                          (src_idx + chunk > num_hosts ? num_hosts - src_idx : chunk),
+                                          &hosts[src_idx],
+                                          num_hosts,
+                                          hosts,
+                                          num_threads,
+                                          false);
+        if( NETLOC_SUCCESS != ret ) {
+            exit_status = ret;
+            break;
+        }
+    }
+
+    free(hosts);
+
+    return exit_status;
+}
+
+int netloc_get_paths(struct netloc_topology * topology,
+                     netloc_node_t *src_node,
+                     netloc_node_t *dest_node,
+                     int max_paths,
+                     unsigned long flags,
+                     netloc_dc_path_weight_fn_t weight,
+                     int *num_paths,
+                     int **path_offsets,
+                     int **edge_uids)
+{
+    int ret, exit_status = NETLOC_SUCCESS;
+    struct netloc_dc_pathfinder_t *pf = NULL;
+    struct path_list_t paths;
+
+    memset(&paths, 0, sizeof(paths));
+
+    // Just in case things go poorly below
+    (*num_paths)    = 0;
+    (*path_offsets) = NULL;
+    (*edge_uids)    = NULL;
+
+    /*
+     * Sanity check
+     */
+    if( NULL == src_node || NULL == dest_node ) {
+        fprintf(stderr, "Error: Source or Destination node is NULL\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    if( max_paths < 0 || (0 == max_paths && !(flags & NETLOC_PATHS_FLAG_EQUAL_COST)) ) {
+        fprintf(stderr, "Error: Invalid maximum number of paths (%d)\n", max_paths);
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    /*
+     * Lazy load the node information
+     */
+    if( !topology->nodes_loaded ) {
+        ret = support_load_json(topology);
+        if( NETLOC_SUCCESS != ret ) {
+            fprintf(stderr, "Error: Failed to load the topology\n");
+            exit_status = ret;
+            goto cleanup;
+        }
+    }
+
+    if( src_node == dest_node ) {
+        exit_status = NETLOC_ERROR_NOT_FOUND;
+        goto cleanup;
+    }
+
+    /*
+     * The nodes of a topology are already numbered by their index
+     */
+    pf = pathfinder_construct(topology->num_nodes);
+    if( NULL == pf ) {
+        fprintf(stderr, "Error: Failed to allocate the pathfinder data structures\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    pf->num_nodes = topology->num_nodes;
+    pf->weight    = weight;
+    pf->graph     = support_topology_graph(topology);
+    if( NULL == pf->graph ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    if( flags & NETLOC_PATHS_FLAG_EQUAL_COST ) {
+        ret = equal_cost_paths(pf, src_node, dest_node, max_paths, &paths);
+    } else {
+        ret = k_shortest_paths(topology, pf, src_node, dest_node, max_paths, &paths);
+    }
     if( NETLOC_SUCCESS != ret ) {
         exit_status = ret;
         goto cleanup;
     }
 
- cleanup:
-    return exit_status;
+    if( 0 == paths.num_paths ) {
+        exit_status = NETLOC_ERROR_NOT_FOUND;
+        goto cleanup;
+    }
+
+    // Hand the arrays over to the caller
+    (*num_paths)    = paths.num_paths;
+    (*path_offsets) = paths.offsets;
+    (*edge_uids)    = paths.edge_uids;
+    paths.offsets   = NULL;
+    paths.edge_uids = NULL;
+
+ cleanup:
+    path_list_destruct(&paths);
+    support_pathfinder_destruct(pf);
+
+    return exit_status;
+}
+
+/*************************************************************
+ * Support Functionality
+ *************************************************************/
+static int compute_shortest_path_dijkstra(netloc_data_collection_handle_t *handle,
+                                          netloc_node_t *src_node,
+                                          netloc_node_t *dest_node,
+                                          struct netloc_dc_pathfinder_t **pf_out)
+{
+    struct netloc_dc_pathfinder_t *pf = NULL;
+    struct support_graph_t *graph = NULL;
+
+    (*pf_out) = NULL;
+
+    /*
+     * Grab the (reusable) scratch space
+     */
+    pf = pathfinder_get(handle, netloc_lookup_table_size(handle->node_list));
+    if( NULL == pf ) {
+        fprintf(stderr, "Error: Failed to allocate the pathfinder data structures\n");
+        return NETLOC_ERROR;
+    }
+
+    // Nodes and edges may have been added since the last search
+    graph = pathfinder_graph(handle);
+    if( NULL == graph ) {
+        return NETLOC_ERROR;
+    }
+    if( graph->num_nodes > pf->alloc ) {
+        fprintf(stderr, "Error: Node list is larger than expected (%d > %d)\n", graph->num_nodes, pf->alloc);
+        support_graph_destruct(graph);
+        return NETLOC_ERROR;
+    }
+
+    // The paths are read off of the graph until the next search
+    if( pf->own_graph ) {
+        support_graph_destruct(pf->graph);
+    }
+    pf->graph     = graph;
+    pf->own_graph = true;
+    pf->num_nodes = graph->num_nodes;
+    pf->weight    = handle->path_weight;
+
+    pathfinder_search(pf, src_node->__uid__, (NULL == dest_node ? -1 : dest_node->__uid__));
+
+    (*pf_out) = pf;
+
+    return NETLOC_SUCCESS;
+}
+
+static struct support_graph_t * pathfinder_graph(netloc_data_collection_handle_t *handle)
+{
+    int i = 0;
+    struct netloc_dt_lookup_table_iterator *hti = NULL;
+    netloc_node_t *cur_node = NULL;
+    netloc_node_t **nodes = NULL;
+    struct support_graph_t *graph = NULL;
+
+    nodes = (netloc_node_t**)malloc(sizeof(netloc_node_t*) * (netloc_lookup_table_size(handle->node_list) + 1));
+    if( NULL == nodes ) {
+        fprintf(stderr, "Error: Failed to allocate the node array\n");
+        return NULL;
+    }
+
+    hti = netloc_dt_lookup_table_iterator_t_construct(handle->node_list);
+    while( !netloc_lookup_table_iterator_at_end(hti) ) {
+        cur_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti);
+        if( NULL == cur_node ) {
+            break;
+        }
+
+        cur_node->__uid__ = i;
+        nodes[i++] = cur_node;
+    }
+    netloc_dt_lookup_table_iterator_t_destruct(hti);
+
+    graph = support_graph_construct(nodes, i);
+    free(nodes);
+
+    return graph;
+}
+
+static void pathfinder_search(struct netloc_dc_pathfinder_t *pf, int src, int dest)
+{
+    int i, e;
+    pq_queue_t *queue = pf->queue;
+    int *distance = pf->distance;
+    bool *not_seen = pf->not_seen;
+    int *prev_node = pf->prev_node;
+    int *prev_edge = pf->prev_edge;
+    const int *edge_offsets = pf->graph->edge_offsets;
+    const int *edge_dests = pf->graph->edge_dests;
+    int alt, weight;
+    int idx_u, idx_v;
+
+    /*
+     * Initialize the data structures
+     * Only the source is queued, the other nodes enter the queue as they
+     * are reached.
+     */
+    for(i = 0; i < pf->num_nodes; ++i) {
+        distance[i] = INT_MAX;
+        not_seen[i] = true;
+
+        prev_node[i] = -1;
+        prev_edge[i] = -1;
+    }
+
+    distance[src] = 0;
+    pq_push(queue, 0, src);
+
+    /*
+     * Search
+     */
+    while( !pq_is_empty(queue) ) {
+        //pq_dump(queue);
+
+        // Grab the next hop
+        idx_u = pq_pop(queue);
+        // Mark as seen
+        not_seen[idx_u] = false;
+
+        // The destination is settled, no shorter path to it remains
+        if( idx_u == dest ) {
+            break;
+        }
+
+        // For all the edges from this node
+        for(e = edge_offsets[idx_u]; e < edge_offsets[idx_u+1]; ++e ) {
+            // Lookup the "dest" node
+            idx_v = edge_dests[e];
+
+            // If the node has been seen, skip
+            if( idx_v < 0 || !not_seen[idx_v] || pathfinder_is_excluded(pf, e) ) {
+                continue;
+            }
+
+            // Otherwise check to see if we found a shorter path
+            weight = pathfinder_weight(pf, e);
+            if( weight > INT_MAX - distance[idx_u] ) {
+                continue;
+            }
+            alt = distance[idx_u] + weight;
+            if( alt < distance[idx_v] ) {
+                distance[idx_v] = alt;
+                prev_node[idx_v] = idx_u;
+                prev_edge[idx_v] = e;
+
+                // Adjust the priority queue as needed
+                if( pq_contains(queue, idx_v) ) {
+                    pq_reorder(queue, alt, idx_v);
+                } else {
+                    pq_push(queue, alt, idx_v);
+                }
+            }
+        }
+    }
+    pq_clear(queue);
+}
+
+static int extract_path(struct netloc_dc_pathfinder_t *pf,
+                        netloc_node_t *src_node,
+                        netloc_node_t *dest_node,
+                        int *num_edges,
+                        netloc_edge_t ***edges)
+{
+    int i, idx;
+
+    (*num_edges) = 0;
+    (*edges) = NULL;
+
+    // Nodes added after the tree was built are unknown to it
+    idx = dest_node->__uid__;
+    if( idx < 0 || idx >= pf->num_nodes || pf->prev_node[idx] < 0 ) {
+        return (dest_node == src_node ? NETLOC_SUCCESS : NETLOC_ERROR_NOT_FOUND);
+    }
+
+    /*
+     * Count the hops, then fill the edges in back to front
+     */
+    for(idx = dest_node->__uid__; pf->prev_node[idx] >= 0; idx = pf->prev_node[idx]) {
+        ++(*num_edges);
+    }
+
+    (*edges) = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * (*num_edges));
+    if( NULL == (*edges) ) {
+        fprintf(stderr, "Error: Failed to allocate the edges array\n");
+        (*num_edges) = 0;
+        return NETLOC_ERROR;
+    }
+
+    i = (*num_edges);
+    for(idx = dest_node->__uid__; pf->prev_node[idx] >= 0; idx = pf->prev_node[idx]) {
+        (*edges)[--i] = pf->graph->edges[pf->prev_edge[idx]];
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+static void * compute_all_paths_worker(void *arg)
+{
+    struct all_paths_worker_t *worker = (struct all_paths_worker_t*)arg;
+    struct all_paths_state_t *state = worker->state;
+    struct netloc_dc_path_tree_t *tree = NULL;
+    int s, i;
+
+    while( true ) {
+        // Claim the next source of the batch
+        pthread_mutex_lock(&state->lock);
+        s = state->next_src++;
+        if( NETLOC_SUCCESS != state->status ) {
+            s = state->batch_end;
+        }
+        pthread_mutex_unlock(&state->lock);
+        if( s >= state->batch_end ) {
+            break;
+        }
+
+        pathfinder_search(worker->pf, state->src_nodes[s]->__uid__, -1);
+
+        // Keep the tree (each source owns its own slot, so no locking here)
+        tree = (struct netloc_dc_path_tree_t*)calloc(1, sizeof(struct netloc_dc_path_tree_t));
+        if( NULL != tree ) {
+            tree->pred_edge_uids = (int*)malloc(sizeof(int) * state->num_nodes);
+        }
+        if( NULL == tree || NULL == tree->pred_edge_uids ) {
+            fprintf(stderr, "Error: Failed to allocate the shortest path tree\n");
+            free(tree);
+            pthread_mutex_lock(&state->lock);
+            state->status = NETLOC_ERROR;
+            pthread_mutex_unlock(&state->lock);
+            break;
+        }
+
+        tree->src_node  = state->src_nodes[s];
+        tree->num_nodes = state->num_nodes;
+        for(i = 0; i < state->num_nodes; ++i) {
+            tree->pred_edge_uids[i] = (worker->pf->prev_edge[i] < 0 ?
+                                       NETLOC_EDGE_UID_INVALID :
+                                       worker->pf->graph->edge_uids[worker->pf->prev_edge[i]]);
+        }
+        state->trees[s - state->batch_start] = tree;
+    }
+
+    return NULL;
 }
 
-/*************************************************************
- * Support Functionality
- *************************************************************/
-static int compute_shortest_path_dijkstra(netloc_data_collection_handle_t *handle,
-                                          netloc_node_t *src_node,
-                                          netloc_node_t *dest_node,
-                                          int *num_edges,
-                                          netloc_edge_t ***edges)
+static int tree_path_uids(struct netloc_dc_pathfinder_t *pf,
+                          int dest,
+                          int *edge_uids)
 {
-    int exit_status = NETLOC_SUCCESS;
-    int i;
-    pq_queue_t *queue = NULL;
-    int *distance = NULL;
-    bool *not_seen = NULL;
-    netloc_node_t *node_u = NULL;
-    netloc_node_t *node_v = NULL;
-    netloc_node_t **prev_node = NULL;
-    netloc_edge_t **prev_edge = NULL;
-    int alt;
-    int idx_u, idx_v;
+    int i, idx, len = 0;
 
-    int num_rev_edges;
-    netloc_edge_t **rev_edges = NULL;
+    if( pf->prev_node[dest] < 0 ) {
+        return -1;
+    }
 
-    struct netloc_dt_lookup_table_iterator *hti = NULL;
-    netloc_node_t *cur_node = NULL;
+    for(idx = dest; pf->prev_node[idx] >= 0; idx = pf->prev_node[idx]) {
+        ++len;
+    }
 
-    unsigned long key_int;
+    i = len;
+    for(idx = dest; pf->prev_node[idx] >= 0; idx = pf->prev_node[idx]) {
+        edge_uids[--i] = pf->graph->edge_uids[pf->prev_edge[idx]];
+    }
 
-    // Just in case things go poorly below
-    (*num_edges) = 0;
-    (*edges) = NULL;
+    return len;
+}
 
+static int equal_cost_paths(struct netloc_dc_pathfinder_t *pf,
+                            netloc_node_t *src_node,
+                            netloc_node_t *dest_node,
+                            int max_paths,
+                            struct path_list_t *paths)
+{
+    struct equal_cost_state_t st;
 
     /*
-     * Allocate some data structures
+     * Every node closer than the destination is settled once the
+     * destination is, which is all the walk looks at
      */
-    queue = pq_queue_t_construct();
-    if( NULL == queue ) {
-        fprintf(stderr, "Error: Failed to allocate the queue\n");
-        exit_status = NETLOC_ERROR;
-        goto cleanup;
+    pathfinder_search(pf, src_node->__uid__, dest_node->__uid__);
+    if( pf->prev_node[dest_node->__uid__] < 0 ) {
+        return NETLOC_SUCCESS;
     }
 
-    distance = (int*)malloc(sizeof(int) * netloc_lookup_table_size(handle->node_list));
-    if( NULL == distance ) {
-        fprintf(stderr, "Error: Failed to allocate the distance array\n");
-        exit_status = NETLOC_ERROR;
-        goto cleanup;
+    st.pf        = pf;
+    st.dest      = dest_node->__uid__;
+    st.max_paths = max_paths;
+    st.paths     = paths;
+    st.status    = NETLOC_SUCCESS;
+    st.reaches   = (char*)calloc(pf->num_nodes, sizeof(char));
+    st.stack     = (int*)malloc(sizeof(int) * pf->num_nodes);
+    if( NULL == st.reaches || NULL == st.stack ) {
+        fprintf(stderr, "Error: Failed to allocate the path enumeration data structures\n");
+        st.status = NETLOC_ERROR;
+    } else {
+        equal_cost_walk(&st, src_node->__uid__, 0);
     }
 
-    not_seen = (bool*)malloc(sizeof(bool) * netloc_lookup_table_size(handle->node_list));
-    if( NULL == not_seen ) {
-        fprintf(stderr, "Error: Failed to allocate the 'not_seen' array\n");
-        exit_status = NETLOC_ERROR;
-        goto cleanup;
-    }
+    free(st.reaches);
+    free(st.stack);
 
-    prev_node = (netloc_node_t**)malloc(sizeof(netloc_node_t*) * netloc_lookup_table_size(handle->node_list));
-    if( NULL == prev_node ) {
-        fprintf(stderr, "Error: Failed to allocate the 'prev_node' array\n");
-        exit_status = NETLOC_ERROR;
-        goto cleanup;
+    return st.status;
+}
+
+/*
+ * If the edge from node lies on a shortest path to the destination
+ */
+static inline bool equal_cost_is_tight(struct equal_cost_state_t *st, int node, int edge)
+{
+    int *distance = st->pf->distance;
+    int idx_v = st->pf->graph->edge_dests[edge];
+
+    if( idx_v < 0 || (idx_v != st->dest && distance[idx_v] >= distance[st->dest]) ) {
+        return false;
     }
 
-    prev_edge = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * netloc_lookup_table_size(handle->node_list));
-    if( NULL == prev_edge ) {
-        fprintf(stderr, "Error: Failed to allocate the 'prev_edge' array\n");
-        exit_status = NETLOC_ERROR;
-        goto cleanup;
+    return ((long)distance[node] + pathfinder_weight(st->pf, edge) == (long)distance[idx_v]);
+}
+
+static bool equal_cost_reaches(struct equal_cost_state_t *st, int node)
+{
+    const int *edge_offsets = st->pf->graph->edge_offsets;
+    int e;
+
+    if( node == st->dest ) {
+        return true;
+    }
+    if( 0 != st->reaches[node] ) {
+        return (1 == st->reaches[node]);
     }
 
-    /*
-     * Initialize the data structures
-     */
-    i = 0;
-    hti = netloc_dt_lookup_table_iterator_t_construct(handle->node_list);
-    while( !netloc_lookup_table_iterator_at_end(hti) ) {
-        cur_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti);
-        if( NULL == cur_node ) {
+    st->reaches[node] = 2;
+    for(e = edge_offsets[node]; e < edge_offsets[node+1]; ++e) {
+        if( equal_cost_is_tight(st, node, e) &&
+            equal_cost_reaches(st, st->pf->graph->edge_dests[e]) ) {
+            st->reaches[node] = 1;
             break;
         }
+    }
 
-        if( cur_node == src_node ) {
-            pq_push(queue, 0, cur_node);
-            distance[i] = 0;
-        } else {
-            pq_push(queue, INT_MAX, cur_node);
-            distance[i] = INT_MAX;
-        }
+    return (1 == st->reaches[node]);
+}
 
-        not_seen[i] = true;
+static void equal_cost_walk(struct equal_cost_state_t *st, int node, int depth)
+{
+    const int *edge_offsets = st->pf->graph->edge_offsets;
+    int e;
 
-        prev_node[i] = NULL;
-        prev_edge[i] = NULL;
+    if( node == st->dest ) {
+        st->status = path_list_append(st->paths, st->stack, depth);
+        return;
+    }
 
-        cur_node->__uid__ = i;
-        ++i;
+    for(e = edge_offsets[node]; e < edge_offsets[node+1]; ++e) {
+        if( NETLOC_SUCCESS != st->status ||
+            (st->max_paths > 0 && st->paths->num_paths >= st->max_paths) ) {
+            return;
+        }
+
+        // Only step onto nodes that lead to the destination, so that no
+        // part of the graph is walked more than needed
+        if( equal_cost_is_tight(st, node, e) &&
+            equal_cost_reaches(st, st->pf->graph->edge_dests[e]) ) {
+            st->stack[depth] = st->pf->graph->edge_uids[e];
+            equal_cost_walk(st, st->pf->graph->edge_dests[e], depth + 1);
+        }
+    }
+}
+
+static int k_shortest_paths(struct netloc_topology * topology,
+                            struct netloc_dc_pathfinder_t *pf,
+                            netloc_node_t *src_node,
+                            netloc_node_t *dest_node,
+                            int max_paths,
+                            struct path_list_t *paths)
+{
+    int ret, exit_status = NETLOC_SUCCESS;
+    int k, i, j, p, best;
+    int prev_len, len, spur_len;
+    long cost, best_cost = 0;
+    int *prev = NULL;
+    int *path = NULL;
+    netloc_edge_t *edge = NULL;
+    netloc_node_t *spur_node = NULL;
+    struct path_list_t candidates;
+
+    memset(&candidates, 0, sizeof(candidates));
+
+    pf->excluded_nodes     = (bool*)calloc(pf->num_nodes, sizeof(bool));
+    pf->excluded_edges     = (bool*)calloc(topology->num_edge_uids, sizeof(bool));
+    pf->num_excluded_edges = topology->num_edge_uids;
+    // A loop-free path has fewer edges than there are nodes
+    path = (int*)malloc(sizeof(int) * pf->num_nodes);
+    if( NULL == pf->excluded_nodes || NULL == pf->excluded_edges || NULL == path ) {
+        fprintf(stderr, "Error: Failed to allocate the path enumeration data structures\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
     }
 
     /*
-     * Search
+     * The shortest path
      */
-    while( !pq_is_empty(queue) ) {
-        //pq_dump(queue);
+    pathfinder_search(pf, src_node->__uid__, dest_node->__uid__);
+    len = tree_path_uids(pf, dest_node->__uid__, path);
+    if( len < 0 ) {
+        goto cleanup;
+    }
+    ret = path_list_append(paths, path, len);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
 
-        // Grab the next hop
-        node_u = pq_pop(queue);
-        // Mark as seen
-        idx_u = -1;
-        i = 0;
-        idx_u = node_u->__uid__;
-        not_seen[idx_u] = false;
+    for(k = 1; k < max_paths; ++k) {
+        /*
+         * Deviate from the last path at each of its nodes (the spur node),
+         * keeping the part before it (the root)
+         */
+        prev_len = paths->offsets[k] - paths->offsets[k-1];
+        for(i = 0; i < prev_len; ++i) {
+            // The list may have moved while appending candidates
+            prev = paths->edge_uids + paths->offsets[k-1];
+
+            edge = NETLOC_DT_EDGE_BY_UID(topology->edges_by_uid, topology->num_edge_uids, prev[i]);
+            if( NULL == edge || NULL == edge->src_node ) {
+                exit_status = NETLOC_ERROR;
+                goto cleanup;
+            }
+            spur_node = edge->src_node;
 
-        // For all the edges from this node
-        for(i = 0; i < node_u->num_edges; ++i ) {
-            node_v = NULL;
-            idx_v  = -1;
+            // The known paths sharing the root must not be found again
+            for(p = 0; p < paths->num_paths; ++p) {
+                len = paths->offsets[p+1] - paths->offsets[p];
+                if( len > i && 0 == memcmp(paths->edge_uids + paths->offsets[p], prev, sizeof(int) * i) ) {
+                    pf->excluded_edges[paths->edge_uids[paths->offsets[p] + i]] = true;
+                }
+            }
 
-            // Lookup the "dest" node
-            node_v = node_u->edges[i]->dest_node;
-            idx_v = node_v->__uid__;
+            // Nor may the spur path loop back through the root
+            for(j = 0; j < i; ++j) {
+                edge = NETLOC_DT_EDGE_BY_UID(topology->edges_by_uid, topology->num_edge_uids, prev[j]);
+                if( NULL != edge && NULL != edge->src_node ) {
+                    pf->excluded_nodes[edge->src_node->__uid__] = true;
+                }
+            }
 
-            // If the node has been seen, skip
-            if( !not_seen[idx_v] ) {
-                continue;
+            pathfinder_search(pf, spur_node->__uid__, dest_node->__uid__);
+            spur_len = tree_path_uids(pf, dest_node->__uid__, path + i);
+            if( spur_len >= 0 ) {
+                memcpy(path, prev, sizeof(int) * i);
+                len = i + spur_len;
+                if( !path_list_contains(paths, path, len) && !path_list_contains(&candidates, path, len) ) {
+                    ret = path_list_append(&candidates, path, len);
+                    if( NETLOC_SUCCESS != ret ) {
+                        exit_status = ret;
+                        goto cleanup;
+                    }
+                }
             }
 
-            // Otherwise check to see if we found a shorter path
-            // Future Work: Add a weight factor other than 1.
-            //              Maybe calculated based on speed/width
-            alt = distance[idx_u] + 1;
-            if( alt < distance[idx_v] ) {
-                distance[idx_v] = alt;
-                prev_node[idx_v] = node_u;
-                prev_edge[idx_v] = node_u->edges[i];
+            memset(pf->excluded_nodes, 0, sizeof(bool) * pf->num_nodes);
+            memset(pf->excluded_edges, 0, sizeof(bool) * pf->num_excluded_edges);
+        }
 
-                // Adjust the priority queue as needed
-                pq_reorder(queue, alt, node_v);
+        /*
+         * Take the lightest candidate (the first found among equals)
+         */
+        best = -1;
+        for(p = 0; p < candidates.num_paths; ++p) {
+            if( candidates.taken[p] ) {
+                continue;
             }
+            cost = path_uids_weight(topology, pf, candidates.edge_uids + candidates.offsets[p],
+                                    candidates.offsets[p+1] - candidates.offsets[p]);
+            if( best < 0 || cost < best_cost ) {
+                best = p;
+                best_cost = cost;
+            }
+        }
+        if( best < 0 ) {
+            break;
+        }
+
+        candidates.taken[best] = true;
+        ret = path_list_append(paths, candidates.edge_uids + candidates.offsets[best],
+                               candidates.offsets[best+1] - candidates.offsets[best]);
+        if( NETLOC_SUCCESS != ret ) {
+            exit_status = ret;
+            goto cleanup;
         }
     }
 
-    /*
-     * Reconstruct the path by picking up the edges
-     * The edges will be in reverse order (dest to source).
-     */
-    num_rev_edges = 0;
-    rev_edges     = NULL;
-
-    // Find last hop
-    SUPPORT_CONVERT_ADDR_TO_INT(dest_node->physical_id,
-                                handle->network->network_type,
-                                key_int);
-    node_u  = netloc_lookup_table_access_with_int( handle->node_list,
-                                                   dest_node->physical_id,
-                                                   key_int);
-    idx_u = node_u->__uid__;
-
-    node_v = NULL;
-    idx_v  = -1;
-    while( prev_node[idx_u] != NULL ) {
-        // Find the linking edge
-        if( node_u != dest_node) {
-            for(i = 0; i < node_u->num_edges; ++i ) {
-                if( node_v->physical_id_int == node_u->edges[i]->dest_node->physical_id_int ) {
-                    ++num_rev_edges;
-                    rev_edges = (netloc_edge_t**)realloc(rev_edges, sizeof(netloc_edge_t*) * num_rev_edges);
-                    if( NULL == rev_edges ) {
-                        fprintf(stderr, "Error: Failed to re-allocate the 'rev_edges' array with %d elements\n",
-                                num_rev_edges);
-                        exit_status = NETLOC_ERROR;
-                        goto cleanup;
-                    }
-                    rev_edges[num_rev_edges-1] = node_u->edges[i];
-                    break;
-                }
-            }
+ cleanup:
+    path_list_destruct(&candidates);
+    free(path);
+
+    return exit_status;
+}
+
+static long path_uids_weight(struct netloc_topology * topology,
+                             struct netloc_dc_pathfinder_t *pf,
+                             const int *edge_uids, int num_edges)
+{
+    int i, weight;
+    long total = 0;
+    netloc_edge_t *edge = NULL;
+
+    if( NULL == pf->weight ) {
+        return num_edges;
+    }
+
+    // Same clamping as pathfinder_weight
+    for(i = 0; i < num_edges; ++i) {
+        edge = NETLOC_DT_EDGE_BY_UID(topology->edges_by_uid, topology->num_edge_uids, edge_uids[i]);
+        weight = (NULL == edge ? 1 : pf->weight(edge));
+        total += (weight < 1 ? 1 : weight);
+    }
+
+    return total;
+}
+
+static int path_list_append(struct path_list_t *list, const int *edge_uids, int num_edges)
+{
+    int alloc, start;
+    int *offsets = NULL;
+    bool *taken = NULL;
+    int *uids = NULL;
+
+    start = (0 == list->num_paths ? 0 : list->offsets[list->num_paths]);
+
+    // One more offset than paths
+    if( list->num_paths + 2 > list->alloc_paths ) {
+        alloc = (0 == list->alloc_paths ? 8 : list->alloc_paths * 2);
+        offsets = (int*)realloc(list->offsets, sizeof(int) * alloc);
+        if( NULL == offsets ) {
+            return NETLOC_ERROR;
         }
-        node_v = node_u;
-        idx_v  = idx_u;
+        list->offsets = offsets;
 
-        // Find the next node
-        SUPPORT_CONVERT_ADDR_TO_INT(prev_node[idx_u]->physical_id,
-                                    handle->network->network_type,
-                                    key_int);
-        node_u = netloc_lookup_table_access_with_int( handle->node_list,
-                                                      prev_node[idx_u]->physical_id,
-                                                      key_int);
-        idx_u = node_u->__uid__;
+        taken = (bool*)realloc(list->taken, sizeof(bool) * alloc);
+        if( NULL == taken ) {
+            return NETLOC_ERROR;
+        }
+        list->taken = taken;
+        list->alloc_paths = alloc;
     }
 
-    for(i = 0; i < src_node->num_edges; ++i ) {
-        if( NULL == node_v ) {
-            fprintf(stderr, "Error: This should never happen, but node_v is NULL at line %d in file %s\n",
-                    __LINE__, __FILE__);
-            exit_status = NETLOC_ERROR;
-            goto cleanup;
+    if( start + num_edges > list->alloc_uids ) {
+        alloc = (0 == list->alloc_uids ? 32 : list->alloc_uids * 2);
+        if( alloc < start + num_edges ) {
+            alloc = start + num_edges;
         }
-        if( node_v->physical_id_int == src_node->edges[i]->dest_node->physical_id_int ) {
-            ++num_rev_edges;
-            rev_edges = (netloc_edge_t**)realloc(rev_edges, sizeof(netloc_edge_t*) * num_rev_edges);
-            if( NULL == rev_edges ) {
-                fprintf(stderr, "Error: Failed to re-allocate the 'rev_edges' array with %d elements\n",
-                        num_rev_edges);
-                exit_status = NETLOC_ERROR;
-                goto cleanup;
-            }
-            rev_edges[num_rev_edges-1] = node_u->edges[i];
+        uids = (int*)realloc(list->edge_uids, sizeof(int) * alloc);
+        if( NULL == uids ) {
+            return NETLOC_ERROR;
+        }
+        list->edge_uids  = uids;
+        list->alloc_uids = alloc;
+    }
 
-            break;
+    memcpy(list->edge_uids + start, edge_uids, sizeof(int) * num_edges);
+    list->offsets[list->num_paths] = start;
+    list->taken[list->num_paths]   = false;
+    list->num_paths += 1;
+    list->offsets[list->num_paths] = start + num_edges;
+
+    return NETLOC_SUCCESS;
+}
+
+static bool path_list_contains(struct path_list_t *list, const int *edge_uids, int num_edges)
+{
+    int p;
+
+    for(p = 0; p < list->num_paths; ++p) {
+        if( list->offsets[p+1] - list->offsets[p] == num_edges &&
+            0 == memcmp(list->edge_uids + list->offsets[p], edge_uids, sizeof(int) * num_edges) ) {
+            return true;
         }
     }
 
+    return false;
+}
 
-    /*
-     * Copy the edges back in correct order
-     */
-    (*num_edges) = num_rev_edges;
-    (*edges) = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * (*num_edges));
-    if( NULL == (*edges) ) {
-        fprintf(stderr, "Error: Failed to allocate the edges array\n");
-        exit_status = NETLOC_ERROR;
-        goto cleanup;
+static void path_list_destruct(struct path_list_t *list)
+{
+    free(list->offsets);
+    free(list->taken);
+    free(list->edge_uids);
+    memset(list, 0, sizeof(*list));
+}
+
+static struct netloc_dc_pathfinder_t * pathfinder_construct(int num_nodes)
+{
+    struct netloc_dc_pathfinder_t *pf = NULL;
+
+    pf = (struct netloc_dc_pathfinder_t*)calloc(1, sizeof(struct netloc_dc_pathfinder_t));
+    if( NULL == pf ) {
+        return NULL;
     }
 
-    for( i = 0; i < num_rev_edges; ++i ) {
-        (*edges)[i] = rev_edges[num_rev_edges-1-i];
-        //printf("DEBUG: \t Edge: %s\n", netloc_pretty_print_edge_t( (*edges)[i] ) );
+    pf->alloc     = num_nodes;
+    pf->queue     = pq_queue_t_construct(num_nodes);
+    pf->distance  = (int*)malloc(sizeof(int) * num_nodes);
+    pf->not_seen  = (bool*)malloc(sizeof(bool) * num_nodes);
+    pf->prev_node = (int*)malloc(sizeof(int) * num_nodes);
+    pf->prev_edge = (int*)malloc(sizeof(int) * num_nodes);
+    if( NULL == pf->queue || NULL == pf->distance || NULL == pf->not_seen ||
+        NULL == pf->prev_node || NULL == pf->prev_edge ) {
+        support_pathfinder_destruct(pf);
+        return NULL;
     }
 
+    return pf;
+}
 
-    /*
-     * Cleanup
-     */
- cleanup:
-    if( NULL != queue ) {
-        pq_queue_t_destruct(queue);
-        queue = NULL;
+static struct netloc_dc_pathfinder_t * pathfinder_get(netloc_data_collection_handle_t *handle,
+                                                      int num_nodes)
+{
+    struct netloc_dc_pathfinder_t *pf = handle->pathfinder;
+
+    if( NULL != pf && pf->alloc >= num_nodes ) {
+        return pf;
     }
 
-    if( NULL != rev_edges ) {
-        free(rev_edges);
-        rev_edges = NULL;
+    // (Re)size the scratch space to the current number of nodes
+    support_pathfinder_destruct(pf);
+    handle->pathfinder = pathfinder_construct(num_nodes);
+
+    return handle->pathfinder;
+}
+
+int support_pathfinder_destruct(struct netloc_dc_pathfinder_t *pf)
+{
+    if( NULL == pf ) {
+        return NETLOC_SUCCESS;
     }
 
-    if( NULL != distance ) {
-        free(distance);
-        distance = NULL;
+    if( pf->own_graph ) {
+        support_graph_destruct(pf->graph);
     }
+    pq_queue_t_destruct(pf->queue);
+    free(pf->distance);
+    free(pf->not_seen);
+    free(pf->prev_node);
+    free(pf->prev_edge);
+    free(pf->excluded_nodes);
+    free(pf->excluded_edges);
+    free(pf);
+
+    return NETLOC_SUCCESS;
+}
 
-    if( NULL != not_seen ) {
-        free(not_seen);
-        not_seen = NULL;
+int support_path_tree_destruct(struct netloc_dc_path_tree_t *tree)
+{
+    if( NULL == tree ) {
+        return NETLOC_SUCCESS;
     }
 
-    if( NULL != prev_node ) {
-        free(prev_node);
-        prev_node = NULL;
+    if( NULL != tree->dests && --tree->dests->refcount <= 0 ) {
+        free(tree->dests->nodes);
+        free(tree->dests);
     }
 
-    if( NULL != prev_edge ) {
-        free(prev_edge);
-        prev_edge = NULL;
+    free(tree->pred_edge_uids);
+    free(tree);
+
+    return NETLOC_SUCCESS;
+}
+
+int support_path_tree_json_encode(struct netloc_dc_path_tree_t *tree,
+                                  netloc_edge_t **edges_by_uid, int num_edge_uids,
+                                  json_t *json_paths)
+{
+    int d, idx, len, hop;
+    int *path = NULL;
+    netloc_node_t *dest_node = NULL;
+    netloc_edge_t *edge = NULL;
+    json_t *json_edges = NULL;
+
+    // A path never has more hops than there are nodes
+    path = (int*)malloc(sizeof(int) * (tree->num_nodes > 0 ? tree->num_nodes : 1));
+    if( NULL == path ) {
+        return NETLOC_ERROR;
     }
 
-    netloc_dt_lookup_table_iterator_t_destruct(hti);
+    for(d = 0; d < tree->dests->num_nodes; ++d) {
+        dest_node = tree->dests->nodes[d];
+        if( dest_node == tree->src_node ) {
+            continue;
+        }
 
-    return exit_status;
+        /*
+         * Walk the tree back from the destination to the source
+         */
+        len = 0;
+        idx = dest_node->__uid__;
+        while( idx >= 0 && idx < tree->num_nodes && len < tree->num_nodes &&
+               NETLOC_EDGE_UID_INVALID != tree->pred_edge_uids[idx] ) {
+            path[len++] = tree->pred_edge_uids[idx];
+            edge = NETLOC_DT_EDGE_BY_UID(edges_by_uid, num_edge_uids, tree->pred_edge_uids[idx]);
+            if( NULL == edge || NULL == edge->src_node ) {
+                break;
+            }
+            idx = edge->src_node->__uid__;
+        }
+
+        // Unreachable destination (or broken tree)
+        if( 0 == len || idx != tree->src_node->__uid__ ) {
+            continue;
+        }
+
+        json_edges = json_array();
+        for(hop = len - 1; hop >= 0; --hop) {
+            json_array_append_new(json_edges, json_integer(path[hop]));
+        }
+        json_object_set_new(json_paths, dest_node->physical_id, json_edges);
+    }
+
+    free(path);
+
+    return NETLOC_SUCCESS;
 }
 
-static pq_queue_t * pq_queue_t_construct()
+static pq_queue_t * pq_queue_t_construct(int max_items)
 {
     pq_queue_t *pq = NULL;
+    int i;
 
     pq = (pq_queue_t*)malloc(sizeof(pq_queue_t));
     if( NULL == pq ) {
         return NULL;
     }
 
+    // Ids are dense in [0, max_items), so the heap never grows
     pq->size  = 0;
-    pq->alloc = 4; // Increment by 4
+    pq->alloc = (max_items > 0 ? max_items : 1);
     pq->data = (pq_element_t*)malloc(sizeof(pq_element_t) * pq->alloc);
-    if( NULL == pq->data ) {
+    pq->pos  = (int*)malloc(sizeof(int) * pq->alloc);
+    if( NULL == pq->data || NULL == pq->pos ) {
+        free(pq->data);
+        free(pq->pos);
         free(pq);
         return NULL;
     }
 
+    for(i = 0; i < pq->alloc; ++i) {
+        pq->pos[i] = -1;
+    }
+
     return pq;
 }
 
@@ -400,6 +1586,11 @@ static int pq_queue_t_destruct(pq_queue_t *pq)
         pq->data = NULL;
     }
 
+    if( NULL != pq->pos ) {
+        free(pq->pos);
+        pq->pos = NULL;
+    }
+
     pq->size = 0;
     pq->alloc = 0;
 
@@ -408,139 +1599,115 @@ static int pq_queue_t_destruct(pq_queue_t *pq)
     return NETLOC_SUCCESS;
 }
 
-static int pq_push(pq_queue_t *pq, int priority, void *data)
+/* Place elem at heap slot i, keeping pos[] in sync */
+static inline void pq_set(pq_queue_t *pq, int i, pq_element_t elem)
 {
-    int i;
-    pq_element_t *elem = NULL;
+    pq->data[i] = elem;
+    pq->pos[elem.id] = i;
+}
 
-    if( NULL == pq ) {
-        return NETLOC_ERROR;
+static void pq_sift_up(pq_queue_t *pq, int i)
+{
+    pq_element_t elem = pq->data[i];
+    int parent;
+
+    while( i > 0 ) {
+        parent = (i - 1) / 2;
+        if( pq->data[parent].priority <= elem.priority ) {
+            break;
+        }
+        pq_set(pq, i, pq->data[parent]);
+        i = parent;
     }
+    pq_set(pq, i, elem);
+}
 
-    pq->size++;
+static void pq_sift_down(pq_queue_t *pq, int i)
+{
+    pq_element_t elem = pq->data[i];
+    int child;
 
-    if( pq->size >= pq->alloc ) {
-        pq->alloc += 4;
-        pq->data = (pq_element_t*)realloc(pq->data, sizeof(pq_element_t) * pq->alloc);
-        if( NULL == pq->data ) {
-            return NETLOC_ERROR;
+    while( (child = 2 * i + 1) < pq->size ) {
+        if( child + 1 < pq->size &&
+            pq->data[child+1].priority < pq->data[child].priority ) {
+            ++child;
+        }
+        if( elem.priority <= pq->data[child].priority ) {
+            break;
         }
+        pq_set(pq, i, pq->data[child]);
+        i = child;
     }
+    pq_set(pq, i, elem);
+}
 
-    if( 1 == pq->size ) {
-        elem = &pq->data[0];
-    }
-    else {
-        elem = &pq->data[pq->size-1];
-        // Make a hole in the array to place the new item
-        for( i = pq->size-2; i >= 0; --i ) {
-            if( pq->data[i].priority > priority ) {
-                // Move item backwards
-                pq->data[i+1].priority = pq->data[i].priority;
-                pq->data[i+1].data     = pq->data[i].data;
+static int pq_push(pq_queue_t *pq, int priority, int id)
+{
+    pq_element_t elem;
 
-                // Save this 'hole'
-                elem = &pq->data[i];
-                elem->priority = INT_MAX;
-                elem->data     = NULL;
-            }
-        }
+    if( NULL == pq || id < 0 || id >= pq->alloc || pq_contains(pq, id) ) {
+        return NETLOC_ERROR;
     }
 
-    // Insert into the hole
-    elem->priority = priority;
-    elem->data     = data;
+    elem.priority = priority;
+    elem.id       = id;
+
+    pq->size++;
+    pq_set(pq, pq->size-1, elem);
+    pq_sift_up(pq, pq->size-1);
 
     return NETLOC_SUCCESS;
 }
 
-static void * pq_pop(pq_queue_t *pq)
+static int pq_pop(pq_queue_t *pq)
 {
-    int i;
-    void *data = NULL;
-
-    if( NULL == pq ) {
-        return NULL;
-    }
+    int id;
 
-    data = pq->data[0].data;
-
-    if( 0 == pq->size ) {
-        return NULL;
+    if( NULL == pq || 0 == pq->size ) {
+        return -1;
     }
 
-    // Remove top item, shift everyone up
-    for(i = 1; i < pq->size; ++i) {
-        pq->data[i-1].priority = pq->data[i].priority;
-        pq->data[i-1].data     = pq->data[i].data;
-    }
-    pq->data[pq->size-1].priority = INT_MAX;
-    pq->data[pq->size-1].data     = NULL;
+    id = pq->data[0].id;
+    pq->pos[id] = -1;
 
+    // Move the last item to the top, and let it sink
     pq->size--;
+    if( pq->size > 0 ) {
+        pq_set(pq, 0, pq->data[pq->size]);
+        pq_sift_down(pq, 0);
+    }
 
-    return data;
+    return id;
 }
 
-static void pq_reorder(pq_queue_t *pq, int priority, void *data)
+static void pq_reorder(pq_queue_t *pq, int priority, int id)
 {
-    int i, elem_idx;
-    pq_element_t *elem = NULL;
-
-    // Find this element in this array
-    elem_idx = -1;
-    for(i = 0; i < pq->size; ++i) {
-        if( data == pq->data[i].data ) {
-            elem_idx = i;
-            break;
-        }
-    }
+    int i;
 
-    if( 0 > elem_idx ) {
+    if( !pq_contains(pq, id) ) {
         fprintf(stderr, "Error: Could not find item!\n");
         return;
     }
 
-    // Use the elem_idx as a pivot since we have the item information
-    // provided as a parameter
-    elem = &pq->data[elem_idx];
-    elem->priority = INT_MAX;
-    elem->data     = NULL;
-
-    // Trivial case - do nothing
-    if( 1 == pq->size ) {
-        ;
+    i = pq->pos[id];
+    if( priority < pq->data[i].priority ) {
+        pq->data[i].priority = priority;
+        pq_sift_up(pq, i);
+    } else {
+        pq->data[i].priority = priority;
+        pq_sift_down(pq, i);
     }
-    // Move this item 'up'
-    else if( priority < elem->priority ) {
-        for(i = elem_idx-1; i >= 0; --i ) {
-            if( pq->data[i].priority > priority ) {
-                pq->data[i+1].priority = pq->data[i].priority;
-                pq->data[i+1].data     = pq->data[i].data;
+}
 
-                elem = &pq->data[i];
-                elem->priority = INT_MAX;
-                elem->data     = NULL;
-            }
-        }
-    }
-    // Move this item 'down'
-    else {
-        for(i = elem_idx+1; i < pq->size; ++i ) {
-            if( pq->data[i].priority < priority ) {
-                pq->data[i-1].priority = pq->data[i].priority;
-                pq->data[i-1].data     = pq->data[i].data;
+static void pq_clear(pq_queue_t *pq)
+{
+    int i;
 
-                elem = &pq->data[i];
-                elem->priority = INT_MAX;
-                elem->data     = NULL;
-            }
-        }
+    // Only the items still queued need their position reset
+    for(i = 0; i < pq->size; ++i) {
+        pq->pos[pq->data[i].id] = -1;
     }
-
-    // Insert into the hole
-    elem->priority = priority;
-    elem->data     = data;
+    pq->size = 0;
 }
 
 #if 0
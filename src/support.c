@@ -18,6 +18,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <strings.h>
 
 /**
  * Decode an edge
@@ -63,15 +64,46 @@ int support_extract_filename_from_uri(const char * uri, uri_type_t *type, char *
 }
 
 int support_load_json(struct netloc_topology * topology)
+{
+    int ret;
+    char * binary_uri = NULL;
+
+    if( topology->nodes_loaded ) {
+        return NETLOC_SUCCESS;
+    }
+
+    /*
+     * Attached through netloc_attach_mapped: serve from the mapping
+     */
+    if( NULL != topology->binary_map ) {
+        return support_load_binary_mapped(topology);
+    }
+
+    /*
+     * Prefer the binary topology cache, if it is at least as recent as the
+     * JSON files. Fall back to the JSON files if it cannot be used.
+     */
+    binary_uri = support_binary_filename(topology->network);
+    if( NULL != binary_uri ) {
+        ret = NETLOC_ERROR_NOENT;
+        if( support_binary_is_current(topology->network, binary_uri) ) {
+            ret = support_load_binary(topology, binary_uri);
+        }
+        free(binary_uri);
+        if( NETLOC_ERROR_NOENT != ret ) {
+            return ret;
+        }
+    }
+
+    return support_load_json_files(topology);
+}
+
+int support_load_json_files(struct netloc_topology * topology)
 {
     int ret, exit_status = NETLOC_SUCCESS;
-    int i;
     json_t *json = NULL;
-    netloc_node_t *node = NULL;
 
     int cur_idx;
-    json_t *json_path_list = NULL;
-    json_t *json_path = NULL;
     json_t *json_node_list = NULL;
     json_t *json_node = NULL;
     json_t *json_edge_list = NULL;
@@ -109,6 +141,16 @@ int support_load_json(struct netloc_topology * topology)
     //netloc_lookup_table_pretty_print(topology->edges);
     //check_edge_data(topology->edges);
 
+    /*
+     * Index the edges by edge_uid, so the node and path decoding below
+     * resolve edge ids without going through string keys.
+     */
+    topology->edges_by_uid = netloc_dt_edge_index_t_construct(topology->edges, &topology->num_edge_uids);
+    if( NULL == topology->edges_by_uid ) {
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
     /*
      * Read in the nodes
      */
@@ -122,17 +164,25 @@ int support_load_json(struct netloc_topology * topology)
 
     cur_idx = 0;
     json_object_foreach(json_node_list, key, json_node) {
-        topology->nodes[cur_idx] = netloc_dt_node_t_json_decode(topology->edges, json_object_get(json_node_list, key) );
+        topology->nodes[cur_idx] = netloc_dt_node_t_json_decode(topology->edges_by_uid, topology->num_edge_uids, json_object_get(json_node_list, key) );
         ++cur_idx;
     }
 
+    ret = support_build_node_index(topology);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: Failed to index the nodes\n");
+        exit_status = ret;
+        goto cleanup;
+    }
+
     if(NULL != json) {
         json_decref(json);
         json = NULL;
     }
 
     /*
-     * For each edge, find the correct pointer for the dest_node.
+     * For each edge, find the correct pointer for the dest_node through the
+     * physical ID index built above.
      * Note: the src_node is filled in during the creation of a node in the
      *       netloc_dt_node_t_json_decode() operation, above.
      */
@@ -143,16 +193,8 @@ int support_load_json(struct netloc_topology * topology)
             break;
         }
 
-        for(i = 0; i < topology->num_nodes; ++i ) {
-            if( NULL != topology->nodes[i] ) {
-                if( 0 == strncmp(cur_edge->dest_node_id,
-                                 topology->nodes[i]->physical_id,
-                                 strlen(cur_edge->dest_node_id)) ) {
-                    cur_edge->dest_node = topology->nodes[i];
-                    break;
-                }
-            }
-        }
+        cur_edge->dest_node = (netloc_node_t*)netloc_lookup_table_access(topology->nodes_by_phy_id,
+                                                                         cur_edge->dest_node_id);
         if( NULL == cur_edge->dest_node ) {
             fprintf(stderr, "Error: Failed to find a node to match the following edge\n");
             char * tmp_str = NULL;
@@ -162,126 +204,716 @@ int support_load_json(struct netloc_topology * topology)
         }
     }
 
-    // for each edge
-    //   find the corresponding node, and point to it.
-
     /*
-     * Load the json object (physical paths)
+     * The paths are loaded later, one source node at a time
+     * (support_load_node_paths)
      */
-    ret = support_load_json_from_file(topology->network->phy_path_uri, &json);
-    if( NETLOC_SUCCESS != ret ) {
-        fprintf(stderr, "Error: Failed to load the physical path file %s\n", topology->network->phy_path_uri);
-        exit_status = ret;
-        goto cleanup;
-    }
+    topology->nodes_loaded = true;
 
-    if( !json_is_object(json) ) {
-        fprintf(stderr, "Error: json handle is not a valid object\n");
-        exit_status = NETLOC_SUCCESS;
-        goto cleanup;
+    cleanup:
+    if(NULL != json) {
+        json_decref(json);
+        json = NULL;
     }
 
+    return exit_status;
+}
+
+int support_build_node_index(struct netloc_topology * topology)
+{
+    int i;
+    netloc_node_t *node = NULL;
+
     /*
-     * Read in the paths
+     * Keys point into the nodes themselves, which outlive the indexes
      */
-    json_path_list = json_object_get(json, JSON_NODE_FILE_PATH_INFO);
+    topology->nodes_by_phy_id = calloc(1, sizeof(*topology->nodes_by_phy_id));
+    topology->nodes_by_phy_id_int = calloc(1, sizeof(*topology->nodes_by_phy_id_int));
+    if( NULL == topology->nodes_by_phy_id || NULL == topology->nodes_by_phy_id_int ) {
+        return NETLOC_ERROR;
+    }
 
-    cur_idx = 0;
-    json_object_foreach(json_path_list, key, json_path) {
-        node = NULL;
-        for(i = 0; i < topology->num_nodes; ++i) {
-            if( 0 == strncmp(topology->nodes[i]->physical_id, key, strlen(key) ) ) {
-                node = topology->nodes[i];
-                break;
+    if( NETLOC_SUCCESS != netloc_lookup_table_init(topology->nodes_by_phy_id, topology->num_nodes,
+                                                   NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY) ||
+        NETLOC_SUCCESS != netloc_lookup_table_init(topology->nodes_by_phy_id_int, topology->num_nodes,
+                                                   NETLOC_LOOKUP_TABLE_FLAG_NO_STRDUP_KEY) ) {
+        return NETLOC_ERROR;
+    }
+
+    for(i = 0; i < topology->num_nodes; ++i) {
+        node = topology->nodes[i];
+        if( NULL == node ) {
+            continue;
+        }
+        node->__uid__ = i;
+
+        if( NULL == node->physical_id ) {
+            continue;
+        }
+
+        // On duplicates the first node wins, as with the former linear search
+        netloc_lookup_table_append(topology->nodes_by_phy_id, node->physical_id, node);
+        if( 0 != node->physical_id_int ) {
+            netloc_lookup_table_append_with_int(topology->nodes_by_phy_id_int, node->physical_id,
+                                                node->physical_id_int, node);
+        }
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+/*
+ * Streaming reader over a path file
+ */
+struct support_stream_t {
+    const char *buf;
+    size_t len;
+    size_t pos;
+};
+
+static void support_stream_skip_ws(struct support_stream_t *stream)
+{
+    while( stream->pos < stream->len &&
+           (' '  == stream->buf[stream->pos] || '\t' == stream->buf[stream->pos] ||
+            '\n' == stream->buf[stream->pos] || '\r' == stream->buf[stream->pos]) ) {
+        ++stream->pos;
+    }
+}
+
+static bool support_stream_expect(struct support_stream_t *stream, char c)
+{
+    support_stream_skip_ws(stream);
+    if( stream->pos < stream->len && c == stream->buf[stream->pos] ) {
+        ++stream->pos;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Decode the next JSON value (of any type) with the jansson parser, and
+ * advance past it.
+ */
+static json_t * support_stream_next_value(struct support_stream_t *stream)
+{
+    json_t *value = NULL;
+    json_error_t error;
+
+    support_stream_skip_ws(stream);
+    value = json_loadb(stream->buf + stream->pos, stream->len - stream->pos,
+                       JSON_DECODE_ANY | JSON_DISABLE_EOF_CHECK, &error);
+    if( NULL == value ) {
+        fprintf(stderr, "Error: Failed to parse JSON at offset %lu: %s\n",
+                (unsigned long)(stream->pos + error.position), error.text);
+        return NULL;
+    }
+    stream->pos += error.position;
+
+    return value;
+}
+
+/*
+ * Decode the next "key": of an object
+ */
+static json_t * support_stream_next_key(struct support_stream_t *stream)
+{
+    json_t *key = NULL;
+
+    key = support_stream_next_value(stream);
+    if( NULL == key ) {
+        return NULL;
+    }
+
+    if( !json_is_string(key) || !support_stream_expect(stream, ':') ) {
+        fprintf(stderr, "Error: Malformed JSON object at offset %lu\n", (unsigned long)stream->pos);
+        json_decref(key);
+        return NULL;
+    }
+
+    return key;
+}
+
+/*
+ * Advance past the string starting at the current position
+ */
+static bool support_stream_skip_string(struct support_stream_t *stream)
+{
+    ++stream->pos;
+    while( stream->pos < stream->len ) {
+        if( '\\' == stream->buf[stream->pos] ) {
+            stream->pos += 2;
+        } else if( '"' == stream->buf[stream->pos++] ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Advance past the next JSON value without decoding it. Only the nesting
+ * and the strings are followed, the value is checked when decoded.
+ */
+static bool support_stream_skip_value(struct support_stream_t *stream)
+{
+    int depth = 0;
+    char c;
+
+    support_stream_skip_ws(stream);
+    if( stream->pos >= stream->len ) {
+        return false;
+    }
+
+    c = stream->buf[stream->pos];
+    if( '"' == c ) {
+        return support_stream_skip_string(stream);
+    }
+
+    if( '{' != c && '[' != c ) {
+        // Number, true, false, null
+        while( stream->pos < stream->len &&
+               NULL == strchr(",}] \t\n\r", stream->buf[stream->pos]) ) {
+            ++stream->pos;
+        }
+        return true;
+    }
+
+    while( stream->pos < stream->len ) {
+        c = stream->buf[stream->pos];
+        if( '"' == c ) {
+            if( !support_stream_skip_string(stream) ) {
+                return false;
             }
+            continue;
+        }
+
+        ++stream->pos;
+        if( '{' == c || '[' == c ) {
+            ++depth;
+        } else if( '}' == c || ']' == c ) {
+            if( 0 == --depth ) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Walk the path_info object of the stream, recording where the paths of
+ * each source node are.
+ */
+static int support_stream_index_paths(struct netloc_topology * topology, struct support_stream_t *stream,
+                                      struct support_path_source_t *source, bool is_logical)
+{
+    json_t *key = NULL;
+    netloc_node_t *node = NULL;
+    size_t offset;
+
+    if( !support_stream_expect(stream, '{') ) {
+        return NETLOC_ERROR;
+    }
+    if( support_stream_expect(stream, '}') ) {
+        return NETLOC_SUCCESS;
+    }
+
+    do {
+        key = support_stream_next_key(stream);
+        if( NULL == key ) {
+            return NETLOC_ERROR;
+        }
+
+        node = (netloc_node_t*)netloc_lookup_table_access(topology->nodes_by_phy_id, json_string_value(key));
+        if( NULL == node ) {
+            fprintf(stderr, "Error: Failed to find the node with physical ID %s for %s path\n",
+                    json_string_value(key), (is_logical ? "logical" : "physical"));
+            json_decref(key);
+            return NETLOC_ERROR;
+        }
+        json_decref(key);
+
+        support_stream_skip_ws(stream);
+        offset = stream->pos;
+        if( !support_stream_skip_value(stream) ) {
+            fprintf(stderr, "Error: Malformed JSON value at offset %lu\n", (unsigned long)offset);
+            return NETLOC_ERROR;
+        }
+
+        source->json_offset[is_logical][node->__uid__] = offset;
+        source->json_length[is_logical][node->__uid__] = stream->pos - offset;
+    } while( support_stream_expect(stream, ',') );
+
+    if( !support_stream_expect(stream, '}') ) {
+        fprintf(stderr, "Error: Malformed JSON object at offset %lu\n", (unsigned long)stream->pos);
+        return NETLOC_ERROR;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+/*
+ * Walk the forwarding_info object of the stream, decoding the forwarding
+ * table of each switch as soon as its value has been parsed.
+ */
+static int support_stream_forwarding(struct netloc_topology * topology, struct support_stream_t *stream)
+{
+    int ret;
+    json_t *key = NULL;
+    json_t *json_table = NULL;
+    netloc_node_t *node = NULL;
+
+    if( !support_stream_expect(stream, '{') ) {
+        return NETLOC_ERROR;
+    }
+    if( support_stream_expect(stream, '}') ) {
+        return NETLOC_SUCCESS;
+    }
+
+    do {
+        key = support_stream_next_key(stream);
+        if( NULL == key ) {
+            return NETLOC_ERROR;
         }
+
+        node = (netloc_node_t*)netloc_lookup_table_access(topology->nodes_by_phy_id, json_string_value(key));
         if( NULL == node ) {
-            fprintf(stderr, "Error: Failed to find the node with physical ID %s for physical path\n", key);
+            fprintf(stderr, "Error: Failed to find the node with physical ID %s for its forwarding table\n",
+                    json_string_value(key));
+            json_decref(key);
+            return NETLOC_ERROR;
+        }
+        json_decref(key);
+
+        json_table = support_stream_next_value(stream);
+        if( NULL == json_table ) {
+            return NETLOC_ERROR;
+        }
+
+        ret = support_forwarding_table_json_decode(topology, node, json_table);
+        json_decref(json_table);
+        if( NETLOC_SUCCESS != ret ) {
+            return ret;
+        }
+    } while( support_stream_expect(stream, ',') );
+
+    if( !support_stream_expect(stream, '}') ) {
+        fprintf(stderr, "Error: Malformed JSON object at offset %lu\n", (unsigned long)stream->pos);
+        return NETLOC_ERROR;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+/*
+ * Check an [offset, length] entry of the path index against the file
+ */
+static bool support_path_index_entry(json_t *json_entry, size_t file_size, size_t *offset, size_t *length)
+{
+    json_int_t off, len;
+
+    if( !json_is_array(json_entry) || 2 != json_array_size(json_entry) ||
+        !json_is_integer(json_array_get(json_entry, 0)) ||
+        !json_is_integer(json_array_get(json_entry, 1)) ) {
+        return false;
+    }
+
+    off = json_integer_value(json_array_get(json_entry, 0));
+    len = json_integer_value(json_array_get(json_entry, 1));
+    if( off < 0 || len <= 0 || (size_t)off > file_size || (size_t)len > file_size - (size_t)off ) {
+        return false;
+    }
+
+    (*offset) = (size_t)off;
+    (*length) = (size_t)len;
+
+    return true;
+}
+
+/*
+ * Read the path index stored at the end of the path file
+ *
+ * The index is the last member of the top level object, and only holds
+ * physical IDs and numbers: searching backward for its key over at most
+ * the size of the largest possible index finds it, if it is there.
+ */
+static int support_read_path_index(struct netloc_topology * topology,
+                                   struct support_path_source_t *source, bool is_logical)
+{
+    int ret, i, exit_status = NETLOC_SUCCESS;
+    const char *index_key = "\"" JSON_NODE_FILE_PATH_INDEX "\":";
+    size_t key_len = strlen(index_key);
+    const char *base = source->json_map[is_logical];
+    size_t size = source->json_map_size[is_logical];
+    size_t max_index_size, pos, offset, length;
+    struct support_stream_t stream;
+    json_t *json_index = NULL;
+    json_t *json_paths = NULL;
+    json_t *json_entry = NULL;
+    const char *key = NULL;
+    netloc_node_t *node = NULL;
+
+    // "physical_id":[offset,length], with up to 20 digits per number
+    max_index_size = 128;
+    for(i = 0; i < topology->num_nodes; ++i) {
+        max_index_size += (NULL == topology->nodes[i]->physical_id ? 0 : strlen(topology->nodes[i]->physical_id)) + 48;
+    }
+
+    if( size < key_len ) {
+        return NETLOC_ERROR_NOT_FOUND;
+    }
+    pos = size - key_len;
+    while( 0 != memcmp(base + pos, index_key, key_len) ) {
+        if( 0 == pos || size - pos > max_index_size ) {
+            return NETLOC_ERROR_NOT_FOUND;
+        }
+        --pos;
+    }
+
+    stream.buf = base;
+    stream.len = size;
+    stream.pos = pos + key_len;
+    json_index = support_stream_next_value(&stream);
+    json_paths = json_object_get(json_index, JSON_NODE_FILE_PATH_INFO);
+    if( !json_is_object(json_paths) ) {
+        fprintf(stderr, "Error: Invalid path index\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    json_object_foreach(json_paths, key, json_entry) {
+        node = (netloc_node_t*)netloc_lookup_table_access(topology->nodes_by_phy_id, key);
+        if( NULL == node ) {
+            fprintf(stderr, "Error: Failed to find the node with physical ID %s for %s path\n",
+                    key, (is_logical ? "logical" : "physical"));
             exit_status = NETLOC_ERROR;
             goto cleanup;
         }
 
-        if( NULL != node->physical_paths ) {
-            netloc_lookup_table_destroy(node->physical_paths);
-	    free(node->physical_paths);
-            node->physical_paths = NULL;
-        }
-        node->physical_paths = netloc_dt_node_t_json_decode_paths(topology->edges, json_path);
-        if( NULL == node->physical_paths ) {
-            fprintf(stderr, "Error: Failed to decode the physical path for node\n");
-            fprintf(stderr, "Error: Node: %s\n", netloc_pretty_print_node_t(node));
+        if( !support_path_index_entry(json_entry, size, &offset, &length) ) {
+            fprintf(stderr, "Error: Invalid path index entry for node %s\n", key);
             exit_status = NETLOC_ERROR;
             goto cleanup;
         }
-        node->num_phy_paths  = netloc_lookup_table_size(node->physical_paths);
+        source->json_offset[is_logical][node->__uid__] = offset;
+        source->json_length[is_logical][node->__uid__] = length;
     }
 
-    if(NULL != json) {
-        json_decref(json);
-        json = NULL;
+    /*
+     * The forwarding tables are few (one per switch), load them now
+     */
+    json_entry = json_object_get(json_index, JSON_NODE_FILE_FORWARDING_INFO);
+    if( is_logical && NULL != json_entry ) {
+        if( !support_path_index_entry(json_entry, size, &offset, &length) ) {
+            fprintf(stderr, "Error: Invalid path index entry for the forwarding tables\n");
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+
+        stream.buf = base + offset;
+        stream.len = length;
+        stream.pos = 0;
+        ret = support_stream_forwarding(topology, &stream);
+        if( NETLOC_SUCCESS != ret ) {
+            exit_status = ret;
+            goto cleanup;
+        }
     }
 
+ cleanup:
+    json_decref(json_index);
+
+    return exit_status;
+}
+
+/*
+ * Index a path file without a path index, by walking over it once
+ */
+static int support_scan_path_file(struct netloc_topology * topology,
+                                  struct support_path_source_t *source, bool is_logical)
+{
+    int exit_status = NETLOC_SUCCESS;
+    struct support_stream_t stream;
+    json_t *key = NULL;
+
+    stream.buf = source->json_map[is_logical];
+    stream.len = source->json_map_size[is_logical];
+    stream.pos = 0;
 
     /*
-     * Load the json object (logical paths)
+     * Only the path_info and forwarding_info objects are looked at, the
+     * other members of the top level object (network_info) are skipped.
      */
-    ret = support_load_json_from_file(topology->network->path_uri, &json);
+    if( !support_stream_expect(&stream, '{') ) {
+        fprintf(stderr, "Error: json handle is not a valid object\n");
+        return NETLOC_ERROR;
+    }
+
+    if( support_stream_expect(&stream, '}') ) {
+        return NETLOC_SUCCESS;
+    }
+
+    do {
+        key = support_stream_next_key(&stream);
+        if( NULL == key ) {
+            return NETLOC_ERROR;
+        }
+
+        if( 0 == strcmp(json_string_value(key), JSON_NODE_FILE_PATH_INFO) ) {
+            exit_status = support_stream_index_paths(topology, &stream, source, is_logical);
+        } else if( is_logical && 0 == strcmp(json_string_value(key), JSON_NODE_FILE_FORWARDING_INFO) ) {
+            exit_status = support_stream_forwarding(topology, &stream);
+        } else if( !support_stream_skip_value(&stream) ) {
+            fprintf(stderr, "Error: Malformed JSON value at offset %lu\n", (unsigned long)stream.pos);
+            exit_status = NETLOC_ERROR;
+        }
+        json_decref(key);
+        key = NULL;
+
+        if( NETLOC_SUCCESS != exit_status ) {
+            return exit_status;
+        }
+    } while( support_stream_expect(&stream, ',') );
+
+    if( !support_stream_expect(&stream, '}') ) {
+        fprintf(stderr, "Error: Malformed JSON object at offset %lu\n", (unsigned long)stream.pos);
+        return NETLOC_ERROR;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+/*
+ * Map a path file, and find where the paths of every source node are
+ */
+static int support_open_path_file(struct netloc_topology * topology,
+                                  struct support_path_source_t *source, bool is_logical)
+{
+    int ret, fd = -1;
+    struct stat sb;
+    char *memblock = NULL;
+    const char *fname = (is_logical ? topology->network->path_uri : topology->network->phy_path_uri);
+
+    if( NULL == fname ) {
+        fprintf(stderr, "Error: No %s path file for network %s\n", (is_logical ? "logical" : "physical"),
+                netloc_pretty_print_network_t(topology->network));
+        return NETLOC_ERROR;
+    }
+
+    fd = open(fname, O_RDONLY);
+    if( 0 > fd ) {
+        fprintf(stderr, "Error: Cannot open the file %s\n", fname);
+        return NETLOC_ERROR;
+    }
+    if( 0 != fstat(fd, &sb) ) {
+        fprintf(stderr, "Error: Cannot stat the file %s\n", fname);
+        close(fd);
+        return NETLOC_ERROR;
+    }
+    if( 0 == sb.st_size ) {
+        fprintf(stderr, "Error: Empty file %s\n", fname);
+        close(fd);
+        return NETLOC_ERROR;
+    }
+
+    memblock = (char *) mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if( MAP_FAILED == memblock ) {
+        fprintf(stderr, "Error: mmap failed\n");
+        return NETLOC_ERROR;
+    }
+
+    source->json_map[is_logical]      = memblock;
+    source->json_map_size[is_logical] = sb.st_size;
+    memset(source->json_offset[is_logical], 0, sizeof(size_t) * topology->num_nodes);
+    memset(source->json_length[is_logical], 0, sizeof(size_t) * topology->num_nodes);
+
+    ret = support_read_path_index(topology, source, is_logical);
+    if( NETLOC_ERROR_NOT_FOUND == ret ) {
+        ret = support_scan_path_file(topology, source, is_logical);
+    }
+
     if( NETLOC_SUCCESS != ret ) {
-        fprintf(stderr, "Error: Failed to load the path file %s\n", topology->network->path_uri);
-        exit_status = ret;
-        goto cleanup;
+        fprintf(stderr, "Error: Failed to load the %s path file %s\n", (is_logical ? "logical" : "physical"), fname);
+        munmap(memblock, sb.st_size);
+        source->json_map[is_logical]      = NULL;
+        source->json_map_size[is_logical] = 0;
+        return ret;
     }
 
-    if( !json_is_object(json) ) {
-        fprintf(stderr, "Error: json handle is not a valid object\n");
-        exit_status = NETLOC_ERROR;
-        goto cleanup;
+    return NETLOC_SUCCESS;
+}
+
+/*
+ * Decode the paths of a source node from its JSON object
+ */
+static int support_set_node_paths(struct netloc_topology * topology, netloc_node_t *node,
+                                  json_t *json_paths, bool is_logical)
+{
+    netloc_dt_lookup_table_t *paths = NULL;
+    char *tmp_str = NULL;
+
+    paths = (is_logical ? &node->logical_paths : &node->physical_paths);
+    if( NULL != (*paths) ) {
+        netloc_lookup_table_destroy(*paths);
+        free(*paths);
+        (*paths) = NULL;
+    }
+    (*paths) = netloc_dt_node_t_json_decode_paths(topology->edges_by_uid, topology->num_edge_uids, json_paths);
+    if( NULL == (*paths) ) {
+        fprintf(stderr, "Error: Failed to decode the %s path for node\n", (is_logical ? "logical" : "physical"));
+        tmp_str = netloc_pretty_print_node_t(node);
+        fprintf(stderr, "Error: Node: %s\n", tmp_str);
+        free(tmp_str);
+        return NETLOC_ERROR;
+    }
+
+    if( is_logical ) {
+        node->num_log_paths = netloc_lookup_table_size(*paths);
+    } else {
+        node->num_phy_paths = netloc_lookup_table_size(*paths);
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+struct support_path_source_t * support_path_source_get(struct netloc_topology * topology)
+{
+    struct support_path_source_t *source = NULL;
+    size_t num = (topology->num_nodes > 0 ? topology->num_nodes : 1);
+    int k;
+
+    if( NULL != topology->path_source ) {
+        return topology->path_source;
+    }
+
+    source = (struct support_path_source_t*)calloc(1, sizeof(struct support_path_source_t));
+    if( NULL == source ) {
+        return NULL;
+    }
+
+    for(k = 0; k < 2; ++k) {
+        source->loaded[k]      = (bool*)calloc(num, sizeof(bool));
+        source->json_offset[k] = (size_t*)calloc(num, sizeof(size_t));
+        source->json_length[k] = (size_t*)calloc(num, sizeof(size_t));
+        if( NULL == source->loaded[k] || NULL == source->json_offset[k] || NULL == source->json_length[k] ) {
+            topology->path_source = source;
+            support_path_source_destruct(topology);
+            return NULL;
+        }
     }
 
+    topology->path_source = source;
+
+    return source;
+}
+
+int support_load_node_paths(struct netloc_topology * topology, netloc_node_t *node, bool is_logical)
+{
+    int ret;
+    struct support_path_source_t *source = NULL;
+    json_t *json_paths = NULL;
+    json_error_t error;
+    size_t offset, length;
+
     /*
-     * Read in the paths
+     * A node of another topology carries its own paths
      */
-    json_path_list = json_object_get(json, JSON_NODE_FILE_PATH_INFO);
+    if( NULL == node || node->__uid__ < 0 || node->__uid__ >= topology->num_nodes ||
+        topology->nodes[node->__uid__] != node ) {
+        return NETLOC_SUCCESS;
+    }
 
-    cur_idx = 0;
-    json_object_foreach(json_path_list, key, json_path) {
-        node = NULL;
-        for(i = 0; i < topology->num_nodes; ++i) {
-            if( 0 == strncmp(topology->nodes[i]->physical_id, key, strlen(key) ) ) {
-                node = topology->nodes[i];
-                break;
-            }
+    source = support_path_source_get(topology);
+    if( NULL == source ) {
+        return NETLOC_ERROR;
+    }
+
+    if( source->loaded[is_logical][node->__uid__] ) {
+        return NETLOC_SUCCESS;
+    }
+
+    if( NULL != source->binary_map ) {
+        ret = support_binary_load_node_paths(topology, node, is_logical);
+        if( NETLOC_SUCCESS != ret ) {
+            return ret;
         }
-        if( NULL == node ) {
-            fprintf(stderr, "Error: Failed to find the node with physical ID %s for logical path\n", key);
+        source->loaded[is_logical][node->__uid__] = true;
+        return NETLOC_SUCCESS;
+    }
+
+    if( NULL == source->json_map[is_logical] ) {
+        ret = support_open_path_file(topology, source, is_logical);
+        if( NETLOC_SUCCESS != ret ) {
+            return ret;
+        }
+    }
+
+    // A node without paths keeps the empty tables it was constructed with
+    offset = source->json_offset[is_logical][node->__uid__];
+    length = source->json_length[is_logical][node->__uid__];
+    if( length > 0 ) {
+        json_paths = json_loadb(source->json_map[is_logical] + offset, length, 0, &error);
+        if( NULL == json_paths ) {
+            fprintf(stderr, "Error: Failed to parse JSON at offset %lu: %s\n",
+                    (unsigned long)(offset + error.position), error.text);
             return NETLOC_ERROR;
         }
 
-        if( NULL != node->logical_paths ) {
-            netloc_lookup_table_destroy(node->logical_paths);
-	    free(node->logical_paths);
-            node->logical_paths = NULL;
+        ret = support_set_node_paths(topology, node, json_paths, is_logical);
+        json_decref(json_paths);
+        if( NETLOC_SUCCESS != ret ) {
+            return ret;
         }
-        node->logical_paths = netloc_dt_node_t_json_decode_paths(topology->edges, json_path);
-        if( NULL == node->logical_paths ) {
-            fprintf(stderr, "Error: Failed to decode the logical path for node\n");
-            fprintf(stderr, "Error: Node: %s\n", netloc_pretty_print_node_t(node));
-            exit_status = NETLOC_ERROR;
-            goto cleanup;
+    }
+    source->loaded[is_logical][node->__uid__] = true;
+
+    return NETLOC_SUCCESS;
+}
+
+int support_load_all_paths(struct netloc_topology * topology)
+{
+    int ret, i;
+
+    for(i = 0; i < topology->num_nodes; ++i) {
+        ret = support_load_node_paths(topology, topology->nodes[i], false);
+        if( NETLOC_SUCCESS != ret ) {
+            return ret;
+        }
+        ret = support_load_node_paths(topology, topology->nodes[i], true);
+        if( NETLOC_SUCCESS != ret ) {
+            return ret;
         }
-        node->num_log_paths = netloc_lookup_table_size(node->logical_paths);
     }
 
+    return NETLOC_SUCCESS;
+}
 
-    topology->nodes_loaded = true;
+int support_path_source_destruct(struct netloc_topology * topology)
+{
+    struct support_path_source_t *source = topology->path_source;
+    int k;
 
-    cleanup:
-    if(NULL != json) {
-        json_decref(json);
-        json = NULL;
+    if( NULL == source ) {
+        return NETLOC_SUCCESS;
     }
 
-    return exit_status;
+    for(k = 0; k < 2; ++k) {
+        if( NULL != source->json_map[k] ) {
+            munmap(source->json_map[k], source->json_map_size[k]);
+        }
+        free(source->loaded[k]);
+        free(source->json_offset[k]);
+        free(source->json_length[k]);
+    }
+
+    if( NULL != source->binary_map && source->binary_owned ) {
+        munmap(source->binary_map, source->binary_map_size);
+    }
+
+    free(source);
+    topology->path_source = NULL;
+
+    return NETLOC_SUCCESS;
 }
 
 int support_load_json_from_file(const char * fname, json_t **json)
@@ -343,3 +975,76 @@ void * dc_decode_edge(const char * key, json_t* json_obj)
 {
     return netloc_dt_edge_t_json_decode(json_obj);
 }
+
+/*
+ * Data rate of one lane (Mbit/s, after encoding overhead)
+ */
+static const struct {
+    const char *name;
+    unsigned long rate;
+} ib_lane_speeds[] = {
+    // FDR10 before FDR, since the names are matched as prefixes
+    {"SDR",    2000},
+    {"DDR",    4000},
+    {"QDR",    8000},
+    {"FDR10", 10000},
+    {"FDR",   13636},
+    {"EDR",   25000},
+    {"HDR",   50000},
+    {"NDR",  100000},
+    {NULL,        0}
+};
+
+unsigned long support_parse_edge_bandwidth(const char * speed, const char * width)
+{
+    unsigned long rate = 0;
+    unsigned long lanes = 1;
+    double bps;
+    char *end = NULL;
+    int i;
+
+    if( NULL == speed || '\0' == speed[0] ) {
+        return 0;
+    }
+
+    for(i = 0; NULL != ib_lane_speeds[i].name; ++i) {
+        if( 0 == strncasecmp(speed, ib_lane_speeds[i].name, strlen(ib_lane_speeds[i].name)) ) {
+            rate = ib_lane_speeds[i].rate;
+            break;
+        }
+    }
+
+    if( 0 == rate ) {
+        bps = strtod(speed, &end);
+        if( end == speed || bps <= 0 ) {
+            return 0;
+        }
+        while( ' ' == *end ) {
+            ++end;
+        }
+        switch( *end ) {
+        case 'k':
+        case 'K':
+            bps *= 1e3;
+            break;
+        case 'm':
+        case 'M':
+            bps *= 1e6;
+            break;
+        case 'g':
+        case 'G':
+            bps *= 1e9;
+            break;
+        }
+        rate = (unsigned long)(bps / 1e6);
+    }
+
+    if( NULL != width ) {
+        lanes = strtoul(width, &end, 10);
+        if( end == width || 0 == lanes ) {
+            lanes = 1;
+        }
+    }
+
+    return rate * lanes;
+}
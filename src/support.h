@@ -35,6 +35,8 @@
 #define JSON_NODE_FILE_NODE_INFO      "node_info"
 #define JSON_NODE_FILE_EDGE_INFO      "edge_info"
 #define JSON_NODE_FILE_PATH_INFO      "path_info"
+#define JSON_NODE_FILE_FORWARDING_INFO "forwarding_info"
+#define JSON_NODE_FILE_PATH_INDEX     "path_index"
 
 #define JSON_NODE_FILE_NETWORK_TYPE   "network_type"
 #define JSON_NODE_FILE_NODE_TYPE      "node_type"
@@ -71,6 +73,17 @@ typedef enum {
 
 #define URI_PREFIX_FILE "file://"
 
+/**
+ * Suffix of the binary topology cache, stored next to the "-nodes.ndat" file
+ */
+#define SUPPORT_BINARY_SUFFIX "topo.nbin"
+
+/**
+ * Suffix of the host distance matrix cache, stored next to the binary
+ * topology cache (see netloc_get_distance_matrix)
+ */
+#define SUPPORT_DISTANCE_SUFFIX "distances.ndist"
+
 
 #define SUPPORT_CONVERT_ADDR_TO_INT(addr, type, v) {        \
     if( NETLOC_NETWORK_TYPE_ETHERNET == type ) {            \
@@ -115,6 +128,111 @@ int support_extract_filename_from_uri(const char * uri, uri_type_t *type, char *
  */
 int support_load_json(struct netloc_topology * topology);
 
+/**
+ * Load data onto the topology handle from the JSON files, ignoring any
+ * binary topology cache.
+ *
+ * \param topology A valid pointer to a topology structure
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR otherwise
+ */
+int support_load_json_files(struct netloc_topology * topology);
+
+/**
+ * Build the physical ID indexes of the nodes loaded on the topology handle
+ *
+ * \param topology A valid pointer to a topology structure with its nodes loaded
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR otherwise
+ */
+int support_build_node_index(struct netloc_topology * topology);
+
+/**
+ * Where the paths of a topology are loaded from, one source node at a time
+ *
+ * Loading the nodes and edges leaves the paths alone. The paths of a source
+ * node are decoded the first time they are asked for, from the file that
+ * stays mapped until the topology is detached: either the two JSON path
+ * files (with the position of the paths of every source node in them), or
+ * the binary topology cache.
+ *
+ * A JSON path file ends with an index of its own (path_index):
+ *   {"path_info": {source physical_id: [offset, length], ...},
+ *    "forwarding_info": [offset, length]}
+ * Files written without it are indexed by scanning over the path_info
+ * object once, without decoding it.
+ */
+struct support_path_source_t {
+    /** If the paths of each source node were loaded (by __uid__), physical then logical */
+    bool *loaded[2];
+
+    /** Mapping of each JSON path file (NULL until its first path is asked for) */
+    char *json_map[2];
+    size_t json_map_size[2];
+    /** Position of the paths of each source node in the JSON path file (by __uid__, length 0 if none) */
+    size_t *json_offset[2];
+    size_t *json_length[2];
+
+    /** Binary topology cache the topology was loaded from (NULL if loaded from the JSON files) */
+    char *binary_map;
+    size_t binary_map_size;
+    /** If binary_map must be unmapped here (it is not the mapping of netloc_attach_mapped) */
+    bool binary_owned;
+    /** Next free element of the block holding the paths (binary_paths), when borrowing from binary_map */
+    netloc_edge_t **binary_path_store;
+};
+
+/**
+ * Access the path source of the topology, creating it if it does not exist
+ *
+ * \param topology A valid pointer to a topology structure with its nodes loaded
+ *
+ * Returns
+ *   The path source of the topology
+ *   NULL on error
+ */
+struct support_path_source_t * support_path_source_get(struct netloc_topology * topology);
+
+/**
+ * Load the physical or logical paths from a node, unless already loaded
+ *
+ * \param topology A valid pointer to a topology structure with its nodes and edges loaded
+ * \param node The source node
+ * \param is_logical Load the logical (instead of the physical) paths
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR otherwise
+ */
+int support_load_node_paths(struct netloc_topology * topology, netloc_node_t *node, bool is_logical);
+
+/**
+ * Load all of the paths (physical and logical) of the topology
+ *
+ * \param topology A valid pointer to a topology structure with its nodes and edges loaded
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR otherwise
+ */
+int support_load_all_paths(struct netloc_topology * topology);
+
+/**
+ * Release the files the paths are loaded from
+ *
+ * The paths already loaded stay on the nodes.
+ *
+ * \param topology A valid pointer to a topology structure
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ */
+int support_path_source_destruct(struct netloc_topology * topology);
+
 /**
  * Returns "*json" as a representation of the JSON in "fname"
  *
@@ -130,4 +248,373 @@ int support_load_json(struct netloc_topology * topology);
  */
 int support_load_json_from_file(const char * fname, json_t **json);
 
+/***********************************************************************
+ *        Binary topology cache
+ ***********************************************************************/
+/**
+ * Filename of the binary topology cache of a network
+ *
+ * Caller is responsible for free'ing the string returned.
+ *
+ * \param network A valid network with its node_uri set
+ *
+ * Returns
+ *   NULL if the network has no node file
+ *   otherwise the filename of the binary topology cache
+ */
+char * support_binary_filename(netloc_network_t *network);
+
+/**
+ * Check if the binary topology cache exists and is at least as recent as
+ * all of the JSON files of the network (comparing the modification times
+ * to the nanosecond).
+ *
+ * \param network A valid network
+ * \param fname Filename of the binary topology cache
+ *
+ * Returns
+ *   true if the cache can be used in place of the JSON files
+ *   false otherwise
+ */
+bool support_binary_is_current(netloc_network_t *network, const char * fname);
+
+/**
+ * Number of JSON files of a network (nodes, physical paths, logical paths)
+ */
+#define SUPPORT_NUM_JSON_FILES 3
+
+/**
+ * Size and modification time of a file that a cache is derived from
+ */
+struct support_file_stamp_t {
+    uint64_t size;
+    /** Modification time, in nanoseconds since the Epoch */
+    uint64_t mtime_ns;
+};
+
+/**
+ * Stamp the JSON files of a network, so that a cache recording the stamps
+ * can later check that none of them was rewritten (down to the nanosecond,
+ * or to a change of size on file systems with coarser times).
+ *
+ * \param network A valid network
+ * \param stamps Array of SUPPORT_NUM_JSON_FILES stamps to fill, in the
+ *               order nodes, physical paths, logical paths (zeroed for a
+ *               missing file)
+ */
+void support_binary_json_stamps(netloc_network_t *network, struct support_file_stamp_t *stamps);
+
+/**
+ * Write the topology to a binary topology cache file
+ *
+ * The topology must already be loaded (its paths are loaded here). The file
+ * is written under a temporary name and renamed into place.
+ *
+ * \param topology A valid pointer to a loaded topology structure
+ * \param fname Filename to write
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR otherwise
+ */
+int support_write_binary(struct netloc_topology * topology, const char * fname);
+
+/**
+ * Load data onto the topology handle from a binary topology cache file
+ *
+ * The file stays mapped, as the source of the paths (see
+ * support_binary_load_node_paths).
+ *
+ * \param topology A valid pointer to a topology structure (not yet loaded)
+ * \param fname Filename of the binary topology cache
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR_NOENT if the file is missing or invalid (the topology is left untouched)
+ *   NETLOC_ERROR otherwise
+ */
+int support_load_binary(struct netloc_topology * topology, const char * fname);
+
+/**
+ * Map a binary topology cache file onto the topology handle (read-only)
+ *
+ * Only the header is checked, the data is decoded by support_load_binary_mapped.
+ *
+ * \param topology A valid pointer to a topology structure (not yet loaded)
+ * \param fname Filename of the binary topology cache
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR_NOENT if the file is missing or invalid
+ */
+int support_map_binary(struct netloc_topology * topology, const char * fname);
+
+/**
+ * Load data onto the topology handle from its mapped binary topology cache
+ *
+ * The strings of the nodes and edges, and the keys of the path tables, point
+ * into the mapping; the paths point into a single block (binary_paths).
+ *
+ * \param topology A valid pointer to a topology structure, with binary_map set
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR otherwise
+ */
+int support_load_binary_mapped(struct netloc_topology * topology);
+
+/**
+ * Load the physical or logical paths from a node out of the binary topology
+ * cache the topology was loaded from
+ *
+ * \param topology A valid pointer to a topology structure, with its path source set
+ * \param node The source node
+ * \param is_logical Load the logical (instead of the physical) paths
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR otherwise
+ */
+int support_binary_load_node_paths(struct netloc_topology * topology, netloc_node_t *node, bool is_logical);
+
+/**
+ * Release the mapped binary topology cache of the topology handle
+ *
+ * Clears every pointer into the mapping from the nodes and edges, so that
+ * they can then be destructed as usual.
+ *
+ * \param topology A valid pointer to a topology structure
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR otherwise
+ */
+int support_unmap_binary(struct netloc_topology * topology);
+
+/***********************************************************************
+ *        Compact graph (traversals)
+ ***********************************************************************/
+/**
+ * Adjacency of the nodes in compressed sparse row form
+ *
+ * Node i is the node of __uid__ i. Its edges are the positions
+ * edge_offsets[i] to edge_offsets[i+1]-1 of the edge arrays, in the order of
+ * its edges array. The node and edge structures stay the public face of the
+ * graph; nodes[] and edges[] lead back to them.
+ */
+struct support_graph_t {
+    int num_nodes;
+    int num_edges;
+    /** Type (netloc_node_type_t) of each node */
+    unsigned char *node_types;
+    /** First edge of each node (num_nodes + 1 entries) */
+    int *edge_offsets;
+    /** Destination node of each edge (-1 if not one of the nodes) */
+    int *edge_dests;
+    /** UID of each edge */
+    int *edge_uids;
+    netloc_node_t **nodes;
+    netloc_edge_t **edges;
+};
+
+/**
+ * Build the compact graph of a set of nodes
+ *
+ * The __uid__ of every node must be its position in nodes.
+ *
+ * \param nodes The nodes
+ * \param num_nodes Number of nodes
+ *
+ * Returns
+ *   The graph (release with support_graph_destruct)
+ *   NULL on error
+ */
+struct support_graph_t * support_graph_construct(netloc_node_t **nodes, int num_nodes);
+
+/**
+ * Release a compact graph
+ *
+ * \param graph The graph (may be NULL)
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ */
+int support_graph_destruct(struct support_graph_t *graph);
+
+/**
+ * Access the compact graph of a topology, building it on first use
+ *
+ * The nodes must be loaded. The graph is released by netloc_detach.
+ *
+ * \param topology A valid pointer to a topology structure
+ *
+ * Returns
+ *   The graph of the topology
+ *   NULL on error
+ */
+struct support_graph_t * support_topology_graph(struct netloc_topology * topology);
+
+/***********************************************************************
+ *        Shortest path trees (Data Collection)
+ ***********************************************************************/
+/**
+ * Destination nodes shared by the shortest path trees stored by one
+ * netloc_dc_compute_all_paths call (reference counted)
+ */
+struct netloc_dc_path_dests_t {
+    int refcount;
+    int num_nodes;
+    netloc_node_t **nodes;
+};
+
+/**
+ * Shortest path tree rooted at a source node
+ *
+ * Holds the UID of the edge used to reach every node (indexed by the node
+ * __uid__, NETLOC_EDGE_UID_INVALID if not reached). The path to any
+ * destination is rebuilt by walking these edges back to the source, so a
+ * source costs one int per node instead of one edge array per destination.
+ */
+struct netloc_dc_path_tree_t {
+    netloc_node_t *src_node;
+    int num_nodes;
+    int *pred_edge_uids;
+    struct netloc_dc_path_dests_t *dests;
+};
+
+/**
+ * Release a shortest path tree (and its reference on the destinations)
+ *
+ * \param tree The tree (may be NULL)
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ */
+int support_path_tree_destruct(struct netloc_dc_path_tree_t *tree);
+
+/**
+ * Add the paths from a shortest path tree to a JSON paths object, in the
+ * format of netloc_dt_node_t_json_encode_paths (destination -> edge UIDs)
+ *
+ * \param tree The shortest path tree
+ * \param edges_by_uid Dense index of the edges by edge_uid
+ * \param num_edge_uids Number of elements in edges_by_uid
+ * \param json_paths The JSON object to add the paths to
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR otherwise
+ */
+int support_path_tree_json_encode(struct netloc_dc_path_tree_t *tree,
+                                  netloc_edge_t **edges_by_uid, int num_edge_uids,
+                                  json_t *json_paths);
+
+struct netloc_dc_pathfinder_t;
+
+/**
+ * Release the pathfinder scratch space of a data collection handle
+ *
+ * \param pf The scratch space (may be NULL)
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ */
+int support_pathfinder_destruct(struct netloc_dc_pathfinder_t *pf);
+
+/***********************************************************************
+ *        Forwarding tables (logical paths)
+ ***********************************************************************/
+/**
+ * Default number of logical paths expanded from the forwarding tables that
+ * are kept for reuse (see netloc_topology::path_cache_size)
+ */
+#define SUPPORT_PATH_CACHE_SIZE 4096
+
+/**
+ * Access the forwarding table of a node, creating it if it does not exist
+ *
+ * The nodes must have been numbered (__uid__) by support_build_node_index.
+ *
+ * \param topology A valid pointer to a topology structure
+ * \param node The node (switch) owning the table
+ * \param size Expected number of entries, if the table is created
+ * \param flags Lookup table flags, if the table is created
+ *
+ * Returns
+ *   The forwarding table (destination logical_id -> outgoing edge)
+ *   NULL on error
+ */
+netloc_dt_lookup_table_t support_forwarding_table_get(struct netloc_topology * topology,
+                                                      netloc_node_t *node,
+                                                      size_t size, unsigned long flags);
+
+/**
+ * Decode the forwarding table of a node from its JSON object
+ * (destination logical_id -> outgoing edge UID)
+ *
+ * \param topology A valid pointer to a topology structure, with its edges indexed
+ * \param node The node (switch) owning the table
+ * \param json_table The JSON object
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR otherwise
+ */
+int support_forwarding_table_json_decode(struct netloc_topology * topology,
+                                         netloc_node_t *node, json_t *json_table);
+
+/**
+ * Release the forwarding tables, and the paths expanded from them
+ *
+ * \param topology A valid pointer to a topology structure
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ */
+int support_forwarding_tables_destruct(struct netloc_topology * topology);
+
+/**
+ * Get the logical path between two nodes by following the forwarding tables
+ *
+ * The path is served from the path cache of the topology when possible.
+ * Without copy the path is owned by the cache, and stays valid until the
+ * topology is detached (it is never evicted). With copy the caller gets its
+ * own array, and the path may later be evicted from the cache.
+ *
+ * \param topology A valid pointer to a topology structure
+ * \param src_node The source node
+ * \param dest_node The destination node
+ * \param num_edges The number of edges in the path
+ * \param path NULL terminated array of edges from the source to the destination
+ * \param copy If the caller wants its own copy of the path (to free())
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR_NOT_FOUND if the forwarding tables do not lead to the destination
+ *   NETLOC_ERROR otherwise
+ */
+int support_forwarding_get_path(struct netloc_topology * topology,
+                                netloc_node_t *src_node, netloc_node_t *dest_node,
+                                int *num_edges, netloc_edge_t ***path, bool copy);
+
+/***********************************************************************
+ * Edge metadata
+ ***********************************************************************/
+/**
+ * Parse the speed and width strings of an edge into its data rate
+ *
+ * The speed is either an InfiniBand lane speed name (SDR, DDR, QDR, FDR10,
+ * FDR, EDR, HDR, NDR) or a number of bits per second (as OpenFlow reports
+ * it), optionally followed by a K, M or G multiplier. The width is a lane
+ * count such as "4x". A rate below 1 Mbit/s (e.g., the placeholder "1"
+ * used by some readers) is taken as unknown.
+ *
+ * \param speed Speed string (may be NULL)
+ * \param width Width string (may be NULL, meaning one lane)
+ *
+ * Returns
+ *   The data rate in Mbit/s, 0 if unknown
+ */
+unsigned long support_parse_edge_bandwidth(const char * speed, const char * width);
+
 #endif /* NETLOC_SUPPORT_H */
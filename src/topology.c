@@ -33,7 +33,20 @@ int netloc_attach(struct netloc_topology ** topology_ptr, netloc_network_t netwo
     topology->nodes_loaded = false;
     topology->num_nodes    = 0;
     topology->nodes        = NULL;
+    topology->nodes_by_phy_id     = NULL;
+    topology->nodes_by_phy_id_int = NULL;
     topology->edges        = NULL;
+    topology->num_edge_uids = 0;
+    topology->edges_by_uid = NULL;
+    topology->graph        = NULL;
+    topology->path_source  = NULL;
+    topology->binary_map      = NULL;
+    topology->binary_map_size = 0;
+    topology->binary_paths    = NULL;
+    topology->num_forwarding_tables = 0;
+    topology->forwarding_tables     = NULL;
+    topology->path_cache            = NULL;
+    topology->path_cache_size       = SUPPORT_PATH_CACHE_SIZE;
 
     /*
      * Make the pointer live
@@ -43,6 +56,39 @@ int netloc_attach(struct netloc_topology ** topology_ptr, netloc_network_t netwo
     return NETLOC_SUCCESS;
 }
 
+int netloc_attach_mapped(struct netloc_topology ** topology_ptr, netloc_network_t network)
+{
+    int ret;
+    char * binary_uri = NULL;
+    struct netloc_topology *topology = NULL;
+
+    binary_uri = support_binary_filename(&network);
+    if( NULL == binary_uri || !support_binary_is_current(&network, binary_uri) ) {
+        free(binary_uri);
+        return NETLOC_ERROR_NOENT;
+    }
+
+    ret = netloc_attach(&topology, network);
+    if( NETLOC_SUCCESS != ret ) {
+        free(binary_uri);
+        return ret;
+    }
+
+    /*
+     * Only map the file here, it is decoded on first access
+     */
+    ret = support_map_binary(topology, binary_uri);
+    free(binary_uri);
+    if( NETLOC_SUCCESS != ret ) {
+        netloc_detach(topology);
+        return ret;
+    }
+
+    (*topology_ptr) = topology;
+
+    return NETLOC_SUCCESS;
+}
+
 int netloc_detach(struct netloc_topology * topology)
 {
     int i;
@@ -57,6 +103,27 @@ int netloc_detach(struct netloc_topology * topology)
         return NETLOC_ERROR;
     }
 
+    /*
+     * Forwarding tables and expanded paths only refer to the nodes and edges
+     */
+    support_forwarding_tables_destruct(topology);
+
+    /*
+     * The compact graph points into the nodes and edges
+     */
+    support_graph_destruct(topology->graph);
+    topology->graph = NULL;
+
+    /*
+     * Files the paths were still to be loaded from
+     */
+    support_path_source_destruct(topology);
+
+    /*
+     * Give back the data borrowed from a mapped binary topology cache
+     */
+    support_unmap_binary(topology);
+
     /*
      * Free Memory
      */
@@ -77,6 +144,25 @@ int netloc_detach(struct netloc_topology * topology)
         topology->edges = NULL;
     }
 
+    if( NULL != topology->edges_by_uid ) {
+        free(topology->edges_by_uid);
+        topology->edges_by_uid = NULL;
+        topology->num_edge_uids = 0;
+    }
+
+    /* The node indexes do not own their keys or values */
+    if( NULL != topology->nodes_by_phy_id ) {
+        netloc_lookup_table_destroy(topology->nodes_by_phy_id);
+        free(topology->nodes_by_phy_id);
+        topology->nodes_by_phy_id = NULL;
+    }
+
+    if( NULL != topology->nodes_by_phy_id_int ) {
+        netloc_lookup_table_destroy(topology->nodes_by_phy_id_int);
+        free(topology->nodes_by_phy_id_int);
+        topology->nodes_by_phy_id_int = NULL;
+    }
+
     if( NULL != topology->nodes ) {
         for(i = 0; i < topology->num_nodes; ++i ) {
             if( NULL != topology->nodes[i] ) {
@@ -8,16 +8,142 @@
 
 #include "netloc.h"
 #include "netloc_map.h"
+#include "private/netloc.h"
+#include "private/map.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 
+/* The topologies that diffs were loaded on top of must stay entire */
+static int check_diff_references(netloc_map_t _map)
+{
+#if HWLOC_API_VERSION >= 0x00010800
+  struct netloc_map *map = _map;
+  struct netloc_map__server *server, *refserver;
+
+  for(server = map->server_first; server; server = server->next) {
+    refserver = server->topology_diff_refserver;
+    if (!refserver)
+      continue;
+    if (!refserver->topology) {
+      fprintf(stderr, "Reference topology %s of %s is compressed\n", refserver->name, server->name);
+      return -1;
+    }
+    if (refserver->topology_diff_refserver) {
+      fprintf(stderr, "Reference topology %s of %s is stored as a diff\n", refserver->name, server->name);
+      return -1;
+    }
+  }
+#endif
+  return 0;
+}
+
+/* With NETLOC_MAP_HWLOC_CACHE=1, releasing a server topology compresses the
+ * one released before it, and the topologies come back intact */
+static int check_hwloc_cache(const char *hwloc_dir)
+{
+#if HWLOC_API_VERSION >= 0x00010800
+  netloc_map_t _map;
+  struct netloc_map *map;
+  struct netloc_map__server *server, *servers[2];
+  hwloc_topology_t topology[2];
+  int nbpus[2];
+  unsigned i, n = 0;
+  int err, ret = -1;
+
+  setenv("NETLOC_MAP_HWLOC_CACHE", "1", 1);
+  err = netloc_map_create(&_map);
+  unsetenv("NETLOC_MAP_HWLOC_CACHE");
+  if (err) {
+    fprintf(stderr, "Failed to create the map\n");
+    return -1;
+  }
+  map = _map;
+  err = netloc_map_load_hwloc_data(_map, hwloc_dir);
+  if (err) {
+    fprintf(stderr, "Failed to load hwloc data\n");
+    goto out;
+  }
+  err = netloc_map_build(_map, NETLOC_MAP_BUILD_FLAG_COMPRESS_HWLOC);
+  if (err) {
+    fprintf(stderr, "Failed to build map data\n");
+    goto out;
+  }
+  if (map->hwloc_cache_max != 1) {
+    fprintf(stderr, "NETLOC_MAP_HWLOC_CACHE=1 gave a cache of %u topologies\n", map->hwloc_cache_max);
+    goto out;
+  }
+
+  for(server = map->server_first; server && n < 2; server = server->next)
+    if (server->topology_diff_refserver)
+      servers[n++] = server;
+  if (n < 2) {
+    fprintf(stderr, "Less than two topologies are stored as a diff\n");
+    goto out;
+  }
+
+  /* use one server, then the other: the first one gets compressed */
+  for(i = 0; i < 2; i++) {
+    err = netloc_map_server2hwloc(servers[i], &topology[i]);
+    if (err) {
+      fprintf(stderr, "Failed to get the topology of %s\n", servers[i]->name);
+      goto out;
+    }
+    nbpus[i] = hwloc_get_nbobjs_by_type(topology[i], HWLOC_OBJ_PU);
+    netloc_map_put_hwloc(_map, topology[i]);
+    if (!servers[i]->topology || map->hwloc_cache_nr != 1 || map->hwloc_cache_first != servers[i]) {
+      fprintf(stderr, "Released topology %s is not the only cached one\n", servers[i]->name);
+      goto out;
+    }
+  }
+  if (servers[0]->topology) {
+    fprintf(stderr, "Topology %s was not compressed when %s was released\n", servers[0]->name, servers[1]->name);
+    goto out;
+  }
+
+  /* use both at once (the first one is uncompressed again), then release them */
+  for(i = 0; i < 2; i++) {
+    err = netloc_map_server2hwloc(servers[i], &topology[i]);
+    if (err) {
+      fprintf(stderr, "Failed to get the topology of %s again\n", servers[i]->name);
+      goto out;
+    }
+    if (hwloc_get_nbobjs_by_type(topology[i], HWLOC_OBJ_PU) != nbpus[i]) {
+      fprintf(stderr, "Topology %s changed since it was first used\n", servers[i]->name);
+      goto out;
+    }
+  }
+  if (map->hwloc_cache_nr) {
+    fprintf(stderr, "Topologies in use are still cached\n");
+    goto out;
+  }
+  for(i = 0; i < 2; i++)
+    netloc_map_put_hwloc(_map, topology[i]);
+  if (servers[0]->topology || !servers[1]->topology || map->hwloc_cache_nr != 1) {
+    fprintf(stderr, "Only the last released topology %s should be uncompressed\n", servers[1]->name);
+    goto out;
+  }
+
+  if (check_diff_references(_map) < 0)
+    goto out;
+  ret = 0;
+
+ out:
+  netloc_map_destroy(_map);
+  return ret;
+#else
+  return 0;
+#endif
+}
+
 int main(int argc, char *argv[])
 {
   netloc_map_t map;
   struct rusage rusage;
-  int verbose __netloc_attribute_unused = 0;
+  const char *hwloc_dir = NETLOC_ABS_TOP_SRCDIR "../examples/avakas/hwloc";
+  int verbose = 0;
   int err;
 
   argc--;
@@ -29,6 +155,12 @@ int main(int argc, char *argv[])
       argv++;
     }
   }
+  if (argc >= 1)
+    hwloc_dir = argv[0];
+
+  /* show what gets compressed */
+  if (verbose)
+    setenv("NETLOC_MAP_VERBOSE", "1", 0);
 
   /* map without any hwloc topology */
   err = netloc_map_create(&map);
@@ -51,7 +183,7 @@ int main(int argc, char *argv[])
     fprintf(stderr, "Failed to create the map\n");
     return -1;
   }
-  err = netloc_map_load_hwloc_data(map, NETLOC_ABS_TOP_SRCDIR "../examples/avakas/hwloc");
+  err = netloc_map_load_hwloc_data(map, hwloc_dir);
   if (err) {
     fprintf(stderr, "Failed to load hwloc data\n");
     return -1;
@@ -61,17 +193,26 @@ int main(int argc, char *argv[])
     fprintf(stderr, "Failed to build map data\n");
     return -1;
   }
+  err = check_diff_references(map);
+  if (err)
+    return -1;
   err = getrusage(RUSAGE_SELF, &rusage);
   printf("map with COMPRESSED hwloc topologies: MAXRSS = %ld kB\n", rusage.ru_maxrss);
   err = netloc_map_destroy(map);
 
+  /* map with compressed hwloc topologies, a single one kept uncompressed */
+  err = check_hwloc_cache(hwloc_dir);
+  if (err)
+    return -1;
+  printf("map with COMPRESSED hwloc topologies, cache of 1: OK\n");
+
   /* map with noncompressed hwloc topologies */
   err = netloc_map_create(&map);
   if (err) {
     fprintf(stderr, "Failed to create the map\n");
     return -1;
   }
-  err = netloc_map_load_hwloc_data(map, NETLOC_ABS_TOP_SRCDIR "../examples/avakas/hwloc");
+  err = netloc_map_load_hwloc_data(map, hwloc_dir);
   if (err) {
     fprintf(stderr, "Failed to load hwloc data\n");
     return -1;
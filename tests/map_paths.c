@@ -19,6 +19,12 @@ int main(int argc, char *argv[])
   netloc_map_paths_t paths;
   unsigned nr_paths, nr_edges, i, j;
   struct netloc_map_edge_s *edges;
+  hwloc_topology_t srctopos[2], dsttopos[2];
+  hwloc_obj_t srcobjs[2], dstobjs[2];
+  netloc_map_paths_t many_paths[2];
+  unsigned many_nrs[2], k;
+  struct netloc_map_edge_s *many_edges;
+  unsigned many_nr_edges;
   unsigned flags = 0x3;
   char *path;
   int err;
@@ -157,6 +163,44 @@ int main(int argc, char *argv[])
     }
   }
 
+  /* the same pair twice in a batch (from the cache) must give the same paths */
+  srctopos[0] = srctopos[1] = srctopo;
+  srcobjs[0] = srcobjs[1] = srcobj;
+  dsttopos[0] = dsttopos[1] = dsttopo;
+  dstobjs[0] = dstobjs[1] = dstobj;
+  err = netloc_map_paths_build_many(map, 2,
+				    srctopos, srcobjs,
+				    dsttopos, dstobjs,
+				    flags,
+				    many_paths, many_nrs);
+  if (err < 0) {
+    fprintf(stderr, "Failed to build paths in a batch\n");
+    return -1;
+  }
+  for(k=0; k<2; k++) {
+    assert(many_nrs[k] == nr_paths);
+    for(i=0; i<nr_paths; i++) {
+      err = netloc_map_paths_get(paths, i, &edges, &nr_edges);
+      assert(!err);
+      err = netloc_map_paths_get(many_paths[k], i, &many_edges, &many_nr_edges);
+      assert(!err);
+      assert(many_nr_edges == nr_edges);
+      for(j=0; j<nr_edges; j++) {
+	assert(many_edges[j].type == edges[j].type);
+	if (edges[j].type == NETLOC_MAP_EDGE_TYPE_NETLOC) {
+	  assert(many_edges[j].netloc.edge == edges[j].netloc.edge);
+	  assert(many_edges[j].netloc.topology == edges[j].netloc.topology);
+	} else {
+	  assert(many_edges[j].hwloc.src_obj == edges[j].hwloc.src_obj);
+	  assert(many_edges[j].hwloc.dest_obj == edges[j].hwloc.dest_obj);
+	  assert(many_edges[j].hwloc.weight == edges[j].hwloc.weight);
+	}
+      }
+    }
+    netloc_map_paths_destroy(many_paths[k]);
+  }
+  printf("got the same paths in a batch\n");
+
   netloc_map_paths_destroy(paths);
 
   netloc_map_put_hwloc(map, srctopo);
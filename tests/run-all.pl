@@ -21,6 +21,10 @@ push(@tests, "test_API");
 push(@tests, "test_ETH_API");
 push(@tests, "test_ETH_verbose");
 push(@tests, "test_conv");
+push(@tests, "test_forwarding");
+push(@tests, "test_paths");
+push(@tests, "test_path_loading");
+push(@tests, "test_distances");
 push(@tests, "test_find_neighbors");
 push(@tests, "test_metadata");
 
@@ -31,6 +35,7 @@ push(@tests, "netloc_all");
 push(@tests, "map_paths data/ node01 1 node08 1");
 push(@tests, "lsmap data/");
 push(@tests, "test_map_hwloc data/ node02 3");
+push(@tests, "hwloc_compress --verbose data/hwloc-diff");
 
 # JJH the following tests require additional repository access.
 #push(@tests, "hwloc_compress");
@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2013-2014 University of Wisconsin-La Crosse.
+ *                         All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ * See COPYING in top-level directory.
+ *
+ * $HEADER$
+ */
+
+/*
+ * Compute the host distance matrix of the InfiniBand test data, check it
+ * against the stored physical paths, and check that it is served from the
+ * cache the second time, but not once the data is rewritten.
+ */
+#include "netloc.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/*
+ * Testing support functions
+ */
+int copy_file(const char *from_dir, const char *to_dir, const char *fname);
+int check_matrix(netloc_topology_t topology, int num_hosts, netloc_node_t **hosts, uint16_t *distances);
+int remove_dir(const char *dir);
+int tamper_cache(const char *cache_fname, const char *dir, const char *fname);
+
+static const char *data_files[] = {
+    "IB-fe80:0000:0000:0000-nodes.ndat",
+    "IB-fe80:0000:0000:0000-phy-paths.ndat",
+    "IB-fe80:0000:0000:0000-log-paths.ndat",
+    NULL
+};
+
+
+int main(void) {
+    int ret, exit_status = NETLOC_SUCCESS;
+    int i;
+    netloc_topology_t topology = NULL;
+    netloc_network_t *tmp_network = NULL;
+    char *search_uri = NULL;
+    char *cache_fname = NULL;
+    char outdir[] = "/tmp/netloc_test_distances.XXXXXX";
+    int num_hosts = 0, num_cached_hosts = 0;
+    netloc_node_t **hosts = NULL;
+    netloc_node_t **cached_hosts = NULL;
+    uint16_t *distances = NULL;
+    uint16_t *cached_distances = NULL;
+    int num_new_hosts = 0;
+    netloc_node_t **new_hosts = NULL;
+    uint16_t *new_distances = NULL;
+
+    /*
+     * Work on a copy of the data, so that the cache is not left behind
+     */
+    if( NULL == mkdtemp(outdir) ) {
+        fprintf(stderr, "Error: Failed to create a temporary directory\n");
+        return NETLOC_ERROR;
+    }
+    for(i = 0; NULL != data_files[i]; ++i) {
+        if( 0 != copy_file("data/netloc", outdir, data_files[i]) ) {
+            fprintf(stderr, "Error: Failed to copy %s\n", data_files[i]);
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+    }
+
+    /*
+     * Setup a Network connection
+     */
+    tmp_network = netloc_dt_network_t_construct();
+    tmp_network->network_type = NETLOC_NETWORK_TYPE_INFINIBAND;
+    tmp_network->subnet_id    = strdup("fe80:0000:0000:0000");
+    asprintf(&search_uri, "file://%s/", outdir);
+
+    ret = netloc_find_network(search_uri, tmp_network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_find_network returned an error (%d)\n", ret);
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    ret = netloc_attach(&topology, *tmp_network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_attach returned an error (%d)\n", ret);
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    /*
+     * Compute (and cache) the matrix
+     */
+    printf("Test get_distance_matrix: ");
+    fflush(NULL);
+    ret = netloc_get_distance_matrix(topology, 4, NETLOC_DISTANCE_FLAG_CACHE,
+                                     &num_hosts, &hosts, &distances);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_distance_matrix returned %d\n", ret);
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    ret = check_matrix(topology, num_hosts, hosts, distances);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+    printf("Success (%d hosts)\n", num_hosts);
+
+    /*
+     * The second time the matrix comes from the cache
+     */
+    printf("Test get_distance_matrix (cached): ");
+    fflush(NULL);
+    asprintf(&cache_fname, "%s/IB-fe80:0000:0000:0000-distances.ndist", outdir);
+    if( 0 != access(cache_fname, F_OK) ) {
+        fprintf(stderr, "Error: The matrix was not cached in %s\n", cache_fname);
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    ret = netloc_get_distance_matrix(topology, 1, NETLOC_DISTANCE_FLAG_CACHE,
+                                     &num_cached_hosts, &cached_hosts, &cached_distances);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_distance_matrix returned %d\n", ret);
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    if( num_cached_hosts != num_hosts ||
+        0 != memcmp(cached_hosts, hosts, sizeof(netloc_node_t*) * num_hosts) ||
+        0 != memcmp(cached_distances, distances, sizeof(uint16_t) * num_hosts * num_hosts) ) {
+        fprintf(stderr, "Error: The cached matrix differs from the computed one\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    printf("Success\n");
+
+    /*
+     * A data file rewritten in the same second as the cache (here, given
+     * the very same modification time) makes the matrix computed again
+     * instead of read from the (tampered) cache
+     */
+    printf("Test get_distance_matrix (data rewritten): ");
+    fflush(NULL);
+    if( 0 != tamper_cache(cache_fname, outdir, data_files[0]) ) {
+        fprintf(stderr, "Error: Failed to tamper with the cache\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    ret = netloc_get_distance_matrix(topology, 1, NETLOC_DISTANCE_FLAG_CACHE,
+                                     &num_new_hosts, &new_hosts, &new_distances);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_distance_matrix returned %d\n", ret);
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    ret = check_matrix(topology, num_new_hosts, new_hosts, new_distances);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: The matrix was read from a stale cache\n");
+        exit_status = ret;
+        goto cleanup;
+    }
+    printf("Success\n");
+
+    /*
+     * Cleanup
+     */
+ cleanup:
+    free(hosts);
+    free(distances);
+    free(cached_hosts);
+    free(cached_distances);
+    free(new_hosts);
+    free(new_distances);
+
+    if( NULL != topology ) {
+        ret = netloc_detach(topology);
+        if( NETLOC_SUCCESS != ret ) {
+            fprintf(stderr, "Error: netloc_detach returned an error (%d)\n", ret);
+            exit_status = ret;
+        }
+    }
+
+    if( NULL != tmp_network ) {
+        netloc_dt_network_t_destruct(tmp_network);
+    }
+    free(search_uri);
+    free(cache_fname);
+
+    remove_dir(outdir);
+
+    return exit_status;
+}
+
+/*
+ * Every stored physical path between two hosts is a shortest one, so its
+ * length is their distance
+ */
+int check_matrix(netloc_topology_t topology, int num_hosts, netloc_node_t **hosts, uint16_t *distances)
+{
+    int ret;
+    int i, j, num_checked = 0;
+    int num_edges = 0;
+    netloc_edge_t **path = NULL;
+
+    for(i = 0; i < num_hosts; ++i) {
+        if( 0 != distances[i * num_hosts + i] ) {
+            fprintf(stderr, "Error: Distance from %s to itself is %d\n",
+                    hosts[i]->physical_id, distances[i * num_hosts + i]);
+            return NETLOC_ERROR;
+        }
+
+        for(j = 0; j < num_hosts; ++j) {
+            if( i == j ) {
+                continue;
+            }
+
+            ret = netloc_get_path(topology, hosts[i], hosts[j], &num_edges, &path, false);
+            if( NETLOC_SUCCESS != ret ) {
+                continue;
+            }
+
+            if( distances[i * num_hosts + j] != num_edges ) {
+                fprintf(stderr, "Error: Distance from %s to %s is %d, the path has %d edges\n",
+                        hosts[i]->physical_id, hosts[j]->physical_id,
+                        distances[i * num_hosts + j], num_edges);
+                return NETLOC_ERROR;
+            }
+            ++num_checked;
+        }
+    }
+
+    if( 0 == num_checked ) {
+        fprintf(stderr, "Error: No host pairs with a physical path\n");
+        return NETLOC_ERROR;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+/*
+ * Change the distance of the last host to itself in the cache, then give a
+ * data file the modification time of the cache
+ */
+int tamper_cache(const char *cache_fname, const char *dir, const char *fname)
+{
+    int ret = 0, fd;
+    uint16_t distance = 1;
+    struct stat sb;
+    struct timespec times[2];
+    char *data_fname = NULL;
+
+    fd = open(cache_fname, O_WRONLY);
+    if( fd < 0 ) {
+        return -1;
+    }
+    if( 0 != fstat(fd, &sb) ||
+        (off_t)-1 == lseek(fd, sb.st_size - sizeof(distance), SEEK_SET) ||
+        sizeof(distance) != write(fd, &distance, sizeof(distance)) ) {
+        ret = -1;
+    }
+    if( 0 != close(fd) || 0 != ret || 0 != stat(cache_fname, &sb) ) {
+        return -1;
+    }
+
+    times[0] = sb.st_mtim;
+    times[1] = sb.st_mtim;
+    asprintf(&data_fname, "%s/%s", dir, fname);
+    ret = utimensat(AT_FDCWD, data_fname, times, 0);
+    free(data_fname);
+
+    return ret;
+}
+
+int copy_file(const char *from_dir, const char *to_dir, const char *fname)
+{
+    int ret = 0;
+    char *from = NULL, *to = NULL;
+    FILE *in = NULL, *out = NULL;
+    char buf[4096];
+    size_t len;
+
+    asprintf(&from, "%s/%s", from_dir, fname);
+    asprintf(&to, "%s/%s", to_dir, fname);
+
+    in  = fopen(from, "r");
+    out = fopen(to, "w");
+    if( NULL == in || NULL == out ) {
+        ret = -1;
+    } else {
+        while( 0 < (len = fread(buf, 1, sizeof(buf), in)) ) {
+            if( len != fwrite(buf, 1, len, out) ) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    if( NULL != in ) {
+        fclose(in);
+    }
+    if( NULL != out && 0 != fclose(out) ) {
+        ret = -1;
+    }
+    free(from);
+    free(to);
+
+    return ret;
+}
+
+int remove_dir(const char *dir)
+{
+    DIR *dirp = NULL;
+    struct dirent *dp = NULL;
+    char *fname = NULL;
+
+    dirp = opendir(dir);
+    if( NULL == dirp ) {
+        return -1;
+    }
+    while( NULL != (dp = readdir(dirp)) ) {
+        if( 0 == strcmp(dp->d_name, ".") || 0 == strcmp(dp->d_name, "..") ) {
+            continue;
+        }
+        asprintf(&fname, "%s/%s", dir, dp->d_name);
+        unlink(fname);
+        free(fname);
+    }
+    closedir(dirp);
+
+    return rmdir(dir);
+}
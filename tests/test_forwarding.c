@@ -0,0 +1,606 @@
+/*
+ * Copyright (c) 2013-2014 University of Wisconsin-La Crosse.
+ *                         All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ * See COPYING in top-level directory.
+ *
+ * $HEADER$
+ */
+
+/*
+ * Store the logical paths of the InfiniBand test data as forwarding tables,
+ * and check that the paths expanded from them match the original ones.
+ */
+#include "netloc.h"
+#include "netloc_dc.h"
+#include "private/netloc.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Testing support functions
+ */
+int write_forwarding_tables(netloc_topology_t topology, netloc_network_t *network, char *outdir);
+int compare_logical_paths(netloc_topology_t orig_topology, netloc_topology_t topology);
+int check_topology(netloc_topology_t orig_topology, netloc_network_t *network, bool mapped);
+int check_path_copies(netloc_topology_t orig_topology, netloc_network_t *network);
+bool same_edge(netloc_edge_t *a, netloc_edge_t *b);
+
+
+int main(void) {
+    int ret, exit_status = NETLOC_SUCCESS;
+    netloc_topology_t topology;
+    netloc_network_t *tmp_network = NULL;
+    netloc_network_t *network = NULL;
+    char *search_uri = NULL;
+    char outdir[] = "/tmp/netloc_test_forwarding.XXXXXX";
+    char *fname = NULL;
+
+    /*
+     * Setup a Network connection
+     */
+    tmp_network = netloc_dt_network_t_construct();
+    tmp_network->network_type = NETLOC_NETWORK_TYPE_INFINIBAND;
+    tmp_network->subnet_id    = strdup("fe80:0000:0000:0000");
+    search_uri = strdup("file://data/netloc");
+
+    ret = netloc_find_network(search_uri, tmp_network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_find_network returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    ret = netloc_attach(&topology, *tmp_network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_attach returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    if( NULL == mkdtemp(outdir) ) {
+        fprintf(stderr, "Error: Failed to create a temporary directory\n");
+        return NETLOC_ERROR;
+    }
+
+    /*
+     * Write the forwarding tables
+     */
+    printf("Test append_forwarding_entry: ");
+    fflush(NULL);
+    ret = write_forwarding_tables(topology, tmp_network, outdir);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+    printf("Success\n");
+
+    network = netloc_dt_network_t_construct();
+    network->network_type = NETLOC_NETWORK_TYPE_INFINIBAND;
+    network->subnet_id    = strdup("fe80:0000:0000:0000");
+    free(search_uri);
+    asprintf(&search_uri, "file://%s/", outdir);
+
+    ret = netloc_find_network(search_uri, network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_find_network returned an error (%d)\n", ret);
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    /*
+     * Expand the paths, from the binary topology cache first
+     */
+    printf("Test get_logical_path (binary, mapped): ");
+    fflush(NULL);
+    ret = check_topology(topology, network, true);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+    printf("Success\n");
+
+    printf("Test get_logical_path (binary): ");
+    fflush(NULL);
+    ret = check_topology(topology, network, false);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+    printf("Success\n");
+
+    asprintf(&fname, "%s/IB-fe80:0000:0000:0000-topo.nbin", outdir);
+    unlink(fname);
+    free(fname);
+    fname = NULL;
+
+    printf("Test get_logical_path (JSON): ");
+    fflush(NULL);
+    ret = check_topology(topology, network, false);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+    printf("Success\n");
+
+    printf("Test get_path_copy (small cache): ");
+    fflush(NULL);
+    ret = check_path_copies(topology, network);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+    printf("Success\n");
+
+ cleanup:
+    /*
+     * Cleanup
+     */
+    ret = netloc_detach(topology);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_detach returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    asprintf(&fname, "%s/IB-fe80:0000:0000:0000-nodes.ndat", outdir);
+    unlink(fname);
+    free(fname);
+    asprintf(&fname, "%s/IB-fe80:0000:0000:0000-phy-paths.ndat", outdir);
+    unlink(fname);
+    free(fname);
+    asprintf(&fname, "%s/IB-fe80:0000:0000:0000-log-paths.ndat", outdir);
+    unlink(fname);
+    free(fname);
+    asprintf(&fname, "%s/IB-fe80:0000:0000:0000-topo.nbin", outdir);
+    unlink(fname);
+    free(fname);
+    rmdir(outdir);
+
+    netloc_dt_network_t_destruct(tmp_network);
+    if( NULL != network ) {
+        netloc_dt_network_t_destruct(network);
+    }
+    free(search_uri);
+
+    return exit_status;
+}
+
+int write_forwarding_tables(netloc_topology_t topology, netloc_network_t *network, char *outdir)
+{
+    int ret, i, j, k;
+    netloc_data_collection_handle_t *dc_handle = NULL;
+    netloc_dt_lookup_table_t nodes = NULL;
+    netloc_dt_lookup_table_iterator_t hti_src = NULL;
+    netloc_dt_lookup_table_iterator_t hti_dest = NULL;
+    netloc_node_t *src_node = NULL;
+    netloc_node_t *dest_node = NULL;
+    netloc_node_t *node = NULL;
+    netloc_edge_t *edge = NULL;
+    int num_edges;
+    netloc_edge_t **edges = NULL;
+
+    dc_handle = netloc_dc_create(network, outdir);
+    if( NULL == dc_handle ) {
+        fprintf(stderr, "Error: netloc_dc_create failed\n");
+        return NETLOC_ERROR;
+    }
+
+    ret = netloc_get_all_nodes(topology, &nodes);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_all_nodes returned %d\n", ret);
+        return ret;
+    }
+
+    /*
+     * Copy the nodes, then their edges (in order, with new edge UIDs)
+     */
+    hti_src = netloc_dt_lookup_table_iterator_t_construct( nodes );
+    while( !netloc_lookup_table_iterator_at_end(hti_src) ) {
+        src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
+        if( NULL == src_node ) {
+            break;
+        }
+
+        node = netloc_dt_node_t_construct();
+        node->network_type = src_node->network_type;
+        node->node_type    = src_node->node_type;
+        node->physical_id  = strdup(src_node->physical_id);
+        node->logical_id   = (NULL == src_node->logical_id ? NULL : strdup(src_node->logical_id));
+        node->subnet_id    = (NULL == src_node->subnet_id ? NULL : strdup(src_node->subnet_id));
+        node->description  = (NULL == src_node->description ? NULL : strdup(src_node->description));
+
+        ret = netloc_dc_append_node(dc_handle, node);
+        netloc_dt_node_t_destruct(node);
+        if( NETLOC_SUCCESS != ret ) {
+            fprintf(stderr, "Error: netloc_dc_append_node returned %d\n", ret);
+            return ret;
+        }
+    }
+
+    netloc_lookup_table_iterator_reset(hti_src);
+    while( !netloc_lookup_table_iterator_at_end(hti_src) ) {
+        src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
+        if( NULL == src_node ) {
+            break;
+        }
+
+        node = netloc_dc_get_node_by_physical_id(dc_handle, src_node->physical_id);
+        for(i = 0; i < src_node->num_edges; ++i) {
+            edge = netloc_dt_edge_t_construct();
+            netloc_dt_edge_t_copy(src_node->edges[i], edge);
+            ret = netloc_dc_append_edge_to_node(dc_handle, node, edge);
+            netloc_dt_edge_t_destruct(edge);
+            if( NETLOC_SUCCESS != ret ) {
+                fprintf(stderr, "Error: netloc_dc_append_edge_to_node returned %d\n", ret);
+                return ret;
+            }
+        }
+    }
+
+    /*
+     * Every hop of a logical path, past the first one, is a forwarding
+     * decision of a switch towards the destination
+     */
+    hti_dest = netloc_dt_lookup_table_iterator_t_construct( nodes );
+    netloc_lookup_table_iterator_reset(hti_src);
+    while( !netloc_lookup_table_iterator_at_end(hti_src) ) {
+        src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
+        if( NULL == src_node ) {
+            break;
+        }
+
+        netloc_lookup_table_iterator_reset(hti_dest);
+        while( !netloc_lookup_table_iterator_at_end(hti_dest) ) {
+            dest_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_dest);
+            if( NULL == dest_node ) {
+                break;
+            }
+
+            ret = netloc_get_path(topology, src_node, dest_node, &num_edges, &edges, true);
+            if( NETLOC_SUCCESS != ret ) {
+                continue;
+            }
+
+            for(j = 1; j < num_edges; ++j) {
+                for(k = 0; edges[j]->src_node->edges[k] != edges[j]; ++k) {
+                    ;
+                }
+                node = netloc_dc_get_node_by_physical_id(dc_handle, edges[j]->src_node_id);
+
+                ret = netloc_dc_append_forwarding_entry(dc_handle, node->physical_id,
+                                                        dest_node->logical_id, node->edges[k]);
+                if( NETLOC_SUCCESS != ret ) {
+                    fprintf(stderr, "Error: netloc_dc_append_forwarding_entry returned %d\n", ret);
+                    return ret;
+                }
+            }
+        }
+    }
+    netloc_dt_lookup_table_iterator_t_destruct(hti_dest);
+    netloc_dt_lookup_table_iterator_t_destruct(hti_src);
+    netloc_lookup_table_destroy(nodes);
+    free(nodes);
+
+    ret = netloc_dc_close(dc_handle);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_dc_close returned %d\n", ret);
+        return ret;
+    }
+    netloc_dt_data_collection_handle_t_destruct(dc_handle);
+
+    return NETLOC_SUCCESS;
+}
+
+int check_topology(netloc_topology_t orig_topology, netloc_network_t *network, bool mapped)
+{
+    int ret, exit_status;
+    netloc_topology_t topology;
+
+    if( mapped ) {
+        ret = netloc_attach_mapped(&topology, *network);
+    } else {
+        ret = netloc_attach(&topology, *network);
+    }
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_attach returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    exit_status = compare_logical_paths(orig_topology, topology);
+
+    ret = netloc_detach(topology);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_detach returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    return exit_status;
+}
+
+/*
+ * Copy out the path of every pair of hosts through a cache much smaller than
+ * the number of pairs, and check that the paths obtained before the others
+ * evicted them from the cache are still intact
+ */
+int check_path_copies(netloc_topology_t orig_topology, netloc_network_t *network)
+{
+    int ret, i, exit_status = NETLOC_SUCCESS;
+    netloc_topology_t topology;
+    netloc_dt_lookup_table_t nodes = NULL;
+    netloc_dt_lookup_table_iterator_t hti_src = NULL;
+    netloc_dt_lookup_table_iterator_t hti_dest = NULL;
+    netloc_node_t *src_node = NULL;
+    netloc_node_t *dest_node = NULL;
+    netloc_node_t *first_src = NULL;
+    netloc_node_t *first_dest = NULL;
+    int num_edges, first_num_edges = 0, pinned_num_edges = 0;
+    netloc_edge_t **edges = NULL;
+    netloc_edge_t **first_edges = NULL;
+    netloc_edge_t **pinned_edges = NULL;
+    netloc_edge_t **pinned_copy = NULL;
+    int num_paths = 0;
+
+    ret = netloc_attach(&topology, *network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_attach returned an error (%d)\n", ret);
+        return ret;
+    }
+    topology->path_cache_size = 4;
+
+    ret = netloc_get_all_host_nodes(topology, &nodes);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_all_host_nodes returned %d\n", ret);
+        netloc_detach(topology);
+        return ret;
+    }
+
+    hti_src = netloc_dt_lookup_table_iterator_t_construct( nodes );
+    hti_dest = netloc_dt_lookup_table_iterator_t_construct( nodes );
+    while( NETLOC_SUCCESS == exit_status && !netloc_lookup_table_iterator_at_end(hti_src) ) {
+        src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
+        if( NULL == src_node ) {
+            break;
+        }
+
+        netloc_lookup_table_iterator_reset(hti_dest);
+        while( !netloc_lookup_table_iterator_at_end(hti_dest) ) {
+            dest_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_dest);
+            if( NULL == dest_node ) {
+                break;
+            }
+
+            ret = netloc_get_path_copy(topology, src_node, dest_node, &num_edges, &edges, true);
+            if( NETLOC_ERROR_NOT_FOUND == ret ) {
+                continue;
+            }
+            if( NETLOC_SUCCESS != ret ) {
+                fprintf(stderr, "Error: get_path_copy returned %d\n", ret);
+                exit_status = NETLOC_ERROR;
+                break;
+            }
+            if( NULL != edges[num_edges] ) {
+                fprintf(stderr, "Error: Path copy is not NULL terminated\n");
+                free(edges);
+                exit_status = NETLOC_ERROR;
+                break;
+            }
+
+            /*
+             * Keep the first copy. The second path is also handed out by
+             * netloc_get_path, which must stay valid until detach.
+             */
+            if( NULL == first_edges ) {
+                first_src = src_node;
+                first_dest = dest_node;
+                first_edges = edges;
+                first_num_edges = num_edges;
+            }
+            else {
+                if( NULL == pinned_edges ) {
+                    ret = netloc_get_path(topology, src_node, dest_node, &pinned_num_edges, &pinned_edges, true);
+                    if( NETLOC_SUCCESS != ret || pinned_num_edges != num_edges || pinned_edges == edges ||
+                        0 != memcmp(pinned_edges, edges, sizeof(netloc_edge_t*) * (num_edges + 1)) ) {
+                        fprintf(stderr, "Error: get_path and get_path_copy disagree (%d)\n", ret);
+                        free(edges);
+                        exit_status = NETLOC_ERROR;
+                        break;
+                    }
+                    pinned_copy = edges;
+                }
+                else {
+                    free(edges);
+                }
+            }
+            edges = NULL;
+
+            ++num_paths;
+        }
+    }
+    netloc_dt_lookup_table_iterator_t_destruct(hti_dest);
+    netloc_dt_lookup_table_iterator_t_destruct(hti_src);
+    netloc_lookup_table_destroy(nodes);
+    free(nodes);
+
+    if( NETLOC_SUCCESS == exit_status && num_paths <= 2 * topology->path_cache_size ) {
+        fprintf(stderr, "Error: Only %d paths for a cache of %d\n", num_paths, topology->path_cache_size);
+        exit_status = NETLOC_ERROR;
+    }
+
+    /*
+     * The first copy matches the original path, and so does the path handed
+     * out before it was evicted
+     */
+    if( NETLOC_SUCCESS == exit_status ) {
+        ret = netloc_get_path(orig_topology,
+                              netloc_get_node_by_physical_id(orig_topology, first_src->physical_id),
+                              netloc_get_node_by_physical_id(orig_topology, first_dest->physical_id),
+                              &num_edges, &edges, true);
+        if( NETLOC_SUCCESS != ret || num_edges != first_num_edges ) {
+            fprintf(stderr, "Error: First path copy of %d edges instead of %d\n", first_num_edges, num_edges);
+            exit_status = NETLOC_ERROR;
+        }
+        for(i = 0; NETLOC_SUCCESS == exit_status && i < num_edges; ++i) {
+            if( !same_edge(first_edges[i], edges[i]) ) {
+                fprintf(stderr, "Error: Edge %d of the first path copy is %s instead of %s\n", i,
+                        netloc_pretty_print_edge_t(first_edges[i]),
+                        netloc_pretty_print_edge_t(edges[i]));
+                exit_status = NETLOC_ERROR;
+            }
+        }
+    }
+    if( NETLOC_SUCCESS == exit_status &&
+        (NULL == pinned_edges ||
+         0 != memcmp(pinned_edges, pinned_copy, sizeof(netloc_edge_t*) * (pinned_num_edges + 1))) ) {
+        fprintf(stderr, "Error: The path from get_path changed after copying out the others\n");
+        exit_status = NETLOC_ERROR;
+    }
+
+    /*
+     * Evicted since, the first path is expanded anew
+     */
+    if( NETLOC_SUCCESS == exit_status ) {
+        ret = netloc_get_path_copy(topology, first_src, first_dest, &num_edges, &edges, true);
+        if( NETLOC_SUCCESS != ret || num_edges != first_num_edges ||
+            0 != memcmp(edges, first_edges, sizeof(netloc_edge_t*) * (num_edges + 1)) ) {
+            fprintf(stderr, "Error: Path copy differs when requested again\n");
+            exit_status = NETLOC_ERROR;
+        }
+        free(edges);
+    }
+
+    free(first_edges);
+    free(pinned_copy);
+
+    ret = netloc_detach(topology);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_detach returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    return exit_status;
+}
+
+int compare_logical_paths(netloc_topology_t orig_topology, netloc_topology_t topology)
+{
+    int ret, i;
+    netloc_dt_lookup_table_t nodes = NULL;
+    netloc_dt_lookup_table_iterator_t hti_src = NULL;
+    netloc_dt_lookup_table_iterator_t hti_dest = NULL;
+    netloc_node_t *src_node = NULL;
+    netloc_node_t *dest_node = NULL;
+    netloc_node_t *orig_src_node = NULL;
+    netloc_node_t *orig_dest_node = NULL;
+    int num_edges, orig_num_edges, cached_num_edges;
+    netloc_edge_t **edges = NULL;
+    netloc_edge_t **orig_edges = NULL;
+    netloc_edge_t **cached_edges = NULL;
+    netloc_edge_t **first_edges = NULL;
+    netloc_edge_t **first_copy = NULL;
+    int first_num_edges = 0;
+    int num_paths = 0;
+
+    ret = netloc_get_all_host_nodes(topology, &nodes);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_all_host_nodes returned %d\n", ret);
+        return ret;
+    }
+
+    hti_src = netloc_dt_lookup_table_iterator_t_construct( nodes );
+    hti_dest = netloc_dt_lookup_table_iterator_t_construct( nodes );
+    while( !netloc_lookup_table_iterator_at_end(hti_src) ) {
+        src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
+        if( NULL == src_node ) {
+            break;
+        }
+        orig_src_node = netloc_get_node_by_physical_id(orig_topology, src_node->physical_id);
+
+        netloc_lookup_table_iterator_reset(hti_dest);
+        while( !netloc_lookup_table_iterator_at_end(hti_dest) ) {
+            dest_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_dest);
+            if( NULL == dest_node ) {
+                break;
+            }
+            orig_dest_node = netloc_get_node_by_physical_id(orig_topology, dest_node->physical_id);
+
+            ret = netloc_get_path(orig_topology, orig_src_node, orig_dest_node, &orig_num_edges, &orig_edges, true);
+            if( NETLOC_SUCCESS != ret ) {
+                continue;
+            }
+
+            ret = netloc_get_path(topology, src_node, dest_node, &num_edges, &edges, true);
+            if( NETLOC_SUCCESS != ret ) {
+                fprintf(stderr, "Error: get_logical_path returned %d\nError: Src  node %s\nError: Dest node %s\n",
+                        ret,
+                        netloc_pretty_print_node_t(src_node),
+                        netloc_pretty_print_node_t(dest_node));
+                return NETLOC_ERROR;
+            }
+
+            if( num_edges != orig_num_edges ) {
+                fprintf(stderr, "Error: Path of %d edges instead of %d\n", num_edges, orig_num_edges);
+                return NETLOC_ERROR;
+            }
+            for(i = 0; i < num_edges; ++i) {
+                if( !same_edge(edges[i], orig_edges[i]) ) {
+                    fprintf(stderr, "Error: Edge %d of the path is %s instead of %s\n", i,
+                            netloc_pretty_print_edge_t(edges[i]),
+                            netloc_pretty_print_edge_t(orig_edges[i]));
+                    return NETLOC_ERROR;
+                }
+            }
+            if( NULL != edges[num_edges] ) {
+                fprintf(stderr, "Error: Path is not NULL terminated\n");
+                return NETLOC_ERROR;
+            }
+
+            /*
+             * A second request is served from the path cache
+             */
+            ret = netloc_get_path(topology, src_node, dest_node, &cached_num_edges, &cached_edges, true);
+            if( NETLOC_SUCCESS != ret || cached_num_edges != num_edges || cached_edges != edges ) {
+                fprintf(stderr, "Error: Path not served from the cache\n");
+                return NETLOC_ERROR;
+            }
+
+            if( NULL == first_edges ) {
+                first_edges = edges;
+                first_num_edges = num_edges;
+                first_copy = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * (num_edges + 1));
+                memcpy(first_copy, edges, sizeof(netloc_edge_t*) * (num_edges + 1));
+            }
+
+            ++num_paths;
+        }
+    }
+    netloc_dt_lookup_table_iterator_t_destruct(hti_dest);
+    netloc_dt_lookup_table_iterator_t_destruct(hti_src);
+    netloc_lookup_table_destroy(nodes);
+    free(nodes);
+
+    if( 0 == num_paths ) {
+        fprintf(stderr, "Error: No logical path to compare\n");
+        return NETLOC_ERROR;
+    }
+
+    /*
+     * The first path is still valid after expanding all of the others
+     */
+    ret = memcmp(first_edges, first_copy, sizeof(netloc_edge_t*) * (first_num_edges + 1));
+    free(first_copy);
+    if( 0 != ret ) {
+        fprintf(stderr, "Error: The first path changed after expanding the others\n");
+        return NETLOC_ERROR;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+bool same_edge(netloc_edge_t *a, netloc_edge_t *b)
+{
+    return (0 == strcmp(a->src_node_id, b->src_node_id) &&
+            0 == strcmp(a->src_port_id, b->src_port_id) &&
+            0 == strcmp(a->dest_node_id, b->dest_node_id) &&
+            0 == strcmp(a->dest_port_id, b->dest_port_id));
+}
@@ -61,6 +61,9 @@ int main(int argc, char *argv[])
     netloc_map_server_t server;
     hwloc_obj_t obj, obj2;
     netloc_map_port_t ports[3], port;
+    hwloc_obj_t hobjs[4];
+    netloc_map_port_t many_ports[4*3];
+    unsigned nrs[4];
     netloc_topology_t ntopos[3];
     netloc_node_t *nnodes[3];
     netloc_edge_t *nedges[3];
@@ -142,6 +145,32 @@ int main(int argc, char *argv[])
     printf("Found %d nodes under non-IO IB PCI dev parent\n", err);
     assert(err == 2);
 
+    hobjs[0] = NULL;
+    hobjs[1] = obj;
+    hobjs[2] = hwloc_get_obj_inside_cpuset_by_type(topo, obj->cpuset, HWLOC_OBJ_PU, 0);
+    hobjs[3] = obj2;
+    err = netloc_map_hwloc2port_many(map, topo, 4, hobjs, many_ports, 3, nrs);
+    printf("Found %u/%u/%u/%u nodes for all, non-IO parent, its first PU and another PCI dev\n",
+           nrs[0], nrs[1], nrs[2], nrs[3]);
+    assert(!err);
+    assert(nrs[0] == 2);
+    assert(nrs[1] == 2);
+    assert(nrs[2] == 2);
+    assert(nrs[3] == 0);
+    assert(many_ports[3] == many_ports[6]);
+
+    /* only room for one port per object, but all of them are counted */
+    err = netloc_map_hwloc2port_many(map, topo, 4, hobjs, many_ports, 1, nrs);
+    printf("Found %u/%u/%u/%u nodes with room for 1 each\n",
+           nrs[0], nrs[1], nrs[2], nrs[3]);
+    assert(!err);
+    assert(nrs[0] == 2);
+    assert(nrs[1] == 2);
+    assert(nrs[2] == 2);
+    assert(nrs[3] == 0);
+    assert(many_ports[1] == many_ports[2]);
+    assert(many_ports[0] == many_ports[1]);
+
     /* FIXME: check with edges too */
 
     err = netloc_map_put_hwloc(map, topo);
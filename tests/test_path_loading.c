@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2013-2014 University of Wisconsin-La Crosse.
+ *                         All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ * See COPYING in top-level directory.
+ *
+ * $HEADER$
+ */
+
+/*
+ * Reattach to a copy of the InfiniBand test data, read the paths from one
+ * source host, and check that they match the original data while the paths
+ * of the other nodes are left unloaded. From the JSON files first, then
+ * from the binary topology cache.
+ */
+#include "netloc.h"
+#include "private/netloc.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <dirent.h>
+
+/*
+ * Testing support functions
+ */
+int copy_file(const char *from_dir, const char *to_dir, const char *fname);
+int remove_dir(const char *dir);
+int check_lazy_loading(netloc_topology_t orig_topology, netloc_network_t *network, bool mapped);
+int compare_source_paths(netloc_topology_t orig_topology, netloc_topology_t topology,
+                         netloc_node_t *src_node, netloc_dt_lookup_table_t hosts, bool is_logical);
+int check_loaded_paths(netloc_topology_t topology, netloc_node_t *src_node);
+
+static const char *data_files[] = {
+    "IB-fe80:0000:0000:0000-nodes.ndat",
+    "IB-fe80:0000:0000:0000-phy-paths.ndat",
+    "IB-fe80:0000:0000:0000-log-paths.ndat",
+    NULL
+};
+
+
+int main(void) {
+    int ret, exit_status = NETLOC_SUCCESS;
+    int i;
+    netloc_topology_t orig_topology = NULL;
+    netloc_topology_t topology = NULL;
+    netloc_network_t *tmp_network = NULL;
+    netloc_network_t *network = NULL;
+    char *search_uri = NULL;
+    char outdir[] = "/tmp/netloc_test_path_loading.XXXXXX";
+
+    /*
+     * The original data, to check the paths against
+     */
+    tmp_network = netloc_dt_network_t_construct();
+    tmp_network->network_type = NETLOC_NETWORK_TYPE_INFINIBAND;
+    tmp_network->subnet_id    = strdup("fe80:0000:0000:0000");
+    search_uri = strdup("file://data/netloc");
+
+    ret = netloc_find_network(search_uri, tmp_network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_find_network returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    ret = netloc_attach(&orig_topology, *tmp_network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_attach returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    /*
+     * Work on a copy of the data, so that the binary cache is not left behind
+     */
+    if( NULL == mkdtemp(outdir) ) {
+        fprintf(stderr, "Error: Failed to create a temporary directory\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    for(i = 0; NULL != data_files[i]; ++i) {
+        if( 0 != copy_file("data/netloc", outdir, data_files[i]) ) {
+            fprintf(stderr, "Error: Failed to copy %s\n", data_files[i]);
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+    }
+
+    network = netloc_dt_network_t_construct();
+    network->network_type = NETLOC_NETWORK_TYPE_INFINIBAND;
+    network->subnet_id    = strdup("fe80:0000:0000:0000");
+    free(search_uri);
+    asprintf(&search_uri, "file://%s/", outdir);
+
+    ret = netloc_find_network(search_uri, network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_find_network returned an error (%d)\n", ret);
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    printf("Test lazy path loading (JSON): ");
+    fflush(NULL);
+    ret = check_lazy_loading(orig_topology, network, false);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+    printf("Success\n");
+
+    /*
+     * Writing the binary topology cache loads all of the paths
+     */
+    ret = netloc_attach(&topology, *network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_attach returned an error (%d)\n", ret);
+        exit_status = ret;
+        goto cleanup;
+    }
+    ret = netloc_topology_export_binary(topology, NULL);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_topology_export_binary returned %d\n", ret);
+        exit_status = ret;
+    }
+    ret = netloc_detach(topology);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_detach returned an error (%d)\n", ret);
+        exit_status = ret;
+    }
+    if( NETLOC_SUCCESS != exit_status ) {
+        goto cleanup;
+    }
+
+    printf("Test lazy path loading (binary): ");
+    fflush(NULL);
+    ret = check_lazy_loading(orig_topology, network, false);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+    printf("Success\n");
+
+    printf("Test lazy path loading (binary, mapped): ");
+    fflush(NULL);
+    ret = check_lazy_loading(orig_topology, network, true);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+    printf("Success\n");
+
+    /*
+     * Cleanup
+     */
+ cleanup:
+    ret = netloc_detach(orig_topology);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_detach returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    remove_dir(outdir);
+
+    netloc_dt_network_t_destruct(tmp_network);
+    if( NULL != network ) {
+        netloc_dt_network_t_destruct(network);
+    }
+    free(search_uri);
+
+    return exit_status;
+}
+
+/*
+ * Attach, read the physical and logical paths from one host to all of the
+ * others, and check that the other nodes did not get their paths loaded
+ */
+int check_lazy_loading(netloc_topology_t orig_topology, netloc_network_t *network, bool mapped)
+{
+    int ret, exit_status = NETLOC_SUCCESS;
+    netloc_topology_t topology;
+    netloc_dt_lookup_table_t hosts = NULL;
+    netloc_dt_lookup_table_iterator_t hti = NULL;
+    netloc_node_t *src_node = NULL;
+
+    if( mapped ) {
+        ret = netloc_attach_mapped(&topology, *network);
+    } else {
+        ret = netloc_attach(&topology, *network);
+    }
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_attach returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    ret = netloc_get_all_host_nodes(topology, &hosts);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_all_host_nodes returned %d\n", ret);
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    hti = netloc_dt_lookup_table_iterator_t_construct(hosts);
+    src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti);
+    netloc_dt_lookup_table_iterator_t_destruct(hti);
+    if( NULL == src_node ) {
+        fprintf(stderr, "Error: No host nodes\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    // Nothing is loaded until a path is asked for
+    ret = check_loaded_paths(topology, NULL);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    ret = compare_source_paths(orig_topology, topology, src_node, hosts, false);
+    if( NETLOC_SUCCESS == ret ) {
+        ret = compare_source_paths(orig_topology, topology, src_node, hosts, true);
+    }
+    if( NETLOC_SUCCESS == ret ) {
+        ret = check_loaded_paths(topology, src_node);
+    }
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+
+ cleanup:
+    if( NULL != hosts ) {
+        netloc_lookup_table_destroy(hosts);
+        free(hosts);
+    }
+
+    ret = netloc_detach(topology);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_detach returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    return exit_status;
+}
+
+/*
+ * The paths from src_node to every host must be the same, edge by edge, as
+ * the ones of the original topology
+ */
+int compare_source_paths(netloc_topology_t orig_topology, netloc_topology_t topology,
+                         netloc_node_t *src_node, netloc_dt_lookup_table_t hosts, bool is_logical)
+{
+    int ret, orig_ret, i;
+    int num_edges, orig_num_edges, num_paths = 0;
+    netloc_edge_t **edges = NULL;
+    netloc_edge_t **orig_edges = NULL;
+    netloc_dt_lookup_table_iterator_t hti = NULL;
+    netloc_node_t *dest_node = NULL;
+    netloc_node_t *orig_src_node = NULL;
+    netloc_node_t *orig_dest_node = NULL;
+
+    orig_src_node = netloc_get_node_by_physical_id(orig_topology, src_node->physical_id);
+
+    hti = netloc_dt_lookup_table_iterator_t_construct(hosts);
+    while( !netloc_lookup_table_iterator_at_end(hti) ) {
+        dest_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti);
+        if( NULL == dest_node ) {
+            break;
+        }
+        orig_dest_node = netloc_get_node_by_physical_id(orig_topology, dest_node->physical_id);
+
+        ret = netloc_get_path(topology, src_node, dest_node, &num_edges, &edges, is_logical);
+        orig_ret = netloc_get_path(orig_topology, orig_src_node, orig_dest_node,
+                                   &orig_num_edges, &orig_edges, is_logical);
+        if( ret != orig_ret ) {
+            fprintf(stderr, "Error: get_path to %s returned %d instead of %d\n",
+                    dest_node->physical_id, ret, orig_ret);
+            netloc_dt_lookup_table_iterator_t_destruct(hti);
+            return NETLOC_ERROR;
+        }
+        if( NETLOC_SUCCESS != ret ) {
+            continue;
+        }
+
+        if( num_edges != orig_num_edges ) {
+            fprintf(stderr, "Error: %s path to %s has %d edges instead of %d\n",
+                    (is_logical ? "Logical" : "Physical"), dest_node->physical_id,
+                    num_edges, orig_num_edges);
+            netloc_dt_lookup_table_iterator_t_destruct(hti);
+            return NETLOC_ERROR;
+        }
+        for(i = 0; i < num_edges; ++i) {
+            if( edges[i]->edge_uid != orig_edges[i]->edge_uid ) {
+                fprintf(stderr, "Error: %s path to %s differs at edge %d\n",
+                        (is_logical ? "Logical" : "Physical"), dest_node->physical_id, i);
+                netloc_dt_lookup_table_iterator_t_destruct(hti);
+                return NETLOC_ERROR;
+            }
+        }
+        if( num_edges > 0 ) {
+            num_paths++;
+        }
+    }
+    netloc_dt_lookup_table_iterator_t_destruct(hti);
+
+    if( 0 == num_paths ) {
+        fprintf(stderr, "Error: No %s paths from %s\n",
+                (is_logical ? "logical" : "physical"), src_node->physical_id);
+        return NETLOC_ERROR;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+/*
+ * Only the paths of src_node (none if NULL) may be loaded
+ */
+int check_loaded_paths(netloc_topology_t topology, netloc_node_t *src_node)
+{
+    int i;
+    netloc_node_t *node = NULL;
+
+    for(i = 0; i < topology->num_nodes; ++i) {
+        node = topology->nodes[i];
+        if( node == src_node ) {
+            continue;
+        }
+
+        if( 0 != netloc_lookup_table_size(node->physical_paths) ||
+            0 != netloc_lookup_table_size(node->logical_paths) ) {
+            fprintf(stderr, "Error: The paths of %s were loaded\n", node->physical_id);
+            return NETLOC_ERROR;
+        }
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+int copy_file(const char *from_dir, const char *to_dir, const char *fname)
+{
+    int ret = 0;
+    char *from = NULL;
+    char *to = NULL;
+    FILE *in = NULL;
+    FILE *out = NULL;
+    char buf[4096];
+    size_t len;
+
+    asprintf(&from, "%s/%s", from_dir, fname);
+    asprintf(&to, "%s/%s", to_dir, fname);
+
+    in = fopen(from, "r");
+    out = fopen(to, "w");
+    if( NULL == in || NULL == out ) {
+        ret = -1;
+    } else {
+        while( 0 < (len = fread(buf, 1, sizeof(buf), in)) ) {
+            if( len != fwrite(buf, 1, len, out) ) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    if( NULL != in ) {
+        fclose(in);
+    }
+    if( NULL != out && 0 != fclose(out) ) {
+        ret = -1;
+    }
+    free(from);
+    free(to);
+
+    return ret;
+}
+
+int remove_dir(const char *dir)
+{
+    DIR *dirp = NULL;
+    struct dirent *dp = NULL;
+    char *fname = NULL;
+
+    dirp = opendir(dir);
+    if( NULL == dirp ) {
+        return -1;
+    }
+    while( NULL != (dp = readdir(dirp)) ) {
+        if( 0 == strcmp(dp->d_name, ".") || 0 == strcmp(dp->d_name, "..") ) {
+            continue;
+        }
+        asprintf(&fname, "%s/%s", dir, dp->d_name);
+        unlink(fname);
+        free(fname);
+    }
+    closedir(dirp);
+
+    return rmdir(dir);
+}
@@ -0,0 +1,626 @@
+/*
+ * Copyright (c) 2013-2014 University of Wisconsin-La Crosse.
+ *                         All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ * See COPYING in top-level directory.
+ *
+ * $HEADER$
+ */
+
+/*
+ * Enumerate the equal-cost and the K shortest paths between the hosts of
+ * the InfiniBand test data, and check them against the stored physical
+ * paths, and against the weights of an edge weight function. The same
+ * weight function is then given to the pathfinder of a data collection.
+ */
+#include "netloc.h"
+#include "netloc_dc.h"
+#include "private/netloc.h"
+
+#include <stdlib.h>
+
+/*
+ * Number of paths asked for in the K shortest paths test
+ */
+#define TEST_K 4
+
+/*
+ * Number of source hosts to test (all of the destinations are tested)
+ */
+#define TEST_NUM_SOURCES 16
+
+/*
+ * Testing support functions
+ */
+int check_paths(netloc_topology_t topology, netloc_node_t *src_node, netloc_node_t *dest_node,
+                int num_paths, int *path_offsets, int *edge_uids);
+int test_pair(netloc_topology_t topology, netloc_node_t *src_node, netloc_node_t *dest_node,
+              int *num_ecmp_paths);
+int test_weighted_pair(netloc_topology_t topology, netloc_node_t *src_node, netloc_node_t *dest_node);
+int test_weight(netloc_edge_t *edge);
+long path_weight(netloc_topology_t topology, int *edge_uids, int num_edges);
+int test_dc_path_weight(netloc_topology_t topology, netloc_network_t *network,
+                        netloc_dt_lookup_table_t hosts);
+long check_dc_path(netloc_node_t *src_node, netloc_node_t *dest_node,
+                   int num_edges, netloc_edge_t **edges);
+
+
+int main(void) {
+    int ret, exit_status = NETLOC_SUCCESS;
+    netloc_topology_t topology;
+    netloc_network_t *tmp_network = NULL;
+    char *search_uri = NULL;
+    netloc_dt_lookup_table_t hosts = NULL;
+    netloc_dt_lookup_table_iterator_t hti_src = NULL;
+    netloc_dt_lookup_table_iterator_t hti_dest = NULL;
+    netloc_node_t *src_node = NULL;
+    netloc_node_t *dest_node = NULL;
+    int num_sources = 0, num_pairs = 0, num_multipath = 0, num_ecmp_paths;
+
+    /*
+     * Setup a Network connection
+     */
+    tmp_network = netloc_dt_network_t_construct();
+    tmp_network->network_type = NETLOC_NETWORK_TYPE_INFINIBAND;
+    tmp_network->subnet_id    = strdup("fe80:0000:0000:0000");
+    search_uri = strdup("file://data/netloc");
+
+    ret = netloc_find_network(search_uri, tmp_network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_find_network returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    ret = netloc_attach(&topology, *tmp_network);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_attach returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    ret = netloc_get_all_host_nodes(topology, &hosts);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_all_host_nodes returned %d\n", ret);
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    /*
+     * Every pair of hosts with a stored physical path (from the first few
+     * sources)
+     */
+    printf("Test get_paths: ");
+    fflush(NULL);
+
+    hti_src = netloc_dt_lookup_table_iterator_t_construct(hosts);
+    hti_dest = netloc_dt_lookup_table_iterator_t_construct(hosts);
+    while( !netloc_lookup_table_iterator_at_end(hti_src) && num_sources < TEST_NUM_SOURCES ) {
+        src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
+        if( NULL == src_node ) {
+            break;
+        }
+        num_sources++;
+
+        netloc_lookup_table_iterator_reset(hti_dest);
+        while( !netloc_lookup_table_iterator_at_end(hti_dest) ) {
+            dest_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_dest);
+            if( NULL == dest_node ) {
+                break;
+            }
+
+            ret = test_pair(topology, src_node, dest_node, &num_ecmp_paths);
+            if( NETLOC_ERROR_NOT_FOUND == ret ) {
+                continue;
+            }
+            if( NETLOC_SUCCESS == ret ) {
+                ret = test_weighted_pair(topology, src_node, dest_node);
+            }
+            if( NETLOC_SUCCESS != ret ) {
+                fprintf(stderr, "Error: Paths from %s to %s failed the checks\n",
+                        src_node->physical_id, dest_node->physical_id);
+                exit_status = ret;
+                goto cleanup;
+            }
+
+            num_pairs++;
+            if( num_ecmp_paths > 1 ) {
+                num_multipath++;
+            }
+        }
+    }
+
+    if( 0 == num_pairs ) {
+        fprintf(stderr, "Error: No host pairs with a physical path\n");
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    printf("Success (%d pairs, %d with several equal-cost paths)\n", num_pairs, num_multipath);
+
+    /*
+     * The paths computed by a data collection follow its weight function
+     */
+    printf("Test dc_set_path_weight: ");
+    fflush(NULL);
+    ret = test_dc_path_weight(topology, tmp_network, hosts);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    /*
+     * Cleanup
+     */
+ cleanup:
+    if( NULL != hti_src ) {
+        netloc_dt_lookup_table_iterator_t_destruct(hti_src);
+    }
+    if( NULL != hti_dest ) {
+        netloc_dt_lookup_table_iterator_t_destruct(hti_dest);
+    }
+    if( NULL != hosts ) {
+        netloc_lookup_table_destroy(hosts);
+        free(hosts);
+    }
+
+    ret = netloc_detach(topology);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: netloc_detach returned an error (%d)\n", ret);
+        return ret;
+    }
+
+    netloc_dt_network_t_destruct(tmp_network);
+    free(search_uri);
+
+    return exit_status;
+}
+
+int test_pair(netloc_topology_t topology, netloc_node_t *src_node, netloc_node_t *dest_node,
+              int *num_ecmp_paths)
+{
+    int ret, exit_status = NETLOC_SUCCESS;
+    int i, num_edges = 0;
+    netloc_edge_t **path = NULL;
+    int num_paths = 0;
+    int *path_offsets = NULL;
+    int *edge_uids = NULL;
+
+    (*num_ecmp_paths) = 0;
+
+    ret = netloc_get_path(topology, src_node, dest_node, &num_edges, &path, false);
+    if( NETLOC_SUCCESS != ret || 0 == num_edges ) {
+        return NETLOC_ERROR_NOT_FOUND;
+    }
+
+    /*
+     * All of the equal-cost paths are as long as the stored path
+     */
+    ret = netloc_get_paths(topology, src_node, dest_node, 0, NETLOC_PATHS_FLAG_EQUAL_COST, NULL,
+                           &num_paths, &path_offsets, &edge_uids);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_paths (equal cost) returned %d\n", ret);
+        return ret;
+    }
+
+    ret = check_paths(topology, src_node, dest_node, num_paths, path_offsets, edge_uids);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    for(i = 0; i < num_paths; ++i) {
+        if( path_offsets[i+1] - path_offsets[i] != num_edges ) {
+            fprintf(stderr, "Error: Equal-cost path %d has %d edges instead of %d\n",
+                    i, path_offsets[i+1] - path_offsets[i], num_edges);
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+    }
+    (*num_ecmp_paths) = num_paths;
+
+    free(path_offsets);
+    free(edge_uids);
+    path_offsets = NULL;
+    edge_uids = NULL;
+
+    /*
+     * The K shortest paths start with the shortest ones, and are only
+     * longer once the equal-cost paths run out
+     */
+    ret = netloc_get_paths(topology, src_node, dest_node, TEST_K, 0, NULL,
+                           &num_paths, &path_offsets, &edge_uids);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_paths (K shortest) returned %d\n", ret);
+        return ret;
+    }
+
+    ret = check_paths(topology, src_node, dest_node, num_paths, path_offsets, edge_uids);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    if( num_paths > TEST_K ) {
+        fprintf(stderr, "Error: Asked for %d paths, got %d\n", TEST_K, num_paths);
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+
+    for(i = 0; i < num_paths; ++i) {
+        if( (i <  (*num_ecmp_paths) && path_offsets[i+1] - path_offsets[i] != num_edges) ||
+            (i >= (*num_ecmp_paths) && path_offsets[i+1] - path_offsets[i] <= num_edges) ) {
+            fprintf(stderr, "Error: Path %d of the K shortest has %d edges (shortest %d, %d equal-cost)\n",
+                    i, path_offsets[i+1] - path_offsets[i], num_edges, (*num_ecmp_paths));
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+    }
+
+ cleanup:
+    free(path_offsets);
+    free(edge_uids);
+
+    return exit_status;
+}
+
+/*
+ * With an edge weight, the equal-cost paths are the lightest ones, and the
+ * K shortest paths come lightest first
+ */
+int test_weighted_pair(netloc_topology_t topology, netloc_node_t *src_node, netloc_node_t *dest_node)
+{
+    int ret, exit_status = NETLOC_SUCCESS;
+    int i;
+    long weight, min_weight = 0, prev_weight;
+    int num_paths = 0;
+    int *path_offsets = NULL;
+    int *edge_uids = NULL;
+
+    ret = netloc_get_paths(topology, src_node, dest_node, 0, NETLOC_PATHS_FLAG_EQUAL_COST, test_weight,
+                           &num_paths, &path_offsets, &edge_uids);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_paths (weighted, equal cost) returned %d\n", ret);
+        return ret;
+    }
+
+    ret = check_paths(topology, src_node, dest_node, num_paths, path_offsets, edge_uids);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    min_weight = path_weight(topology, edge_uids, path_offsets[1]);
+    for(i = 1; i < num_paths; ++i) {
+        weight = path_weight(topology, &edge_uids[path_offsets[i]], path_offsets[i+1] - path_offsets[i]);
+        if( weight != min_weight ) {
+            fprintf(stderr, "Error: Weighted equal-cost path %d weighs %ld instead of %ld\n",
+                    i, weight, min_weight);
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+    }
+
+    free(path_offsets);
+    free(edge_uids);
+    path_offsets = NULL;
+    edge_uids = NULL;
+
+    ret = netloc_get_paths(topology, src_node, dest_node, TEST_K, 0, test_weight,
+                           &num_paths, &path_offsets, &edge_uids);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_paths (weighted, K shortest) returned %d\n", ret);
+        return ret;
+    }
+
+    ret = check_paths(topology, src_node, dest_node, num_paths, path_offsets, edge_uids);
+    if( NETLOC_SUCCESS != ret ) {
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    prev_weight = min_weight;
+    for(i = 0; i < num_paths; ++i) {
+        weight = path_weight(topology, &edge_uids[path_offsets[i]], path_offsets[i+1] - path_offsets[i]);
+        if( (0 == i && weight != min_weight) || weight < prev_weight ) {
+            fprintf(stderr, "Error: Path %d of the weighted K shortest weighs %ld (lightest %ld, previous %ld)\n",
+                    i, weight, min_weight, prev_weight);
+            exit_status = NETLOC_ERROR;
+            goto cleanup;
+        }
+        prev_weight = weight;
+    }
+
+ cleanup:
+    free(path_offsets);
+    free(edge_uids);
+
+    return exit_status;
+}
+
+/*
+ * Uneven edge weights, so that the lightest paths are not simply the
+ * shortest ones
+ */
+int test_weight(netloc_edge_t *edge)
+{
+    return 1 + (edge->edge_uid % 5);
+}
+
+long path_weight(netloc_topology_t topology, int *edge_uids, int num_edges)
+{
+    int i;
+    long weight = 0;
+
+    for(i = 0; i < num_edges; ++i) {
+        weight += test_weight(netloc_get_edge_by_uid(topology, edge_uids[i]));
+    }
+
+    return weight;
+}
+
+/*
+ * Every path must lead from the source to the destination without going
+ * through a node twice, and no path may be returned twice
+ */
+int check_paths(netloc_topology_t topology, netloc_node_t *src_node, netloc_node_t *dest_node,
+                int num_paths, int *path_offsets, int *edge_uids)
+{
+    int i, j, e, len;
+    netloc_edge_t *edge = NULL;
+    netloc_node_t *cur_node = NULL;
+
+    if( num_paths <= 0 || 0 != path_offsets[0] ) {
+        fprintf(stderr, "Error: No paths returned\n");
+        return NETLOC_ERROR;
+    }
+
+    for(i = 0; i < num_paths; ++i) {
+        cur_node = src_node;
+        for(e = path_offsets[i]; e < path_offsets[i+1]; ++e) {
+            edge = netloc_get_edge_by_uid(topology, edge_uids[e]);
+            if( NULL == edge || edge->src_node != cur_node ) {
+                fprintf(stderr, "Error: Path %d is broken at edge %d\n", i, e - path_offsets[i]);
+                return NETLOC_ERROR;
+            }
+            cur_node = edge->dest_node;
+
+            // Loop-free: no later edge leaves the node again
+            for(j = e + 1; j < path_offsets[i+1]; ++j) {
+                if( netloc_get_edge_by_uid(topology, edge_uids[j])->src_node == edge->src_node ) {
+                    fprintf(stderr, "Error: Path %d loops through %s\n", i, edge->src_node->physical_id);
+                    return NETLOC_ERROR;
+                }
+            }
+        }
+        if( cur_node != dest_node ) {
+            fprintf(stderr, "Error: Path %d does not reach the destination\n", i);
+            return NETLOC_ERROR;
+        }
+
+        len = path_offsets[i+1] - path_offsets[i];
+        for(j = 0; j < i; ++j) {
+            if( path_offsets[j+1] - path_offsets[j] == len &&
+                0 == memcmp(&edge_uids[path_offsets[i]], &edge_uids[path_offsets[j]], sizeof(int) * len) ) {
+                fprintf(stderr, "Error: Paths %d and %d are the same\n", j, i);
+                return NETLOC_ERROR;
+            }
+        }
+    }
+
+    return NETLOC_SUCCESS;
+}
+
+/*
+ * Copy the topology into a data collection, and compute the paths between
+ * the hosts with the default (hop count) and with the test edge weights.
+ * The weighted path may be longer, but never heavier, than the hop count
+ * path, and must be lighter for some of the pairs.
+ */
+int test_dc_path_weight(netloc_topology_t topology, netloc_network_t *network,
+                        netloc_dt_lookup_table_t hosts)
+{
+    int ret, exit_status = NETLOC_SUCCESS;
+    int i, num_sources = 0, num_pairs = 0, num_lighter = 0;
+    netloc_data_collection_handle_t *dc_handle = NULL;
+    netloc_dt_lookup_table_t nodes = NULL;
+    netloc_dt_lookup_table_iterator_t hti_src = NULL;
+    netloc_dt_lookup_table_iterator_t hti_dest = NULL;
+    netloc_node_t *src_node = NULL;
+    netloc_node_t *dest_node = NULL;
+    netloc_node_t *node = NULL;
+    netloc_edge_t *edge = NULL;
+    int num_hop_edges = 0, num_weighted_edges = 0;
+    netloc_edge_t **hop_edges = NULL;
+    netloc_edge_t **weighted_edges = NULL;
+    long hop_weight, weighted_weight;
+
+    dc_handle = netloc_dc_create(network, NULL);
+    if( NULL == dc_handle ) {
+        fprintf(stderr, "Error: netloc_dc_create failed\n");
+        return NETLOC_ERROR;
+    }
+
+    ret = netloc_get_all_nodes(topology, &nodes);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: get_all_nodes returned %d\n", ret);
+        exit_status = ret;
+        goto cleanup;
+    }
+
+    /*
+     * Copy the nodes, then their edges
+     */
+    hti_src = netloc_dt_lookup_table_iterator_t_construct(nodes);
+    while( !netloc_lookup_table_iterator_at_end(hti_src) ) {
+        src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
+        if( NULL == src_node ) {
+            break;
+        }
+
+        node = netloc_dt_node_t_construct();
+        node->network_type = src_node->network_type;
+        node->node_type    = src_node->node_type;
+        node->physical_id  = strdup(src_node->physical_id);
+
+        ret = netloc_dc_append_node(dc_handle, node);
+        netloc_dt_node_t_destruct(node);
+        if( NETLOC_SUCCESS != ret ) {
+            fprintf(stderr, "Error: netloc_dc_append_node returned %d\n", ret);
+            exit_status = ret;
+            goto cleanup;
+        }
+    }
+
+    netloc_lookup_table_iterator_reset(hti_src);
+    while( !netloc_lookup_table_iterator_at_end(hti_src) ) {
+        src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
+        if( NULL == src_node ) {
+            break;
+        }
+
+        node = netloc_dc_get_node_by_physical_id(dc_handle, src_node->physical_id);
+        for(i = 0; i < src_node->num_edges; ++i) {
+            edge = netloc_dt_edge_t_construct();
+            netloc_dt_edge_t_copy(src_node->edges[i], edge);
+            ret = netloc_dc_append_edge_to_node(dc_handle, node, edge);
+            netloc_dt_edge_t_destruct(edge);
+            if( NETLOC_SUCCESS != ret ) {
+                fprintf(stderr, "Error: netloc_dc_append_edge_to_node returned %d\n", ret);
+                exit_status = ret;
+                goto cleanup;
+            }
+        }
+    }
+    netloc_dt_lookup_table_iterator_t_destruct(hti_src);
+    hti_src = NULL;
+
+    /*
+     * Host pairs (from the first few sources)
+     */
+    hti_src = netloc_dt_lookup_table_iterator_t_construct(hosts);
+    hti_dest = netloc_dt_lookup_table_iterator_t_construct(hosts);
+    while( !netloc_lookup_table_iterator_at_end(hti_src) && num_sources < TEST_NUM_SOURCES ) {
+        node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
+        if( NULL == node ) {
+            break;
+        }
+        src_node = netloc_dc_get_node_by_physical_id(dc_handle, node->physical_id);
+        num_sources++;
+
+        netloc_lookup_table_iterator_reset(hti_dest);
+        while( !netloc_lookup_table_iterator_at_end(hti_dest) ) {
+            node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_dest);
+            if( NULL == node ) {
+                break;
+            }
+            dest_node = netloc_dc_get_node_by_physical_id(dc_handle, node->physical_id);
+            if( src_node == dest_node ) {
+                continue;
+            }
+
+            netloc_dc_set_path_weight(dc_handle, NULL);
+            ret = netloc_dc_compute_path_between_nodes(dc_handle, src_node, dest_node,
+                                                       &num_hop_edges, &hop_edges, false);
+            if( NETLOC_ERROR_NOT_FOUND == ret ) {
+                continue;
+            }
+            if( NETLOC_SUCCESS != ret ) {
+                fprintf(stderr, "Error: dc_compute_path_between_nodes returned %d\n", ret);
+                exit_status = ret;
+                goto cleanup;
+            }
+
+            netloc_dc_set_path_weight(dc_handle, test_weight);
+            ret = netloc_dc_compute_path_between_nodes(dc_handle, src_node, dest_node,
+                                                       &num_weighted_edges, &weighted_edges, false);
+            if( NETLOC_SUCCESS != ret ) {
+                fprintf(stderr, "Error: dc_compute_path_between_nodes (weighted) returned %d\n", ret);
+                exit_status = ret;
+                goto cleanup;
+            }
+
+            hop_weight = check_dc_path(src_node, dest_node, num_hop_edges, hop_edges);
+            weighted_weight = check_dc_path(src_node, dest_node, num_weighted_edges, weighted_edges);
+            if( hop_weight < 0 || weighted_weight < 0 ) {
+                exit_status = NETLOC_ERROR;
+            }
+            else if( num_weighted_edges < num_hop_edges ) {
+                fprintf(stderr, "Error: Weighted path has %d edges, fewer than the %d of the hop count path\n",
+                        num_weighted_edges, num_hop_edges);
+                exit_status = NETLOC_ERROR;
+            }
+            else if( weighted_weight > hop_weight ) {
+                fprintf(stderr, "Error: Weighted path weighs %ld, more than the %ld of the hop count path\n",
+                        weighted_weight, hop_weight);
+                exit_status = NETLOC_ERROR;
+            }
+            if( NETLOC_SUCCESS != exit_status ) {
+                fprintf(stderr, "Error: Paths from %s to %s failed the checks\n",
+                        src_node->physical_id, dest_node->physical_id);
+                goto cleanup;
+            }
+
+            num_pairs++;
+            if( weighted_weight < hop_weight ) {
+                num_lighter++;
+            }
+
+            free(hop_edges);
+            free(weighted_edges);
+            hop_edges = NULL;
+            weighted_edges = NULL;
+        }
+    }
+
+    if( 0 == num_lighter ) {
+        fprintf(stderr, "Error: No weighted path is lighter than the hop count path (%d pairs)\n", num_pairs);
+        exit_status = NETLOC_ERROR;
+        goto cleanup;
+    }
+    printf("Success (%d pairs, %d on a lighter path than the fewest hops)\n", num_pairs, num_lighter);
+
+ cleanup:
+    free(hop_edges);
+    free(weighted_edges);
+    if( NULL != hti_src ) {
+        netloc_dt_lookup_table_iterator_t_destruct(hti_src);
+    }
+    if( NULL != hti_dest ) {
+        netloc_dt_lookup_table_iterator_t_destruct(hti_dest);
+    }
+    if( NULL != nodes ) {
+        netloc_lookup_table_destroy(nodes);
+        free(nodes);
+    }
+    netloc_dt_data_collection_handle_t_destruct(dc_handle);
+
+    return exit_status;
+}
+
+/*
+ * A path of a data collection must lead from the source to the destination.
+ * Returns its weight (test_weight), or -1 if it is broken.
+ */
+long check_dc_path(netloc_node_t *src_node, netloc_node_t *dest_node,
+                   int num_edges, netloc_edge_t **edges)
+{
+    int i;
+    long weight = 0;
+    const char *cur_id = src_node->physical_id;
+
+    for(i = 0; i < num_edges; ++i) {
+        if( 0 != strcmp(edges[i]->src_node_id, cur_id) ) {
+            fprintf(stderr, "Error: Path is broken at edge %d\n", i);
+            return -1;
+        }
+        cur_id = edges[i]->dest_node_id;
+        weight += test_weight(edges[i]);
+    }
+    if( 0 != strcmp(cur_id, dest_node->physical_id) ) {
+        fprintf(stderr, "Error: Path does not reach the destination\n");
+        return -1;
+    }
+
+    return weight;
+}
@@ -61,8 +61,8 @@ static bool full_output = false;
 /*
  * Valid Export types for graph data
  */
-static int num_valid_export_types = 3;
-const char * valid_export_types[3] = {"screen", "graphml", "gexf"};
+static int num_valid_export_types = 4;
+const char * valid_export_types[4] = {"screen", "graphml", "gexf", "binary"};
 
 /*
  * Selected export type
@@ -148,6 +148,13 @@ int main(int argc, char ** argv) {
 
             ret = netloc_topology_export_gexf(topology, filename);
         }
+        else if( 0 == strncmp("binary", export_type, strlen("binary")) ) {
+            printf("Network: %s\n", netloc_pretty_print_network_t(all_networks[i]) );
+            printf("\tCache file written next to the .ndat files\n");
+
+            // Written where netloc_attach will look for it
+            ret = netloc_topology_export_binary(topology, NULL);
+        }
 
         if( NETLOC_SUCCESS != ret ) {
             return ret;
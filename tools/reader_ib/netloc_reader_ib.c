@@ -41,6 +41,10 @@ const char * ARG_ROUTEDIR       = "--routedir";
 const char * ARG_SHORT_ROUTEDIR = "-r";
 const char * ARG_PROGRESS       = "--progress";
 const char * ARG_SHORT_PROGRESS = "-p";
+const char * ARG_THREADS        = "--threads";
+const char * ARG_SHORT_THREADS  = "-t";
+const char * ARG_WEIGHT         = "--weight";
+const char * ARG_SHORT_WEIGHT   = "-w";
 const char * ARG_HELP           = "--help";
 const char * ARG_SHORT_HELP     = "-h";
 
@@ -72,12 +76,6 @@ static int compute_physical_paths(netloc_data_collection_handle_t *dc_handle);
  */
 static int run_routes_parser();
 static int process_logical_paths(netloc_data_collection_handle_t *dc_handle);
-static int process_logical_paths_between_nodes(netloc_data_collection_handle_t *handle,
-                                               netloc_dt_lookup_table_t all_routes,
-                                               netloc_node_t *src_node,
-                                               netloc_node_t *dest_node,
-                                               int *num_edges,
-                                               netloc_edge_t ***edges);
 
 /*
  * Check the resulting .dat files
@@ -112,6 +110,17 @@ static char * dir_ibroutes = NULL;
  */
 static int progress = 0;
 
+/*
+ * Number of threads used to compute the physical paths
+ */
+static int num_threads = 1;
+
+/*
+ * Edge weight used to compute the physical paths
+ */
+static const char * weight_name = "hops";
+static netloc_dc_path_weight_fn_t path_weight = NULL;
+
 int main(int argc, char ** argv) {
     int ret, exit_status = NETLOC_SUCCESS;
     netloc_network_t *network = NULL;
@@ -121,16 +130,20 @@ int main(int argc, char ** argv) {
      * Parse Args
      */
     if( 0 != parse_args(argc, argv) ) {
-        printf("Usage: %s %s|%s <input file> [%s|%s <path to routing files>] [%s|%s <subnet id>] [%s|%s <output directory>] [%s|%s] [--help|-h]\n",
+        printf("Usage: %s %s|%s <input file> [%s|%s <path to routing files>] [%s|%s <subnet id>] [%s|%s <output directory>] [%s|%s] [%s|%s <number of threads>] [%s|%s hops|bandwidth|latency] [--help|-h]\n",
                argv[0],
                ARG_FILE, ARG_SHORT_FILE,
                ARG_ROUTEDIR, ARG_SHORT_ROUTEDIR,
                ARG_SUBNET, ARG_SHORT_SUBNET,
                ARG_OUTDIR, ARG_SHORT_OUTDIR,
-               ARG_PROGRESS, ARG_SHORT_PROGRESS);
+               ARG_PROGRESS, ARG_SHORT_PROGRESS,
+               ARG_THREADS, ARG_SHORT_THREADS,
+               ARG_WEIGHT, ARG_SHORT_WEIGHT);
         printf("       Default %-10s = none\n", ARG_ROUTEDIR);
         printf("       Default %-10s = \"unknown\"\n", ARG_SUBNET);
         printf("       Default %-10s = current working directory\n", ARG_OUTDIR);
+        printf("       Default %-10s = 1\n", ARG_THREADS);
+        printf("       Default %-10s = hops\n", ARG_WEIGHT);
         return NETLOC_ERROR;
     }
 
@@ -309,6 +322,47 @@ static int parse_args(int argc, char ** argv) {
                  0 == strncmp(ARG_SHORT_PROGRESS, argv[i], strlen(ARG_SHORT_PROGRESS)) ) {
             progress = 1;
         }
+        /*
+         * --threads
+         */
+        else if( 0 == strncmp(ARG_THREADS,       argv[i], strlen(ARG_THREADS)) ||
+                 0 == strncmp(ARG_SHORT_THREADS, argv[i], strlen(ARG_SHORT_THREADS)) ) {
+            ++i;
+            if( i >= argc ) {
+                fprintf(stderr, "Error: Must supply an argument to %s\n", ARG_THREADS );
+                return NETLOC_ERROR;
+            }
+            num_threads = atoi(argv[i]);
+            if( num_threads < 1 ) {
+                fprintf(stderr, "Error: %s must be at least 1 (given \"%s\")\n", ARG_THREADS, argv[i]);
+                return NETLOC_ERROR;
+            }
+        }
+        /*
+         * --weight
+         */
+        else if( 0 == strncmp(ARG_WEIGHT,       argv[i], strlen(ARG_WEIGHT)) ||
+                 0 == strncmp(ARG_SHORT_WEIGHT, argv[i], strlen(ARG_SHORT_WEIGHT)) ) {
+            ++i;
+            if( i >= argc ) {
+                fprintf(stderr, "Error: Must supply an argument to %s\n", ARG_WEIGHT );
+                return NETLOC_ERROR;
+            }
+            if( 0 == strcmp("hops", argv[i]) ) {
+                path_weight = netloc_dc_path_weight_hops;
+            }
+            else if( 0 == strcmp("bandwidth", argv[i]) ) {
+                path_weight = netloc_dc_path_weight_bandwidth;
+            }
+            else if( 0 == strcmp("latency", argv[i]) ) {
+                path_weight = netloc_dc_path_weight_latency;
+            }
+            else {
+                fprintf(stderr, "Error: Unknown %s \"%s\" (hops, bandwidth or latency)\n", ARG_WEIGHT, argv[i]);
+                return NETLOC_ERROR;
+            }
+            weight_name = argv[i];
+        }
         /*
          * Help
          */
@@ -373,6 +427,8 @@ static int parse_args(int argc, char ** argv) {
     printf("  Subnet             : %s\n", subnet);
     printf("  ibnetdiscover File : %s\n", file_ibnetdiscover);
     printf("  ibroutes Directory : %s\n", (NULL == dir_ibroutes || strlen(dir_ibroutes) <= 0 ? "None Specified" : dir_ibroutes) );
+    printf("  Threads            : %d\n", num_threads);
+    printf("  Path Weight        : %s\n", weight_name);
 
     return ret;
 }
@@ -453,131 +509,23 @@ static int convert_nodes_file(netloc_data_collection_handle_t *dc_handle)
 static int compute_physical_paths(netloc_data_collection_handle_t *dc_handle)
 {
     int ret;
-    int src_idx, dst_idx;
-
-    int num_edges = 0;
-    netloc_edge_t **edges = NULL;
-
-    netloc_dt_lookup_table_iterator_t hti_src = NULL;
-    netloc_dt_lookup_table_iterator_t hti_dst = NULL;
-    netloc_node_t *cur_src_node = NULL;
-    netloc_node_t *cur_dst_node = NULL;
-
-    int total_nodes;
-    double last_perc = 0;
 
     printf("Status: Computing Physical Paths\n");
 
-    /*
-     * Calculate the path from all sources to all destinations
-     */
-
-    total_nodes = netloc_lookup_table_size(dc_handle->node_list);
-    src_idx = 0;
-    hti_src = netloc_dt_lookup_table_iterator_t_construct(dc_handle->node_list);
-    hti_dst = netloc_dt_lookup_table_iterator_t_construct(dc_handle->node_list);
+    netloc_dc_set_path_weight(dc_handle, path_weight);
 
-    netloc_lookup_table_iterator_reset(hti_src);
-    while( !netloc_lookup_table_iterator_at_end(hti_src) ) {
-        cur_src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
-        if( NULL == cur_src_node ) {
-            break;
-        }
-
-        // JJH: For now limit to just the "host" nodes
-        if( NETLOC_NODE_TYPE_HOST != cur_src_node->node_type ) {
-            ++src_idx;
-            continue;
-        }
-
-        if( progress > 0 ) {
-            if( last_perc + 0.05 < src_idx / (double)total_nodes ) {
-                last_perc = src_idx / (double)total_nodes;
-                printf("\tProgress: %6.2f%% -- %4d of %4d\n", last_perc * 100, src_idx, total_nodes);
-            }
-        }
-
-#if 0
-        printf("\tSource:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-#endif
-
-        dst_idx = 0;
-        netloc_lookup_table_iterator_reset(hti_dst);
-        while( !netloc_lookup_table_iterator_at_end(hti_dst) ) {
-            cur_dst_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_dst);
-            if( NULL == cur_dst_node ) {
-                break;
-            }
-
-            // Skip path to self
-            if( src_idx == dst_idx ) {
-                ++dst_idx;
-                continue;
-            }
-
-            // JJH: For now limit to just the "host" nodes
-            if( NETLOC_NODE_TYPE_HOST != cur_dst_node->node_type ) {
-                ++dst_idx;
-                continue;
-            }
-
-#if 0
-            printf("Computing a path between the following two nodes\n");
-            printf("\tSource:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-            printf("\tDestination: %s\n", netloc_pretty_print_node_t(cur_dst_node));
-#endif
-            /*
-             * Calculate the path between these nodes
-             */
-            ret = netloc_dc_compute_path_between_nodes(dc_handle,
-                                                       cur_src_node,
-                                                       cur_dst_node,
-                                                       &num_edges,
-                                                       &edges,
-                                                       false);
-            if( NETLOC_SUCCESS != ret ) {
-                fprintf(stderr, "Error: Failed to compute a path between the following two nodes\n");
-                fprintf(stderr, "Error: Source:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-                fprintf(stderr, "Error: Destination: %s\n", netloc_pretty_print_node_t(cur_dst_node));
-                return ret;
-            }
-
-
-            /*
-             * Store that path in the data collection
-             */
-            ret = netloc_dc_append_path(dc_handle,
-                                        cur_src_node->physical_id,
-                                        cur_dst_node->physical_id,
-                                        num_edges,
-                                        edges,
-                                        false);
-            if( NETLOC_SUCCESS != ret ) {
-                fprintf(stderr, "Error: Could not append the physical path between the following two nodes\n");
-                fprintf(stderr, "Error: Source:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-                fprintf(stderr, "Error: Destination: %s\n", netloc_pretty_print_node_t(cur_dst_node));
-                return ret;
-            }
-
-            num_edges = 0;
-            free(edges);
-            edges = NULL;
-
-            ++dst_idx;
-        }
-
-        ++src_idx;
+    ret = netloc_dc_compute_all_host_paths(dc_handle, num_threads, progress > 0);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: Failed to compute the physical paths\n");
+        return ret;
     }
 
-    netloc_dt_lookup_table_iterator_t_destruct(hti_src);
-    netloc_dt_lookup_table_iterator_t_destruct(hti_dst);
-
     return NETLOC_SUCCESS;
 }
 
 static int process_logical_paths(netloc_data_collection_handle_t *dc_handle)
 {
-    int ret;
+    int ret, i;
     json_t *json = NULL;
 
     const char * key = NULL;
@@ -585,21 +533,9 @@ static int process_logical_paths(netloc_data_collection_handle_t *dc_handle)
     json_t * value = NULL;
     json_t * value2 = NULL;
 
-    netloc_dt_lookup_table_t all_routes = NULL;
-    netloc_dt_lookup_table_t tmp_routes = NULL;
-
-    netloc_dt_lookup_table_iterator_t hti = NULL;
-    netloc_dt_lookup_table_iterator_t hti2 = NULL;
-
-    netloc_dt_lookup_table_iterator_t hti_src = NULL;
-    netloc_dt_lookup_table_iterator_t hti_dst = NULL;
-    netloc_node_t *cur_src_node = NULL;
-    netloc_node_t *cur_dst_node = NULL;
-
-    char *out_port = NULL;
-    int src_idx, dst_idx;
-    int num_edges = 0;
-    netloc_edge_t **edges = NULL;
+    netloc_node_t *cur_node = NULL;
+    netloc_edge_t *cur_edge = NULL;
+    const char *out_port = NULL;
 
     printf("Status: Processing Logical Paths\n");
 
@@ -618,149 +554,53 @@ static int process_logical_paths(netloc_data_collection_handle_t *dc_handle)
     }
 
     /*
-     * Pull in the logical path 'hops' into memory
-     * Lookup Table[Key   = GUID of switch,
-     *              Value = Lookup Table[Key   = LID,
-     *                                   Value = Output Port
-     *                                   ]
-     *             ]
+     * Store the forwarding table of each switch, from which the logical paths
+     * are expanded on demand (instead of storing the path between every pair
+     * of hosts).
+     * JSON Object[Key   = GUID of switch,
+     *             Value = JSON Object[Key   = LID,
+     *                                 Value = Output Port
+     *                                 ]
+     *            ]
      */
-    all_routes = calloc(1, sizeof(*all_routes));
-    netloc_lookup_table_init(all_routes, 1, 0);
-
     json_object_foreach(json, key, value) {
-        //printf("Switch %s\n", key);
-        tmp_routes = calloc(1, sizeof(*tmp_routes));
-        netloc_lookup_table_init(tmp_routes, 1, 0);
-
-        json_object_foreach(value, key2, value2) {
-            //printf("\t%s \t %s\n", key2, json_string_value(value2));
-            netloc_lookup_table_append(tmp_routes, key2, strdup(json_string_value(value2)));
-        }
-
-        netloc_lookup_table_append(all_routes, key, tmp_routes);
-    }
-
-    /*
-     * Compute logical path between all 'host' node pairs
-     */
-    src_idx = 0;
-    hti_src = netloc_dt_lookup_table_iterator_t_construct(dc_handle->node_list);
-    hti_dst = netloc_dt_lookup_table_iterator_t_construct(dc_handle->node_list);
-
-    netloc_lookup_table_iterator_reset(hti_src);
-    while( !netloc_lookup_table_iterator_at_end(hti_src) ) {
-        cur_src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
-        if( NULL == cur_src_node ) {
-            break;
-        }
-
-        // JJH: For now limit to just the "host" nodes
-        if( NETLOC_NODE_TYPE_HOST != cur_src_node->node_type ) {
-            ++src_idx;
+        cur_node = netloc_dc_get_node_by_physical_id(dc_handle, (char*)key);
+        if( NULL == cur_node ) {
+            fprintf(stderr, "Warning: No node matching the routing information of switch %s\n", key);
             continue;
         }
 
-#if 0
-        printf("\tSource:      %s\n", netloc_pretty_print_node_t( cur_src_node ));
-#endif
-        dst_idx = 0;
-
-        netloc_lookup_table_iterator_reset(hti_dst);
-        while( !netloc_lookup_table_iterator_at_end(hti_dst) ) {
-            cur_dst_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_dst);
-            if( NULL == cur_dst_node ) {
-                break;
-            }
-
-            // Skip path to self
-            if( src_idx == dst_idx ) {
-                dst_idx++;
-                continue;
-            }
-
-            // JJH: For now limit to just the "host" nodes
-            if( NETLOC_NODE_TYPE_HOST != cur_dst_node->node_type ) {
-                dst_idx++;
+        json_object_foreach(value, key2, value2) {
+            out_port = json_string_value(value2);
+            if( NULL == out_port ) {
                 continue;
             }
 
-#if 0
-            printf("Computing a path between the following two nodes\n");
-            printf("\tSource:      %s\n", netloc_pretty_print_node_t( cur_src_node ));
-            printf("\tDestination: %s\n", netloc_pretty_print_node_t( cur_dst_node ));
-#endif
             /*
-             * Calculate the path between these nodes
+             * Find the edge on this switch that matches the output port
+             * (none for the LIDs of the switch itself, on port 0)
              */
-            ret = process_logical_paths_between_nodes(dc_handle,
-                                                      all_routes,
-                                                      cur_src_node,
-                                                      cur_dst_node,
-                                                      &num_edges,
-                                                      &edges);
-            if( NETLOC_SUCCESS != ret ) {
-                fprintf(stderr, "Error: Failed to compute a path between the following two nodes\n");
-                fprintf(stderr, "Error: Source:      %s\n", netloc_pretty_print_node_t( cur_src_node ));
-                fprintf(stderr, "Error: Destination: %s\n", netloc_pretty_print_node_t( cur_dst_node ));
-                return ret;
+            cur_edge = NULL;
+            for(i = 0; i < cur_node->num_edges; ++i) {
+                if( 0 == strcmp(cur_node->edges[i]->src_port_id, out_port) ) {
+                    cur_edge = cur_node->edges[i];
+                    break;
+                }
+            }
+            if( NULL == cur_edge ) {
+                continue;
             }
 
-
-            /*
-             * Store that path in the data collection
-             */
-            ret = netloc_dc_append_path(dc_handle,
-                                        cur_src_node->physical_id,
-                                        cur_dst_node->physical_id,
-                                        num_edges,
-                                        edges,
-                                        true);
+            ret = netloc_dc_append_forwarding_entry(dc_handle, cur_node->physical_id, key2, cur_edge);
             if( NETLOC_SUCCESS != ret ) {
-                fprintf(stderr, "Error: Could not append the logical path between the following two nodes\n");
-                fprintf(stderr, "Error: Source:      %s\n", netloc_pretty_print_node_t( cur_src_node ));
-                fprintf(stderr, "Error: Destination: %s\n", netloc_pretty_print_node_t( cur_dst_node ));
+                fprintf(stderr, "Error: Could not append the route to LID %s on node %s\n",
+                        key2, netloc_pretty_print_node_t(cur_node));
+                json_decref(json);
                 return ret;
             }
-
-            num_edges = 0;
-            free(edges);
-            edges = NULL;
-
-            dst_idx++;
         }
-
-        src_idx++;
     }
 
-    /*
-     * Cleanup
-     */
-    hti = netloc_dt_lookup_table_iterator_t_construct( all_routes );
-    while( !netloc_lookup_table_iterator_at_end(hti) ) {
-        key = netloc_lookup_table_iterator_next_key(hti);
-        if( NULL == key ) {
-            break;
-        }
-        tmp_routes = (netloc_dt_lookup_table_t)netloc_lookup_table_access(all_routes, key);
-
-        hti2 = netloc_dt_lookup_table_iterator_t_construct( tmp_routes );
-        while( !netloc_lookup_table_iterator_at_end(hti2) ) {
-            key2 = netloc_lookup_table_iterator_next_key(hti2);
-            if( NULL == key2 ) {
-                break;
-            }
-            out_port = (char *)netloc_lookup_table_access(tmp_routes, key2);
-            free(out_port);
-        }
-        netloc_dt_lookup_table_iterator_t_destruct(hti2);
-        netloc_lookup_table_destroy(tmp_routes);
-        free(tmp_routes);
-    }
-    netloc_dt_lookup_table_iterator_t_destruct(hti);
-    netloc_lookup_table_destroy(all_routes);
-    free(all_routes);
-
     /*
      * Remove the temporary prep file
      */
@@ -775,133 +615,9 @@ static int process_logical_paths(netloc_data_collection_handle_t *dc_handle)
         json = NULL;
     }
 
-    netloc_dt_lookup_table_iterator_t_destruct(hti_src);
-    netloc_dt_lookup_table_iterator_t_destruct(hti_dst);
-
     return 0;
 }
 
-static int process_logical_paths_between_nodes(netloc_data_collection_handle_t *handle,
-                                               netloc_dt_lookup_table_t all_routes,
-                                               netloc_node_t *src_node,
-                                               netloc_node_t *dest_node,
-                                               int *num_edges,
-                                               netloc_edge_t ***edges)
-{
-    int exit_status = NETLOC_SUCCESS;
-    netloc_node_t *cur_node = NULL;
-    netloc_edge_t *cur_edge = NULL;
-    netloc_dt_lookup_table_t cur_routes = NULL;
-    char * output_port = NULL;
-    int i, len;
-
-    if( src_node == dest_node ) {
-        fprintf(stderr, "Error: Source and Destination node are the same\n");
-        (*num_edges) = 0;
-        (*edges) = NULL;
-        return NETLOC_ERROR;
-    }
-
-    if( src_node->num_edges <= 0 ) {
-        fprintf(stderr, "Error: Source node has no edges\n");
-        (*num_edges) = 0;
-        (*edges) = NULL;
-        return NETLOC_ERROR;
-    }
-
-    if( dest_node->num_edges <= 0 ) {
-        fprintf(stderr, "Error: Destination node has no edges\n");
-        (*num_edges) = 0;
-        (*edges) = NULL;
-        return NETLOC_ERROR;
-    }
-
-    /*
-     * Access first edge from the src_node
-     * Since we assume that the src_node is a 'host' then it should only have one edge
-     */
-    (*num_edges) = 1;
-    (*edges) = (netloc_edge_t**)malloc(sizeof(netloc_edge_t*) * (*num_edges));
-    if( NULL == (*edges) ) {
-        fprintf(stderr, "Error: Failed to allocate memory for edge list (%d items)\n", (*num_edges));
-        return NETLOC_ERROR;
-    }
-
-    cur_edge = src_node->edges[0];
-    // Append to the edge list
-    (*edges)[(*num_edges)-1] = cur_edge;
-    cur_node = netloc_dc_get_node_by_physical_id(handle, cur_edge->dest_node_id);
-
-    /*
-     * While we have not reached the dest_node
-     */
-    while( cur_node != dest_node ) {
-        /*
-         * Get output port from this switch for the LID we are tracing
-         */
-        cur_routes = (netloc_dt_lookup_table_t)netloc_lookup_table_access(all_routes, cur_node->physical_id);
-        if( NULL == cur_routes ) {
-            fprintf(stderr, "Error: No routing information for node %s\n", netloc_pretty_print_node_t(cur_node));
-            exit_status = NETLOC_ERROR;
-            goto cleanup;
-        }
-
-        // Look for the destination LID at this hop, to get output port
-        output_port = (char*)netloc_lookup_table_access(cur_routes, dest_node->logical_id);
-        if( NULL == output_port ) {
-            fprintf(stderr, "Error: No output port associated with LID %s on node %s\n",
-                    dest_node->logical_id, netloc_pretty_print_node_t(cur_node));
-            exit_status = NETLOC_ERROR;
-            goto cleanup;
-        }
-
-
-        /*
-         * Find the edge on this switch that matches the output port
-         */
-        cur_edge = NULL;
-        for(i = 0; i < cur_node->num_edges; ++i) {
-            if( strlen(output_port) > strlen(cur_node->edges[i]->src_port_id) ) {
-                len = strlen(output_port);
-            }
-            else {
-                len = strlen(cur_node->edges[i]->src_port_id);
-            }
-            if( 0 == strncmp(cur_node->edges[i]->src_port_id, output_port, len) ) {
-                cur_edge = cur_node->edges[i];
-                break;
-            }
-        }
-
-        if( NULL == cur_edge ) {
-            fprintf(stderr, "Error: Could not find output port %s associated with LID %s on node %s\n",
-                    output_port, dest_node->logical_id, netloc_pretty_print_node_t(cur_node));
-            exit_status = NETLOC_ERROR;
-            goto cleanup;
-        }
-
-        /*
-         * Save this edge in our edge list
-         */
-        (*num_edges) += 1;
-        (*edges) = (netloc_edge_t**)realloc((*edges), sizeof(netloc_edge_t*) * (*num_edges));
-        if( NULL == (*edges) ) {
-            fprintf(stderr, "Error: Failed to allocate memory for edge list (%d items)\n", (*num_edges));
-            return NETLOC_ERROR;
-        }
-        (*edges)[(*num_edges)-1] = cur_edge;
-
-        /*
-         * Hop along this edge to the next node
-         */
-        cur_node = netloc_dc_get_node_by_physical_id(handle, cur_edge->dest_node_id);
-    }
-
- cleanup:
-
-    return exit_status;
-}
-
 static int check_dat_files() {
     int ret, exit_status = NETLOC_SUCCESS;
     char * spec = NULL;
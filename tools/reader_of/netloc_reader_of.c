@@ -42,6 +42,8 @@ const char * ARG_AUTH_USER        = "--username";
 const char * ARG_SHORT_AUTH_USER  = "-u";
 const char * ARG_AUTH_PASS        = "--password";
 const char * ARG_SHORT_AUTH_PASS  = "-p";
+const char * ARG_THREADS          = "--threads";
+const char * ARG_SHORT_THREADS    = "-t";
 const char * ARG_HELP             = "--help";
 const char * ARG_SHORT_HELP       = "-h";
 
@@ -92,6 +94,11 @@ static char * uri_address = NULL;
 static char * auth_username = NULL;
 static char * auth_password = NULL;
 
+/*
+ * Number of threads used to compute the physical paths
+ */
+static int num_threads = 1;
+
 /*
  * Valid controllers
  * The short names must match the corresponding perl script
@@ -123,7 +130,7 @@ int main(int argc, char ** argv) {
      * Parse Args
      */
     if( 0 != parse_args(argc, argv) ) {
-        printf("Usage: %s %s|%s <controller> [%s|%s <subnet id>] [%s|%s <output directory>] [%s|%s <URL Address:Port>] [%s|%s <username>] [%s|%s <password>] [%s|%s]\n",
+        printf("Usage: %s %s|%s <controller> [%s|%s <subnet id>] [%s|%s <output directory>] [%s|%s <URL Address:Port>] [%s|%s <username>] [%s|%s <password>] [%s|%s <number of threads>] [%s|%s]\n",
                argv[0],
                ARG_CONTROLLER, ARG_SHORT_CONTROLLER,
                ARG_SUBNET, ARG_SHORT_SUBNET,
@@ -131,10 +138,12 @@ int main(int argc, char ** argv) {
                ARG_ADDRESS, ARG_SHORT_ADDRESS,
                ARG_AUTH_USER, ARG_SHORT_AUTH_USER,
                ARG_AUTH_PASS, ARG_SHORT_AUTH_PASS,
+               ARG_THREADS, ARG_SHORT_THREADS,
                ARG_HELP, ARG_SHORT_HELP);
         printf("       Default %-10s = \"unknown\"\n", ARG_SUBNET);
         printf("       Default %-10s = \"127.0.0.1:8080\"\n", ARG_ADDRESS);
         printf("       Default %-10s = current working directory\n", ARG_OUTDIR);
+        printf("       Default %-10s = 1\n", ARG_THREADS);
         printf("       Valid Options for %s:\n", ARG_CONTROLLER );
         // Note: Hide 'noop' since it is only meant for debugging, and not for normal use
         for(i = 1; i < num_valid_controllers; ++i) {
@@ -319,6 +328,22 @@ static int parse_args(int argc, char ** argv) {
             }
             auth_password = strdup(argv[i]);
         }
+        /*
+         * --threads
+         */
+        else if( 0 == strncmp(ARG_THREADS,       argv[i], strlen(ARG_THREADS)) ||
+                 0 == strncmp(ARG_SHORT_THREADS, argv[i], strlen(ARG_SHORT_THREADS)) ) {
+            ++i;
+            if( i >= argc ) {
+                fprintf(stderr, "Error: Must supply an argument to %s\n", ARG_THREADS );
+                return NETLOC_ERROR;
+            }
+            num_threads = atoi(argv[i]);
+            if( num_threads < 1 ) {
+                fprintf(stderr, "Error: %s must be at least 1 (given \"%s\")\n", ARG_THREADS, argv[i]);
+                return NETLOC_ERROR;
+            }
+        }
         /*
          * Help
          */
@@ -410,6 +435,7 @@ static int parse_args(int argc, char ** argv) {
     printf("  Subnet           : %s\n", subnet);
     printf("  Controller       : %s\n", controller);
     printf("  Address:Port     : %s\n", uri_address);
+    printf("  Threads          : %d\n", num_threads);
     printf("  Username         : %s\n", (NULL == auth_username ? "<none>" : auth_username) );
 
     return ret;
@@ -487,112 +513,15 @@ static int convert_nodes_file(netloc_data_collection_handle_t *dc_handle)
 static int compute_physical_paths(netloc_data_collection_handle_t *dc_handle)
 {
     int ret;
-    int src_idx, dst_idx;
-
-    int num_edges = 0;
-    netloc_edge_t **edges = NULL;
-
-    netloc_dt_lookup_table_iterator_t hti_src = NULL;
-    netloc_dt_lookup_table_iterator_t hti_dst = NULL;
-    netloc_node_t *cur_src_node = NULL;
-    netloc_node_t *cur_dst_node = NULL;
 
     printf("Status: Computing Physical Paths\n");
 
-    /*
-     * Calculate the path from all sources to all destinations
-     */
-    src_idx = 0;
-    hti_src = netloc_dt_lookup_table_iterator_t_construct(dc_handle->node_list);
-    hti_dst = netloc_dt_lookup_table_iterator_t_construct(dc_handle->node_list);
-
-    netloc_lookup_table_iterator_reset(hti_src);
-    while( !netloc_lookup_table_iterator_at_end(hti_src) ) {
-        cur_src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
-        if( NULL == cur_src_node ) {
-            break;
-        }
-
-        // JJH: For now limit to just the "host" nodes
-        if( NETLOC_NODE_TYPE_HOST != cur_src_node->node_type ) {
-            src_idx++;
-            continue;
-        }
-
-#if 0
-        printf("\tSource:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-#endif
-        dst_idx = 0;
-        netloc_lookup_table_iterator_reset(hti_dst);
-        while( !netloc_lookup_table_iterator_at_end(hti_dst) ) {
-            cur_dst_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_dst);
-            if( NULL == cur_dst_node ) {
-                break;
-            }
-
-            // Skip path to self
-            if( src_idx == dst_idx ) {
-                dst_idx++;
-                continue;
-            }
-
-            // JJH: For now limit to just the "host" nodes
-            if( NETLOC_NODE_TYPE_HOST != cur_dst_node->node_type ) {
-                dst_idx++;
-                continue;
-            }
-
-#if 0
-            printf("Computing a path between the following two nodes\n");
-            printf("\tSource:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-            printf("\tDestination: %s\n", netloc_pretty_print_node_t(cur_dst_node));
-#endif
-            /*
-             * Calculate the path between these nodes
-             */
-            ret = netloc_dc_compute_path_between_nodes(dc_handle,
-                                                       cur_src_node,
-                                                       cur_dst_node,
-                                                       &num_edges,
-                                                       &edges,
-                                                       false);
-            if( NETLOC_SUCCESS != ret ) {
-                fprintf(stderr, "Error: Failed to compute a path between the following two nodes\n");
-                fprintf(stderr, "Error: Source:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-                fprintf(stderr, "Error: Destination: %s\n", netloc_pretty_print_node_t(cur_dst_node));
-                return ret;
-            }
-
-
-            /*
-             * Store that path in the data collection
-             */
-            ret = netloc_dc_append_path(dc_handle,
-                                        cur_src_node->physical_id,
-                                        cur_dst_node->physical_id,
-                                        num_edges,
-                                        edges,
-                                        false);
-            if( NETLOC_SUCCESS != ret ) {
-                fprintf(stderr, "Error: Could not append the physical path between the following two nodes\n");
-                fprintf(stderr, "Error: Source:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-                fprintf(stderr, "Error: Destination: %s\n", netloc_pretty_print_node_t(cur_dst_node));
-                return ret;
-            }
-
-            num_edges = 0;
-            free(edges);
-            edges = NULL;
-
-            dst_idx++;
-        }
-
-        src_idx++;
+    ret = netloc_dc_compute_all_host_paths(dc_handle, num_threads, false);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: Failed to compute the physical paths\n");
+        return ret;
     }
 
-    netloc_dt_lookup_table_iterator_t_destruct(hti_src);
-    netloc_dt_lookup_table_iterator_t_destruct(hti_dst);
-
     return NETLOC_SUCCESS;
 }
 
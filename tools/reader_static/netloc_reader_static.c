@@ -123,6 +123,8 @@ const char * ARG_INPUT            = "--input";
 const char * ARG_SHORT_INPUT      = "-i";
 const char * ARG_PROGRESS         = "--progress";
 const char * ARG_SHORT_PROGRESS   = "-p";
+const char * ARG_THREADS          = "--threads";
+const char * ARG_SHORT_THREADS    = "-t";
 const char * ARG_HELP             = "--help";
 const char * ARG_SHORT_HELP       = "-h";
 
@@ -176,6 +178,11 @@ static char * inputfile = NULL;
  */
 static bool progress = false;
 
+/*
+ * Number of threads used to compute the physical paths
+ */
+static int num_threads = 1;
+
 int main(int argc, char ** argv) {
     int ret, exit_status = NETLOC_SUCCESS;
     netloc_network_t *network = NULL;
@@ -185,13 +192,15 @@ int main(int argc, char ** argv) {
      * Parse Args
      */
     if( 0 != parse_args(argc, argv) ) {
-        printf("Usage: %s %s|%s <input_file> [%s|%s <output directory>] [%s|%s] [%s|%s]\n",
+        printf("Usage: %s %s|%s <input_file> [%s|%s <output directory>] [%s|%s] [%s|%s <number of threads>] [%s|%s]\n",
                argv[0],
                ARG_INPUT, ARG_SHORT_INPUT,
                ARG_OUTDIR, ARG_SHORT_OUTDIR,
                ARG_PROGRESS, ARG_SHORT_PROGRESS,
+               ARG_THREADS, ARG_SHORT_THREADS,
                ARG_HELP, ARG_SHORT_HELP);
         printf("       Default %-10s = current working directory\n", ARG_OUTDIR);
+        printf("       Default %-10s = 1\n", ARG_THREADS);
         return NETLOC_ERROR;
     }
 
@@ -307,6 +316,22 @@ static int parse_args(int argc, char ** argv) {
                  0 == strncmp(ARG_SHORT_PROGRESS, argv[i], strlen(ARG_SHORT_PROGRESS)) ) {
             progress = true;
         }
+        /*
+         * --threads
+         */
+        else if( 0 == strncmp(ARG_THREADS,       argv[i], strlen(ARG_THREADS)) ||
+                 0 == strncmp(ARG_SHORT_THREADS, argv[i], strlen(ARG_SHORT_THREADS)) ) {
+            ++i;
+            if( i >= argc ) {
+                fprintf(stderr, "Error: Must supply an argument to %s\n", ARG_THREADS );
+                return NETLOC_ERROR;
+            }
+            num_threads = atoi(argv[i]);
+            if( num_threads < 1 ) {
+                fprintf(stderr, "Error: %s must be at least 1 (given \"%s\")\n", ARG_THREADS, argv[i]);
+                return NETLOC_ERROR;
+            }
+        }
         /*
          * Help
          */
@@ -354,6 +379,7 @@ static int parse_args(int argc, char ** argv) {
      */
     printf("  Input file       : %s\n", inputfile);
     printf("  Output Directory : %s\n", outdir);
+    printf("  Threads          : %d\n", num_threads);
 
     return ret;
 }
@@ -806,112 +832,15 @@ static int convert_nodes_file(netloc_data_collection_handle_t *dc_handle) {
 static int compute_physical_paths(netloc_data_collection_handle_t *dc_handle)
 {
     int ret;
-    int src_idx, dst_idx;
-
-    int num_edges = 0;
-    netloc_edge_t **edges = NULL;
-
-    netloc_dt_lookup_table_iterator_t hti_src = NULL;
-    netloc_dt_lookup_table_iterator_t hti_dst = NULL;
-    netloc_node_t *cur_src_node = NULL;
-    netloc_node_t *cur_dst_node = NULL;
 
     printf("Status: Computing Physical Paths\n");
 
-    /*
-     * Calculate the path from all sources to all destinations
-     */
-    src_idx = 0;
-    hti_src = netloc_dt_lookup_table_iterator_t_construct(dc_handle->node_list);
-    hti_dst = netloc_dt_lookup_table_iterator_t_construct(dc_handle->node_list);
-
-    netloc_lookup_table_iterator_reset(hti_src);
-    while( !netloc_lookup_table_iterator_at_end(hti_src) ) {
-        cur_src_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_src);
-        if( NULL == cur_src_node ) {
-            break;
-        }
-
-        // JJH: For now limit to just the "host" nodes
-        if( NETLOC_NODE_TYPE_HOST != cur_src_node->node_type ) {
-            src_idx++;
-            continue;
-        }
-
-#if 0
-        printf("\tSource:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-#endif
-        dst_idx = 0;
-        netloc_lookup_table_iterator_reset(hti_dst);
-        while( !netloc_lookup_table_iterator_at_end(hti_dst) ) {
-            cur_dst_node = (netloc_node_t*)netloc_lookup_table_iterator_next_entry(hti_dst);
-            if( NULL == cur_dst_node ) {
-                break;
-            }
-
-            // Skip path to self
-            if( src_idx == dst_idx ) {
-                dst_idx++;
-                continue;
-            }
-
-            // JJH: For now limit to just the "host" nodes
-            if( NETLOC_NODE_TYPE_HOST != cur_dst_node->node_type ) {
-                dst_idx++;
-                continue;
-            }
-
-#if 0
-            printf("Computing a path between the following two nodes\n");
-            printf("\tSource:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-            printf("\tDestination: %s\n", netloc_pretty_print_node_t(cur_dst_node));
-#endif
-            /*
-             * Calculate the path between these nodes
-             */
-            ret = netloc_dc_compute_path_between_nodes(dc_handle,
-                                                       cur_src_node,
-                                                       cur_dst_node,
-                                                       &num_edges,
-                                                       &edges,
-                                                       false);
-            if( NETLOC_SUCCESS != ret ) {
-                fprintf(stderr, "Error: Failed to compute a path between the following two nodes\n");
-                fprintf(stderr, "Error: Source:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-                fprintf(stderr, "Error: Destination: %s\n", netloc_pretty_print_node_t(cur_dst_node));
-                return ret;
-            }
-
-
-            /*
-             * Store that path in the data collection
-             */
-            ret = netloc_dc_append_path(dc_handle,
-                                        cur_src_node->physical_id,
-                                        cur_dst_node->physical_id,
-                                        num_edges,
-                                        edges,
-                                        false);
-            if( NETLOC_SUCCESS != ret ) {
-                fprintf(stderr, "Error: Could not append the physical path between the following two nodes\n");
-                fprintf(stderr, "Error: Source:      %s\n", netloc_pretty_print_node_t(cur_src_node));
-                fprintf(stderr, "Error: Destination: %s\n", netloc_pretty_print_node_t(cur_dst_node));
-                return ret;
-            }
-
-            num_edges = 0;
-            free(edges);
-            edges = NULL;
-
-            dst_idx++;
-        }
-
-        src_idx++;
+    ret = netloc_dc_compute_all_host_paths(dc_handle, num_threads, progress);
+    if( NETLOC_SUCCESS != ret ) {
+        fprintf(stderr, "Error: Failed to compute the physical paths\n");
+        return ret;
     }
 
-    netloc_dt_lookup_table_iterator_t_destruct(hti_src);
-    netloc_dt_lookup_table_iterator_t_destruct(hti_dst);
-
     return NETLOC_SUCCESS;
 }
 